@@ -19,7 +19,7 @@ bool PtSceneFurnace::create()
 
     auto &instanceModels = vengine::AssetManager::getInstance().modelsMap();
     auto sphere = instanceModels.get("assets/models/uvsphere.obj");
-    so->add<vengine::ComponentMesh>().setMesh(sphere->mesh("defaultobject"));
+    so->add<vengine::ComponentMesh>().setMesh(sphere->mesh("defaultobject"), sphere);
 
     auto material = engine().materials().createMaterial<vengine::MaterialLambert>(vengine::AssetInfo("material"));
     material->albedo() = glm::vec4(0.6, 0.6, 0.6, 1);
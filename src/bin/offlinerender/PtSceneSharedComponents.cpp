@@ -34,7 +34,7 @@ bool PtSceneSharedComponents::create()
             so->add_shared<vengine::ComponentMaterial>(materialComponent);
         }
     }
-    meshComponent->setMesh(cube->mesh("Cube"));
+    meshComponent->setMesh(cube->mesh("Cube"), cube);
     materialComponent->setMaterial(matDef);
 
     {
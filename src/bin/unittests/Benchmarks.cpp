@@ -0,0 +1,286 @@
+#include "Benchmarks.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "vengine/core/MeshKernels.hpp"
+#include "vengine/math/BVH.hpp"
+#include "vengine/utils/RadixSort.hpp"
+
+/* The benchmarks are disabled so that they don't slow down every test run, run them with
+ * unittests --gtest_also_run_disabled_tests --gtest_filter=BenchmarkTest.* */
+
+TEST_F(BenchmarkTest, DISABLED_ThreadPoolScaling)
+{
+    /* A tree of tasks with some arithmetic per task, run with 1 to N workers */
+    class WorkTask : public Task
+    {
+    public:
+        WorkTask(uint32_t depth, uint32_t width, ThreadPool &tp, WorkTask *parent = nullptr)
+            : Task(parent)
+            , mDepth(depth)
+            , mWidth(width)
+            , mTp(tp)
+        {
+        }
+
+        bool work(float &progress) override
+        {
+            float v = 0.F;
+            for (uint32_t i = 0; i < 20000; i++) {
+                v += std::sqrt(static_cast<float>(i));
+            }
+            mResult = v;
+
+            if (mDepth > 1) {
+                mChildren.reserve(mWidth);
+                for (uint32_t i = 0; i < mWidth; i++) {
+                    mChildren.emplace_back(mDepth - 1, mWidth, mTp, this);
+                }
+                for (auto &c : mChildren) {
+                    mTp.push(&c);
+                }
+            }
+            return true;
+        }
+
+        float mResult = 0.F;
+        uint32_t mDepth;
+        uint32_t mWidth;
+        ThreadPool &mTp;
+        std::vector<WorkTask> mChildren;
+    };
+
+    uint32_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (uint32_t threads : threadCounts) {
+        ThreadPool tp;
+        tp.init(threads);
+
+        double ms = measure([&]() {
+            WorkTask root(4, 20, tp);
+            tp.push(&root)->wait();
+        });
+        report("ThreadPool task tree, " + std::to_string(threads) + " threads", ms);
+    }
+}
+
+TEST_F(BenchmarkTest, DISABLED_BVH)
+{
+    ThreadPool tp;
+    tp.init(std::max(1U, std::thread::hardware_concurrency()));
+
+    std::srand(5);
+    auto random = [](float min, float max) { return min + (max - min) * static_cast<float>(std::rand()) / RAND_MAX; };
+
+    for (uint32_t n : {10000U, 100000U, 1000000U}) {
+        /* Boxes in a volume that grows with the number of boxes, so the density stays the same */
+        float extent = 10.0F * std::cbrt(static_cast<float>(n));
+        std::vector<BVH::ItemID> items(n);
+        std::vector<AABB3> bounds(n);
+        for (uint32_t i = 0; i < n; i++) {
+            items[i] = i;
+            glm::vec3 center(random(-extent, extent), random(-extent, extent), random(-extent, extent));
+            bounds[i] = AABB3::fromCenterAndLength(center, glm::vec3(random(0.5F, 4), random(0.5F, 4), random(0.5F, 4)));
+        }
+        std::string suffix = ", " + std::to_string(n) + " objects";
+
+        BVH bvh;
+        report("BVH build" + suffix, measure([&]() { bvh.build(items, bounds, tp); }));
+
+        /* Move 1% of the objects one at a time, then all of them with one refit */
+        uint32_t nMoved = n / 100;
+        report("BVH update 1%" + suffix, measure([&]() {
+                   for (uint32_t i = 0; i < nMoved; i++) {
+                       uint32_t item = (i * 97) % n;
+                       bounds[item].translate(glm::vec3(0.1F, 0, 0));
+                       bvh.update(item, bounds[item]);
+                   }
+               }));
+        report("BVH refit" + suffix, measure([&]() {
+                   for (uint32_t i = 0; i < n; i++) {
+                       bounds[i].translate(glm::vec3(0, 0.1F, 0));
+                       bvh.setBounds(i, bounds[i]);
+                   }
+                   bvh.refit();
+               }));
+
+        /* Remove and insert 1% of the objects */
+        report("BVH remove and insert 1%" + suffix, measure([&]() {
+                   for (uint32_t i = 0; i < nMoved; i++) {
+                       bvh.remove((i * 97) % n);
+                   }
+                   for (uint32_t i = 0; i < nMoved; i++) {
+                       bvh.insert((i * 97) % n, bounds[(i * 97) % n]);
+                   }
+               }));
+
+        /* 1000 queries of each kind */
+        std::vector<glm::vec3> points(1000);
+        for (glm::vec3 &p : points) {
+            p = glm::vec3(random(-extent, extent), random(-extent, extent), random(-extent, extent));
+        }
+        uint32_t hits = 0;
+        report("BVH 1000 box queries" + suffix, measure([&]() {
+                   for (const glm::vec3 &p : points) {
+                       bvh.queryBox(AABB3::fromCenterAndLength(p, glm::vec3(20)), [&](BVH::ItemID) { hits++; });
+                   }
+               }));
+        report("BVH 1000 sphere queries" + suffix, measure([&]() {
+                   for (const glm::vec3 &p : points) {
+                       bvh.querySphere(p, 10, [&](BVH::ItemID) { hits++; });
+                   }
+               }));
+        report("BVH 1000 frustum queries" + suffix, measure([&]() {
+                   for (const glm::vec3 &p : points) {
+                       glm::mat4 view = glm::lookAt(p, glm::vec3(0), glm::vec3(0, 1, 0));
+                       glm::mat4 projection = glm::perspective(glm::radians(60.0F), 1.5F, 0.1F, 50.0F);
+                       bvh.queryFrustum(Frustum::fromMatrix(projection * view), [&](BVH::ItemID) { hits++; });
+                   }
+               }));
+        report("BVH 1000 closest hit rays" + suffix, measure([&]() {
+                   for (const glm::vec3 &p : points) {
+                       Ray ray(p, -p);
+                       float t;
+                       bvh.intersectRay(
+                           ray,
+                           1.0F,
+                           [&](BVH::ItemID item, float &tItem) {
+                               /* Hit the box of the item, closer than the closest hit so far, like a pick does */
+                               float tEnter = 0.0F, tExit = tItem;
+                               for (int axis = 0; axis < 3; axis++) {
+                                   float t0 = (bounds[item].min()[axis] - ray.origin[axis]) / ray.direction[axis];
+                                   float t1 = (bounds[item].max()[axis] - ray.origin[axis]) / ray.direction[axis];
+                                   tEnter = std::max(tEnter, std::min(t0, t1));
+                                   tExit = std::min(tExit, std::max(t0, t1));
+                               }
+                               if (tEnter > tExit)
+                                   return false;
+                               tItem = tEnter;
+                               hits++;
+                               return true;
+                           },
+                           t);
+                   }
+               }));
+        EXPECT_GT(hits, 0);
+    }
+}
+
+TEST_F(BenchmarkTest, DISABLED_RadixSort)
+{
+    ThreadPool tp;
+    tp.init(std::max(1U, std::thread::hardware_concurrency()));
+
+    std::srand(7);
+    RadixSorter<uint32_t> sorter;
+    for (uint32_t n : {10000U, 100000U, 1000000U}) {
+        std::vector<uint32_t> keys(n), values(n);
+        for (uint32_t i = 0; i < n; i++) {
+            keys[i] = (static_cast<uint32_t>(std::rand()) << 16) ^ static_cast<uint32_t>(std::rand());
+            values[i] = i;
+        }
+        std::string suffix = ", " + std::to_string(n) + " keys";
+
+        /* Every repetition sorts the same unsorted keys */
+        std::vector<uint32_t> sortKeys, sortValues;
+        report("std::sort" + suffix, measure([&]() {
+                   sortValues = values;
+                   std::sort(sortValues.begin(), sortValues.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+               }));
+        report("Radix sort" + suffix, measure([&]() {
+                   sortKeys = keys;
+                   sortValues = values;
+                   sorter.sort(sortKeys, sortValues, tp);
+               }));
+        EXPECT_TRUE(std::is_sorted(sortKeys.begin(), sortKeys.end()));
+    }
+}
+
+TEST_F(BenchmarkTest, DISABLED_MeshKernels)
+{
+    ThreadPool tp;
+    tp.init(std::max(1U, std::thread::hardware_concurrency()));
+
+    for (uint32_t n : {1024U, 2048U}) {
+        /* A grid of n x n vertices */
+        std::vector<Vertex> vertices(static_cast<size_t>(n) * n);
+        for (uint32_t j = 0; j < n; j++) {
+            for (uint32_t i = 0; i < n; i++) {
+                Vertex &vertex = vertices[static_cast<size_t>(j) * n + i];
+                vertex.position = glm::vec3(i, j, std::sin(0.01F * static_cast<float>(i * j)));
+                vertex.uv = glm::vec2(i, j) / static_cast<float>(n);
+            }
+        }
+        std::vector<uint32_t> indices;
+        indices.reserve(6 * static_cast<size_t>(n - 1) * (n - 1));
+        for (uint32_t j = 0; j + 1 < n; j++) {
+            for (uint32_t i = 0; i + 1 < n; i++) {
+                uint32_t k = j * n + i;
+                indices.insert(indices.end(), {k, k + 1, k + n + 1, k, k + n + 1, k + n});
+            }
+        }
+        std::string suffix = ", " + std::to_string(vertices.size()) + " vertices";
+
+        /* The scalar loops the kernels replaced */
+        report("Scalar bounds" + suffix, measure([&]() {
+                   AABB3 aabb = AABB3::fromPoint(vertices[0].position);
+                   for (const Vertex &vertex : vertices) {
+                       aabb.add(vertex.position);
+                   }
+                   EXPECT_LE(aabb.min().x, aabb.max().x);
+               }));
+        report("Kernel bounds" + suffix, measure([&]() { computeBounds(vertices); }));
+        report("Kernel bounds, thread pool" + suffix, measure([&]() { computeBounds(vertices, &tp); }));
+
+        report("Scalar normals" + suffix, measure([&]() {
+                   for (Vertex &vertex : vertices) {
+                       vertex.normal = glm::vec3(0);
+                   }
+                   for (size_t i = 0; i < indices.size(); i += 3) {
+                       Vertex &v1 = vertices[indices[i]];
+                       Vertex &v2 = vertices[indices[i + 1]];
+                       Vertex &v3 = vertices[indices[i + 2]];
+                       glm::vec3 normal = glm::cross(v2.position - v1.position, v3.position - v1.position);
+                       v1.normal += normal;
+                       v2.normal += normal;
+                       v3.normal += normal;
+                   }
+                   for (Vertex &vertex : vertices) {
+                       vertex.normal = glm::normalize(vertex.normal);
+                   }
+               }));
+        report("Kernel normals" + suffix, measure([&]() { computeVertexNormals(vertices, indices); }));
+        report("Kernel normals, thread pool" + suffix, measure([&]() { computeVertexNormals(vertices, indices, &tp); }));
+
+        report("Kernel tangents" + suffix, measure([&]() { computeVertexTangents(vertices, indices); }));
+        report("Kernel tangents, thread pool" + suffix, measure([&]() { computeVertexTangents(vertices, indices, &tp); }));
+
+        /* Normalization and the validity checks of the import */
+        report("Scalar normalize and check" + suffix, measure([&]() {
+                   uint32_t invalid = 0;
+                   for (Vertex &vertex : vertices) {
+                       vertex.tangent = glm::normalize(vertex.tangent);
+                       invalid += std::isnan(vertex.tangent.x) || std::isinf(vertex.tangent.x) || std::isnan(vertex.tangent.y) ||
+                                  std::isinf(vertex.tangent.y) || std::isnan(vertex.tangent.z) || std::isinf(vertex.tangent.z);
+                   }
+                   EXPECT_EQ(invalid, 0U);
+               }));
+        report("Kernel normalize and check" + suffix, measure([&]() {
+                   EXPECT_EQ(normalizeVectors(vertices, &Vertex::tangent), 0U);
+               }));
+        report("Kernel normalize and check, thread pool" + suffix, measure([&]() {
+                   EXPECT_EQ(normalizeVectors(vertices, &Vertex::tangent, &tp), 0U);
+               }));
+    }
+}
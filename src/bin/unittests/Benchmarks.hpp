@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "vengine/utils/ThreadPool.hpp"
+using namespace vengine;
+
+class BenchmarkTest : public testing::Test
+{
+protected:
+    // Per-test-suite set-up.
+    // Called before the first test in this test suite.
+    // Can be omitted if not needed.
+    static void SetUpTestSuite() {}
+
+    // Per-test-suite tear-down.
+    // Called after the last test in this test suite.
+    // Can be omitted if not needed.
+    static void TearDownTestSuite() {}
+
+    // You can define per-test set-up logic as usual.
+    void SetUp() override {}
+
+    // You can define per-test tear-down logic as usual.
+    void TearDown() override {}
+
+    /* Run f a number of times and return the best time in milliseconds */
+    static double measure(std::function<void()> f, uint32_t repetitions = 3)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t r = 0; r < repetitions; r++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            f();
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+
+    static void report(const std::string &name, double ms)
+    {
+        std::cout << "[ BENCHMARK] " << name << ": " << std::to_string(ms) << " ms" << std::endl;
+    }
+};
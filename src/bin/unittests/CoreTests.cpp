@@ -1,8 +1,38 @@
 #include "CoreTests.hpp"
 
 #include <thread>
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "vengine/utils/ThreadPool.hpp"
+#include "vengine/utils/Parallel.hpp"
+#include "vengine/utils/TaskGraph.hpp"
+#include "vengine/utils/PagedPool.hpp"
+#include "vengine/utils/RadixSort.hpp"
+#include "vengine/math/TransformHierarchy.hpp"
+#include "vengine/math/BVH.hpp"
+#include "vengine/math/MathUtils.hpp"
+#include "vengine/core/FrameGraph.hpp"
+#include "vengine/core/SceneNode.hpp"
+#include "vengine/core/Mesh.hpp"
+#include "vengine/core/MeshKernels.hpp"
+#include "vengine/core/MeshOptimization.hpp"
+#include "vengine/core/MeshRegistry.hpp"
+#include "vengine/core/MeshSimplification.hpp"
+#include "vengine/vulkan/common/VulkanUtils.hpp"
+#include "vengine/vulkan/renderers/VulkanRendererCulling.hpp"
 
 TEST_F(CoreTest, ThreadPool1)
 {
@@ -117,4 +147,2068 @@ TEST_F(CoreTest, ThreadPool3)
     Waitable *w = tp.push(&dt);
     w->wait();
     dt.validate();
-}
\ No newline at end of file
+}
+TEST_F(CoreTest, ThreadPoolWaitInsideTask)
+{
+    /* A single worker waits on a task it pushed itself, the wait has to run the child instead of blocking */
+    vengine::ThreadPool tp;
+    tp.init(1);
+
+    class ChildTask : public Task
+    {
+    public:
+        bool work(float &progress) override
+        {
+            val++;
+            return true;
+        }
+
+        uint32_t val = 0;
+    };
+
+    class ParentTask : public Task
+    {
+    public:
+        ParentTask(ThreadPool &tp)
+            : mTp(tp)
+        {
+        }
+
+        bool work(float &progress) override
+        {
+            mTp.push(&mChild)->wait();
+            return mChild.val == 1;
+        }
+
+        ThreadPool &mTp;
+        ChildTask mChild;
+    };
+
+    ParentTask pt(tp);
+    Waitable *w = tp.push(&pt);
+    w->wait();
+
+    EXPECT_TRUE(pt.isSuccess());
+    EXPECT_EQ(pt.mChild.val, 1);
+}
+
+TEST_F(CoreTest, ThreadPoolContinuation)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    class DummyTask : public Task
+    {
+    public:
+        DummyTask(Task *parent = nullptr)
+            : Task(parent)
+        {
+        }
+
+        bool work(float &progress) override
+        {
+            val++;
+            return true;
+        }
+
+        uint32_t val = 0;
+    };
+
+    class ParentTask : public Task
+    {
+    public:
+        ParentTask(ThreadPool &tp)
+            : mTp(tp)
+        {
+            mChildren.reserve(1000);
+            for (uint32_t i = 0; i < 1000; i++) {
+                mChildren.emplace_back(this);
+            }
+        }
+
+        bool work(float &progress) override
+        {
+            for (auto &c : mChildren) {
+                mTp.push(&c);
+            }
+            return true;
+        }
+
+        ThreadPool &mTp;
+        std::vector<DummyTask> mChildren;
+    };
+
+    class SumTask : public Task
+    {
+    public:
+        SumTask(ParentTask &parent)
+            : mParent(parent)
+        {
+        }
+
+        bool work(float &progress) override
+        {
+            for (auto &c : mParent.mChildren) {
+                sum += c.val;
+            }
+            return true;
+        }
+
+        ParentTask &mParent;
+        uint32_t sum = 0;
+    };
+
+    /* The continuation runs only after the parent and all its children have finished */
+    ParentTask pt(tp);
+    SumTask st(pt);
+    pt.then(&st);
+    tp.push(&pt);
+    st.wait();
+    EXPECT_EQ(st.sum, 1000);
+
+    /* A continuation on a ready waitable is scheduled immediately */
+    DummyTask dt1, dt2;
+    tp.push(&dt1)->wait();
+    dt1.then(&dt2)->wait();
+    EXPECT_EQ(dt2.val, 1);
+}
+
+TEST_F(CoreTest, ParallelFor)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    /* Every index is visited exactly once */
+    std::vector<uint32_t> visited(100000, 0);
+    vengine::parallelFor(tp, 0, static_cast<uint32_t>(visited.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            visited[i]++;
+        }
+    });
+    EXPECT_EQ(static_cast<size_t>(std::count(visited.begin(), visited.end(), 1)), visited.size());
+
+    /* Nested calls from inside a chunk */
+    std::vector<std::vector<uint32_t>> nested(64, std::vector<uint32_t>(1000, 0));
+    vengine::parallelFor(tp, 0, static_cast<uint32_t>(nested.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            vengine::parallelFor(tp, 0, static_cast<uint32_t>(nested[i].size()), 1, [&](uint32_t b, uint32_t e) {
+                for (uint32_t j = b; j < e; j++) {
+                    nested[i][j] = i;
+                }
+            });
+        }
+    });
+    for (uint32_t i = 0; i < nested.size(); i++) {
+        EXPECT_EQ(static_cast<size_t>(std::count(nested[i].begin(), nested[i].end(), i)), nested[i].size());
+    }
+
+    /* Empty ranges and an uninitialized pool */
+    uint32_t calls = 0;
+    vengine::parallelFor(tp, 10, 10, 1, [&](uint32_t begin, uint32_t end) { calls++; });
+    EXPECT_EQ(calls, 0U);
+
+    vengine::ThreadPool tpEmpty;
+    vengine::parallelFor(tpEmpty, 0, 1000, 1, [&](uint32_t begin, uint32_t end) { calls += end - begin; });
+    EXPECT_EQ(calls, 1000U);
+}
+
+TEST_F(CoreTest, ParallelReduce)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    auto sumRange = [](uint32_t begin, uint32_t end) {
+        uint64_t sum = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            sum += i;
+        }
+        return sum;
+    };
+    auto add = [](const uint64_t &a, const uint64_t &b) { return a + b; };
+
+    uint64_t sum = vengine::parallelReduce(tp, 0, 1000000, 1, uint64_t(0), sumRange, add);
+    EXPECT_EQ(sum, uint64_t(999999) * 1000000 / 2);
+
+    uint64_t empty = vengine::parallelReduce(tp, 5, 5, 1, uint64_t(42), sumRange, add);
+    EXPECT_EQ(empty, uint64_t(42));
+}
+
+TEST_F(CoreTest, TaskGraph)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    /* A diamond: a -> (b, c) -> d, plus an independent job e */
+    std::atomic<uint32_t> order = 0;
+    uint32_t a, b, c, d, e;
+
+    vengine::TaskGraph graph;
+    auto ja = graph.addJob("a", [&]() { a = order++; });
+    auto jb = graph.addJob("b", [&]() { b = order++; }, {ja});
+    auto jc = graph.addJob("c", [&]() { c = order++; }, {ja});
+    auto jd = graph.addJob("d", [&]() { d = order++; }, {jb, jc});
+    graph.addJob("e", [&]() { e = order++; });
+    EXPECT_EQ(graph.size(), 5);
+
+    /* The same graph can be executed many times */
+    for (uint32_t i = 0; i < 100; i++) {
+        order = 0;
+        graph.execute(tp);
+        graph.wait();
+
+        EXPECT_EQ(order, 5);
+        EXPECT_TRUE(a < b && a < c);
+        EXPECT_TRUE(b < d && c < d);
+        /* Every job ran once, e anywhere among the others */
+        EXPECT_EQ((std::set<uint32_t>{a, b, c, d, e}), (std::set<uint32_t>{0, 1, 2, 3, 4}));
+    }
+
+    /* The tasks are reused between executions, and created again when a job is added */
+    uint32_t f;
+    graph.addJob("f", [&]() { f = order++; }, {jd});
+    for (uint32_t i = 0; i < 10; i++) {
+        order = 0;
+        graph.execute(tp);
+        graph.wait();
+
+        EXPECT_EQ(order, 6);
+        EXPECT_TRUE(d < f);
+    }
+}
+
+TEST_F(CoreTest, FrameGraphOrdering)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    /* The engine frame graph, with jobs that record the order they run in. The sort reorders the transparent objects that
+     * the scene buffers job reads, so the buffers job has to see them sorted */
+    std::vector<uint32_t> transparent(1000);
+    std::atomic<uint32_t> order = 0;
+    std::array<uint32_t, 13> at;
+    bool sorted = false;
+    auto record = [&](uint32_t job) { return [&, job]() { at[job] = order++; }; };
+
+    vengine::FrameJobs jobs;
+    jobs.submitFrame = record(0);
+    jobs.updateSceneGraph = record(1);
+    jobs.updateInstances = record(2);
+    jobs.updateLightInstances = record(3);
+    jobs.sortTransparent = [&]() {
+        std::sort(transparent.begin(), transparent.end());
+        at[4] = order++;
+    };
+    jobs.cullInstances = record(5);
+    jobs.beginFrame = record(6);
+    jobs.updateSceneBuffers = [&]() {
+        sorted = std::is_sorted(transparent.begin(), transparent.end());
+        at[7] = order++;
+    };
+    jobs.updateMaterialBuffers = record(8);
+    jobs.updateTextures = record(9);
+    jobs.recordDeferredPass = record(10);
+    jobs.recordOverlayPass = record(11);
+    jobs.recordOutputPass = record(12);
+
+    vengine::TaskGraph graph;
+    vengine::FrameGraphJobs ids = vengine::buildFrameGraph(graph, jobs);
+    EXPECT_EQ(graph.size(), at.size());
+
+    EXPECT_TRUE(graph.dependsOn(ids.sceneBuffers, ids.transparentSort));
+    EXPECT_TRUE(graph.dependsOn(ids.sceneBuffers, ids.sceneGraph));
+    EXPECT_TRUE(graph.dependsOn(ids.culling, ids.instances));
+    EXPECT_TRUE(graph.dependsOn(ids.recordDeferredPass, ids.textures));
+    EXPECT_TRUE(graph.dependsOn(ids.recordOverlayPass, ids.culling));
+    EXPECT_TRUE(graph.dependsOn(ids.recordOutputPass, ids.submitFrame));
+    EXPECT_FALSE(graph.dependsOn(ids.lightInstances, ids.transparentSort));
+    EXPECT_FALSE(graph.dependsOn(ids.transparentSort, ids.lightInstances));
+    EXPECT_FALSE(graph.dependsOn(ids.beginFrame, ids.sceneGraph));
+    EXPECT_FALSE(graph.dependsOn(ids.sceneGraph, ids.submitFrame));
+    EXPECT_FALSE(graph.dependsOn(ids.sceneGraph, ids.sceneBuffers));
+    EXPECT_FALSE(graph.dependsOn(ids.recordOutputPass, ids.sceneBuffers));
+
+    for (uint32_t i = 0; i < 100; i++) {
+        for (uint32_t j = 0; j < transparent.size(); j++) {
+            transparent[j] = (j * 7919 + i) % 1000;
+        }
+        order = 0;
+        graph.execute(tp);
+        graph.wait();
+
+        EXPECT_EQ(order, at.size());
+        EXPECT_TRUE(sorted);
+        /* Every job runs after the jobs it depends on */
+        for (uint32_t job = 0; job < graph.size(); job++) {
+            for (uint32_t dependency = 0; dependency < job; dependency++) {
+                if (graph.dependsOn(job, dependency)) {
+                    EXPECT_LT(at[dependency], at[job]);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(CoreTest, ThreadPoolStatistics)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    class DummyTask : public Task
+    {
+    public:
+        bool work(float &progress) override
+        {
+            val++;
+            return true;
+        }
+
+        uint32_t val = 0;
+    };
+
+    std::vector<DummyTask> tasks(1000);
+    for (auto &t : tasks) {
+        tp.push(&t);
+    }
+    for (auto &t : tasks) {
+        t.wait();
+    }
+
+    /* One entry per worker and one for the waiting thread */
+    vengine::ThreadPoolStatistics statistics = tp.statistics();
+    EXPECT_EQ(statistics.workers.size(), 5);
+
+    vengine::ThreadPoolWorkerStatistics total = statistics.total();
+    EXPECT_EQ(total.tasksExecuted, 1000);
+    EXPECT_GE(total.maxQueueDepth, 1);
+
+    uint64_t histogramTotal = 0;
+    for (uint64_t count : total.latencyHistogram) {
+        histogramTotal += count;
+    }
+    EXPECT_EQ(histogramTotal, 1000);
+
+    std::string json = statistics.toJSON();
+    EXPECT_NE(json.find("\"workers\""), std::string::npos);
+
+    tp.resetStatistics();
+    EXPECT_EQ(tp.statistics().total().tasksExecuted, 0);
+}
+
+TEST_F(CoreTest, ECSComponents)
+{
+    static_assert(vengine::componentIndex<vengine::ComponentMesh>() != vengine::componentIndex<vengine::ComponentMaterial>());
+
+    vengine::Entity entity;
+    EXPECT_EQ(entity.signature(), 0);
+    EXPECT_FALSE(entity.has<vengine::ComponentMesh>());
+    EXPECT_THROW(entity.get<vengine::ComponentMesh>(), std::runtime_error);
+
+    entity.add<vengine::ComponentMesh>();
+    entity.add<vengine::ComponentLight>();
+    EXPECT_TRUE(entity.has<vengine::ComponentMesh>());
+    EXPECT_TRUE(entity.has<vengine::ComponentLight>());
+    EXPECT_FALSE(entity.has<vengine::ComponentMaterial>());
+    EXPECT_EQ(entity.signature(), (vengine::componentMask<vengine::ComponentMesh, vengine::ComponentLight>()));
+    EXPECT_EQ(entity.get<vengine::ComponentMesh>().owner()->isShared(), false);
+
+    entity.remove<vengine::ComponentMesh>();
+    EXPECT_FALSE(entity.has<vengine::ComponentMesh>());
+    EXPECT_EQ(entity.signature(), vengine::componentMask<vengine::ComponentLight>());
+}
+
+TEST_F(CoreTest, ECSView)
+{
+    vengine::ComponentManager &cm = vengine::ComponentManager::getInstance();
+
+    /* The component storage is global, other tests may have left entities in it */
+    uint32_t nMeshes = cm.buffer<vengine::ComponentMesh>()->entitiesSize();
+    uint32_t nMaterials = cm.buffer<vengine::ComponentMaterial>()->entitiesSize();
+    std::set<vengine::Entity *> meshesBefore;
+    for (auto [entity, mesh] : cm.view<vengine::ComponentMesh>()) {
+        meshesBefore.insert(entity);
+    }
+    std::set<vengine::Entity *> bothBefore;
+    for (auto [entity, mesh, material] : cm.view<vengine::ComponentMesh, vengine::ComponentMaterial>()) {
+        bothBefore.insert(entity);
+    }
+
+    std::vector<std::unique_ptr<vengine::Entity>> entities(100);
+    for (uint32_t i = 0; i < entities.size(); i++) {
+        entities[i] = std::make_unique<vengine::Entity>();
+        entities[i]->add<vengine::ComponentMesh>();
+        if (i % 2 == 0) {
+            entities[i]->add<vengine::ComponentMaterial>();
+        }
+    }
+
+    /* Remove from the middle of the packed arrays */
+    for (uint32_t i = 0; i < entities.size(); i += 4) {
+        entities[i]->remove<vengine::ComponentMesh>();
+    }
+
+    /* Every entity with the components is visited once, the ones from before and exactly the expected new ones */
+    std::set<vengine::Entity *> expectedMeshes = meshesBefore, expectedBoth = bothBefore;
+    for (uint32_t i = 0; i < entities.size(); i++) {
+        if (i % 4 != 0) {
+            expectedMeshes.insert(entities[i].get());
+            if (i % 2 == 0) {
+                expectedBoth.insert(entities[i].get());
+            }
+        }
+    }
+
+    std::set<vengine::Entity *> visited;
+    for (auto [entity, mesh, material] : cm.view<vengine::ComponentMesh, vengine::ComponentMaterial>()) {
+        EXPECT_EQ(&mesh, &entity->get<vengine::ComponentMesh>());
+        EXPECT_EQ(&material, &entity->get<vengine::ComponentMaterial>());
+        EXPECT_TRUE(visited.insert(entity).second);
+    }
+    EXPECT_EQ(visited, expectedBoth);
+    EXPECT_EQ(visited.size(), bothBefore.size() + 25);
+
+    visited.clear();
+    for (auto [entity, mesh] : cm.view<vengine::ComponentMesh>()) {
+        EXPECT_EQ(&mesh, &entity->get<vengine::ComponentMesh>());
+        EXPECT_TRUE(visited.insert(entity).second);
+    }
+    EXPECT_EQ(visited, expectedMeshes);
+    EXPECT_EQ(visited.size(), meshesBefore.size() + 75);
+    EXPECT_EQ(cm.buffer<vengine::ComponentMesh>()->entitiesSize(), nMeshes + 75);
+    EXPECT_EQ(cm.buffer<vengine::ComponentMaterial>()->entitiesSize(), nMaterials + 50);
+
+    /* Destroying the entities removes their components */
+    entities.clear();
+    EXPECT_EQ(cm.buffer<vengine::ComponentMesh>()->entitiesSize(), nMeshes);
+    EXPECT_EQ(cm.buffer<vengine::ComponentMaterial>()->entitiesSize(), nMaterials);
+}
+
+TEST_F(CoreTest, PagedPool)
+{
+    vengine::PagedPool<uint64_t> pool(64);
+    EXPECT_EQ(pool.occupancy().pages, 0);
+
+    pool.reserve(100);
+    EXPECT_EQ(pool.occupancy().pages, 2);
+    EXPECT_EQ(pool.size(), 0);
+
+    std::vector<uint64_t *> objects;
+    for (uint32_t i = 0; i < 1000; i++) {
+        uint64_t *object = pool.get();
+        *object = i;
+        objects.push_back(object);
+    }
+    EXPECT_EQ(pool.size(), 1000);
+    EXPECT_EQ(pool.occupancy().pages, 16);
+    EXPECT_EQ(pool.occupancy().capacity, 1024);
+
+    /* Growing doesn't move existing objects */
+    for (uint32_t i = 0; i < objects.size(); i++) {
+        EXPECT_EQ(*objects[i], i);
+    }
+
+    /* Pages are released when they become empty, but one empty page is kept */
+    for (uint32_t i = 0; i < 500; i++) {
+        pool.remove(objects[i]);
+    }
+    EXPECT_EQ(pool.size(), 500);
+    EXPECT_EQ(pool.occupancy().pages, 10);
+
+    /* Free slots are reused before new pages are allocated */
+    uint32_t pages = pool.occupancy().pages;
+    uint32_t freeSlots = pool.occupancy().capacity - pool.size();
+    for (uint32_t i = 0; i < freeSlots; i++) {
+        pool.get();
+    }
+    EXPECT_EQ(pool.occupancy().pages, pages);
+
+    pool.reset();
+    EXPECT_EQ(pool.size(), 0);
+    EXPECT_EQ(pool.occupancy().bytes, 0);
+
+    /* Adding and removing an object at a page boundary doesn't allocate and release a page every time */
+    objects.clear();
+    for (uint32_t i = 0; i < 128; i++) {
+        objects.push_back(pool.get());
+    }
+    EXPECT_EQ(pool.occupancy().pages, 2);
+    for (uint32_t i = 0; i < 100; i++) {
+        uint64_t *object = pool.get();
+        EXPECT_EQ(pool.occupancy().pages, 3);
+        pool.remove(object);
+        EXPECT_EQ(pool.occupancy().pages, 3);
+    }
+
+    /* Only one empty page is kept, objects in the other pages are still valid */
+    for (uint32_t i = 0; i < 128; i++) {
+        *objects[i] = i;
+    }
+    for (uint32_t i = 0; i < 64; i++) {
+        pool.remove(objects[i]);
+    }
+    EXPECT_EQ(pool.occupancy().pages, 2);
+    for (uint32_t i = 64; i < 128; i++) {
+        EXPECT_EQ(*objects[i], i);
+    }
+}
+
+TEST_F(CoreTest, TransformHierarchy)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    vengine::TransformHierarchy hierarchy;
+    typedef vengine::TransformHierarchy::Handle Handle;
+
+    /* A random tree, every node has a parent added before it */
+    std::srand(7);
+    auto random = [](float min, float max) { return min + (max - min) * static_cast<float>(std::rand()) / RAND_MAX; };
+    auto randomTransform = [&]() {
+        return vengine::Transform(glm::vec3(random(-5, 5), random(-5, 5), random(-5, 5)),
+                                  glm::vec3(random(0.5, 2), random(0.5, 2), random(0.5, 2)),
+                                  glm::vec3(random(-3, 3), random(-3, 3), random(-3, 3)));
+    };
+
+    std::vector<Handle> handles;
+    std::vector<int32_t> parents;
+    std::vector<vengine::Transform> transforms;
+    for (uint32_t i = 0; i < 5000; i++) {
+        transforms.push_back(randomTransform());
+        handles.push_back(hierarchy.add(transforms.back()));
+        parents.push_back(i < 10 ? -1 : static_cast<int32_t>(std::rand() % i));
+        if (parents.back() >= 0) {
+            hierarchy.setParent(handles.back(), handles[parents.back()]);
+        }
+    }
+
+    auto expectWorldMatrices = [&]() {
+        std::vector<glm::mat4> reference(handles.size());
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            glm::mat4 local = transforms[i].getModelMatrix();
+            reference[i] = (parents[i] >= 0 ? reference[parents[i]] * local : local);
+
+            const glm::mat4 &world = hierarchy.worldMatrix(handles[i]);
+            for (uint32_t c = 0; c < 4; c++) {
+                for (uint32_t r = 0; r < 4; r++) {
+                    EXPECT_NEAR(world[c][r], reference[i][c][r], 1e-2F * std::max(1.0F, std::abs(reference[i][c][r])));
+                }
+            }
+        }
+    };
+
+    hierarchy.update(tp);
+    EXPECT_EQ(hierarchy.size(), 5000);
+    EXPECT_EQ(hierarchy.changed().size(), 5000);
+    expectWorldMatrices();
+
+    /* Nothing changed */
+    hierarchy.update(tp);
+    EXPECT_EQ(hierarchy.changed().size(), 0);
+
+    /* Changing a leaf updates only the leaf */
+    std::vector<bool> hasChildren(handles.size(), false);
+    for (int32_t parent : parents) {
+        if (parent >= 0) {
+            hasChildren[parent] = true;
+        }
+    }
+    uint32_t leaf = static_cast<uint32_t>(std::find(hasChildren.rbegin(), hasChildren.rend(), false) - hasChildren.rbegin());
+    leaf = static_cast<uint32_t>(handles.size()) - 1 - leaf;
+    transforms[leaf] = randomTransform();
+    hierarchy.setLocalTransform(handles[leaf], transforms[leaf]);
+    hierarchy.update(tp);
+    ASSERT_EQ(hierarchy.changed().size(), 1);
+    EXPECT_EQ(hierarchy.changed()[0], handles[leaf]);
+    expectWorldMatrices();
+
+    /* Changing a root updates its whole subtree */
+    transforms[0] = randomTransform();
+    hierarchy.setLocalTransform(handles[0], transforms[0]);
+    std::vector<bool> inSubtree(handles.size(), false);
+    inSubtree[0] = true;
+    for (uint32_t i = 1; i < handles.size(); i++) {
+        inSubtree[i] = (parents[i] >= 0 && inSubtree[parents[i]]);
+    }
+    hierarchy.update(tp);
+    EXPECT_EQ(hierarchy.changed().size(), static_cast<size_t>(std::count(inSubtree.begin(), inSubtree.end(), true)));
+    expectWorldMatrices();
+
+    /* Re-parent a node and remove the last one */
+    parents[20] = 3;
+    hierarchy.setParent(handles[20], handles[3]);
+    hierarchy.remove(handles.back());
+    handles.pop_back();
+    parents.pop_back();
+    transforms.pop_back();
+    hierarchy.update(tp);
+    EXPECT_EQ(hierarchy.size(), 4999);
+    expectWorldMatrices();
+
+    /* Freed handles are reused */
+    Handle handle = hierarchy.add(vengine::Transform());
+    EXPECT_LT(handle, 5000);
+}
+
+TEST_F(CoreTest, SceneNodeTraversal)
+{
+    class TestNode : public vengine::SceneNode<TestNode>
+    {
+    public:
+        TestNode(vengine::TransformHierarchy &hierarchy, uint32_t id)
+            : SceneNode(hierarchy, vengine::Transform())
+            , m_id(id){};
+        uint32_t m_id;
+
+    private:
+        void transformChanged() override {}
+        void updateModelMatrix(const glm::mat4 &modelMatrix) override {}
+    };
+
+    vengine::TransformHierarchy hierarchy;
+    std::vector<std::unique_ptr<TestNode>> nodes;
+    TestNode::Siblings roots;
+
+    /* A random forest, every node has a parent added before it */
+    std::srand(11);
+    for (uint32_t i = 0; i < 1000; i++) {
+        nodes.push_back(std::make_unique<TestNode>(hierarchy, i));
+        if (i < 5) {
+            TestNode::addRoot(roots, nodes.back().get());
+        } else {
+            nodes[std::rand() % i]->addChild(nodes.back().get());
+        }
+    }
+
+    std::function<void(TestNode *, std::vector<uint32_t> &)> reference = [&](TestNode *node, std::vector<uint32_t> &ids) {
+        ids.push_back(node->m_id);
+        for (TestNode *child : node->children()) {
+            reference(child, ids);
+        }
+    };
+    auto expectDepthFirst = [&]() {
+        std::vector<uint32_t> expected, ids;
+        for (TestNode *root : roots) {
+            reference(root, expected);
+        }
+        for (TestNode *node : TestNode::depthFirst(roots)) {
+            ids.push_back(node->m_id);
+        }
+        EXPECT_EQ(ids, expected);
+    };
+    expectDepthFirst();
+
+    /* A subtree stops at its root */
+    std::vector<uint32_t> expected, ids;
+    reference(nodes[3].get(), expected);
+    for (TestNode *node : nodes[3]->subtree()) {
+        ids.push_back(node->m_id);
+    }
+    EXPECT_EQ(ids, expected);
+    EXPECT_EQ(nodes[3]->getSceneNodesFlat().size(), expected.size() - 1);
+
+    /* Removing children keeps the sibling links valid, and the other children in the order they were added */
+    for (uint32_t i = 0; i < 100; i++) {
+        TestNode *node = nodes[5 + std::rand() % 995].get();
+        if (node->parent() != nullptr) {
+            TestNode *parent = static_cast<TestNode *>(node->parent());
+            parent->removeChild(node);
+            TestNode::addRoot(roots, node);
+        }
+    }
+    expectDepthFirst();
+    for (auto &node : nodes) {
+        std::vector<uint32_t> childIDs;
+        for (TestNode *child : node->children()) {
+            childIDs.push_back(child->m_id);
+        }
+        EXPECT_EQ(childIDs.size(), node->children().size());
+        EXPECT_TRUE(std::is_sorted(childIDs.begin(), childIDs.end()));
+    }
+
+    /* And so does removing roots, the first, the last and any in between */
+    std::vector<TestNode *> remainingRoots(roots.begin(), roots.end());
+    for (uint32_t i = 0; i < 20; i++) {
+        size_t index = (i == 0 ? 0 : (i == 1 ? remainingRoots.size() - 1 : std::rand() % remainingRoots.size()));
+        TestNode::removeRoot(roots, remainingRoots[index]);
+        remainingRoots.erase(remainingRoots.begin() + index);
+    }
+    EXPECT_EQ(std::vector<TestNode *>(roots.begin(), roots.end()), remainingRoots);
+    EXPECT_EQ(roots.size(), remainingRoots.size());
+    expectDepthFirst();
+
+    /* Breadth first order has parents before children */
+    std::vector<uint32_t> position(hierarchy.size());
+    const std::vector<vengine::TransformHierarchy::Handle> &order = hierarchy.nodes();
+    EXPECT_EQ(order.size(), nodes.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        position[order[i]] = i;
+    }
+    for (auto &node : nodes) {
+        if (node->parent() != nullptr) {
+            EXPECT_LT(position[node->parent()->transformHandle()], position[node->transformHandle()]);
+        }
+    }
+}
+
+TEST_F(CoreTest, BVH)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    typedef vengine::BVH::ItemID ItemID;
+
+    std::srand(13);
+    auto random = [](float min, float max) { return min + (max - min) * static_cast<float>(std::rand()) / RAND_MAX; };
+    auto randomBox = [&]() {
+        glm::vec3 center(random(-100, 100), random(-100, 100), random(-100, 100));
+        glm::vec3 length(random(0.1F, 5), random(0.1F, 5), random(0.1F, 5));
+        return vengine::AABB3::fromCenterAndLength(center, length);
+    };
+
+    /* Every other ID is used, so IDs are not contiguous */
+    std::vector<ItemID> items;
+    std::vector<vengine::AABB3> bounds;
+    for (uint32_t i = 0; i < 20000; i++) {
+        items.push_back(2 * i);
+        bounds.push_back(randomBox());
+    }
+    std::vector<bool> present(2 * items.size(), false);
+    std::vector<vengine::AABB3> itemBounds(2 * items.size());
+    for (uint32_t i = 0; i < items.size(); i++) {
+        present[items[i]] = true;
+        itemBounds[items[i]] = bounds[i];
+    }
+
+    vengine::BVH bvh;
+    bvh.build(items, bounds, tp);
+    EXPECT_EQ(bvh.size(), 20000);
+    EXPECT_EQ(bvh.nodes(), 2 * 20000 - 1);
+    EXPECT_LT(bvh.depth(), 64);
+
+    auto slab = [](const vengine::AABB3 &box, const vengine::Ray &ray, float tMax, float &t) {
+        glm::vec3 invDirection = 1.0F / ray.direction;
+        glm::vec3 t0 = (box.min() - ray.origin) * invDirection;
+        glm::vec3 t1 = (box.max() - ray.origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        t = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0F));
+        return t <= std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    };
+
+    /* Every query returns the same items as testing all of them */
+    auto expectQueries = [&]() {
+        for (uint32_t q = 0; q < 20; q++) {
+            std::vector<ItemID> found, expected;
+
+            vengine::AABB3 box = vengine::AABB3::fromCenterAndLength(glm::vec3(random(-100, 100), random(-100, 100), 0),
+                                                                     glm::vec3(random(1, 40)));
+            bvh.queryBox(box, [&](ItemID item) { found.push_back(item); });
+            for (ItemID item = 0; item < present.size(); item++) {
+                if (present[item] && box.overlaps(itemBounds[item])) {
+                    expected.push_back(item);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            EXPECT_EQ(found, expected);
+
+            found.clear();
+            expected.clear();
+            glm::vec3 center(random(-100, 100), random(-100, 100), random(-100, 100));
+            float radius = random(1, 30);
+            bvh.querySphere(center, radius, [&](ItemID item) { found.push_back(item); });
+            for (ItemID item = 0; item < present.size(); item++) {
+                glm::vec3 d = glm::clamp(center, itemBounds[item].min(), itemBounds[item].max()) - center;
+                if (present[item] && glm::dot(d, d) <= radius * radius) {
+                    expected.push_back(item);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            EXPECT_EQ(found, expected);
+
+            found.clear();
+            expected.clear();
+            glm::mat4 view = glm::lookAt(center, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+            glm::mat4 projection = glm::perspective(glm::radians(random(20, 90)), 1.5F, 0.1F, random(20, 200));
+            vengine::Frustum frustum = vengine::Frustum::fromMatrix(projection * view);
+            bvh.queryFrustum(frustum, [&](ItemID item) { found.push_back(item); });
+            for (ItemID item = 0; item < present.size(); item++) {
+                if (present[item] && frustum.intersects(itemBounds[item])) {
+                    expected.push_back(item);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            EXPECT_EQ(found, expected);
+
+            /* Rays, all the boxes along the ray and the closest one */
+            found.clear();
+            expected.clear();
+            vengine::Ray ray(center, glm::vec3(random(-1, 1), random(-1, 1), random(-1, 1)));
+            float tMax = 300;
+            bvh.queryRay(ray, tMax, [&](ItemID item, float t) { found.push_back(item); });
+            ItemID expectedClosest = vengine::BVH::INVALID_INDEX;
+            float expectedT = tMax;
+            for (ItemID item = 0; item < present.size(); item++) {
+                float t;
+                if (present[item] && slab(itemBounds[item], ray, tMax, t)) {
+                    expected.push_back(item);
+                    if (t < expectedT) {
+                        expectedT = t;
+                        expectedClosest = item;
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end());
+            EXPECT_EQ(found, expected);
+
+            float t;
+            ItemID closest = bvh.intersectRay(
+                ray, tMax, [&](ItemID item, float &tItem) { return slab(itemBounds[item], ray, tItem, tItem); }, t);
+            EXPECT_EQ(closest, expectedClosest);
+            EXPECT_FLOAT_EQ(t, expectedT);
+        }
+    };
+    expectQueries();
+
+    /* Incremental changes, remove some, insert the odd IDs and move some */
+    for (uint32_t i = 0; i < 2000; i++) {
+        ItemID item = 2 * (std::rand() % 20000);
+        if (present[item]) {
+            bvh.remove(item);
+            present[item] = false;
+        }
+    }
+    for (uint32_t i = 0; i < 2000; i++) {
+        ItemID item = 2 * i + 1;
+        itemBounds[item] = randomBox();
+        bvh.insert(item, itemBounds[item]);
+        present[item] = true;
+    }
+    for (ItemID item = 0; item < present.size(); item += 7) {
+        if (present[item]) {
+            itemBounds[item] = randomBox();
+            bvh.update(item, itemBounds[item]);
+        }
+    }
+    EXPECT_EQ(bvh.size(), static_cast<uint32_t>(std::count(present.begin(), present.end(), true)));
+    EXPECT_EQ(bvh.nodes(), 2 * bvh.size() - 1);
+    expectQueries();
+
+    /* Move everything and refit once */
+    for (ItemID item = 0; item < present.size(); item++) {
+        if (present[item]) {
+            itemBounds[item].translate(glm::vec3(random(-2, 2), random(-2, 2), random(-2, 2)));
+            bvh.setBounds(item, itemBounds[item]);
+        }
+    }
+    bvh.refit();
+    expectQueries();
+
+    /* Remove everything */
+    for (ItemID item = 0; item < present.size(); item++) {
+        if (present[item]) {
+            bvh.remove(item);
+        }
+    }
+    EXPECT_EQ(bvh.size(), 0);
+    EXPECT_FALSE(bvh.contains(0));
+    bool visited = false;
+    bvh.queryBox(vengine::AABB3(), [&](ItemID item) { visited = true; });
+    EXPECT_FALSE(visited);
+}
+
+TEST_F(CoreTest, MeshIntersect)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    /* A bumpy grid of quads in the xz plane */
+    const uint32_t N = 64;
+    std::vector<vengine::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t z = 0; z <= N; z++) {
+        for (uint32_t x = 0; x <= N; x++) {
+            vengine::Vertex v;
+            v.position = glm::vec3(x, std::sin(0.5F * x) * std::cos(0.3F * z), z);
+            vertices.push_back(v);
+        }
+    }
+    for (uint32_t z = 0; z < N; z++) {
+        for (uint32_t x = 0; x < N; x++) {
+            uint32_t i = z * (N + 1) + x;
+            indices.insert(indices.end(), {i, i + N + 1, i + 1, i + 1, i + N + 1, i + N + 2});
+        }
+    }
+    vengine::Mesh mesh(vengine::AssetInfo("grid"), vertices, indices, true, false);
+
+    /* Brute force, with the same triangle test */
+    auto bruteForce = [&](const vengine::Ray &ray, float tMax) {
+        float closest = tMax;
+        bool hit = false;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            glm::vec3 v0 = vertices[indices[i]].position;
+            glm::vec3 e1 = vertices[indices[i + 1]].position - v0;
+            glm::vec3 e2 = vertices[indices[i + 2]].position - v0;
+            glm::vec3 p = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, p);
+            if (det == 0.0F)
+                continue;
+            glm::vec3 s = ray.origin - v0;
+            float u = glm::dot(s, p) / det;
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(ray.direction, q) / det;
+            float t = glm::dot(e2, q) / det;
+            if (u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t <= closest) {
+                closest = t;
+                hit = true;
+            }
+        }
+        return hit ? closest : -1.0F;
+    };
+
+    std::srand(15);
+    auto random = [](float min, float max) { return min + (max - min) * static_cast<float>(std::rand()) / RAND_MAX; };
+    uint32_t hits = 0;
+    for (uint32_t r = 0; r < 500; r++) {
+        glm::vec3 origin(random(-10, N + 10), random(2, 10), random(-10, N + 10));
+        glm::vec3 target(random(0, N), random(-1, 1), random(0, N));
+        vengine::Ray ray(origin, target - origin);
+
+        float expected = bruteForce(ray, 2.0F);
+        float t;
+        bool hit = mesh.intersect(ray, 2.0F, t, tp);
+        EXPECT_EQ(hit, expected >= 0);
+        if (hit) {
+            EXPECT_NEAR(t, expected, 1e-4F);
+            hits++;
+        }
+    }
+    EXPECT_GT(hits, 0U);
+
+    /* Both sides of the triangles are hit, and nothing past tMax */
+    float t;
+    EXPECT_TRUE(mesh.intersect(vengine::Ray(glm::vec3(10.5F, -5, 10.5F), glm::vec3(0, 1, 0)), 10.0F, t, tp));
+    EXPECT_FALSE(mesh.intersect(vengine::Ray(glm::vec3(10.5F, 5, 10.5F), glm::vec3(0, -1, 0)), 3.0F, t, tp));
+    EXPECT_FALSE(mesh.intersect(vengine::Ray(glm::vec3(-1, 5, -1), glm::vec3(-1, 0, 0)), 100.0F, t, tp));
+
+    /* An axis parallel ray with its origin on the bounds of the triangles along x */
+    vengine::Ray onBounds(glm::vec3(10, 5, 10.5F), glm::vec3(0, -1, 0));
+    EXPECT_TRUE(mesh.intersect(onBounds, 10.0F, t, tp));
+    EXPECT_NEAR(t, bruteForce(onBounds, 10.0F), 1e-4F);
+
+    /* First picks from inside pool tasks build the BVHs of different meshes, and of the same mesh, concurrently */
+    std::vector<std::unique_ptr<vengine::Mesh>> meshes;
+    for (uint32_t i = 0; i < 8; i++) {
+        vengine::AssetInfo info("grid" + std::to_string(i));
+        meshes.push_back(std::make_unique<vengine::Mesh>(info, vertices, indices, true, false));
+    }
+    vengine::Ray down(glm::vec3(20.5F, 5, 30.5F), glm::vec3(0, -1, 0));
+    float expected = bruteForce(down, 10.0F);
+    std::atomic<uint32_t> matches = 0;
+    vengine::parallelFor(tp, 0, 2 * static_cast<uint32_t>(meshes.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            float tMesh;
+            if (meshes[i % meshes.size()]->intersect(down, 10.0F, tMesh, tp) && std::abs(tMesh - expected) < 1e-4F)
+                matches++;
+        }
+    });
+    EXPECT_EQ(matches.load(), 2 * meshes.size());
+}
+
+TEST_F(CoreTest, RadixSort)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+    vengine::ThreadPool tpEmpty;
+
+    std::srand(17);
+    vengine::RadixSorter<uint32_t> sorter;
+    for (uint32_t n : {0U, 1U, 1000U, 300000U}) {
+        for (uint32_t range : {100U, 0xFFFFFFFFU}) {
+            /* Values are the original positions, to check that equal keys keep their order */
+            std::vector<uint32_t> keys(n), values(n);
+            for (uint32_t i = 0; i < n; i++) {
+                keys[i] = ((static_cast<uint32_t>(std::rand()) << 16) ^ static_cast<uint32_t>(std::rand())) % range;
+                values[i] = i;
+            }
+
+            std::vector<uint32_t> expected(n);
+            for (uint32_t i = 0; i < n; i++) {
+                expected[i] = i;
+            }
+            std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+            std::vector<uint32_t> keysSerial = keys, valuesSerial = values;
+            sorter.sort(keys, values, tp);
+            EXPECT_EQ(values, expected);
+            EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+
+            sorter.sort(keysSerial, valuesSerial, tpEmpty);
+            EXPECT_EQ(valuesSerial, expected);
+        }
+    }
+}
+
+TEST_F(CoreTest, MeshSimplification)
+{
+    /* A cube with a grid of quads on every face. The faces have their own vertices, so the cube edges are normal seams */
+    const uint32_t N = 16;
+    std::vector<vengine::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        for (float side : {-1.0F, 1.0F}) {
+            glm::vec3 normal(0), u(0), v(0);
+            normal[axis] = side;
+            u[(axis + 1) % 3] = 1;
+            v[(axis + 2) % 3] = side;
+            uint32_t first = static_cast<uint32_t>(vertices.size());
+            for (uint32_t j = 0; j <= N; j++) {
+                for (uint32_t i = 0; i <= N; i++) {
+                    vengine::Vertex vertex;
+                    vertex.position = normal + u * (2.0F * i / N - 1.0F) + v * (2.0F * j / N - 1.0F);
+                    vertex.normal = normal;
+                    vertices.push_back(vertex);
+                }
+            }
+            for (uint32_t j = 0; j < N; j++) {
+                for (uint32_t i = 0; i < N; i++) {
+                    uint32_t k = first + j * (N + 1) + i;
+                    indices.insert(indices.end(), {k, k + 1, k + N + 2, k, k + N + 2, k + N + 1});
+                }
+            }
+        }
+    }
+    uint32_t nTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+    std::vector<uint32_t> simplified = vengine::simplifyMesh(vertices, indices, nTriangles / 4);
+    ASSERT_EQ(simplified.size() % 3, 0U);
+    EXPECT_LE(simplified.size() / 3, nTriangles / 2);
+    EXPECT_GE(simplified.size() / 3, 12U);
+
+    /* Valid triangles that keep their orientation, and the corners of the cube don't move */
+    vengine::AABB3 aabb = vengine::AABB3::fromPoint(vertices[simplified[0]].position);
+    for (size_t i = 0; i < simplified.size(); i += 3) {
+        ASSERT_LT(simplified[i], vertices.size());
+        ASSERT_LT(simplified[i + 1], vertices.size());
+        ASSERT_LT(simplified[i + 2], vertices.size());
+        const vengine::Vertex &v0 = vertices[simplified[i]];
+        const vengine::Vertex &v1 = vertices[simplified[i + 1]];
+        const vengine::Vertex &v2 = vertices[simplified[i + 2]];
+        glm::vec3 n = glm::cross(v1.position - v0.position, v2.position - v0.position);
+        EXPECT_GT(glm::dot(n, v0.normal), 0.0F);
+        /* Vertices of a face stay on the face */
+        EXPECT_EQ(v0.normal, v1.normal);
+        EXPECT_EQ(v0.normal, v2.normal);
+        aabb.add(v0.position);
+        aabb.add(v1.position);
+        aabb.add(v2.position);
+    }
+    EXPECT_EQ(aabb.min(), glm::vec3(-1));
+    EXPECT_EQ(aabb.max(), glm::vec3(1));
+
+    /* The levels of detail of a mesh index the same vertices after the full mesh */
+    vengine::Mesh mesh(vengine::AssetInfo("cube"), vertices, indices, true, false);
+    mesh.generateLODs();
+    EXPECT_GT(mesh.nLODs(), 1U);
+    EXPECT_LE(mesh.nLODs(), vengine::Mesh::MAX_LODS);
+    EXPECT_EQ(mesh.lod(0).firstIndex, 0U);
+    EXPECT_EQ(mesh.lod(0).nIndices, indices.size());
+    uint32_t end = mesh.lod(0).nIndices;
+    for (uint32_t l = 1; l < mesh.nLODs(); l++) {
+        EXPECT_EQ(mesh.lod(l).firstIndex, end);
+        EXPECT_LT(mesh.lod(l).nIndices, mesh.lod(l - 1).nIndices);
+        end += mesh.lod(l).nIndices;
+    }
+    EXPECT_EQ(end, mesh.indices().size() + mesh.lodIndices().size());
+
+    /* Smaller on the screen, coarser level */
+    EXPECT_EQ(mesh.selectLOD(1.0F), 0U);
+    EXPECT_EQ(mesh.selectLOD(0.0F), mesh.nLODs() - 1);
+    for (float size = 1.0F; size > 0.001F; size *= 0.9F) {
+        EXPECT_LE(mesh.selectLOD(size), mesh.selectLOD(size * 0.9F));
+    }
+}
+
+TEST_F(CoreTest, MeshOptimization)
+{
+    /* A grid of quads with the triangles in random order. The uv of a vertex stores its index, to follow it when reordered */
+    const uint32_t N = 32;
+    std::vector<vengine::Vertex> vertices;
+    for (uint32_t j = 0; j <= N; j++) {
+        for (uint32_t i = 0; i <= N; i++) {
+            vengine::Vertex vertex;
+            vertex.position = glm::vec3(i, j, 0);
+            vertex.uv = glm::vec2(static_cast<float>(vertices.size()), 0);
+            vertices.push_back(vertex);
+        }
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t j = 0; j < N; j++) {
+        for (uint32_t i = 0; i < N; i++) {
+            uint32_t k = j * (N + 1) + i;
+            triangles.push_back({k, k + 1, k + N + 2});
+            triangles.push_back({k, k + N + 2, k + N + 1});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+    std::vector<uint32_t> indices;
+    for (auto &triangle : triangles) {
+        indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    uint32_t nTriangles = static_cast<uint32_t>(triangles.size());
+
+    /* Cache optimized orders keep the triangles and start a cluster at every dead end */
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> ordered = vengine::optimizeVertexCache(indices, nVertices, vengine::VERTEX_CACHE_SIZE, &clusters);
+    ASSERT_EQ(ordered.size(), indices.size());
+    ASSERT_FALSE(clusters.empty());
+    EXPECT_EQ(clusters[0], 0U);
+    EXPECT_TRUE(std::is_sorted(clusters.begin(), clusters.end()));
+    EXPECT_LT(clusters.back(), nTriangles);
+    EXPECT_LT(vengine::analyzeVertexCache(ordered, nVertices).acmr(), 0.8F);
+
+    vengine::VertexCacheStatistics before;
+    vengine::VertexCacheStatistics after = vengine::optimizeMesh(vertices, indices, &before);
+    EXPECT_EQ(before.nTriangles, nTriangles);
+    EXPECT_EQ(before.nVertices, nVertices);
+    EXPECT_GT(before.acmr(), 2.0F);
+    EXPECT_EQ(after.nTriangles, nTriangles);
+    EXPECT_EQ(after.nVertices, nVertices);
+    EXPECT_LT(after.acmr(), 0.85F);
+    EXPECT_LT(after.atvr(), 1.5F);
+    EXPECT_GE(after.atvr(), 1.0F);
+
+    /* The vertices are in the order they are first referenced */
+    ASSERT_EQ(vertices.size(), nVertices);
+    uint32_t nextVertex = 0;
+    for (uint32_t index : indices) {
+        ASSERT_LE(index, nextVertex);
+        nextVertex = std::max(nextVertex, index + 1);
+    }
+
+    /* The same triangles with the same winding */
+    auto canonical = [](std::array<uint32_t, 3> triangle) {
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        return triangle;
+    };
+    std::vector<std::array<uint32_t, 3>> optimized;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        optimized.push_back(canonical({static_cast<uint32_t>(vertices[indices[i]].uv.x),
+                                       static_cast<uint32_t>(vertices[indices[i + 1]].uv.x),
+                                       static_cast<uint32_t>(vertices[indices[i + 2]].uv.x)}));
+    }
+    for (auto &triangle : triangles) {
+        triangle = canonical(triangle);
+    }
+    std::sort(optimized.begin(), optimized.end());
+    std::sort(triangles.begin(), triangles.end());
+    EXPECT_EQ(optimized, triangles);
+
+    /* Unreferenced vertices are removed */
+    vertices.push_back(vengine::Vertex());
+    vengine::optimizeVertexFetch(vertices, indices);
+    EXPECT_EQ(vertices.size(), nVertices);
+}
+
+TEST_F(CoreTest, MeshRegistry)
+{
+    std::vector<vengine::Vertex> vertices(4);
+    vertices[1].position = glm::vec3(1, 0, 0);
+    vertices[2].position = glm::vec3(1, 1, 0);
+    vertices[3].position = glm::vec3(0, 1, 0);
+    std::vector<uint32_t> indices = {0, 1, 2, 0, 2, 3};
+
+    /* The same geometry under another name, and a different geometry */
+    vengine::Mesh a(vengine::AssetInfo("a"), vertices, indices, true, true);
+    vengine::Mesh b(vengine::AssetInfo("b"), vertices, indices, true, true);
+    std::vector<uint32_t> flipped = {0, 2, 1, 0, 3, 2};
+    vengine::Mesh c(vengine::AssetInfo("c"), vertices, flipped, true, true);
+    EXPECT_EQ(a.contentHash(), b.contentHash());
+    EXPECT_NE(a.contentHash(), c.contentHash());
+    EXPECT_TRUE(a.sameGeometry(b));
+    EXPECT_FALSE(a.sameGeometry(c));
+
+    vengine::MeshRegistry registry;
+    uint32_t nCreated = 0;
+    auto create = [&](const vengine::Mesh &mesh) {
+        return [&]() {
+            nCreated++;
+            return new vengine::Mesh(mesh);
+        };
+    };
+
+    vengine::Mesh *registeredA = registry.get(a, false, create(a));
+    vengine::Mesh *registeredB = registry.get(b, false, create(b));
+    vengine::Mesh *registeredC = registry.get(c, false, create(c));
+    EXPECT_EQ(registeredA, registeredB);
+    EXPECT_NE(registeredA, registeredC);
+    EXPECT_EQ(nCreated, 2U);
+    EXPECT_EQ(registry.size(), 2U);
+
+    /* The shared mesh is released with its last reference */
+    EXPECT_FALSE(registry.release(registeredA));
+    EXPECT_TRUE(registry.release(registeredB));
+    EXPECT_TRUE(registry.release(registeredC));
+    EXPECT_EQ(registry.size(), 0U);
+    delete registeredA;
+    delete registeredC;
+
+    /* Meshes that were never registered belong to the caller */
+    EXPECT_TRUE(registry.release(&a));
+}
+
+TEST_F(CoreTest, MeshKernels)
+{
+    vengine::ThreadPool tp;
+    tp.init(4);
+
+    /* A wavy grid, large enough to be split in chunks */
+    const uint32_t N = 256;
+    std::vector<vengine::Vertex> vertices;
+    for (uint32_t j = 0; j <= N; j++) {
+        for (uint32_t i = 0; i <= N; i++) {
+            vengine::Vertex vertex;
+            vertex.position = glm::vec3(i, j, std::sin(0.1F * static_cast<float>(i)) * std::cos(0.07F * static_cast<float>(j)));
+            vertex.uv = glm::vec2(i, j) / static_cast<float>(N);
+            vertices.push_back(vertex);
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t j = 0; j < N; j++) {
+        for (uint32_t i = 0; i < N; i++) {
+            uint32_t k = j * (N + 1) + i;
+            indices.insert(indices.end(), {k, k + 1, k + N + 2, k, k + N + 2, k + N + 1});
+        }
+    }
+
+    /* Bounds */
+    vengine::AABB3 reference = vengine::AABB3::fromPoint(vertices[0].position);
+    for (const vengine::Vertex &vertex : vertices) {
+        reference.add(vertex.position);
+    }
+    for (vengine::ThreadPool *threadPool : {static_cast<vengine::ThreadPool *>(nullptr), &tp}) {
+        vengine::AABB3 aabb = vengine::computeBounds(vertices, threadPool);
+        EXPECT_EQ(aabb.min(), reference.min());
+        EXPECT_EQ(aabb.max(), reference.max());
+    }
+
+    /* Normals, the area weighted sum of the face normals */
+    std::vector<glm::vec3> normals(vertices.size(), glm::vec3(0));
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3 &p0 = vertices[indices[i]].position;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+        for (size_t j = 0; j < 3; j++) {
+            normals[indices[i + j]] += normal;
+        }
+    }
+    std::vector<vengine::Vertex> serial = vertices;
+    vengine::computeVertexNormals(serial, indices);
+    vengine::computeVertexNormals(vertices, indices, &tp);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        glm::vec3 expected = glm::normalize(normals[i]);
+        EXPECT_LT(glm::length(vertices[i].normal - expected), 1e-5F);
+        EXPECT_EQ(vertices[i].normal, serial[i].normal);
+    }
+
+    /* Tangents follow u and are orthogonal to the normal, bitangents follow v */
+    vengine::computeVertexTangents(serial, indices);
+    vengine::computeVertexTangents(vertices, indices, &tp);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const vengine::Vertex &vertex = vertices[i];
+        EXPECT_NEAR(glm::length(vertex.tangent), 1.0F, 1e-4F);
+        EXPECT_NEAR(glm::dot(vertex.tangent, vertex.normal), 0.0F, 1e-4F);
+        EXPECT_GT(vertex.tangent.x, 0.5F);
+        EXPECT_GT(vertex.bitangent.y, 0.5F);
+        EXPECT_EQ(vertex.tangent, serial[i].tangent);
+        EXPECT_EQ(vertex.bitangent, serial[i].bitangent);
+    }
+
+    /* Mirrored uvs flip the tangent, the bitangent still follows v */
+    for (vengine::Vertex &vertex : vertices) {
+        vertex.uv.x = 1.0F - vertex.uv.x;
+    }
+    vengine::computeVertexTangents(vertices, indices, &tp);
+    for (const vengine::Vertex &vertex : vertices) {
+        EXPECT_LT(vertex.tangent.x, -0.5F);
+        EXPECT_GT(vertex.bitangent.y, 0.5F);
+    }
+
+    /* Degenerate uvs leave any tangent on the plane of the normal */
+    std::vector<vengine::Vertex> flat = vertices;
+    for (vengine::Vertex &vertex : flat) {
+        vertex.uv = glm::vec2(0);
+    }
+    vengine::computeVertexTangents(flat, indices, &tp);
+    for (const vengine::Vertex &vertex : flat) {
+        EXPECT_NEAR(glm::length(vertex.tangent), 1.0F, 1e-4F);
+        EXPECT_NEAR(glm::dot(vertex.tangent, vertex.normal), 0.0F, 1e-4F);
+    }
+
+    /* Normalization and validity */
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertices[i].tangent *= 1.0F + static_cast<float>(i % 7);
+    }
+    EXPECT_EQ(vengine::normalizeVectors(vertices, &vengine::Vertex::tangent, &tp), 0U);
+    for (const vengine::Vertex &vertex : vertices) {
+        EXPECT_NEAR(glm::length(vertex.tangent), 1.0F, 1e-5F);
+    }
+
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::position, &tp), 0U);
+    vertices[3].position.z = std::numeric_limits<float>::quiet_NaN();
+    vertices[40000].position.x = std::numeric_limits<float>::infinity();
+    vertices[50000].uv.y = -std::numeric_limits<float>::infinity();
+    vertices[60000].normal = glm::vec3(0);
+    EXPECT_EQ(vengine::normalizeVectors(vertices, &vengine::Vertex::normal, &tp), 1U);
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::position, &tp), 2U);
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::position), 2U);
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::uv, &tp), 1U);
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::normal, &tp), 1U);
+    EXPECT_EQ(vengine::countNonFinite(vertices, &vengine::Vertex::tangent, &tp), 0U);
+}
+
+TEST_F(CoreTest, MeshReleaseGeometry)
+{
+    vengine::ThreadPool tp;
+    tp.init(2);
+
+    const uint32_t N = 32;
+    std::vector<vengine::Vertex> vertices;
+    for (uint32_t j = 0; j <= N; j++) {
+        for (uint32_t i = 0; i <= N; i++) {
+            vengine::Vertex vertex;
+            vertex.position = glm::vec3(i, 0, j);
+            vertices.push_back(vertex);
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t j = 0; j < N; j++) {
+        for (uint32_t i = 0; i < N; i++) {
+            uint32_t k = j * (N + 1) + i;
+            indices.insert(indices.end(), {k, k + N + 2, k + 1, k, k + N + 1, k + N + 2});
+        }
+    }
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    uint32_t nIndices = static_cast<uint32_t>(indices.size());
+
+    /* The geometry is moved into the mesh, and from mesh to mesh, without copies */
+    const vengine::Vertex *vertexData = vertices.data();
+    const uint32_t *indexData = indices.data();
+    vengine::Mesh imported(vengine::AssetInfo("imported"), std::move(vertices), std::move(indices), true, false);
+    imported.generateLODs();
+    vengine::Mesh copy(imported);
+    vengine::Mesh mesh(std::move(imported));
+    EXPECT_EQ(mesh.vertices().data(), vertexData);
+    EXPECT_EQ(mesh.indices().data(), indexData);
+    EXPECT_EQ(mesh.name(), "imported");
+
+    uint32_t nLODs = mesh.nLODs();
+    ASSERT_GT(nLODs, 1U);
+    vengine::Mesh::LOD lastLOD = mesh.lod(nLODs - 1);
+    float t;
+    vengine::Ray ray(glm::vec3(10.5F, 5, 10.5F), glm::vec3(0, -1, 0));
+    EXPECT_TRUE(mesh.intersect(ray, 10.0F, t, tp));
+
+    /* The counts, the levels, the bounds and the hash survive the release */
+    mesh.releaseGeometry();
+    EXPECT_FALSE(mesh.hasGeometry());
+    EXPECT_TRUE(mesh.vertices().empty());
+    EXPECT_TRUE(mesh.indices().empty());
+    EXPECT_TRUE(mesh.lodIndices().empty());
+    EXPECT_EQ(mesh.nVertices(), nVertices);
+    EXPECT_EQ(mesh.nIndices(), nIndices);
+    EXPECT_EQ(mesh.nTriangles(), nIndices / 3);
+    EXPECT_EQ(mesh.lod(0).nIndices, nIndices);
+    EXPECT_EQ(mesh.nLODs(), nLODs);
+    EXPECT_EQ(mesh.lod(nLODs - 1).firstIndex, lastLOD.firstIndex);
+    EXPECT_EQ(mesh.aabb().max(), glm::vec3(N, 0, N));
+    EXPECT_EQ(mesh.contentHash(), copy.contentHash());
+
+    /* Released meshes are not hit. Their geometry can't be compared anymore, they match by the two content hashes */
+    EXPECT_FALSE(mesh.intersect(ray, 10.0F, t, tp));
+    mesh.generateLODs();
+    EXPECT_EQ(mesh.nLODs(), nLODs);
+    EXPECT_FALSE(mesh.sameGeometry(copy));
+    EXPECT_FALSE(copy.sameGeometry(mesh));
+    EXPECT_TRUE(mesh.sameContent(copy));
+    EXPECT_TRUE(copy.sameContent(mesh));
+
+    /* A registered mesh that released its geometry is shared, unless the geometry is needed */
+    vengine::MeshRegistry registry;
+    vengine::Mesh *registered = registry.get(copy, false, [&]() { return new vengine::Mesh(copy); });
+    registered->releaseGeometry();
+    EXPECT_EQ(registry.get(copy, false, [&]() { return new vengine::Mesh(copy); }), registered);
+    vengine::Mesh *created = registry.get(copy, true, [&]() { return new vengine::Mesh(copy); });
+    EXPECT_NE(created, registered);
+    EXPECT_TRUE(created->hasGeometry());
+    EXPECT_EQ(registry.size(), 2U);
+    EXPECT_FALSE(registry.release(registered));
+    EXPECT_TRUE(registry.release(registered));
+    EXPECT_TRUE(registry.release(created));
+    delete registered;
+    delete created;
+}
+
+TEST_F(SceneTest, MeshIndexType)
+{
+    Scene &scene = mEngine->scene();
+    InstancesManager &instances = scene.instancesManager();
+    Material *material = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("indexTypeOpaque"));
+
+    /* A grid of (n + 1) x (n + 1) vertices */
+    auto grid = [](uint32_t n, const std::string &name) {
+        std::vector<Vertex> vertices;
+        for (uint32_t j = 0; j <= n; j++) {
+            for (uint32_t i = 0; i <= n; i++) {
+                Vertex vertex;
+                vertex.position = glm::vec3(i, 0, j);
+                vertices.push_back(vertex);
+            }
+        }
+        std::vector<uint32_t> indices;
+        for (uint32_t j = 0; j < n; j++) {
+            for (uint32_t i = 0; i < n; i++) {
+                uint32_t k = j * (n + 1) + i;
+                indices.insert(indices.end(), {k, k + n + 2, k + 1, k, k + n + 1, k + n + 2});
+            }
+        }
+        return Mesh(AssetInfo(name), std::move(vertices), std::move(indices), true, false);
+    };
+
+    /* With 65536 vertices the largest index still fits in 16 bits, one more row needs 32 bits */
+    auto mesh16 = static_cast<VulkanMesh *>(mEngine->createMesh(grid(255, "indexType16")));
+    EXPECT_EQ(mesh16->nVertices(), 65536U);
+    EXPECT_EQ(mesh16->indexType(), VK_INDEX_TYPE_UINT16);
+    EXPECT_EQ(mesh16->indexSize(), 2U);
+
+    auto mesh32 = static_cast<VulkanMesh *>(mEngine->createMesh(grid(256, "indexType32")));
+    EXPECT_EQ(mesh32->nVertices(), 66049U);
+    EXPECT_EQ(mesh32->indexType(), VK_INDEX_TYPE_UINT32);
+    EXPECT_EQ(mesh32->indexSize(), 4U);
+
+    /* The instance data tells the shaders how to read the index buffer */
+    SceneObject *so16 = scene.addSceneObject("indexType16", Transform({0, 0, 0}));
+    so16->add<ComponentMesh>().setMesh(mesh16);
+    so16->add<ComponentMaterial>().setMaterial(material);
+    SceneObject *so32 = scene.addSceneObject("indexType32", Transform({0, 0, 0}));
+    so32->add<ComponentMesh>().setMesh(mesh32);
+    so32->add<ComponentMaterial>().setMaterial(material);
+    scene.update();
+    EXPECT_EQ(instances.findInstanceData(so16)->indexSize, 2U);
+    EXPECT_EQ(instances.findInstanceData(so32)->indexSize, 4U);
+}
+
+TEST_F(CoreTest, OctahedralEncoding)
+{
+    std::srand(19);
+    auto random = []() { return -1.0F + 2.0F * static_cast<float>(std::rand()) / RAND_MAX; };
+    std::vector<glm::vec3> directions = {glm::vec3(1, 0, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)};
+    for (uint32_t i = 0; i < 1000; i++) {
+        glm::vec3 d(random(), random(), random());
+        if (glm::length(d) > 0.01F) {
+            directions.push_back(glm::normalize(d));
+        }
+    }
+
+    for (const glm::vec3 &d : directions) {
+        glm::vec2 e = vengine::octahedralEncode(d);
+        EXPECT_LE(std::abs(e.x), 1.0F);
+        EXPECT_LE(std::abs(e.y), 1.0F);
+        EXPECT_GT(glm::dot(vengine::octahedralDecode(e), d), 0.99999F);
+
+        /* Quantized to snorm 16 as in the packed vertices */
+        glm::vec2 q = glm::round(e * 32767.0F) / 32767.0F;
+        EXPECT_GT(glm::dot(vengine::octahedralDecode(q), d), 0.9999F);
+    }
+}
+
+VulkanEngine *SceneTest::mEngine = nullptr;
+
+TEST_F(SceneTest, Pick)
+{
+    Scene &scene = mEngine->scene();
+    VulkanRenderer &renderer = static_cast<VulkanRenderer &>(mEngine->renderer());
+    ThreadPool &tp = mEngine->threadPool();
+
+    auto camera = std::make_shared<PerspectiveCamera>();
+    camera->fov() = 60.0F;
+    camera->setWindowSize(800, 800);
+    camera->transform().position() = glm::vec3(0, 0, 10);
+    scene.camera() = camera;
+
+    /* Viewport coordinates of a point in world space */
+    auto project = [&](const glm::vec3 &p) {
+        glm::vec4 clip = camera->projectionMatrix() * camera->viewMatrix() * glm::vec4(p, 1.0F);
+        return (glm::vec2(clip.x, clip.y) / clip.w + 1.0F) * 0.5F;
+    };
+
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    SceneObject *front = scene.addSceneObject("front", Transform({0, 0, 0}, {1, 1, 1}));
+    front->add<ComponentMesh>().setMesh(cubeMesh);
+    SceneObject *back = scene.addSceneObject("back", Transform({0, 0, -5}, {1, 1, 1}));
+    back->add<ComponentMesh>().setMesh(cubeMesh);
+    scene.update();
+
+    EXPECT_EQ(renderer.findID(0.5F, 0.5F, tp), front->getID());
+    EXPECT_EQ(renderer.findID(0.0F, 0.0F, tp), 0U);
+
+    /* Hidden objects can't be picked, the ray reaches the object behind */
+    front->setActive(false);
+    scene.update();
+    EXPECT_EQ(scene.pick(0.5F, 0.5F), back);
+    EXPECT_EQ(renderer.findID(0.5F, 0.5F, tp), back->getID());
+    front->setActive(true);
+    scene.update();
+
+    /* The arrows of the transform widget are drawn on top, so they are hit before the selected object around them. At this
+     * distance the arrows are about one unit long */
+    renderer.setSelectedObject(front);
+    glm::vec2 arrowX = project(glm::vec3(0.7F, 0, 0));
+    glm::vec2 arrowY = project(glm::vec3(0, 0.7F, 0));
+    EXPECT_EQ(renderer.findID(arrowX.x, arrowX.y, tp), static_cast<ID>(ReservedObjectID::TRANSFORM_ARROW_X));
+    EXPECT_EQ(renderer.findID(arrowY.x, arrowY.y, tp), static_cast<ID>(ReservedObjectID::TRANSFORM_ARROW_Y));
+    glm::vec2 arrowZ = project(glm::vec3(0.02F, 0.02F, 0.5F));
+    EXPECT_EQ(renderer.findID(arrowZ.x, arrowZ.y, tp), static_cast<ID>(ReservedObjectID::TRANSFORM_ARROW_Z));
+
+    /* Away from the arrows the object is hit. The pick runs on the engine thread between two frames */
+    glm::vec2 corner = project(glm::vec3(-0.8F, -0.8F, 1.0F));
+    ID id = 0;
+    mEngine->runBetweenFrames([&]() { id = renderer.findID(corner.x, corner.y, tp); });
+    EXPECT_EQ(id, front->getID());
+}
+
+TEST_F(SceneTest, Instances)
+{
+    Scene &scene = mEngine->scene();
+    InstancesManager &instances = scene.instancesManager();
+    instances.cullOpaque() = true;
+
+    auto camera = std::make_shared<PerspectiveCamera>();
+    camera->fov() = 60.0F;
+    camera->setWindowSize(800, 800);
+    camera->transform().position() = glm::vec3(0, 0, 30);
+    scene.camera() = camera;
+
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    Mesh *planeMesh = AssetManager::getInstance().modelsMap().get("assets/models/plane.obj")->mesh("Plane");
+    Material *opaque = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("instancesOpaque"));
+    Material *glass = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("instancesGlass"));
+
+    /* Small objects in a row, all inside the frustum */
+    uint32_t nAdded = 0;
+    auto add = [&](Mesh *mesh, Material *material) {
+        float x = -10.0F + static_cast<float>(nAdded++ % 20);
+        SceneObject *so = scene.addSceneObject("instance", Transform({x, 0, 0}, {0.2F, 0.2F, 0.2F}));
+        so->add<ComponentMesh>().setMesh(mesh);
+        so->add<ComponentMaterial>().setMaterial(material);
+        return so;
+    };
+    auto frame = [&]() {
+        scene.update();
+        scene.sortTransparent();
+        scene.cullInstances();
+    };
+
+    /* The groups own disjoint ranges of the instance buffer, with every object at its index in the group. Transparent objects
+     * have a slot of their own outside the ranges. Everything is visible */
+    auto expectInstances = [&](const SceneObjectVector &expectedOpaque, const SceneObjectVector &expectedTransparent) {
+        const std::vector<uint32_t> &visible = instances.visibleInstances();
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::set<SceneObject *> opaqueObjects;
+        for (const auto &[mesh, group] : instances.opaqueMeshes()) {
+            uint32_t nObjects = static_cast<uint32_t>(group.sceneObjects.size());
+            EXPECT_LE(nObjects, group.capacity);
+            for (const auto &[start, capacity] : ranges) {
+                EXPECT_TRUE(group.startIndex + group.capacity <= start || start + capacity <= group.startIndex);
+            }
+            ranges.push_back({group.startIndex, group.capacity});
+
+            for (uint32_t i = 0; i < nObjects; i++) {
+                SceneObject *so = group.sceneObjects[i];
+                EXPECT_EQ(so->get<ComponentMesh>().mesh(), mesh);
+                EXPECT_EQ(instances.findInstanceDataIndex(so), group.startIndex + i);
+                EXPECT_EQ(static_cast<ID>(instances.findInstanceData(so)->id.r), so->getID());
+                opaqueObjects.insert(so);
+            }
+
+            EXPECT_EQ(group.visibleCount, nObjects);
+            std::vector<uint32_t> groupVisible(visible.begin() + group.startIndex, visible.begin() + group.startIndex + nObjects);
+            std::sort(groupVisible.begin(), groupVisible.end());
+            for (uint32_t i = 0; i < nObjects; i++) {
+                EXPECT_EQ(groupVisible[i], group.startIndex + i);
+            }
+        }
+        EXPECT_EQ(opaqueObjects, std::set<SceneObject *>(expectedOpaque.begin(), expectedOpaque.end()));
+
+        std::set<uint32_t> slots;
+        for (SceneObject *so : instances.transparentMeshes()) {
+            uint32_t index = instances.findInstanceDataIndex(so);
+            for (const auto &[start, capacity] : ranges) {
+                EXPECT_TRUE(index < start || index >= start + capacity);
+            }
+            EXPECT_TRUE(slots.insert(index).second);
+            EXPECT_EQ(visible[index], index);
+        }
+        EXPECT_EQ(std::set<SceneObject *>(instances.transparentMeshes().begin(), instances.transparentMeshes().end()),
+                  std::set<SceneObject *>(expectedTransparent.begin(), expectedTransparent.end()));
+        EXPECT_EQ(instances.visibleTransparentMeshes().size(), expectedTransparent.size());
+        EXPECT_EQ(instances.sceneObjectInstanceMap().size(), expectedOpaque.size() + expectedTransparent.size());
+    };
+
+    /* Built from scratch, the cube group is full */
+    SceneObjectVector cubes = {add(cubeMesh, opaque), add(cubeMesh, opaque), add(cubeMesh, opaque)};
+    SceneObjectVector glassCubes = {add(cubeMesh, glass), add(cubeMesh, glass)};
+    SceneObjectVector planes = {add(planeMesh, opaque)};
+    frame();
+    ASSERT_TRUE(instances.isBuilt());
+    auto all = [&]() {
+        SceneObjectVector objects = cubes;
+        objects.insert(objects.end(), glassCubes.begin(), glassCubes.end());
+        objects.insert(objects.end(), planes.begin(), planes.end());
+        return objects;
+    };
+    expectInstances(all(), {});
+    EXPECT_EQ(instances.opaqueMeshes().at(cubeMesh).capacity, 5U);
+
+    /* In one frame, an object added and removed before the update, an old one removed, and enough new ones to grow the cube
+     * group twice past its capacity */
+    SceneObject *temp = add(cubeMesh, opaque);
+    scene.removeSceneObject(temp);
+    scene.removeSceneObject(cubes[0]);
+    cubes.erase(cubes.begin());
+    for (uint32_t i = 0; i < 8; i++) {
+        cubes.push_back(add(cubeMesh, opaque));
+    }
+    frame();
+    EXPECT_TRUE(instances.isBuilt());
+    expectInstances(all(), {});
+    /* Patched, not rebuilt, the group doubled from 5 to 10 and to 20 */
+    EXPECT_EQ(instances.opaqueMeshes().at(cubeMesh).sceneObjects.size(), 12U);
+    EXPECT_EQ(instances.opaqueMeshes().at(cubeMesh).capacity, 20U);
+
+    /* The objects of a material that becomes transparent move out of their group, and back */
+    glass->setTransparent(true);
+    frame();
+    SceneObjectVector opaqueObjects = cubes;
+    opaqueObjects.insert(opaqueObjects.end(), planes.begin(), planes.end());
+    expectInstances(opaqueObjects, glassCubes);
+
+    glass->setTransparent(false);
+    frame();
+    expectInstances(all(), {});
+}
+
+TEST_F(SceneTest, InstancesReuseRanges)
+{
+    Scene &scene = mEngine->scene();
+    InstancesManager &instances = scene.instancesManager();
+
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    Mesh *planeMesh = AssetManager::getInstance().modelsMap().get("assets/models/plane.obj")->mesh("Plane");
+    Material *opaque = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("rangesOpaque"));
+    Material *glass = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("rangesGlass"));
+    glass->setTransparent(true);
+
+    auto add = [&](Mesh *mesh, Material *material) {
+        SceneObject *so = scene.addSceneObject("instance", Transform({0, 0, 0}, {1, 1, 1}));
+        so->add<ComponentMesh>().setMesh(mesh);
+        so->add<ComponentMaterial>().setMaterial(material);
+        return so;
+    };
+    /* Every object is at its index in its group, and the groups and the transparent slots don't overlap */
+    auto expectInstances = [&]() {
+        std::vector<bool> used(instances.instancesEnd(), false);
+        auto use = [&](uint32_t index) {
+            ASSERT_LT(index, used.size());
+            EXPECT_FALSE(used[index]);
+            used[index] = true;
+        };
+        for (const auto &[mesh, group] : instances.opaqueMeshes()) {
+            for (uint32_t i = 0; i < group.capacity; i++) {
+                use(group.startIndex + i);
+            }
+            for (uint32_t i = 0; i < group.sceneObjects.size(); i++) {
+                SceneObject *so = group.sceneObjects[i];
+                EXPECT_EQ(instances.findInstanceDataIndex(so), group.startIndex + i);
+                EXPECT_EQ(static_cast<ID>(instances.findInstanceData(so)->id.r), so->getID());
+            }
+        }
+        for (SceneObject *so : instances.transparentMeshes()) {
+            use(instances.findInstanceDataIndex(so));
+            EXPECT_EQ(static_cast<ID>(instances.findInstanceData(so)->id.r), so->getID());
+        }
+    };
+
+    scene.update();
+    ASSERT_TRUE(instances.isBuilt());
+    for (uint32_t round = 0; round < 50; round++) {
+        /* Grow both groups one object at a time, with transparent objects taking single slots in between */
+        SceneObjectVector cubes, planes, glassCubes;
+        for (uint32_t i = 0; i < 24; i++) {
+            cubes.push_back(add(cubeMesh, opaque));
+            planes.push_back(add(planeMesh, opaque));
+            if (i % 4 == (round % 4)) {
+                glassCubes.push_back(add(cubeMesh, glass));
+            }
+            if (i % 8 == 0) {
+                scene.update();
+            }
+        }
+        scene.update();
+        ASSERT_TRUE(instances.isBuilt());
+        expectInstances();
+        /* Patched, a rebuild would fit the capacities to the objects */
+        EXPECT_EQ(instances.opaqueMeshes().at(cubeMesh).capacity, 32U);
+        EXPECT_EQ(instances.opaqueMeshes().at(planeMesh).capacity, 32U);
+        EXPECT_LE(instances.instancesEnd(), 128U);
+
+        /* Shrink, the planes group and half of the cubes go away */
+        SceneObjectVector removed = planes;
+        for (uint32_t i = 0; i < cubes.size(); i += 2) {
+            removed.push_back(cubes[i]);
+        }
+        scene.removeSceneObjects(removed);
+        scene.update();
+        expectInstances();
+        EXPECT_EQ(instances.opaqueMeshes().count(planeMesh), 0U);
+        EXPECT_EQ(instances.opaqueMeshes().at(cubeMesh).sceneObjects.size(), 12U);
+
+        /* Everything freed merges back into the end of the buffer */
+        removed.clear();
+        for (uint32_t i = 1; i < cubes.size(); i += 2) {
+            removed.push_back(cubes[i]);
+        }
+        removed.insert(removed.end(), glassCubes.begin(), glassCubes.end());
+        scene.removeSceneObjects(removed);
+        scene.update();
+        EXPECT_TRUE(instances.isBuilt());
+        EXPECT_TRUE(instances.opaqueMeshes().empty());
+        EXPECT_EQ(instances.instancesEnd(), 0U);
+    }
+}
+
+TEST_F(SceneTest, CullingLOD)
+{
+    Scene &scene = mEngine->scene();
+    InstancesManager &instances = scene.instancesManager();
+    instances.cullOpaque() = true;
+
+    auto camera = std::make_shared<PerspectiveCamera>();
+    camera->fov() = 60.0F;
+    camera->zfar() = 1000.0F;
+    camera->setWindowSize(800, 800);
+    camera->transform().position() = glm::vec3(0, 0, 0);
+    scene.camera() = camera;
+
+    Mesh *sphereMesh = AssetManager::getInstance().modelsMap().get("assets/models/uvsphere.obj")->mesh("defaultobject");
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    ASSERT_GT(sphereMesh->nLODs(), 1U);
+    ASSERT_EQ(cubeMesh->nLODs(), 1U);
+    Material *material = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("cullingLODOpaque"));
+
+    auto add = [&](Mesh *mesh, const glm::vec3 &position) {
+        SceneObject *so = scene.addSceneObject("culled", Transform(position, {1, 1, 1}));
+        so->add<ComponentMesh>().setMesh(mesh);
+        so->add<ComponentMaterial>().setMaterial(material);
+        return so;
+    };
+
+    /* The depth in front of the camera where a sphere has a screen size, from the same metric as cull() */
+    SceneData sceneData = scene.getSceneData();
+    glm::vec4 sizeRow = InstancesManager::screenSizeRow(sceneData.m_projection * sceneData.m_view);
+    float radius = 0.5F * glm::length(sphereMesh->aabb().max() - sphereMesh->aabb().min());
+    auto depth = [&](float screenSize) {
+        float distance0 = glm::dot(sizeRow, glm::vec4(0, 0, 0, 1));
+        float distancePerUnit = glm::dot(sizeRow, glm::vec4(0, 0, -1, 0));
+        return (radius / screenSize - distance0) / distancePerUnit;
+    };
+
+    /* l + 1 spheres at a screen size in the middle of the range of every level l */
+    std::map<SceneObject *, uint32_t> expectedLOD;
+    std::array<uint32_t, Mesh::MAX_LODS> expectedCounts{};
+    for (uint32_t l = 0; l < sphereMesh->nLODs(); l++) {
+        float screenSize = 1.5F * Mesh::LOD_SCREEN_SIZE;
+        if (l > 0) {
+            screenSize = Mesh::LOD_SCREEN_SIZE * std::pow(0.5F, static_cast<float>(l)) * std::sqrt(2.0F);
+        }
+        ASSERT_EQ(sphereMesh->selectLOD(screenSize), l);
+        float z = depth(screenSize);
+        for (uint32_t k = 0; k <= l; k++) {
+            expectedLOD[add(sphereMesh, {2.5F * k - 1.25F * l, 0, -z})] = l;
+        }
+        expectedCounts[l] = l + 1;
+    }
+
+    /* Outside of the frustum, behind the camera, far to the side and past the far plane */
+    add(sphereMesh, {0, 0, 20});
+    add(sphereMesh, {1000, 0, -20});
+    add(sphereMesh, {0, 0, -2000});
+
+    /* A mesh with a single level, one cube inside and one outside */
+    SceneObject *cube = add(cubeMesh, {0, 3, -20});
+    add(cubeMesh, {0, -500, -20});
+
+    scene.update();
+    scene.sortTransparent();
+    scene.cullInstances();
+
+    const std::vector<uint32_t> &visible = instances.visibleInstances();
+    const InstancesManager::MeshGroup &spheres = instances.opaqueMeshes().at(sphereMesh);
+    EXPECT_EQ(spheres.sceneObjects.size(), expectedLOD.size() + 3);
+    EXPECT_EQ(spheres.visibleCount, expectedLOD.size());
+    for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+        EXPECT_EQ(spheres.lodVisibleCount[l], expectedCounts[l]);
+    }
+
+    /* The visible instances of the group are sorted by level */
+    uint32_t v = spheres.startIndex;
+    for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+        for (uint32_t k = 0; k < spheres.lodVisibleCount[l]; k++, v++) {
+            SceneObject *so = spheres.sceneObjects[visible[v] - spheres.startIndex];
+            ASSERT_EQ(expectedLOD.count(so), 1U);
+            EXPECT_EQ(expectedLOD.at(so), l);
+        }
+    }
+
+    const InstancesManager::MeshGroup &cubes = instances.opaqueMeshes().at(cubeMesh);
+    EXPECT_EQ(cubes.visibleCount, 1U);
+    EXPECT_EQ(cubes.lodVisibleCount[0], 1U);
+    EXPECT_EQ(visible[cubes.startIndex], instances.findInstanceDataIndex(cube));
+
+    /* With twice the field of view every screen size halves, and every sphere is drawn one level lower */
+    camera->fov() = glm::degrees(2.0F * std::atan(2.0F * std::tan(glm::radians(30.0F))));
+    scene.cullInstances();
+    uint32_t nLODs = sphereMesh->nLODs();
+    EXPECT_EQ(spheres.lodVisibleCount[0], 0U);
+    for (uint32_t l = 1; l + 1 < nLODs; l++) {
+        EXPECT_EQ(spheres.lodVisibleCount[l], expectedCounts[l - 1]);
+    }
+    EXPECT_EQ(spheres.lodVisibleCount[nLODs - 1], expectedCounts[nLODs - 2] + expectedCounts[nLODs - 1]);
+}
+
+TEST_F(SceneTest, CullingGPU)
+{
+    VulkanScene &scene = static_cast<VulkanScene &>(mEngine->scene());
+    VulkanInstancesManager &instances = static_cast<VulkanInstancesManager &>(scene.instancesManager());
+    VulkanContext &ctx = mEngine->context();
+
+    /* A culling pass of its own, on the single image of the offline engine */
+    VulkanRendererCulling culling(ctx);
+    ASSERT_EQ(culling.initResources(scene.descriptorSetlayoutInstanceData()), VK_SUCCESS);
+    ASSERT_EQ(culling.initSwapChainResources(1), VK_SUCCESS);
+
+    auto camera = std::make_shared<PerspectiveCamera>();
+    camera->fov() = 60.0F;
+    camera->zfar() = 300.0F;
+    camera->setWindowSize(800, 600);
+    camera->transform().position() = glm::vec3(0, 0, 0);
+    scene.camera() = camera;
+
+    Mesh *sphereMesh = AssetManager::getInstance().modelsMap().get("assets/models/uvsphere.obj")->mesh("defaultobject");
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    Mesh *planeMesh = AssetManager::getInstance().modelsMap().get("assets/models/plane.obj")->mesh("Plane");
+    std::array<Mesh *, 3> meshes = {sphereMesh, cubeMesh, planeMesh};
+    Material *material = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("cullingGPUOpaque"));
+
+    /* Rotated and scaled objects around and behind the camera and past the far plane */
+    const uint32_t nObjects = 600;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> xy(-80.0F, 80.0F);
+    std::uniform_real_distribution<float> z(-400.0F, 30.0F);
+    std::uniform_real_distribution<float> scale(0.2F, 3.0F);
+    std::uniform_real_distribution<float> angle(0.0F, 6.28F);
+    for (uint32_t i = 0; i < nObjects; i++) {
+        SceneObject *so = scene.addSceneObject(
+            "culled", Transform({xy(gen), xy(gen) / 4, z(gen)}, glm::vec3(scale(gen)), glm::vec3(angle(gen), angle(gen), 0)));
+        so->add<ComponentMesh>().setMesh(meshes[i % meshes.size()]);
+        so->add<ComponentMaterial>().setMaterial(material);
+    }
+    scene.update();
+
+    /* The visible instances of every level of every group, culled on the CPU */
+    instances.cullOpaque() = true;
+    scene.cullInstances();
+    std::map<const Mesh *, std::array<std::set<uint32_t>, Mesh::MAX_LODS>> expected;
+    uint32_t nVisible = 0;
+    for (const auto &[mesh, group] : instances.opaqueMeshes()) {
+        auto &levels = expected[mesh];
+        uint32_t v = group.startIndex;
+        for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+            for (uint32_t k = 0; k < group.lodVisibleCount[l]; k++, v++) {
+                levels[l].insert(instances.visibleInstances()[v]);
+            }
+        }
+        nVisible += group.visibleCount;
+    }
+    EXPECT_GT(nVisible, 0U);
+    EXPECT_LT(nVisible, nObjects);
+    EXPECT_GT(expected[sphereMesh][1].size(), 0U);
+
+    /* The same view culled by the compute pass, on the instance data of the frame */
+    instances.cullOpaque() = false;
+    scene.cullInstances();
+    instances.updateBuffers(0);
+    SceneData sceneData = scene.getSceneData();
+    culling.updateBuffers(instances, sceneData.m_projection * sceneData.m_view, 0);
+
+    VkCommandBuffer commandBuffer;
+    ASSERT_EQ(beginSingleTimeCommands(ctx.device(), ctx.renderCommandPool(), commandBuffer), VK_SUCCESS);
+    culling.record(commandBuffer, scene.descriptorSetInstanceData(0), 0);
+    ASSERT_EQ(endSingleTimeCommands(ctx.device(), ctx.renderCommandPool(), ctx.queueManager().renderQueue(), commandBuffer),
+              VK_SUCCESS);
+
+    void *commandsData, *countsData, *visibleData;
+    vkMapMemory(ctx.device(), culling.drawCommandsBuffer(0).memory(), 0, VK_WHOLE_SIZE, 0, &commandsData);
+    vkMapMemory(ctx.device(), culling.drawCountsBuffer(0).memory(), 0, VK_WHOLE_SIZE, 0, &countsData);
+    vkMapMemory(ctx.device(), culling.visibleInstancesBuffer(0).memory(), 0, VK_WHOLE_SIZE, 0, &visibleData);
+    auto commands = static_cast<const VkDrawIndexedIndirectCommand *>(commandsData);
+    auto counts = static_cast<const uint32_t *>(countsData);
+    auto visible = static_cast<const uint32_t *>(visibleData);
+
+    /* Per group, the instance counts of the draw commands, the draw count and the visible instances match the CPU cull */
+    const std::vector<const VulkanMesh *> &groups = culling.meshGroups(0);
+    EXPECT_EQ(groups.size(), expected.size());
+    for (uint32_t g = 0; g < groups.size(); g++) {
+        const auto &levels = expected[groups[g]];
+        uint32_t drawCount = 0;
+        for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+            const VkDrawIndexedIndirectCommand &command = commands[g * Mesh::MAX_LODS + l];
+            EXPECT_EQ(command.instanceCount, levels[l].size());
+            std::set<uint32_t> gpuLevel(visible + command.firstInstance, visible + command.firstInstance + command.instanceCount);
+            EXPECT_EQ(gpuLevel, levels[l]);
+            if (!levels[l].empty()) {
+                drawCount = l + 1;
+            }
+        }
+        EXPECT_EQ(counts[g], drawCount);
+    }
+
+    vkUnmapMemory(ctx.device(), culling.drawCommandsBuffer(0).memory());
+    vkUnmapMemory(ctx.device(), culling.drawCountsBuffer(0).memory());
+    vkUnmapMemory(ctx.device(), culling.visibleInstancesBuffer(0).memory());
+
+    instances.cullOpaque() = true;
+    culling.releaseSwapChainResources();
+    culling.releaseResources();
+}
+
+TEST_F(SceneTest, BatchAddRemove)
+{
+    Scene &scene = mEngine->scene();
+    ComponentManager &cm = ComponentManager::getInstance();
+    Mesh *cubeMesh = AssetManager::getInstance().modelsMap().get("assets/models/cube.obj")->mesh("Cube");
+    Material *material = mEngine->materials().createMaterial<MaterialLambert>(AssetInfo("batchMaterial"));
+
+    SceneObject *anchor = scene.addSceneObject("anchor", Transform({-5, 0, 0}, {1, 1, 1}));
+    scene.update();
+    uint32_t nMeshes = cm.buffer<ComponentMesh>()->entitiesSize();
+    uint32_t nMaterials = cm.buffer<ComponentMaterial>()->entitiesSize();
+    uint32_t nBounds = scene.bvh().size();
+
+    /* root -> a -> a1, root -> b -> b1, and c under an object outside the batch. b only has a material */
+    std::vector<SceneObjectDesc> descs = {
+        {"root", Transform({1, 0, 0}, {1, 1, 1}), -1, nullptr, cubeMesh, material},
+        {"a", Transform({0, 2, 0}, {1, 1, 1}), 0, nullptr, cubeMesh, material},
+        {"a1", Transform({0, 0, 3}, {1, 1, 1}), 1, nullptr, cubeMesh, material},
+        {"b", Transform({0, -2, 0}, {1, 1, 1}), 0, nullptr, nullptr, material},
+        {"b1", Transform({0, 0, -3}, {1, 1, 1}), 3, nullptr, cubeMesh, material},
+        {"c", Transform({0, 1, 0}, {1, 1, 1}), -1, anchor, cubeMesh, nullptr},
+    };
+    SceneObjectVector objects = scene.addSceneObjects(descs);
+    ASSERT_EQ(objects.size(), descs.size());
+    SceneObject *root = objects[0], *a = objects[1], *a1 = objects[2], *b = objects[3], *b1 = objects[4], *c = objects[5];
+
+    EXPECT_EQ(root->parent(), nullptr);
+    EXPECT_EQ(static_cast<SceneObject *>(a->parent()), root);
+    EXPECT_EQ(static_cast<SceneObject *>(a1->parent()), a);
+    EXPECT_EQ(static_cast<SceneObject *>(b->parent()), root);
+    EXPECT_EQ(static_cast<SceneObject *>(b1->parent()), b);
+    EXPECT_EQ(static_cast<SceneObject *>(c->parent()), anchor);
+    EXPECT_EQ(root->children().size(), 2U);
+    EXPECT_EQ(scene.getSceneObjectsFlat().size(), 7U);
+    EXPECT_EQ(cm.buffer<ComponentMesh>()->entitiesSize(), nMeshes + 5);
+    EXPECT_EQ(cm.buffer<ComponentMaterial>()->entitiesSize(), nMaterials + 5);
+    EXPECT_FALSE(b->hasBounds());
+
+    /* The AABBs of the batch are computed by the first update, at the world positions */
+    EXPECT_EQ(a1->AABB().min(), glm::vec3(std::numeric_limits<float>::lowest()));
+    scene.update();
+    auto expectAABB = [](const SceneObject *so, const glm::vec3 &center) {
+        EXPECT_EQ(so->AABB().min(), center - glm::vec3(1));
+        EXPECT_EQ(so->AABB().max(), center + glm::vec3(1));
+    };
+    expectAABB(root, glm::vec3(1, 0, 0));
+    expectAABB(a, glm::vec3(1, 2, 0));
+    expectAABB(a1, glm::vec3(1, 2, 3));
+    expectAABB(b1, glm::vec3(1, -2, -3));
+    expectAABB(c, glm::vec3(-5, 1, 0));
+    EXPECT_EQ(scene.bvh().size(), nBounds + 5);
+
+    /* Remove the subtrees of a and b, a1 is listed with its ancestor and removed once */
+    std::vector<ID> removedIDs = {a->getID(), a1->getID(), b->getID(), b1->getID()};
+    SceneObjectVector removed = {a1, a, b};
+    scene.removeSceneObjects(removed);
+    EXPECT_TRUE(root->children().empty());
+    EXPECT_EQ(static_cast<SceneObject *>(c->parent()), anchor);
+    for (ID id : removedIDs) {
+        EXPECT_EQ(scene.findSceneObjectByID(id), nullptr);
+    }
+    EXPECT_EQ(scene.getSceneObjectsFlat().size(), 3U);
+    EXPECT_EQ(cm.buffer<ComponentMesh>()->entitiesSize(), nMeshes + 2);
+    EXPECT_EQ(cm.buffer<ComponentMaterial>()->entitiesSize(), nMaterials + 1);
+    EXPECT_EQ(scene.bvh().size(), nBounds + 2);
+
+    /* The objects that are left still move with their parents */
+    root->setLocalTransform(Transform({0, 0, 4}, {1, 1, 1}));
+    scene.update();
+    expectAABB(root, glm::vec3(0, 0, 4));
+    expectAABB(c, glm::vec3(-5, 1, 0));
+    EXPECT_EQ(scene.pick(Ray(glm::vec3(0, 0, 10), glm::vec3(0, 0, -1))), root);
+}
+
+TEST_F(SceneTest, SharedMeshes)
+{
+    /* The same triangle in three models, under different names */
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    auto writeModel = [&](const std::string &name) {
+        std::filesystem::path path = directory / ("vviewer_" + name + ".obj");
+        std::ofstream file(path);
+        file << "o " << name << "\nv 0 0 0\nv 3 0 0\nv 0 2 1\nvn 0 0 1\nf 1//1 2//1 3//1\n";
+        return path.string();
+    };
+    std::string pathA = writeModel("SharedA"), pathB = writeModel("SharedB"), pathC = writeModel("SharedC");
+
+    Model3D *modelA = mEngine->importModel(AssetInfo(pathA), false, false);
+    Model3D *modelB = mEngine->importModel(AssetInfo(pathB), false, false);
+    Model3D *modelC = mEngine->importModel(AssetInfo(pathC), false, true);
+    ASSERT_NE(modelA, nullptr);
+    ASSERT_NE(modelB, nullptr);
+    ASSERT_NE(modelC, nullptr);
+
+    /* A and B share the mesh even though it released its geometry after the first import, C keeps its own geometry */
+    Mesh *meshA = modelA->mesh("SharedA");
+    ASSERT_NE(meshA, nullptr);
+    EXPECT_EQ(modelB->mesh("SharedB"), meshA);
+    EXPECT_FALSE(meshA->hasGeometry());
+    Mesh *meshC = modelC->mesh("SharedC");
+    ASSERT_NE(meshC, nullptr);
+    EXPECT_NE(meshC, meshA);
+    EXPECT_TRUE(meshC->hasGeometry());
+    EXPECT_TRUE(meshC->sameContent(*meshA));
+
+    /* The names and the owning model come from the model, not from the shared mesh */
+    EXPECT_EQ(modelA->meshName(meshA), "SharedA");
+    EXPECT_EQ(modelB->meshName(meshA), "SharedB");
+    EXPECT_EQ(modelC->meshName(meshA), "");
+
+    Scene &scene = mEngine->scene();
+    SceneObject *a = scene.addSceneObject("a", Transform({0, 0, 0}, {1, 1, 1}));
+    SceneObject *b = scene.addSceneObject("b", Transform({5, 0, 0}, {1, 1, 1}));
+    a->add<ComponentMesh>().setMesh(meshA, modelA);
+    b->add<ComponentMesh>().setMesh(meshA, modelB);
+    EXPECT_EQ(a->get<ComponentMesh>().model(), modelA);
+    EXPECT_EQ(b->get<ComponentMesh>().model(), modelB);
+    EXPECT_EQ(a->get<ComponentMesh>().mesh(), b->get<ComponentMesh>().mesh());
+
+    std::filesystem::remove(pathA);
+    std::filesystem::remove(pathB);
+    std::filesystem::remove(pathC);
+}
@@ -22,5 +22,28 @@ protected:
     // You can define per-test tear-down logic as usual.
     void TearDown() override {}
 
+    static VulkanEngine *mEngine;
+};
+
+/* Tests of the scene on an offline engine */
+class SceneTest : public testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        mEngine = new VulkanEngine("unittests");
+        mEngine->initResources();
+    }
+
+    static void TearDownTestSuite() { mEngine->releaseResources(); }
+
+    void SetUp() override
+    {
+        mEngine->renderer().setSelectedObject(nullptr);
+        mEngine->scene().clear();
+    }
+
+    void TearDown() override {}
+
     static VulkanEngine *mEngine;
 };
\ No newline at end of file
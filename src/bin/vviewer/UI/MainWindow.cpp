@@ -38,6 +38,9 @@
 
 using namespace vengine;
 
+/* Imported meshes keep their geometry on the CPU, objects are picked against it in the viewport */
+static const bool KEEP_MESH_GEOMETRY = true;
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
@@ -90,10 +93,15 @@ QWidget *MainWindow::initViewport()
     QCheckBox *m_showAABBCheckBox = new QCheckBox();
     m_showAABBCheckBox->setChecked(m_engine->renderer().showSelectedAABB());
     connect(m_showAABBCheckBox, SIGNAL(stateChanged(int)), this, SLOT(onShowSelectedAABBSlot(int)));
+    QCheckBox *m_gpuCullingCheckBox = new QCheckBox();
+    m_gpuCullingCheckBox->setChecked(m_engine->renderer().gpuCulling());
+    connect(m_gpuCullingCheckBox, SIGNAL(stateChanged(int)), this, SLOT(onGPUCullingSlot(int)));
     /* Create options bar widget */
     QHBoxLayout *viewportOptionsLayout = new QHBoxLayout();
     viewportOptionsLayout->addWidget(new QLabel("AABB:"));
     viewportOptionsLayout->addWidget(m_showAABBCheckBox);
+    viewportOptionsLayout->addWidget(new QLabel("GPU culling:"));
+    viewportOptionsLayout->addWidget(m_gpuCullingCheckBox);
     viewportOptionsLayout->setAlignment(Qt::AlignLeft);
     viewportOptionsLayout->setContentsMargins(0, 0, 0, 0);
     QWidget *viewportOptionsWidget = new QWidget();
@@ -290,9 +298,9 @@ void MainWindow::addSceneObjectModel(QTreeWidgetItem *parentItem,
                 if (isRoot && overrideRootTransform.has_value()) {
                     nodeTransform = overrideRootTransform.value();
                 }
-                auto child = createEmptySceneObject(mesh->name(), nodeTransform, parent);
+                auto child = createEmptySceneObject(model->meshName(mesh), nodeTransform, parent);
 
-                child.second->add<ComponentMesh>().setMesh(mesh);
+                child.second->add<ComponentMesh>().setMesh(mesh, model);
                 if (overrideMat != nullptr) {
                     child.second->add<ComponentMaterial>().setMaterial(overrideMat);
                 } else if (mat != nullptr) {
@@ -336,7 +344,7 @@ void MainWindow::addImportedSceneObject(const Tree<ImportedSceneObject> &scene,
     if (object.mesh.has_value()) {
         auto model3D = instanceModels.get(object.mesh->modelName);
         auto mesh = model3D->mesh(object.mesh->submesh);
-        newSceneObject.second->add<ComponentMesh>().setMesh(mesh);
+        newSceneObject.second->add<ComponentMesh>().setMesh(mesh, model3D);
     }
 
     /* Add material component */
@@ -406,7 +414,7 @@ void MainWindow::onImportModelSlot()
         std::string filename;
         bool work(float &)
         {
-            bool ret = engine->importModel(AssetInfo(filename), true) != nullptr;
+            bool ret = engine->importModel(AssetInfo(filename), true, KEEP_MESH_GEOMETRY) != nullptr;
             if (ret) {
                 debug_tools::ConsoleInfo("Model imported");
             }
@@ -639,7 +647,7 @@ void MainWindow::onImportScene()
     /* Import models */
     for (auto &itr : models) {
         debug_tools::ConsoleInfo("Importing model: " + itr.filepath);
-        m_engine->importModel(AssetInfo(itr.name, itr.filepath), true);
+        m_engine->importModel(AssetInfo(itr.name, itr.filepath), true, KEEP_MESH_GEOMETRY);
     }
 
     /* Import materials */
@@ -834,7 +842,7 @@ void MainWindow::onAddMeshLightSlot()
 
     auto plane = instanceModels.get("assets/models/plane.obj");
 
-    newObject.second->add<ComponentMesh>().setMesh(plane->mesh("Plane"));
+    newObject.second->add<ComponentMesh>().setMesh(plane->mesh("Plane"), plane);
     newObject.second->add<ComponentMaterial>().setMaterial(matDefE);
 
     m_engine->start();
@@ -936,7 +944,8 @@ void MainWindow::onDuplicateSceneObjectSlot()
             newObject.second->add<ComponentLight>().setLight(l);
         }
         if (so->has<ComponentMesh>()) {
-            newObject.second->add<ComponentMesh>().setMesh(so->get<ComponentMesh>().mesh());
+            const ComponentMesh &meshComponent = so->get<ComponentMesh>();
+            newObject.second->add<ComponentMesh>().setMesh(meshComponent.mesh(), meshComponent.model());
         }
         if (so->has<ComponentMaterial>()) {
             newObject.second->add<ComponentMaterial>().setMaterial(so->get<ComponentMaterial>().material());
@@ -1056,10 +1065,19 @@ void MainWindow::onShowSelectedAABBSlot(int a)
     }
 }
 
+void MainWindow::onGPUCullingSlot(int a)
+{
+    if (a == 0) {
+        m_engine->renderer().gpuCulling() = false;
+    } else {
+        m_engine->renderer().gpuCulling() = true;
+    }
+}
+
 void MainWindow::onStartUpInitialization()
 {
     std::string assetName = "assets/models/DamagedHelmet.gltf";
-    m_engine->importModel(AssetInfo(assetName), true);
+    m_engine->importModel(AssetInfo(assetName), true, KEEP_MESH_GEOMETRY);
 
     auto &instanceModels = AssetManager::getInstance().modelsMap();
     auto &instanceMaterials = AssetManager::getInstance().materialsMap();
@@ -1076,7 +1094,7 @@ void MainWindow::onStartUpInitialization()
 
         {
             auto o = createEmptySceneObject("plane", Transform({0, -1, 0}, {10, 10, 10}), nullptr);
-            o.second->add<ComponentMesh>().setMesh(plane->mesh("Plane"));
+            o.second->add<ComponentMesh>().setMesh(plane->mesh("Plane"), plane);
             o.second->add<ComponentMaterial>().setMaterial(matDef);
         }
 
@@ -130,6 +130,8 @@ private Q_SLOTS:
 
     /* Show selected AABB slot */
     void onShowSelectedAABBSlot(int);
+    /* Toggle GPU culling slot */
+    void onGPUCullingSlot(int);
 
     /* Start up scene initialization */
     void onStartUpInitialization();
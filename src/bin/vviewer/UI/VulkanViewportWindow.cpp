@@ -131,8 +131,12 @@ void VulkanViewportWindow::mousePressEvent(QMouseEvent *ev)
         QPointF pos = ev->position();
         QSize size = this->size();
 
+        /* Pick between two frames, while the engine isn't updating the scene */
         VulkanRenderer &renderer = static_cast<VulkanRenderer &>(m_engine->renderer());
-        ID objectID = renderer.findID(pos.x() / size.width(), pos.y() / size.height());
+        ID objectID = 0;
+        m_engine->runBetweenFrames([&]() {
+            objectID = renderer.findID(pos.x() / size.width(), pos.y() / size.height(), m_engine->threadPool());
+        });
 
         m_selectedPressed = objectID;
     }
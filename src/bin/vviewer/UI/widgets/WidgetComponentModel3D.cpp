@@ -16,7 +16,7 @@ WidgetComponentModel3D::WidgetComponentModel3D(QWidget *parent, ComponentMesh &m
     : QWidget(parent)
     , m_meshComponent(meshComponent)
 {
-    m_model = meshComponent.mesh()->m_model;
+    m_model = meshComponent.model();
 
     QGroupBox *boxPickModel = new QGroupBox();
 
@@ -34,7 +34,7 @@ WidgetComponentModel3D::WidgetComponentModel3D(QWidget *parent, ComponentMesh &m
 
     m_meshes = new QComboBox();
     m_meshes->addItems(getModelMeshes(m_model));
-    m_meshes->setCurrentText(QString::fromStdString(meshComponent.mesh()->name()));
+    m_meshes->setCurrentText(QString::fromStdString(m_model->meshName(meshComponent.mesh())));
     connect(m_meshes, SIGNAL(currentIndexChanged(int)), this, SLOT(onMeshChangedSlot(int)));
     QHBoxLayout *layoutPickMesh = new QHBoxLayout();
     layoutPickMesh->addWidget(new QLabel("Mesh: "));
@@ -74,8 +74,8 @@ std::string WidgetComponentModel3D::getSelectedMesh() const
 QStringList WidgetComponentModel3D::getModelMeshes(const Model3D *model)
 {
     QStringList list;
-    for (auto itr : model->meshes()) {
-        list.push_back(QString::fromStdString(itr->name()));
+    for (auto &name : model->meshNames()) {
+        list.push_back(QString::fromStdString(name));
     }
     return list;
 }
@@ -94,10 +94,8 @@ void WidgetComponentModel3D::onMeshModelChangedSlot(int)
 void WidgetComponentModel3D::onMeshChangedSlot(int)
 {
     /* Find the mesh from the selected mesh model, and assign it to the scene object */
-    std::string selectedMesh = getSelectedMesh();
-    for (auto itr : m_model->meshes()) {
-        if (itr->name() == selectedMesh) {
-            m_meshComponent.setMesh(itr);
-        }
+    Mesh *mesh = m_model->mesh(getSelectedMesh());
+    if (mesh != nullptr) {
+        m_meshComponent.setMesh(mesh, m_model);
     }
 }
@@ -249,7 +249,7 @@ void WidgetRightPanel::onAddComponentMesh()
     m_engine->stop();
     m_engine->waitIdle();
 
-    m_object->add<ComponentMesh>().setMesh(sphere->meshes()[0]);
+    m_object->add<ComponentMesh>().setMesh(sphere->meshes()[0], sphere);
 
     m_engine->start();
 
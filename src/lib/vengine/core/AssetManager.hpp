@@ -15,6 +15,7 @@
 #include "Model3D.hpp"
 #include "EnvironmentMap.hpp"
 #include "Light.hpp"
+#include "MeshRegistry.hpp"
 
 namespace vengine
 {
@@ -100,6 +101,8 @@ public:
     AssetMap<Model3D> &modelsMap() { return m_modelsMap; }
     AssetMap<EnvironmentMap> &environmentsMapMap() { return m_environmentMapsMap; }
     AssetMap<Mesh> &meshesMap() { return m_meshesMap; }
+    /* The meshes of the imported models, shared between the models by their geometry */
+    MeshRegistry &meshRegistry() { return m_meshRegistry; }
 
 private:
     AssetManager() {}
@@ -112,6 +115,7 @@ private:
     AssetMap<Model3D> m_modelsMap;
     AssetMap<EnvironmentMap> m_environmentMapsMap;
     AssetMap<Mesh> m_meshesMap;
+    MeshRegistry m_meshRegistry;
 };
 
 }  // namespace vengine
@@ -1,6 +1,8 @@
 #ifndef __Engine_hpp__
 #define __Engine_hpp__
 
+#include <functional>
+
 #include "Scene.hpp"
 #include "Renderer.hpp"
 #include "Model3D.hpp"
@@ -38,9 +40,14 @@ public:
     virtual void stop() = 0;
     virtual void exit() = 0;
     virtual void waitIdle() = 0;
+    /* Run a function on the engine thread between two frames, while the scene isn't updated, and wait for it to finish.
+     * Lighter than a stop() and waitIdle() for short scene queries from other threads */
+    virtual void runBetweenFrames(const std::function<void()> &function) = 0;
 
-    virtual Mesh *createMesh(const Mesh& mesh) = 0;
-    virtual Model3D *importModel(const AssetInfo &info, bool importMaterials = true) = 0;
+    /* The mesh is moved from. Its vertices and indices are freed on the CPU after the upload, unless keepGeometry is set */
+    virtual Mesh *createMesh(Mesh &&mesh, bool keepGeometry = false) = 0;
+    /* Keep the geometry of the meshes on the CPU if they are picked with Scene::pick() */
+    virtual Model3D *importModel(const AssetInfo &info, bool importMaterials = true, bool keepGeometry = false) = 0;
     virtual EnvironmentMap *importEnvironmentMap(const AssetInfo &info, bool keepTexture = false) = 0;
 
     virtual void deleteImportedAssets() = 0;
@@ -0,0 +1,42 @@
+#include "FrameGraph.hpp"
+
+#include <cassert>
+
+namespace vengine
+{
+
+FrameGraphJobs buildFrameGraph(TaskGraph &graph, const FrameJobs &jobs)
+{
+    graph.clear();
+
+    FrameGraphJobs ids;
+
+    /* Submitting the frame recorded in the previous iteration doesn't touch the scene, so it overlaps with the scene update */
+    ids.submitFrame = graph.addJob("Submit frame", jobs.submitFrame);
+
+    /* Scene update */
+    ids.sceneGraph = graph.addJob("Scene graph", jobs.updateSceneGraph);
+    ids.instances = graph.addJob("Instances", jobs.updateInstances, {ids.sceneGraph});
+    ids.lightInstances = graph.addJob("Light instances", jobs.updateLightInstances, {ids.instances});
+    ids.transparentSort = graph.addJob("Transparent sort", jobs.sortTransparent, {ids.instances});
+    ids.culling = graph.addJob("Culling", jobs.cullInstances, {ids.transparentSort});
+
+    /* Buffer uploads, waiting for the GPU to release the frame resources overlaps with the scene update */
+    ids.beginFrame = graph.addJob("Begin frame", jobs.beginFrame, {ids.submitFrame});
+    ids.sceneBuffers = graph.addJob("Scene buffers", jobs.updateSceneBuffers, {ids.beginFrame, ids.lightInstances, ids.culling});
+    ids.materialBuffers = graph.addJob("Material buffers", jobs.updateMaterialBuffers, {ids.beginFrame});
+    ids.textures = graph.addJob("Textures", jobs.updateTextures, {ids.beginFrame});
+
+    /* Pass recording */
+    ids.recordDeferredPass =
+        graph.addJob("Record deferred pass", jobs.recordDeferredPass, {ids.sceneBuffers, ids.materialBuffers, ids.textures});
+    ids.recordOverlayPass = graph.addJob("Record overlay pass", jobs.recordOverlayPass, {ids.sceneBuffers});
+    ids.recordOutputPass = graph.addJob("Record output pass", jobs.recordOutputPass, {ids.beginFrame});
+
+    /* The scene buffers and the TLAS build iterate the transparent objects in their sorted order */
+    assert(graph.dependsOn(ids.sceneBuffers, ids.transparentSort));
+
+    return ids;
+}
+
+}  // namespace vengine
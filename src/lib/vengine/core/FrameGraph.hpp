@@ -0,0 +1,60 @@
+#ifndef __FrameGraph_hpp__
+#define __FrameGraph_hpp__
+
+#include <functional>
+
+#include "vengine/utils/TaskGraph.hpp"
+
+namespace vengine
+{
+
+/* The work of the CPU jobs of a frame */
+struct FrameJobs {
+    /* Scene update */
+    std::function<void()> updateSceneGraph;
+    std::function<void()> updateInstances;
+    std::function<void()> updateLightInstances;
+    std::function<void()> sortTransparent;
+    std::function<void()> cullInstances;
+    /* Frame submission and buffer uploads */
+    std::function<void()> submitFrame;
+    std::function<void()> beginFrame;
+    std::function<void()> updateSceneBuffers;
+    std::function<void()> updateMaterialBuffers;
+    std::function<void()> updateTextures;
+    /* Pass recording */
+    std::function<void()> recordDeferredPass;
+    std::function<void()> recordOverlayPass;
+    std::function<void()> recordOutputPass;
+};
+
+/* The ids of the frame jobs in the graph */
+struct FrameGraphJobs {
+    TaskGraph::JobID submitFrame;
+    TaskGraph::JobID sceneGraph;
+    TaskGraph::JobID instances;
+    TaskGraph::JobID lightInstances;
+    TaskGraph::JobID transparentSort;
+    TaskGraph::JobID culling;
+    TaskGraph::JobID beginFrame;
+    TaskGraph::JobID sceneBuffers;
+    TaskGraph::JobID materialBuffers;
+    TaskGraph::JobID textures;
+    TaskGraph::JobID recordDeferredPass;
+    TaskGraph::JobID recordOverlayPass;
+    TaskGraph::JobID recordOutputPass;
+};
+
+/**
+ * @brief Build the graph of the CPU jobs of a frame. Submitting the previous frame overlaps with the scene update, buffer
+ * uploads wait for the scene update jobs they read, and passes are recorded after the buffers they use are uploaded
+ *
+ * @param graph Cleared and filled with the jobs
+ * @param jobs The work of every job
+ * @return The ids of the jobs
+ */
+FrameGraphJobs buildFrameGraph(TaskGraph &graph, const FrameJobs &jobs);
+
+}  // namespace vengine
+
+#endif
@@ -1,11 +1,21 @@
 #include "Instances.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
 #include "Scene.hpp"
 #include "SceneObject.hpp"
+#include "utils/Parallel.hpp"
 
 namespace vengine
 {
 
+/* Minimum number of AABBs a culling task tests */
+static const uint32_t CULL_MIN_GRAIN = 1024;
+/* Minimum number of sort keys a task computes */
+static const uint32_t SORT_KEYS_MIN_GRAIN = 4096;
+
 InstancesManager::InstancesManager(Scene *scene)
     : m_scene(scene)
 {
@@ -26,8 +36,7 @@ void InstancesManager::build()
         return;
     }
 
-    SceneObjectVector sceneObjects = m_scene->getSceneObjectsFlat();
-    fillSceneObjectVectors(sceneObjects);
+    fillSceneObjectVectors();
     buildInstanceDataFromScratch();
 
     m_isBuilt = true;
@@ -42,10 +51,44 @@ void InstancesManager::invalidate()
     m_volumes.clear();
 
     m_sceneObjectMap.clear();
+    m_records.clear();
+    m_freeRanges.clear();
+    m_instancesEnd = 0;
+
+    m_visibleInstances.clear();
+    m_visibleTransparent.clear();
 
     m_isBuilt = false;
 }
 
+void InstancesManager::update(const std::unordered_set<SceneObject *> &sceneObjects)
+{
+    /* If not built, the next build() gathers everything anyway */
+    if (!isBuilt()) {
+        return;
+    }
+
+    for (SceneObject *sceneObject : sceneObjects) {
+        removeInstances(sceneObject);
+    }
+    for (SceneObject *sceneObject : sceneObjects) {
+        if (!addInstances(sceneObject)) {
+            /* Out of space in the instance buffer, rebuild compacted */
+            invalidate();
+            return;
+        }
+    }
+}
+
+void InstancesManager::removeSceneObject(SceneObject *so)
+{
+    if (!isBuilt()) {
+        return;
+    }
+
+    removeInstances(so);
+}
+
 InstanceData *InstancesManager::findInstanceData(SceneObject *so) const
 {
     auto itr = m_sceneObjectMap.find(so);
@@ -64,13 +107,122 @@ uint32_t InstancesManager::findInstanceDataIndex(SceneObject *so) const
     return static_cast<uint32_t>(instanceDataPtr - &m_instancesBuffer[0]);
 }
 
-void InstancesManager::sortTransparent(const glm::vec3 &pos)
+void InstancesManager::sortTransparent(const glm::vec3 &pos, ThreadPool &threadPool)
 {
-    std::sort(m_transparent.begin(), m_transparent.end(), [&](SceneObject *a, SceneObject *b) {
-        float d1 = glm::distance(pos, a->worldPosition());
-        float d2 = glm::distance(pos, b->worldPosition());
-        return d1 > d2;
+    uint32_t nObjects = static_cast<uint32_t>(m_transparent.size());
+    m_transparentKeys.resize(nObjects);
+    parallelFor(threadPool, 0, nObjects, SORT_KEYS_MIN_GRAIN, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            glm::vec3 d = m_transparent[i]->worldPosition() - pos;
+            /* The bits of positive floats order like the floats, inverted to sort far to near */
+            m_transparentKeys[i] = ~std::bit_cast<uint32_t>(glm::dot(d, d));
+        }
     });
+
+    /* The camera and the objects didn't move enough to change the order */
+    if (std::is_sorted(m_transparentKeys.begin(), m_transparentKeys.end()))
+        return;
+
+    m_transparentSorter.sort(m_transparentKeys, m_transparent, threadPool);
+
+    for (uint32_t i = 0; i < m_transparent.size(); i++) {
+        m_records.find(m_transparent[i])->second.transparentIndex = i;
+    }
+}
+
+glm::vec4 InstancesManager::screenSizeRow(const glm::mat4 &viewProjection)
+{
+    /* The view matrix is a rigid transform, so the length of the y row is the projection's scale of y */
+    glm::vec4 wRow(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    float yScale = glm::length(glm::vec3(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]));
+    return wRow / yScale;
+}
+
+void InstancesManager::cull(const glm::mat4 &viewProjection, ThreadPool &threadPool)
+{
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    glm::vec4 sizeRow = screenSizeRow(viewProjection);
+
+    /* Opaque groups and transparent objects in one flat index space, so that the tests are split evenly between the tasks */
+    m_cullRanges.clear();
+    uint32_t nObjects = 0;
+    if (m_cullOpaque) {
+        for (auto &meshGroup : m_instancesOpaque) {
+            m_cullRanges.push_back({&meshGroup.second.sceneObjects, nObjects, meshGroup.first});
+            nObjects += static_cast<uint32_t>(meshGroup.second.sceneObjects.size());
+        }
+    }
+    m_cullRanges.push_back({&m_transparent, nObjects, nullptr});
+    nObjects += static_cast<uint32_t>(m_transparent.size());
+
+    m_cullVisible.resize(nObjects);
+    parallelFor(threadPool, 0, nObjects, CULL_MIN_GRAIN, [&](uint32_t begin, uint32_t end) {
+        /* The last range that starts at or before begin */
+        auto range = std::upper_bound(m_cullRanges.begin(),
+                                      m_cullRanges.end(),
+                                      begin,
+                                      [](uint32_t i, const CullRange &r) { return i < r.begin; }) -
+                     1;
+        for (uint32_t i = begin; i < end; i++) {
+            while (i >= range->begin + range->sceneObjects->size()) {
+                ++range;
+            }
+            const SceneObject *sceneObject = (*range->sceneObjects)[i - range->begin];
+            const AABB3 &aabb = sceneObject->AABB();
+            if (!frustum.intersects(aabb)) {
+                m_cullVisible[i] = 0;
+                continue;
+            }
+
+            /* Visible, store 1 + the level of detail. The bounding sphere of the AABB gives the screen size */
+            uint32_t lod = 0;
+            if (range->mesh != nullptr && range->mesh->nLODs() > 1) {
+                float distance = glm::dot(sizeRow, glm::vec4(0.5F * (aabb.min() + aabb.max()), 1.0F));
+                if (distance > 0.0F) {
+                    lod = range->mesh->selectLOD(0.5F * glm::length(aabb.max() - aabb.min()) / distance);
+                }
+            }
+            m_cullVisible[i] = static_cast<uint8_t>(1 + lod);
+        }
+    });
+
+    /* Compact the visible instances of every group at the start of the group's range, sorted by level of detail */
+    m_visibleInstances.resize(m_instancesEnd);
+    uint32_t i = 0;
+    for (auto &meshGroup : m_instancesOpaque) {
+        MeshGroup &group = meshGroup.second;
+        uint32_t nGroupObjects = static_cast<uint32_t>(group.sceneObjects.size());
+
+        group.visibleCount = 0;
+        group.lodVisibleCount.fill(0);
+        if (!m_cullOpaque)
+            continue;
+        for (uint32_t index = 0; index < nGroupObjects; index++) {
+            if (m_cullVisible[i + index]) {
+                group.lodVisibleCount[m_cullVisible[i + index] - 1]++;
+            }
+        }
+
+        std::array<uint32_t, Mesh::MAX_LODS> lodOffsets;
+        for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+            lodOffsets[l] = group.startIndex + group.visibleCount;
+            group.visibleCount += group.lodVisibleCount[l];
+        }
+        for (uint32_t index = 0; index < nGroupObjects; index++, i++) {
+            if (m_cullVisible[i]) {
+                m_visibleInstances[lodOffsets[m_cullVisible[i] - 1]++] = group.startIndex + index;
+            }
+        }
+    }
+
+    m_visibleTransparent.clear();
+    for (SceneObject *sceneObject : m_transparent) {
+        if (m_cullVisible[i++]) {
+            uint32_t index = findInstanceDataIndex(sceneObject);
+            m_visibleInstances[index] = index;
+            m_visibleTransparent.push_back(sceneObject);
+        }
+    }
 }
 
 void InstancesManager::initInstanceData(InstanceData *instanceData, SceneObject *so)
@@ -97,51 +249,87 @@ void InstancesManager::initInstanceData(InstanceData *instanceData, SceneObject
     }
 }
 
-void InstancesManager::fillSceneObjectVectors(SceneObjectVector &sceneGraph)
+bool InstancesManager::isInstanced(const SceneObject *sceneObject) const
 {
-    for (SceneObject *sceneObject : sceneGraph) {
-        if (!sceneObject->isActive())
+    return sceneObject->scene() == m_scene && sceneObject->isActive();
+}
+
+void InstancesManager::fillSceneObjectVectors()
+{
+    ComponentManager &cm = ComponentManager::getInstance();
+
+    for (auto [entity, meshComponent, materialComponent] : cm.view<ComponentMesh, ComponentMaterial>()) {
+        SceneObject *sceneObject = static_cast<SceneObject *>(entity);
+        if (!isInstanced(sceneObject))
             continue;
 
-        if (sceneObject->has<ComponentMesh>()) {
-            Mesh *mesh = sceneObject->get<ComponentMesh>().mesh();
+        gatherMesh(sceneObject, meshComponent.mesh(), materialComponent.material());
+    }
 
-            if (sceneObject->has<ComponentMaterial>()) {
-                Material *material = sceneObject->get<ComponentMaterial>().material();
+    for (auto [entity, lightComponent] : cm.view<ComponentLight>()) {
+        SceneObject *sceneObject = static_cast<SceneObject *>(entity);
+        if (!isInstanced(sceneObject))
+            continue;
 
-                if (material->isEmissive()) {
-                    m_meshLights.push_back(sceneObject);
-                }
+        if (lightComponent.light() != nullptr)
+            gatherLight(sceneObject);
+    }
 
-                if (!material->isTransparent()) {
-                    /* Search mesh in existing groups */
-                    auto itr = m_instancesOpaque.find(mesh);
-                    if (itr == m_instancesOpaque.end()) {
-                        MeshGroup meshGroup;
-                        meshGroup.sceneObjects.push_back(sceneObject);
-
-                        m_instancesOpaque.insert({mesh, meshGroup});
-                    } else {
-                        itr->second.sceneObjects.push_back(sceneObject);
-                    }
-                } else {
-                    m_transparent.push_back(sceneObject);
-                }
-            }
-        }
-        if (sceneObject->has<ComponentLight>()) {
-            ComponentLight &lightComponent = sceneObject->get<ComponentLight>();
-            if (lightComponent.light() != nullptr)
-                m_lights.push_back(sceneObject);
-        }
-        if (sceneObject->has<ComponentVolume>()) {
-            ComponentVolume &volumeComponent = sceneObject->get<ComponentVolume>();
-            if (volumeComponent.frontFacing() != nullptr || volumeComponent.backFacing() != nullptr)
-                m_volumes.push_back(sceneObject);
-        }
+    for (auto [entity, volumeComponent] : cm.view<ComponentVolume>()) {
+        SceneObject *sceneObject = static_cast<SceneObject *>(entity);
+        if (!isInstanced(sceneObject))
+            continue;
+
+        if (volumeComponent.frontFacing() != nullptr || volumeComponent.backFacing() != nullptr)
+            gatherVolume(sceneObject);
+    }
+}
+
+void InstancesManager::gatherMesh(SceneObject *sceneObject, Mesh *mesh, Material *material)
+{
+    InstanceRecord &record = m_records[sceneObject];
+
+    if (material->isEmissive()) {
+        pushBack(m_meshLights, sceneObject, record.meshLightIndex);
+    }
+
+    if (!material->isTransparent()) {
+        record.meshGroup = mesh;
+        pushBack(m_instancesOpaque[mesh].sceneObjects, sceneObject, record.groupIndex);
+    } else {
+        pushBack(m_transparent, sceneObject, record.transparentIndex);
     }
 }
 
+void InstancesManager::gatherLight(SceneObject *sceneObject)
+{
+    pushBack(m_lights, sceneObject, m_records[sceneObject].lightIndex);
+}
+
+void InstancesManager::gatherVolume(SceneObject *sceneObject)
+{
+    pushBack(m_volumes, sceneObject, m_records[sceneObject].volumeIndex);
+}
+
+void InstancesManager::pushBack(SceneObjectVector &sceneObjects, SceneObject *sceneObject, uint32_t &index)
+{
+    index = static_cast<uint32_t>(sceneObjects.size());
+    sceneObjects.push_back(sceneObject);
+}
+
+void InstancesManager::swapRemove(SceneObjectVector &sceneObjects, uint32_t index, uint32_t InstanceRecord::*recordIndex)
+{
+    if (index == INVALID_INDEX)
+        return;
+
+    uint32_t last = static_cast<uint32_t>(sceneObjects.size() - 1);
+    if (index != last) {
+        sceneObjects[index] = sceneObjects[last];
+        m_records.find(sceneObjects[index])->second.*recordIndex = index;
+    }
+    sceneObjects.pop_back();
+}
+
 void InstancesManager::buildInstanceDataFromScratch()
 {
     uint32_t currentIndex = 0;
@@ -150,6 +338,7 @@ void InstancesManager::buildInstanceDataFromScratch()
         meshGroup.second.startIndex = currentIndex;
 
         uint32_t nObjects = static_cast<uint32_t>(meshGroup.second.sceneObjects.size());
+        meshGroup.second.capacity = nObjects;
         assert(currentIndex + nObjects < m_instancesBufferSize);
         for (uint32_t index = 0; index < nObjects; ++index) {
             SceneObject *sceneObject = meshGroup.second.sceneObjects[index];
@@ -171,6 +360,10 @@ void InstancesManager::buildInstanceDataFromScratch()
     }
 
     for (SceneObject *&sceneObject : m_lights) {
+        /* Lights with a mesh already have an instance */
+        if (m_sceneObjectMap.find(sceneObject) != m_sceneObjectMap.end())
+            continue;
+
         assert(currentIndex < m_instancesBufferSize);
 
         initInstanceData(&m_instancesBuffer[currentIndex], sceneObject);
@@ -178,6 +371,188 @@ void InstancesManager::buildInstanceDataFromScratch()
 
         currentIndex++;
     }
+
+    m_instancesEnd = currentIndex;
+}
+
+bool InstancesManager::addInstances(SceneObject *so)
+{
+    if (!isInstanced(so))
+        return true;
+
+    if (so->has<ComponentMesh>() && so->has<ComponentMaterial>()) {
+        gatherMesh(so, so->get<ComponentMesh>().mesh(), so->get<ComponentMaterial>().material());
+    }
+    if (so->has<ComponentLight>() && so->get<ComponentLight>().light() != nullptr) {
+        gatherLight(so);
+    }
+    if (so->has<ComponentVolume>()) {
+        ComponentVolume &volumeComponent = so->get<ComponentVolume>();
+        if (volumeComponent.frontFacing() != nullptr || volumeComponent.backFacing() != nullptr)
+            gatherVolume(so);
+    }
+
+    auto itr = m_records.find(so);
+    if (itr == m_records.end())
+        return true;
+    const InstanceRecord &record = itr->second;
+
+    /* Find a slot in the instance buffer, objects that are only volumes don't have one */
+    uint32_t slot;
+    if (record.meshGroup != nullptr) {
+        MeshGroup &meshGroup = m_instancesOpaque[record.meshGroup];
+        if (!growMeshGroup(meshGroup))
+            return false;
+        slot = meshGroup.startIndex + record.groupIndex;
+    } else if (record.transparentIndex != INVALID_INDEX || record.lightIndex != INVALID_INDEX) {
+        if (!allocateSlot(slot))
+            return false;
+    } else {
+        return true;
+    }
+
+    initInstanceData(&m_instancesBuffer[slot], so);
+    m_sceneObjectMap[so] = &m_instancesBuffer[slot];
+
+    return true;
+}
+
+void InstancesManager::removeInstances(SceneObject *so)
+{
+    auto itr = m_records.find(so);
+    if (itr == m_records.end())
+        return;
+    InstanceRecord record = itr->second;
+    m_records.erase(itr);
+
+    auto instanceItr = m_sceneObjectMap.find(so);
+    if (instanceItr != m_sceneObjectMap.end()) {
+        uint32_t slot = static_cast<uint32_t>(instanceItr->second - m_instancesBuffer);
+        m_sceneObjectMap.erase(instanceItr);
+
+        if (record.meshGroup != nullptr) {
+            removeFromMeshGroup(record.meshGroup, record.groupIndex);
+        } else {
+            freeRange(slot, 1);
+        }
+    }
+
+    swapRemove(m_transparent, record.transparentIndex, &InstanceRecord::transparentIndex);
+    swapRemove(m_lights, record.lightIndex, &InstanceRecord::lightIndex);
+    swapRemove(m_meshLights, record.meshLightIndex, &InstanceRecord::meshLightIndex);
+    swapRemove(m_volumes, record.volumeIndex, &InstanceRecord::volumeIndex);
+}
+
+void InstancesManager::removeFromMeshGroup(Mesh *mesh, uint32_t index)
+{
+    MeshGroup &meshGroup = m_instancesOpaque[mesh];
+
+    /* Move the last instance of the group in the hole */
+    uint32_t last = static_cast<uint32_t>(meshGroup.sceneObjects.size() - 1);
+    if (index != last) {
+        SceneObject *moved = meshGroup.sceneObjects[last];
+        meshGroup.sceneObjects[index] = moved;
+        m_records.find(moved)->second.groupIndex = index;
+
+        m_instancesBuffer[meshGroup.startIndex + index] = m_instancesBuffer[meshGroup.startIndex + last];
+        m_sceneObjectMap[moved] = &m_instancesBuffer[meshGroup.startIndex + index];
+    }
+    meshGroup.sceneObjects.pop_back();
+
+    if (meshGroup.sceneObjects.empty()) {
+        freeRange(meshGroup.startIndex, meshGroup.capacity);
+        m_instancesOpaque.erase(mesh);
+    }
+}
+
+bool InstancesManager::growMeshGroup(MeshGroup &meshGroup)
+{
+    uint32_t nObjects = static_cast<uint32_t>(meshGroup.sceneObjects.size());
+    if (nObjects <= meshGroup.capacity)
+        return true;
+
+    /* Free the old range first, so that it merges with its free neighbors and the larger range can overlap it. The instances
+     * stay in the buffer until they are moved */
+    uint32_t capacity = std::max(2 * meshGroup.capacity, MESH_GROUP_MIN_CAPACITY);
+    freeRange(meshGroup.startIndex, meshGroup.capacity);
+    uint32_t startIndex;
+    if (!allocateRange(capacity, startIndex))
+        return false;
+
+    /* The last object is the one being added, it doesn't have an instance yet. The ranges may overlap */
+    if (startIndex != meshGroup.startIndex) {
+        InstanceData *first = &m_instancesBuffer[meshGroup.startIndex];
+        InstanceData *last = first + (nObjects - 1);
+        if (startIndex < meshGroup.startIndex) {
+            std::copy(first, last, &m_instancesBuffer[startIndex]);
+        } else {
+            std::copy_backward(first, last, &m_instancesBuffer[startIndex] + (nObjects - 1));
+        }
+        for (uint32_t index = 0; index + 1 < nObjects; index++) {
+            m_sceneObjectMap[meshGroup.sceneObjects[index]] = &m_instancesBuffer[startIndex + index];
+        }
+    }
+
+    meshGroup.startIndex = startIndex;
+    meshGroup.capacity = capacity;
+
+    return true;
+}
+
+bool InstancesManager::allocateSlot(uint32_t &slot)
+{
+    return allocateRange(1, slot);
+}
+
+bool InstancesManager::allocateRange(uint32_t count, uint32_t &startIndex)
+{
+    for (auto itr = m_freeRanges.begin(); itr != m_freeRanges.end(); ++itr) {
+        if (itr->second < count)
+            continue;
+
+        /* Take the start of the range, the rest stays free */
+        startIndex = itr->first;
+        uint32_t remaining = itr->second - count;
+        m_freeRanges.erase(itr);
+        if (remaining > 0) {
+            m_freeRanges.emplace(startIndex + count, remaining);
+        }
+        return true;
+    }
+
+    if (m_instancesEnd + count > m_instancesBufferSize)
+        return false;
+    startIndex = m_instancesEnd;
+    m_instancesEnd += count;
+    return true;
+}
+
+void InstancesManager::freeRange(uint32_t startIndex, uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    /* Merge with the free ranges right before and right after */
+    auto next = m_freeRanges.lower_bound(startIndex);
+    if (next != m_freeRanges.begin()) {
+        auto previous = std::prev(next);
+        assert(previous->first + previous->second <= startIndex);
+        if (previous->first + previous->second == startIndex) {
+            startIndex = previous->first;
+            count += previous->second;
+            m_freeRanges.erase(previous);
+        }
+    }
+    if (next != m_freeRanges.end() && startIndex + count == next->first) {
+        count += next->second;
+        m_freeRanges.erase(next);
+    }
+
+    if (startIndex + count == m_instancesEnd) {
+        m_instancesEnd = startIndex;
+    } else {
+        m_freeRanges.emplace(startIndex, count);
+    }
 }
 
-}  // namespace vengine
\ No newline at end of file
+}  // namespace vengine
@@ -1,9 +1,16 @@
 #ifndef __Instances_hpp__
 #define __Instances_hpp__
 
+#include <array>
+#include <map>
+#include <unordered_set>
+
 #include "glm/glm.hpp"
 
+#include "math/Frustum.hpp"
 #include "utils/IDGeneration.hpp"
+#include "utils/RadixSort.hpp"
+#include "utils/ThreadPool.hpp"
 #include "Material.hpp"
 #include "Mesh.hpp"
 #include "SceneObject.hpp"
@@ -27,12 +34,14 @@ struct InstanceData {
     uint64_t indexAddress;
     /* The number of triangles in the index buffer */
     uint32_t numTriangles;
+    /* The size of an index in bytes, 2 or 4 */
+    uint32_t indexSize;
 
-    uint32_t padding1;
     uint32_t padding2;
     uint32_t padding3;
     uint32_t padding4;
-}; /* sizeof(LightInstance) = 120 */
+}; /* sizeof(InstanceData) = 128 */
+static_assert(sizeof(InstanceData) == 128);
 
 /* A GPU clone */
 /* Describes the instance of a light */
@@ -52,6 +61,12 @@ public:
         SceneObjectVector sceneObjects;
         /* starting index for m_instancesBuffer */
         uint32_t startIndex = 0;
+        /* number of instances reserved for the group in m_instancesBuffer starting at startIndex */
+        uint32_t capacity = 0;
+        /* number of visible instances found by cull(), stored in visibleInstances() starting at startIndex */
+        uint32_t visibleCount = 0;
+        /* number of visible instances per level of detail of the mesh, the visible instances are sorted by level */
+        std::array<uint32_t, Mesh::MAX_LODS> lodVisibleCount{};
     };
 
     typedef std::unordered_map<SceneObject *, InstanceData *> SceneObjectInstanceMap;
@@ -69,8 +84,22 @@ public:
     virtual void build();
     bool isBuilt() const { return m_isBuilt; }
 
+    /* Fill the light instance data of the light objects found by build(). Runs every frame since lights can move */
+    virtual void buildLightInstances(){};
+
     void invalidate();
 
+    /**
+     * @brief Update the instances of some scene objects, without touching the rest. Objects that are no longer instanced are
+     * removed. If the instance buffer runs out of space, the manager is invalidated and the next build() starts from scratch
+     *
+     * @param sceneObjects The scene objects that changed
+     */
+    void update(const std::unordered_set<SceneObject *> &sceneObjects);
+
+    /* Remove the instances of a scene object that is about to be deleted */
+    void removeSceneObject(SceneObject *so);
+
     const std::unordered_map<Mesh *, MeshGroup> &opaqueMeshes() const { return m_instancesOpaque; }
     const SceneObjectVector &transparentMeshes() const { return m_transparent; }
     const SceneObjectVector &lights() const { return m_lights; }
@@ -78,10 +107,47 @@ public:
     const SceneObjectVector &volumes() const { return m_volumes; }
 
     const SceneObjectInstanceMap &sceneObjectInstanceMap() const { return m_sceneObjectMap; }
+    /* End of the used part of the instance data buffer */
+    uint32_t instancesEnd() const { return m_instancesEnd; }
     InstanceData *findInstanceData(SceneObject *so) const;
     uint32_t findInstanceDataIndex(SceneObject *so) const;
 
-    void sortTransparent(const glm::vec3 &pos);
+    /**
+     * @brief Sort the transparent objects back to front by their distance from a point. The distances are computed once per
+     * object and radix sorted, and if they are still in order from the last sort nothing is moved
+     *
+     * @param pos The camera position
+     * @param threadPool Used to compute the distances and sort in parallel
+     */
+    void sortTransparent(const glm::vec3 &pos, ThreadPool &threadPool);
+
+    /**
+     * @brief Find the instances whose world AABB intersects the camera frustum. The visible instances of every mesh group are
+     * written compacted to visibleInstances() and sorted by the level of detail selected for their screen size, and the
+     * visible transparent objects to visibleTransparentMeshes() in sorted order. Transparent objects always use level 0
+     *
+     * @param viewProjection The camera projection * view matrix
+     * @param threadPool Used to test the AABBs in parallel
+     */
+    void cull(const glm::mat4 &viewProjection, ThreadPool &threadPool);
+
+    /**
+     * @brief The screen size of a bounding sphere, as passed to Mesh::selectLOD(), is its radius over the dot product of this
+     * row with its center. It's the clip space w row of the view projection, divided by the vertical projection scale
+     *
+     * @param viewProjection
+     * @return glm::vec4
+     */
+    static glm::vec4 screenSizeRow(const glm::mat4 &viewProjection);
+
+    /* If false, cull() only tests the transparent objects and leaves the visibleCount of the opaque groups to 0, for renderers
+     * that cull the opaque instances on the GPU */
+    bool &cullOpaque() { return m_cullOpaque; }
+
+    /* Instance data indices indexed like the instance data buffer. After cull(), the visible instances of a mesh group are
+     * [startIndex, startIndex + visibleCount), and the entry of a visible transparent object is its own index */
+    const std::vector<uint32_t> &visibleInstances() const { return m_visibleInstances; }
+    const SceneObjectVector &visibleTransparentMeshes() const { return m_visibleTransparent; }
 
 protected:
     /* Holds all opaque mesh instances in the scene */
@@ -108,14 +174,75 @@ protected:
     virtual void initInstanceData(InstanceData *instanceData, SceneObject *so);
 
 private:
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+    /* Capacity of a mesh group when it's first created or moved by an update */
+    static constexpr uint32_t MESH_GROUP_MIN_CAPACITY = 4;
+
+    /* Where a scene object is stored, indices are INVALID_INDEX if the object is not in that vector */
+    struct InstanceRecord {
+        /* Mesh of the group of an opaque object, nullptr otherwise */
+        Mesh *meshGroup = nullptr;
+        uint32_t groupIndex = INVALID_INDEX;
+        uint32_t transparentIndex = INVALID_INDEX;
+        uint32_t lightIndex = INVALID_INDEX;
+        uint32_t meshLightIndex = INVALID_INDEX;
+        uint32_t volumeIndex = INVALID_INDEX;
+    };
+
     Scene *m_scene = nullptr;
 
     /* CPU memory for the InstanceData buffer */
     InstanceData *m_instancesBuffer = nullptr;
     uint32_t m_instancesBufferSize = 0;
-
-    void fillSceneObjectVectors(SceneObjectVector &sceneGraph);
+    /* End of the used part of the InstanceData buffer */
+    uint32_t m_instancesEnd = 0;
+    /* Unused ranges before m_instancesEnd, start index to count. Neighboring ranges are merged, and a range that reaches
+     * m_instancesEnd is given back to the end */
+    std::map<uint32_t, uint32_t> m_freeRanges;
+
+    std::unordered_map<SceneObject *, InstanceRecord> m_records;
+
+    /* Sort keys of m_transparent, in the same order */
+    std::vector<uint32_t> m_transparentKeys;
+    RadixSorter<SceneObject *> m_transparentSorter;
+
+    bool m_cullOpaque = true;
+    /* Output of cull() */
+    std::vector<uint32_t> m_visibleInstances;
+    SceneObjectVector m_visibleTransparent;
+    /* Scratch space of cull(), a range of objects in the flat index space of the culled objects */
+    struct CullRange {
+        const SceneObjectVector *sceneObjects;
+        uint32_t begin;
+        /* The mesh of an opaque group, nullptr for the transparent objects */
+        const Mesh *mesh;
+    };
+    std::vector<CullRange> m_cullRanges;
+    /* 0 if culled, 1 + the level of detail otherwise */
+    std::vector<uint8_t> m_cullVisible;
+
+    /* Check if a scene object with components should be instanced, the component buffers hold the objects of all scenes */
+    bool isInstanced(const SceneObject *sceneObject) const;
+    /* Gather the objects of the scene by scanning the component buffers */
+    void fillSceneObjectVectors();
     void buildInstanceDataFromScratch();
+
+    void gatherMesh(SceneObject *sceneObject, Mesh *mesh, Material *material);
+    void gatherLight(SceneObject *sceneObject);
+    void gatherVolume(SceneObject *sceneObject);
+    void pushBack(SceneObjectVector &sceneObjects, SceneObject *sceneObject, uint32_t &index);
+    void swapRemove(SceneObjectVector &sceneObjects, uint32_t index, uint32_t InstanceRecord::*recordIndex);
+
+    /* Gather a scene object and set up its instance, returns false if the instance buffer is full */
+    bool addInstances(SceneObject *so);
+    void removeInstances(SceneObject *so);
+    void removeFromMeshGroup(Mesh *mesh, uint32_t index);
+    /* Make room for the last object of a mesh group, returns false if the instance buffer is full */
+    bool growMeshGroup(MeshGroup &meshGroup);
+    bool allocateSlot(uint32_t &slot);
+    /* Find count contiguous instances, in the first free range large enough or at the end. Returns false if the buffer is full */
+    bool allocateRange(uint32_t count, uint32_t &startIndex);
+    void freeRange(uint32_t startIndex, uint32_t count);
 };
 
 }  // namespace vengine
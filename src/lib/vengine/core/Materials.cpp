@@ -24,7 +24,13 @@ MaterialVolume *Materials::createMaterial<MaterialVolume>(const AssetInfo &info)
 
 void Materials::materialTransparencyChanged(Material *material)
 {
-    m_engine.scene().invalidateInstances(true);
+    /* Objects using the material move between the opaque and the transparent instances */
+    Scene &scene = m_engine.scene();
+    for (auto [entity, materialComponent] : ComponentManager::getInstance().view<ComponentMaterial>()) {
+        if (materialComponent.material() == material) {
+            scene.invalidateInstances(static_cast<SceneObject *>(entity));
+        }
+    }
 }
 
 }  // namespace vengine
\ No newline at end of file
@@ -1,7 +1,16 @@
 #include "Mesh.hpp"
 
+#include <cassert>
+#include <cstring>
+#include <atomic>
+
 #include <glm/glm.hpp>
 
+#include "vengine/utils/Hash.hpp"
+#include "MeshKernels.hpp"
+#include "MeshOptimization.hpp"
+#include "MeshSimplification.hpp"
+
 namespace vengine
 {
 
@@ -11,23 +20,30 @@ Mesh::Mesh(const AssetInfo &info)
 }
 
 Mesh::Mesh(const AssetInfo &info,
-           const std::vector<Vertex> &vertices,
-           const std::vector<uint32_t> &indices,
+           std::vector<Vertex> vertices,
+           std::vector<uint32_t> indices,
            bool hasNormals,
-           bool hasUVs)
+           bool hasUVs,
+           ThreadPool *threadPool)
     : Asset(info)
+    , m_vertices(std::move(vertices))
+    , m_indices(std::move(indices))
 {
-    m_vertices = vertices;
-    m_indices = indices;
     m_hasNormals = hasNormals;
     m_hasUVs = hasUVs;
-    m_nTriangles = static_cast<uint32_t>(indices.size() / 3U);
+    m_nVertices = static_cast<uint32_t>(m_vertices.size());
+    m_nTriangles = static_cast<uint32_t>(m_indices.size() / 3U);
 
     if (!hasNormals) {
-        computeNormals();
+        computeNormals(threadPool);
+        /* Tangents are imported only along with normals */
+        if (hasUVs) {
+            computeTangents(threadPool);
+        }
     }
 
-    computeAABB();
+    computeAABB(threadPool);
+    computeContentHash();
 }
 
 const std::vector<Vertex> &Mesh::vertices() const
@@ -40,11 +56,98 @@ const std::vector<uint32_t> &Mesh::indices() const
     return m_indices;
 }
 
+uint32_t Mesh::nVertices() const
+{
+    return m_nVertices;
+}
+
+uint32_t Mesh::nIndices() const
+{
+    return 3U * m_nTriangles;
+}
+
 uint32_t Mesh::nTriangles() const
 {
     return m_nTriangles;
 }
 
+bool Mesh::hasGeometry() const
+{
+    return m_hasGeometry;
+}
+
+void Mesh::releaseGeometry()
+{
+    /* Swap with empty vectors, clear() keeps the memory */
+    std::vector<Vertex>().swap(m_vertices);
+    std::vector<uint32_t>().swap(m_indices);
+    std::vector<uint32_t>().swap(m_lodIndices);
+    std::atomic_store(&m_triangleBVH, std::shared_ptr<const BVH>());
+    m_hasGeometry = false;
+}
+
+uint32_t Mesh::nLODs() const
+{
+    return 1 + static_cast<uint32_t>(m_lods.size());
+}
+
+Mesh::LOD Mesh::lod(uint32_t l) const
+{
+    assert(l < nLODs());
+    if (l == 0) {
+        return {0, nIndices()};
+    }
+    return m_lods[l - 1];
+}
+
+const std::vector<uint32_t> &Mesh::lodIndices() const
+{
+    return m_lodIndices;
+}
+
+/* Meshes with fewer triangles are not simplified */
+static const uint32_t LOD_MIN_TRIANGLES = 256;
+/* A level that keeps more than this fraction of the previous level's triangles is dropped, the mesh doesn't simplify further */
+static const float LOD_MIN_REDUCTION = 0.75F;
+
+void Mesh::generateLODs()
+{
+    if (!m_hasGeometry)
+        return;
+
+    m_lods.clear();
+    m_lodIndices.clear();
+
+    std::vector<uint32_t> previous = m_indices;
+    while (nLODs() < MAX_LODS) {
+        uint32_t nPreviousTriangles = static_cast<uint32_t>(previous.size() / 3);
+        if (nPreviousTriangles < LOD_MIN_TRIANGLES)
+            break;
+
+        std::vector<uint32_t> simplified = simplifyMesh(m_vertices, previous, nPreviousTriangles / 2);
+        if (simplified.size() / 3 > static_cast<size_t>(LOD_MIN_REDUCTION * nPreviousTriangles))
+            break;
+
+        simplified = optimizeVertexCache(simplified, static_cast<uint32_t>(m_vertices.size()));
+
+        uint32_t firstIndex = static_cast<uint32_t>(m_indices.size() + m_lodIndices.size());
+        m_lods.push_back({firstIndex, static_cast<uint32_t>(simplified.size())});
+        m_lodIndices.insert(m_lodIndices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+}
+
+uint32_t Mesh::selectLOD(float screenSize) const
+{
+    uint32_t l = 0;
+    float threshold = LOD_SCREEN_SIZE;
+    while (l + 1 < nLODs() && screenSize < threshold) {
+        l++;
+        threshold *= 0.5F;
+    }
+    return l;
+}
+
 bool Mesh::hasNormals() const
 {
     return m_hasNormals;
@@ -66,42 +169,136 @@ const AABB3 &Mesh::aabb() const
     return m_aabb;
 }
 
-void Mesh::computeNormals()
+uint64_t Mesh::contentHash() const
 {
-    /* Make all normals zero */
-    for (size_t i = 0; i < m_vertices.size(); i++) {
-        m_vertices[i].normal = glm::vec3(0, 0, 0);
-    };
+    return m_contentHash;
+}
 
-    /* Add contribution of each normal to the face's vertices */
-    for (size_t i = 0; i < m_indices.size(); i += 3) {
-        Vertex &v1 = m_vertices[m_indices[i]];
-        Vertex &v2 = m_vertices[m_indices[i + 1]];
-        Vertex &v3 = m_vertices[m_indices[i + 2]];
-
-        glm::vec3 U = v2.position - v1.position, V = v3.position - v1.position;
-        glm::vec3 normal = glm::vec3(U.y * V.z - U.z * V.y, U.z * V.x - U.x * V.z, U.x * V.y - U.y * V.x);
-        v1.normal += normal;
-        v2.normal += normal;
-        v3.normal += normal;
-    }
+bool Mesh::sameGeometry(const Mesh &other) const
+{
+    if (m_contentHash != other.m_contentHash || m_hasNormals != other.m_hasNormals || m_hasUVs != other.m_hasUVs)
+        return false;
+    if (m_nVertices != other.m_nVertices || m_nTriangles != other.m_nTriangles)
+        return false;
+    /* Equal hashes and counts are not proof, without the geometry of both meshes they can't be told apart */
+    if (!m_hasGeometry || !other.m_hasGeometry)
+        return false;
+    if (m_indices != other.m_indices)
+        return false;
 
-    /* Normalize */
-    for (size_t i = 0; i < m_vertices.size(); i++) {
-        m_vertices[i].normal = glm::normalize(m_vertices[i].normal);
+    /* Vertex has no padding, a bitwise compare also tells apart the vertices that only differ in the sign of a zero */
+    return std::memcmp(m_vertices.data(), other.m_vertices.data(), m_vertices.size() * sizeof(Vertex)) == 0;
+}
+
+bool Mesh::sameContent(const Mesh &other) const
+{
+    if (m_hasGeometry && other.m_hasGeometry)
+        return sameGeometry(other);
+
+    return m_contentHash == other.m_contentHash && m_contentHashCheck == other.m_contentHashCheck &&
+           m_hasNormals == other.m_hasNormals && m_hasUVs == other.m_hasUVs && m_nVertices == other.m_nVertices &&
+           m_nTriangles == other.m_nTriangles;
+}
+
+/* Seed of the second content hash */
+static const uint64_t CONTENT_HASH_CHECK_SEED = 0x9E3779B97F4A7C15ULL;
+
+/* Vertices are hashed and compared as bytes */
+static_assert(sizeof(Vertex) == 17 * sizeof(float), "Vertex must not have padding");
+
+void Mesh::computeContentHash()
+{
+    auto hash = [&](uint64_t seed) {
+        const unsigned char *vertices = reinterpret_cast<const unsigned char *>(m_vertices.data());
+        const unsigned char *indices = reinterpret_cast<const unsigned char *>(m_indices.data());
+        uint64_t h = MurmurHash64A(vertices, m_vertices.size() * sizeof(Vertex), seed);
+        return MurmurHash64A(indices, m_indices.size() * sizeof(uint32_t), h);
     };
+    m_contentHash = hash(0);
+    m_contentHashCheck = hash(CONTENT_HASH_CHECK_SEED);
 }
 
-void Mesh::computeAABB()
+void Mesh::computeNormals(ThreadPool *threadPool)
 {
-    if (m_vertices.size() == 0) {
-        return;
+    computeVertexNormals(m_vertices, m_indices, threadPool);
+}
+
+void Mesh::computeTangents(ThreadPool *threadPool)
+{
+    computeVertexTangents(m_vertices, m_indices, threadPool);
+}
+
+void Mesh::computeAABB(ThreadPool *threadPool)
+{
+    m_aabb = computeBounds(m_vertices, threadPool);
+}
+
+const BVH &Mesh::triangleBVH(ThreadPool &threadPool) const
+{
+    /* No lock is held while building on the pool, concurrent first calls may both build and the first one published wins */
+    std::shared_ptr<const BVH> published = std::atomic_load(&m_triangleBVH);
+    if (published != nullptr) {
+        return *published;
     }
 
-    m_aabb = AABB3::fromPoint(m_vertices[0].position);
-    for (size_t i = 1; i < m_vertices.size(); i++) {
-        m_aabb.add(m_vertices[i].position);
+    std::vector<BVH::ItemID> triangles(m_nTriangles);
+    std::vector<AABB3> bounds(m_nTriangles);
+    for (uint32_t i = 0; i < m_nTriangles; i++) {
+        triangles[i] = i;
+        bounds[i] = AABB3::fromPoint(m_vertices[m_indices[3 * i]].position);
+        bounds[i].add(m_vertices[m_indices[3 * i + 1]].position);
+        bounds[i].add(m_vertices[m_indices[3 * i + 2]].position);
+    }
+
+    auto bvh = std::make_shared<BVH>();
+    bvh->build(triangles, bounds, threadPool);
+    std::shared_ptr<const BVH> built = bvh;
+    if (!std::atomic_compare_exchange_strong(&m_triangleBVH, &published, built)) {
+        /* Another call published first, published now holds its BVH */
+        return *published;
+    }
+
+    return *built;
+}
+
+bool Mesh::intersect(const Ray &ray, float tMax, float &t, ThreadPool &threadPool) const
+{
+    if (!m_hasGeometry)
+        return false;
+
+    /* Moller-Trumbore, both sides of the triangles are hit */
+    auto intersectTriangle = [&](BVH::ItemID triangle, float &tTriangle) {
+        const glm::vec3 &v0 = m_vertices[m_indices[3 * triangle]].position;
+        const glm::vec3 &v1 = m_vertices[m_indices[3 * triangle + 1]].position;
+        const glm::vec3 &v2 = m_vertices[m_indices[3 * triangle + 2]].position;
+
+        glm::vec3 e1 = v1 - v0;
+        glm::vec3 e2 = v2 - v0;
+        glm::vec3 p = glm::cross(ray.direction, e2);
+        float det = glm::dot(e1, p);
+        if (det == 0.0F)
+            return false;
+
+        float invDet = 1.0F / det;
+        glm::vec3 s = ray.origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0F || u > 1.0F)
+            return false;
+
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0F || u + v > 1.0F)
+            return false;
+
+        float tHit = glm::dot(e2, q) * invDet;
+        if (tHit < 0.0F || tHit > tTriangle)
+            return false;
+
+        tTriangle = tHit;
+        return true;
     };
+
+    return triangleBVH(threadPool).intersectRay(ray, tMax, intersectTriangle, t) != BVH::INVALID_INDEX;
 }
 
 }  // namespace vengine
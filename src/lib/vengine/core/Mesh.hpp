@@ -3,10 +3,13 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include <glm/glm.hpp>
 
 #include "vengine/math/AABB.hpp"
+#include "vengine/math/BVH.hpp"
+#include "vengine/math/Ray.hpp"
 #include "Asset.hpp"
 
 namespace vengine
@@ -39,43 +42,122 @@ struct Vertex {
         , bitangent(_bitangent){};
 };
 
-class Model3D;
+class ThreadPool;
 
 class Mesh : public Asset
 {
 public:
+    /* Maximum number of levels of detail of a mesh, including the full mesh */
+    static constexpr uint32_t MAX_LODS = 5;
+    /* Below this screen size the first simplified level is used, every next level at half the size of the previous one */
+    static constexpr float LOD_SCREEN_SIZE = 0.25F;
+
+    /* A level of detail, as a range of the indices followed by the LOD indices */
+    struct LOD {
+        uint32_t firstIndex;
+        uint32_t nIndices;
+    };
+
     Mesh(const AssetInfo &info);
+    /* The vertices and the indices are moved into the mesh, pass them with std::move to avoid a copy */
     Mesh(const AssetInfo &info,
-         const std::vector<Vertex> &vertices,
-         const std::vector<uint32_t> &indices,
+         std::vector<Vertex> vertices,
+         std::vector<uint32_t> indices,
          bool hasNormals = false,
-         bool hasUVs = false);
+         bool hasUVs = false,
+         ThreadPool *threadPool = nullptr);
 
+    /* Empty after releaseGeometry() */
     const std::vector<Vertex> &vertices() const;
     const std::vector<uint32_t> &indices() const;
 
+    /* The counts of the full mesh, the only level of detail used for ray tracing. They are kept after releaseGeometry() */
+    uint32_t nVertices() const;
+    uint32_t nIndices() const;
     uint32_t nTriangles() const;
 
+    /* False after releaseGeometry() */
+    bool hasGeometry() const;
+    /**
+     * @brief Free the vertices and the indices of all levels of detail, e.g. once they are uploaded to the GPU. The counts, the
+     * level ranges, the bounds and the content hash are kept. Meshes without geometry are never hit by intersect()
+     */
+    void releaseGeometry();
+
+    /* Number of levels of detail, level 0 is the full mesh indices() */
+    uint32_t nLODs() const;
+    LOD lod(uint32_t l) const;
+    /* The indices of the levels after 0, concatenated. They index the same vertices as indices() */
+    const std::vector<uint32_t> &lodIndices() const;
+
+    /**
+     * @brief Generate the simplified levels of detail. Every level simplifies the previous one to half of its triangles, until
+     * MAX_LODS levels exist or the mesh doesn't simplify further. The triangles of every level are ordered for the vertex cache
+     */
+    void generateLODs();
+
+    /**
+     * @brief Select the level of detail for a screen size
+     *
+     * @param screenSize The radius of the bounding sphere over the distance, scaled by the projection like the screen height.
+     * Roughly the fraction of the screen height the object covers
+     * @return The level of detail
+     */
+    uint32_t selectLOD(float screenSize) const;
+
     bool hasNormals() const;
     bool hasUVs() const;
     bool hasTangents() const;
 
+    /* Hash of the vertices and the indices of the full mesh, computed on construction */
+    uint64_t contentHash() const;
+    /* True if the meshes have the same vertices, indices and attributes. False if one of them has released its geometry */
+    bool sameGeometry(const Mesh &other) const;
+    /* Like sameGeometry(), but if one of the meshes has released its geometry the two independent content hashes, 128 bits,
+     * the counts and the attributes are compared instead */
+    bool sameContent(const Mesh &other) const;
+
     const AABB3 &aabb() const;
 
-    const Model3D *m_model = nullptr;
+    /**
+     * @brief Find the closest triangle hit by a ray in object space. A BVH over the triangles is built on the first call
+     *
+     * @param ray
+     * @param tMax Max distance along the ray
+     * @param t The distance of the closest hit
+     * @param threadPool Used to build the triangle BVH
+     * @return True on hit
+     */
+    bool intersect(const Ray &ray, float tMax, float &t, ThreadPool &threadPool) const;
 
 protected:
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
+    uint32_t m_nVertices = 0;
     uint32_t m_nTriangles = 0;
+    bool m_hasGeometry = true;
+    /* The levels after 0, their indices are stored in m_lodIndices */
+    std::vector<LOD> m_lods;
+    std::vector<uint32_t> m_lodIndices;
 
     bool m_hasNormals = false;
     bool m_hasUVs = false;
+    uint64_t m_contentHash = 0;
+    /* A second hash of the same data with another seed, kept to match meshes after releaseGeometry() */
+    uint64_t m_contentHashCheck = 0;
 
     AABB3 m_aabb;
-
-    void computeNormals();
-    void computeAABB();
+    /* BVH over the triangles, items are triangle indices. Built lazily and published atomically, copies of the mesh share it */
+    mutable std::shared_ptr<const BVH> m_triangleBVH;
+
+    /* Compute the normals from the triangles, on the thread pool if one is given */
+    void computeNormals(ThreadPool *threadPool = nullptr);
+    /* Compute the tangents and bitangents from the uvs and the normals, on the thread pool if one is given */
+    void computeTangents(ThreadPool *threadPool = nullptr);
+    void computeContentHash();
+    /* Compute the AABB of the vertices, on the thread pool if one is given */
+    void computeAABB(ThreadPool *threadPool = nullptr);
+    const BVH &triangleBVH(ThreadPool &threadPool) const;
 };
 
 }  // namespace vengine
@@ -0,0 +1,426 @@
+#include "MeshKernels.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+#include "vengine/utils/Parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define MESH_KERNELS_SSE
+#endif
+
+namespace vengine
+{
+
+namespace
+{
+
+/* Minimum number of vertices or triangles a task processes */
+static constexpr uint32_t KERNEL_MIN_GRAIN = 16384;
+
+#ifdef MESH_KERNELS_SSE
+
+/* A vector in the first three lanes of an SSE register. The fourth lane is ignored by the dot product and never stored */
+struct Float3 {
+    __m128 v;
+};
+
+inline Float3 load(const glm::vec3 &p)
+{
+    /* Two unaligned loads, a four lane load could read past the end of the last vertex */
+    __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(&p.x)));
+    return {_mm_movelh_ps(xy, _mm_load_ss(&p.z))};
+}
+
+inline void store(glm::vec3 &p, Float3 a)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(&p.x), _mm_castps_si128(a.v));
+    _mm_store_ss(&p.z, _mm_movehl_ps(a.v, a.v));
+}
+
+inline Float3 zero3()
+{
+    return {_mm_setzero_ps()};
+}
+
+inline Float3 operator+(Float3 a, Float3 b)
+{
+    return {_mm_add_ps(a.v, b.v)};
+}
+
+inline Float3 operator-(Float3 a, Float3 b)
+{
+    return {_mm_sub_ps(a.v, b.v)};
+}
+
+inline Float3 operator*(Float3 a, float s)
+{
+    return {_mm_mul_ps(a.v, _mm_set1_ps(s))};
+}
+
+/* The dot product in all four lanes */
+inline __m128 dotSplat(Float3 a, Float3 b)
+{
+    __m128 m = _mm_mul_ps(a.v, b.v);
+    __m128 y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 sum = _mm_add_ss(_mm_add_ss(m, y), z);
+    return _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 0));
+}
+
+inline float dot(Float3 a, Float3 b)
+{
+    return _mm_cvtss_f32(dotSplat(a, b));
+}
+
+inline Float3 cross(Float3 a, Float3 b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+    /* (z, x, y) of the cross product */
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a.v, bYZX), _mm_mul_ps(aYZX, b.v));
+    return {_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1))};
+}
+
+/* The second operand is returned if one of them is NaN, like glm::min(b, a) */
+inline Float3 min(Float3 a, Float3 b)
+{
+    return {_mm_min_ps(a.v, b.v)};
+}
+
+inline Float3 max(Float3 a, Float3 b)
+{
+    return {_mm_max_ps(a.v, b.v)};
+}
+
+/* NaN for a zero vector, like glm::normalize */
+inline Float3 normalize(Float3 a)
+{
+    return {_mm_div_ps(a.v, _mm_sqrt_ps(dotSplat(a, a)))};
+}
+
+/* x - x is 0 for finite values and NaN for NaN and infinity */
+inline bool isFinite(__m128 a, int lanes)
+{
+    return (_mm_movemask_ps(_mm_cmpneq_ps(_mm_sub_ps(a, a), _mm_setzero_ps())) & lanes) == 0;
+}
+
+inline bool isFinite(Float3 a)
+{
+    return isFinite(a.v, 0x7);
+}
+
+inline bool isFinite(const glm::vec3 &p)
+{
+    return isFinite(load(p));
+}
+
+inline bool isFinite(const glm::vec2 &p)
+{
+    return isFinite(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(&p.x))), 0x3);
+}
+
+#else
+
+using Float3 = glm::vec3;
+
+inline Float3 load(const glm::vec3 &p)
+{
+    return p;
+}
+
+inline void store(glm::vec3 &p, Float3 a)
+{
+    p = a;
+}
+
+inline Float3 zero3()
+{
+    return glm::vec3(0);
+}
+
+inline Float3 min(Float3 a, Float3 b)
+{
+    return glm::min(b, a);
+}
+
+inline Float3 max(Float3 a, Float3 b)
+{
+    return glm::max(b, a);
+}
+
+inline bool isFinite(const glm::vec3 &p)
+{
+    return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+}
+
+inline bool isFinite(const glm::vec2 &p)
+{
+    return std::isfinite(p.x) && std::isfinite(p.y);
+}
+
+#endif
+
+/* Run f(chunkBegin, chunkEnd) over [0, n), in chunks on the thread pool if one is given */
+template <typename F>
+void forChunks(ThreadPool *threadPool, uint32_t n, const F &f)
+{
+    if (threadPool == nullptr) {
+        f(0, n);
+        return;
+    }
+    parallelFor(*threadPool, 0, n, KERNEL_MIN_GRAIN, f);
+}
+
+/* Reduce map(chunkBegin, chunkEnd) over [0, n), in chunks on the thread pool if one is given */
+template <typename T, typename Map, typename Reduce>
+T reduceChunks(ThreadPool *threadPool, uint32_t n, const T &identity, const Map &map, const Reduce &reduce)
+{
+    if (threadPool == nullptr) {
+        return map(0, n);
+    }
+    return parallelReduce(*threadPool, 0, n, KERNEL_MIN_GRAIN, identity, map, reduce);
+}
+
+/* The corners of the triangles around every vertex, as indices into the triangle list, in order */
+struct VertexCorners {
+    std::vector<uint32_t> start;
+    std::vector<uint32_t> corners;
+};
+
+VertexCorners buildVertexCorners(const std::vector<uint32_t> &indices, uint32_t nVertices)
+{
+    uint32_t nCorners = static_cast<uint32_t>(indices.size() / 3 * 3);
+
+    VertexCorners vertexCorners;
+    vertexCorners.start.assign(nVertices + 1, 0);
+    for (uint32_t c = 0; c < nCorners; c++) {
+        vertexCorners.start[indices[c] + 1]++;
+    }
+    std::partial_sum(vertexCorners.start.begin(), vertexCorners.start.end(), vertexCorners.start.begin());
+
+    vertexCorners.corners.resize(nCorners);
+    std::vector<uint32_t> fill(vertexCorners.start.begin(), vertexCorners.start.end() - 1);
+    for (uint32_t c = 0; c < nCorners; c++) {
+        vertexCorners.corners[fill[indices[c]]++] = c;
+    }
+    return vertexCorners;
+}
+
+/* The part of a vector on the plane of a unit normal */
+inline Float3 projectOnPlane(Float3 v, Float3 n)
+{
+    return v - n * dot(n, v);
+}
+
+/* Normalize a vector, zero vectors are returned as they are */
+inline Float3 normalizeSafe(Float3 v)
+{
+    return dot(v, v) > FLT_MIN ? normalize(v) : v;
+}
+
+template <typename T>
+uint32_t countNonFiniteAttribute(const std::vector<Vertex> &vertices, T Vertex::*attribute, ThreadPool *threadPool)
+{
+    auto count = [&](uint32_t begin, uint32_t end) {
+        uint32_t n = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            n += !isFinite(vertices[i].*attribute);
+        }
+        return n;
+    };
+
+    return reduceChunks(threadPool, static_cast<uint32_t>(vertices.size()), 0U, count, std::plus<uint32_t>());
+}
+
+}  // namespace
+
+AABB3 computeBounds(const std::vector<Vertex> &vertices, ThreadPool *threadPool)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    if (nVertices == 0) {
+        return AABB3();
+    }
+
+    auto bounds = [&](uint32_t begin, uint32_t end) {
+        Float3 low = load(vertices[begin].position);
+        Float3 high = low;
+        for (uint32_t i = begin + 1; i < end; i++) {
+            Float3 p = load(vertices[i].position);
+            low = min(p, low);
+            high = max(p, high);
+        }
+
+        glm::vec3 lowPoint, highPoint;
+        store(lowPoint, low);
+        store(highPoint, high);
+        AABB3 aabb = AABB3::fromPoint(lowPoint);
+        aabb.add(highPoint);
+        return aabb;
+    };
+
+    auto merge = [](const AABB3 &a, const AABB3 &b) {
+        AABB3 aabb = a;
+        aabb.add(b.min());
+        aabb.add(b.max());
+        return aabb;
+    };
+    return reduceChunks(threadPool, nVertices, AABB3(), bounds, merge);
+}
+
+uint32_t normalizeVectors(std::vector<Vertex> &vertices, glm::vec3 Vertex::*attribute, ThreadPool *threadPool)
+{
+    /* The check runs in the same pass, the vertices are read from memory once */
+    auto normalizeRange = [&](uint32_t begin, uint32_t end) {
+        uint32_t nonFinite = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            glm::vec3 &v = vertices[i].*attribute;
+            Float3 normalized = normalize(load(v));
+            store(v, normalized);
+            nonFinite += !isFinite(normalized);
+        }
+        return nonFinite;
+    };
+
+    return reduceChunks(threadPool, static_cast<uint32_t>(vertices.size()), 0U, normalizeRange, std::plus<uint32_t>());
+}
+
+uint32_t countNonFinite(const std::vector<Vertex> &vertices, glm::vec3 Vertex::*attribute, ThreadPool *threadPool)
+{
+    return countNonFiniteAttribute(vertices, attribute, threadPool);
+}
+
+uint32_t countNonFinite(const std::vector<Vertex> &vertices, glm::vec2 Vertex::*attribute, ThreadPool *threadPool)
+{
+    return countNonFiniteAttribute(vertices, attribute, threadPool);
+}
+
+void computeVertexNormals(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, ThreadPool *threadPool)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    uint32_t nTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+    if (threadPool == nullptr) {
+        /* On a single thread, every triangle adds its normal to its vertices */
+        for (Vertex &vertex : vertices) {
+            vertex.normal = glm::vec3(0);
+        }
+        for (uint32_t t = 0; t < nTriangles; t++) {
+            Vertex &v0 = vertices[indices[3 * t]];
+            Vertex &v1 = vertices[indices[3 * t + 1]];
+            Vertex &v2 = vertices[indices[3 * t + 2]];
+            Float3 p0 = load(v0.position);
+            Float3 normal = cross(load(v1.position) - p0, load(v2.position) - p0);
+            store(v0.normal, load(v0.normal) + normal);
+            store(v1.normal, load(v1.normal) + normal);
+            store(v2.normal, load(v2.normal) + normal);
+        }
+        normalizeVectors(vertices, &Vertex::normal);
+        return;
+    }
+
+    /* Cross products of the triangle edges, their length is twice the area */
+    std::vector<glm::vec3> faceNormals(nTriangles);
+    forChunks(threadPool, nTriangles, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; t++) {
+            Float3 p0 = load(vertices[indices[3 * t]].position);
+            Float3 p1 = load(vertices[indices[3 * t + 1]].position);
+            Float3 p2 = load(vertices[indices[3 * t + 2]].position);
+            store(faceNormals[t], cross(p1 - p0, p2 - p0));
+        }
+    });
+
+    /* Every vertex gathers the normals of its triangles instead, so that the vertices can be processed in parallel. The sums
+     * are added in the same order as on a single thread */
+    VertexCorners vertexCorners = buildVertexCorners(indices, nVertices);
+    forChunks(threadPool, nVertices, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t v = begin; v < end; v++) {
+            Float3 sum = zero3();
+            for (uint32_t i = vertexCorners.start[v]; i < vertexCorners.start[v + 1]; i++) {
+                sum = sum + load(faceNormals[vertexCorners.corners[i] / 3]);
+            }
+            store(vertices[v].normal, normalize(sum));
+        }
+    });
+}
+
+void computeVertexTangents(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, ThreadPool *threadPool)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    uint32_t nTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+    /* The directions of increasing u and v on every triangle, unit length, zero if the uvs are degenerate */
+    std::vector<glm::vec3> faceU(nTriangles);
+    std::vector<glm::vec3> faceV(nTriangles);
+    forChunks(threadPool, nTriangles, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; t++) {
+            const Vertex &v0 = vertices[indices[3 * t]];
+            const Vertex &v1 = vertices[indices[3 * t + 1]];
+            const Vertex &v2 = vertices[indices[3 * t + 2]];
+
+            Float3 d1 = load(v1.position) - load(v0.position);
+            Float3 d2 = load(v2.position) - load(v0.position);
+            glm::vec2 uv1 = v1.uv - v0.uv;
+            glm::vec2 uv2 = v2.uv - v0.uv;
+
+            float signedArea = uv1.x * uv2.y - uv1.y * uv2.x;
+            if (std::abs(signedArea) <= FLT_MIN) {
+                faceU[t] = glm::vec3(0);
+                faceV[t] = glm::vec3(0);
+                continue;
+            }
+
+            /* Flipped with the uvs, so that mirrored triangles point the same way as their vertices */
+            float sign = signedArea > 0.0F ? 1.0F : -1.0F;
+            store(faceU[t], normalizeSafe(d1 * uv2.y - d2 * uv1.y) * sign);
+            store(faceV[t], normalizeSafe(d2 * uv1.x - d1 * uv2.x) * sign);
+        }
+    });
+
+    VertexCorners vertexCorners = buildVertexCorners(indices, nVertices);
+    forChunks(threadPool, nVertices, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t v = begin; v < end; v++) {
+            Float3 n = load(vertices[v].normal);
+            Float3 p = load(vertices[v].position);
+
+            Float3 sumU = zero3();
+            Float3 sumV = zero3();
+            for (uint32_t i = vertexCorners.start[v]; i < vertexCorners.start[v + 1]; i++) {
+                uint32_t corner = vertexCorners.corners[i];
+                uint32_t t = corner / 3;
+                Float3 u = load(faceU[t]);
+                if (dot(u, u) == 0.0F)
+                    continue;
+
+                /* The angle of the triangle at the vertex, on the plane of the normal */
+                uint32_t first = 3 * t;
+                Float3 e1 = normalizeSafe(projectOnPlane(load(vertices[indices[first + (corner + 1) % 3]].position) - p, n));
+                Float3 e2 = normalizeSafe(projectOnPlane(load(vertices[indices[first + (corner + 2) % 3]].position) - p, n));
+                float angle = std::acos(std::clamp(dot(e1, e2), -1.0F, 1.0F));
+
+                sumU = sumU + normalizeSafe(projectOnPlane(u, n)) * angle;
+                sumV = sumV + normalizeSafe(projectOnPlane(load(faceV[t]), n)) * angle;
+            }
+
+            Float3 tangent = normalizeSafe(projectOnPlane(sumU, n));
+            if (dot(tangent, tangent) == 0.0F) {
+                /* No uv direction, any direction on the plane of the normal */
+                glm::vec3 normal = vertices[v].normal;
+                glm::vec3 t1 = glm::cross(normal, glm::vec3(0, 0, 1));
+                glm::vec3 t2 = glm::cross(normal, glm::vec3(1, 0, 0));
+                tangent = normalizeSafe(load(glm::length(t1) > glm::length(t2) ? t1 : t2));
+            }
+
+            Float3 bitangent = cross(n, tangent);
+            float handedness = dot(bitangent, sumV) < 0.0F ? -1.0F : 1.0F;
+            store(vertices[v].tangent, tangent);
+            store(vertices[v].bitangent, bitangent * handedness);
+        }
+    });
+}
+
+}  // namespace vengine
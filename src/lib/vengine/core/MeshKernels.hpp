@@ -0,0 +1,73 @@
+#ifndef __MeshKernels_hpp__
+#define __MeshKernels_hpp__
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "vengine/math/AABB.hpp"
+
+namespace vengine
+{
+
+class ThreadPool;
+
+/*
+ * Geometry kernels over the vertices of a mesh. The vector math runs on SSE registers where available and on glm otherwise,
+ * and the work is split in chunks over the thread pool if one is given
+ */
+
+/**
+ * @brief Compute the bounds of the vertex positions
+ *
+ * @param vertices
+ * @param threadPool
+ * @return The bounds, default constructed if there are no vertices
+ */
+AABB3 computeBounds(const std::vector<Vertex> &vertices, ThreadPool *threadPool = nullptr);
+
+/**
+ * @brief Normalize a vector attribute of every vertex
+ *
+ * @param vertices
+ * @param attribute e.g. &Vertex::normal
+ * @param threadPool
+ * @return The number of vectors that are not finite after normalization, zero vectors included
+ */
+uint32_t normalizeVectors(std::vector<Vertex> &vertices, glm::vec3 Vertex::*attribute, ThreadPool *threadPool = nullptr);
+
+/**
+ * @brief Count the vertices that have a NaN or infinite component in an attribute
+ *
+ * @param vertices
+ * @param attribute e.g. &Vertex::position
+ * @param threadPool
+ * @return The number of vertices
+ */
+uint32_t countNonFinite(const std::vector<Vertex> &vertices, glm::vec3 Vertex::*attribute, ThreadPool *threadPool = nullptr);
+uint32_t countNonFinite(const std::vector<Vertex> &vertices, glm::vec2 Vertex::*attribute, ThreadPool *threadPool = nullptr);
+
+/**
+ * @brief Set the normal of every vertex to the normalized sum of the normals of its triangles, weighted by their area
+ *
+ * @param vertices
+ * @param indices Triangle list
+ * @param threadPool
+ */
+void computeVertexNormals(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, ThreadPool *threadPool = nullptr);
+
+/**
+ * @brief Set the tangent and bitangent of every vertex from the uvs, the way MikkTSpace does without splitting vertices. The uv
+ * directions of every triangle are projected on the plane of the vertex normal and summed weighted by the angle of the
+ * triangle at the vertex. Triangles with degenerate uvs don't contribute. The bitangent is cross(normal, tangent), with the
+ * sign of the summed v direction. The normals must be set
+ *
+ * @param vertices
+ * @param indices Triangle list
+ * @param threadPool
+ */
+void computeVertexTangents(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, ThreadPool *threadPool = nullptr);
+
+}  // namespace vengine
+
+#endif
@@ -0,0 +1,284 @@
+#include "MeshOptimization.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+namespace vengine
+{
+
+namespace
+{
+
+/* A FIFO vertex cache, a vertex is in the cache if fewer than cacheSize vertices were added after it */
+class VertexCache
+{
+public:
+    VertexCache(uint32_t nVertices, uint32_t cacheSize)
+        : m_timestamps(nVertices, 0)
+        , m_cacheSize(cacheSize)
+        , m_time(cacheSize + 1){};
+
+    /* Returns true on a miss, the vertex is then added to the cache */
+    bool access(uint32_t v)
+    {
+        if (m_time - m_timestamps[v] <= m_cacheSize)
+            return false;
+
+        m_timestamps[v] = m_time++;
+        return true;
+    }
+
+    /* Number of vertices added to the cache since v */
+    uint32_t age(uint32_t v) const { return m_time - m_timestamps[v]; }
+
+    void flush() { m_time += m_cacheSize + 1; }
+
+private:
+    std::vector<uint32_t> m_timestamps;
+    uint32_t m_cacheSize;
+    uint32_t m_time;
+};
+
+}  // namespace
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t nVertices, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    statistics.nTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+    VertexCache cache(nVertices, cacheSize);
+    std::vector<uint8_t> referenced(nVertices, 0);
+    for (size_t i = 0; i < 3 * static_cast<size_t>(statistics.nTriangles); i++) {
+        uint32_t v = indices[i];
+        statistics.nMisses += cache.access(v);
+        statistics.nVertices += (referenced[v] == 0);
+        referenced[v] = 1;
+    }
+
+    return statistics;
+}
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          uint32_t nVertices,
+                                          uint32_t cacheSize,
+                                          std::vector<uint32_t> *clusters)
+{
+    uint32_t nTriangles = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters != nullptr) {
+        clusters->clear();
+    }
+
+    /* Triangles around every vertex, and the number of them not emitted yet */
+    std::vector<uint32_t> vertexTrianglesStart(nVertices + 1, 0);
+    for (size_t i = 0; i < 3 * static_cast<size_t>(nTriangles); i++) {
+        vertexTrianglesStart[indices[i] + 1]++;
+    }
+    std::vector<uint32_t> live(vertexTrianglesStart.begin() + 1, vertexTrianglesStart.end());
+    std::partial_sum(vertexTrianglesStart.begin(), vertexTrianglesStart.end(), vertexTrianglesStart.begin());
+    std::vector<uint32_t> vertexTriangles(3 * static_cast<size_t>(nTriangles));
+    {
+        std::vector<uint32_t> fill(vertexTrianglesStart.begin(), vertexTrianglesStart.end() - 1);
+        for (uint32_t i = 0; i < 3 * nTriangles; i++) {
+            vertexTriangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(3 * static_cast<size_t>(nTriangles));
+    std::vector<uint8_t> emitted(nTriangles, 0);
+    VertexCache cache(nVertices, cacheSize);
+    /* Recently emitted vertices, where the order continues after a dead end */
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    uint32_t cursor = 0;
+
+    auto nextVertexInOrder = [&]() {
+        while (cursor < nVertices && live[cursor] == 0) {
+            cursor++;
+        }
+        return cursor < nVertices ? cursor : ~0u;
+    };
+
+    uint32_t fanning = nextVertexInOrder();
+    if (fanning != ~0u && clusters != nullptr) {
+        clusters->push_back(0);
+    }
+    while (fanning != ~0u) {
+        /* Emit the remaining triangles around the fanning vertex */
+        candidates.clear();
+        for (uint32_t i = vertexTrianglesStart[fanning]; i < vertexTrianglesStart[fanning + 1]; i++) {
+            uint32_t t = vertexTriangles[i];
+            if (emitted[t])
+                continue;
+
+            for (uint32_t j = 0; j < 3; j++) {
+                uint32_t v = indices[3 * t + j];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.access(v);
+            }
+            emitted[t] = 1;
+        }
+
+        /* Continue with the oldest emitted vertex that will still be in the cache after its remaining triangles are emitted */
+        uint32_t next = ~0u;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if (cache.age(v) + 2 * live[v] <= cacheSize) {
+                priority = cache.age(v);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next == ~0u) {
+            /* Dead end, the order jumps and a new cluster starts */
+            while (!deadEnds.empty() && next == ~0u) {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+            if (next == ~0u) {
+                next = nextVertexInOrder();
+            }
+            if (next != ~0u && clusters != nullptr) {
+                clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> optimizeOverdraw(const std::vector<Vertex> &vertices,
+                                       const std::vector<uint32_t> &indices,
+                                       const std::vector<uint32_t> &clusters,
+                                       float threshold)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    uint32_t nTriangles = static_cast<uint32_t>(indices.size() / 3);
+    if (nTriangles == 0 || clusters.empty())
+        return indices;
+
+    /* Split the clusters where the cache miss ratio of the part so far is close to the one of the whole order. The cache is
+     * flushed at every split, since the parts are drawn in a different order */
+    float maxACMR = threshold * analyzeVertexCache(indices, nVertices).acmr();
+    std::vector<uint32_t> parts;
+    VertexCache cache(nVertices, VERTEX_CACHE_SIZE);
+    for (size_t c = 0; c < clusters.size(); c++) {
+        uint32_t begin = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : nTriangles;
+
+        parts.push_back(begin);
+        cache.flush();
+        uint32_t partBegin = begin;
+        uint32_t misses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            for (uint32_t j = 0; j < 3; j++) {
+                misses += cache.access(indices[3 * t + j]);
+            }
+
+            if (t + 1 < end && static_cast<float>(misses) <= maxACMR * static_cast<float>(t + 1 - partBegin)) {
+                parts.push_back(t + 1);
+                cache.flush();
+                partBegin = t + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    /* The area weighted centroid and normal of every part, and the centroid of the mesh */
+    uint32_t nParts = static_cast<uint32_t>(parts.size());
+    std::vector<glm::vec3> partCentroids(nParts, glm::vec3(0));
+    std::vector<glm::vec3> partNormals(nParts, glm::vec3(0));
+    std::vector<float> partAreas(nParts, 0.F);
+    glm::vec3 meshCentroid(0);
+    float meshArea = 0.F;
+    for (uint32_t p = 0; p < nParts; p++) {
+        uint32_t end = p + 1 < nParts ? parts[p + 1] : nTriangles;
+        for (uint32_t t = parts[p]; t < end; t++) {
+            const glm::vec3 &p0 = vertices[indices[3 * t]].position;
+            const glm::vec3 &p1 = vertices[indices[3 * t + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[3 * t + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+
+            partCentroids[p] += area * (p0 + p1 + p2) / 3.F;
+            partNormals[p] += normal;
+            partAreas[p] += area;
+        }
+        meshCentroid += partCentroids[p];
+        meshArea += partAreas[p];
+    }
+    if (meshArea > 0.F) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> sortKeys(nParts, 0.F);
+    for (uint32_t p = 0; p < nParts; p++) {
+        float normalLength = glm::length(partNormals[p]);
+        if (partAreas[p] > 0.F && normalLength > 0.F) {
+            sortKeys[p] = glm::dot(partCentroids[p] / partAreas[p] - meshCentroid, partNormals[p] / normalLength);
+        }
+    }
+
+    std::vector<uint32_t> order(nParts);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t p : order) {
+        uint32_t end = p + 1 < nParts ? parts[p + 1] : nTriangles;
+        result.insert(
+            result.end(), indices.begin() + 3 * static_cast<size_t>(parts[p]), indices.begin() + 3 * static_cast<size_t>(end));
+    }
+
+    return result;
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), ~0u);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (uint32_t &index : indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(ordered);
+}
+
+VertexCacheStatistics optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, VertexCacheStatistics *before)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    if (before != nullptr) {
+        *before = analyzeVertexCache(indices, nVertices);
+    }
+
+    std::vector<uint32_t> clusters;
+    indices = optimizeVertexCache(indices, nVertices, VERTEX_CACHE_SIZE, &clusters);
+    indices = optimizeOverdraw(vertices, indices, clusters);
+    optimizeVertexFetch(vertices, indices);
+
+    return analyzeVertexCache(indices, static_cast<uint32_t>(vertices.size()));
+}
+
+}  // namespace vengine
@@ -0,0 +1,105 @@
+#ifndef __MeshOptimization_hpp__
+#define __MeshOptimization_hpp__
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace vengine
+{
+
+/* Size of the FIFO post-transform vertex cache the triangle orders are optimized for and measured with */
+static constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+/* Cache misses of a triangle order, measured with a FIFO post-transform vertex cache */
+struct VertexCacheStatistics {
+    uint32_t nTriangles = 0;
+    /* Number of vertices referenced by the triangles */
+    uint32_t nVertices = 0;
+    /* Number of vertex shader invocations */
+    uint32_t nMisses = 0;
+
+    /* Average cache miss ratio, vertex shader invocations per triangle. 3 at worst, about 0.5 at best for regular meshes */
+    float acmr() const { return nTriangles == 0 ? 0.F : static_cast<float>(nMisses) / static_cast<float>(nTriangles); }
+    /* Average transform to vertex ratio, vertex shader invocations per referenced vertex. 1 at best */
+    float atvr() const { return nVertices == 0 ? 0.F : static_cast<float>(nMisses) / static_cast<float>(nVertices); }
+
+    VertexCacheStatistics &operator+=(const VertexCacheStatistics &other)
+    {
+        nTriangles += other.nTriangles;
+        nVertices += other.nVertices;
+        nMisses += other.nMisses;
+        return *this;
+    }
+};
+
+/**
+ * @brief Simulate a FIFO post-transform vertex cache over a triangle list
+ *
+ * @param indices Triangle list
+ * @param nVertices Number of vertices indexed
+ * @param cacheSize
+ * @return The statistics of the triangle order
+ */
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                         uint32_t nVertices,
+                                         uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorder the triangles for the post-transform vertex cache with Tipsify. Triangles are emitted in fans around a vertex,
+ * and the next vertex is picked among the ones just emitted that are still in the cache. When none is left, the order jumps to
+ * a recently used vertex with triangles left or to the next such vertex in index order, which starts a new cluster
+ *
+ * @param indices Triangle list
+ * @param nVertices Number of vertices indexed
+ * @param cacheSize
+ * @param clusters If not null, set to the first triangle of every cluster of the new order
+ * @return The reordered triangle list
+ */
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices,
+                                          uint32_t nVertices,
+                                          uint32_t cacheSize = VERTEX_CACHE_SIZE,
+                                          std::vector<uint32_t> *clusters = nullptr);
+
+/**
+ * @brief Reorder the clusters of a cache optimized triangle order to reduce overdraw. Clusters are split further where the
+ * cache miss ratio of the part so far gets close to the one of the whole order, and the clusters that face away from the
+ * center of the mesh are drawn first, since from most directions they occlude the rest
+ *
+ * @param vertices
+ * @param indices Triangle list, ordered by optimizeVertexCache()
+ * @param clusters The first triangle of every cluster, as returned by optimizeVertexCache()
+ * @param threshold The cache miss ratio a cluster part can reach relative to the whole order before it is split
+ * @return The reordered triangle list
+ */
+std::vector<uint32_t> optimizeOverdraw(const std::vector<Vertex> &vertices,
+                                       const std::vector<uint32_t> &indices,
+                                       const std::vector<uint32_t> &clusters,
+                                       float threshold = 1.05F);
+
+/**
+ * @brief Reorder the vertices in the order they are first referenced by the triangles, and remap the indices. Vertices that
+ * are not referenced are removed
+ *
+ * @param vertices
+ * @param indices Triangle list
+ */
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+/**
+ * @brief Optimize a triangle mesh for rendering: reorder the triangles for the vertex cache and for overdraw, and then the
+ * vertices for fetch locality
+ *
+ * @param vertices
+ * @param indices Triangle list
+ * @param before If not null, set to the statistics of the order before the optimization
+ * @return The statistics of the optimized order
+ */
+VertexCacheStatistics optimizeMesh(std::vector<Vertex> &vertices,
+                                   std::vector<uint32_t> &indices,
+                                   VertexCacheStatistics *before = nullptr);
+
+}  // namespace vengine
+
+#endif
@@ -0,0 +1,43 @@
+#include "MeshRegistry.hpp"
+
+namespace vengine
+{
+
+Mesh *MeshRegistry::get(const Mesh &mesh, bool needsGeometry, const std::function<Mesh *()> &create)
+{
+    auto range = m_meshes.equal_range(mesh.contentHash());
+    for (auto itr = range.first; itr != range.second; ++itr) {
+        if (needsGeometry && !itr->second->hasGeometry())
+            continue;
+        if (itr->second->sameContent(mesh)) {
+            m_references[itr->second]++;
+            return itr->second;
+        }
+    }
+
+    Mesh *registered = create();
+    m_meshes.emplace(registered->contentHash(), registered);
+    m_references[registered] = 1;
+    return registered;
+}
+
+bool MeshRegistry::release(const Mesh *mesh)
+{
+    auto itr = m_references.find(mesh);
+    if (itr == m_references.end())
+        return true;
+    if (--itr->second > 0)
+        return false;
+
+    m_references.erase(itr);
+    auto range = m_meshes.equal_range(mesh->contentHash());
+    for (auto meshItr = range.first; meshItr != range.second; ++meshItr) {
+        if (meshItr->second == mesh) {
+            m_meshes.erase(meshItr);
+            break;
+        }
+    }
+    return true;
+}
+
+}  // namespace vengine
@@ -0,0 +1,54 @@
+#ifndef __MeshRegistry_hpp__
+#define __MeshRegistry_hpp__
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "Mesh.hpp"
+
+namespace vengine
+{
+
+/**
+ * @brief Registry of meshes by their geometry, so that imported meshes with the same vertices and indices share one mesh, in
+ * the same or in different models, and with it the GPU buffers, the acceleration structure and the instanced draw group.
+ * Meshes are reference counted, every get adds a reference and every release removes one
+ */
+class MeshRegistry
+{
+public:
+    MeshRegistry() {}
+    MeshRegistry(MeshRegistry const &) = delete;
+    void operator=(MeshRegistry const &) = delete;
+
+    /**
+     * @brief Get the registered mesh with the same geometry as a mesh, or register a new one
+     *
+     * @param mesh The mesh to look up, by its content hash and then by its content, see Mesh::sameContent()
+     * @param needsGeometry If set, registered meshes that released their geometry are skipped
+     * @param create Called on a miss to create the mesh that is registered
+     * @return The registered mesh
+     */
+    Mesh *get(const Mesh &mesh, bool needsGeometry, const std::function<Mesh *()> &create);
+
+    /**
+     * @brief Remove a reference to a mesh
+     *
+     * @param mesh
+     * @return True if it was the last reference and the mesh is no longer registered, or if it was never registered. The caller
+     * then owns the mesh
+     */
+    bool release(const Mesh *mesh);
+
+    /* Number of registered meshes */
+    size_t size() const { return m_references.size(); }
+
+private:
+    std::unordered_multimap<uint64_t, Mesh *> m_meshes;
+    std::unordered_map<const Mesh *, uint32_t> m_references;
+};
+
+}  // namespace vengine
+
+#endif
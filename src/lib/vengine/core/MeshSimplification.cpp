@@ -0,0 +1,313 @@
+#include "MeshSimplification.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+namespace vengine
+{
+
+namespace
+{
+
+/* A symmetric 4x4 matrix that measures the sum of squared distances of a point to a set of planes */
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    void addPlane(double nx, double ny, double nz, double d, double weight)
+    {
+        a00 += weight * nx * nx;
+        a01 += weight * nx * ny;
+        a02 += weight * nx * nz;
+        a03 += weight * nx * d;
+        a11 += weight * ny * ny;
+        a12 += weight * ny * nz;
+        a13 += weight * ny * d;
+        a22 += weight * nz * nz;
+        a23 += weight * nz * d;
+        a33 += weight * d * d;
+    }
+
+    void add(const Quadric &q)
+    {
+        a00 += q.a00;
+        a01 += q.a01;
+        a02 += q.a02;
+        a03 += q.a03;
+        a11 += q.a11;
+        a12 += q.a12;
+        a13 += q.a13;
+        a22 += q.a22;
+        a23 += q.a23;
+        a33 += q.a33;
+    }
+
+    double error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        return a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+               2.0 * (a03 * x + a13 * y + a23 * z) + a33;
+    }
+};
+
+struct Collapse {
+    double error;
+    uint32_t from;
+    uint32_t to;
+};
+
+/* Reject a collapse if it turns a remaining triangle by more than this, as the cosine of the angle between the normals */
+static constexpr float COLLAPSE_MIN_NORMAL_COSINE = 0.2F;
+
+}  // namespace
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, uint32_t targetTriangles)
+{
+    uint32_t nVertices = static_cast<uint32_t>(vertices.size());
+    auto position = [&](uint32_t v) -> const glm::vec3 & { return vertices[v].position; };
+
+    /* Vertices with the same position form a ring through nextCopy, and are simplified as their first vertex, canon */
+    std::vector<uint32_t> canon(nVertices);
+    std::vector<uint32_t> nextCopy(nVertices);
+    {
+        std::vector<uint32_t> order(nVertices);
+        std::iota(order.begin(), order.end(), 0);
+        auto less = [&](uint32_t a, uint32_t b) {
+            const glm::vec3 &pa = position(a);
+            const glm::vec3 &pb = position(b);
+            return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && (pa.z < pb.z || (pa.z == pb.z && a < b)))));
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        for (uint32_t begin = 0; begin < nVertices;) {
+            uint32_t end = begin + 1;
+            while (end < nVertices && position(order[end]) == position(order[begin])) {
+                end++;
+            }
+            for (uint32_t i = begin; i < end; i++) {
+                canon[order[i]] = order[begin];
+                nextCopy[order[i]] = order[i + 1 < end ? i + 1 : begin];
+            }
+            begin = end;
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (canon[a] != canon[b] && canon[b] != canon[c] && canon[c] != canon[a]) {
+            triangles.insert(triangles.end(), {a, b, c});
+        }
+    }
+
+    /* The planes of the triangles around a position, weighted by the triangle areas */
+    std::vector<Quadric> quadrics(nVertices);
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        const glm::vec3 &p0 = position(triangles[i]);
+        glm::vec3 n = glm::cross(position(triangles[i + 1]) - p0, position(triangles[i + 2]) - p0);
+        float area = glm::length(n);
+        if (area == 0.F)
+            continue;
+
+        n /= area;
+        for (uint32_t j = 0; j < 3; j++) {
+            quadrics[canon[triangles[i + j]]].addPlane(n.x, n.y, n.z, -glm::dot(n, p0), 0.5 * area);
+        }
+    }
+
+    std::vector<uint32_t> remap(nVertices);
+    std::iota(remap.begin(), remap.end(), 0);
+
+    std::vector<uint32_t> vertexTrianglesStart(nVertices + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<uint64_t> edges;
+    std::vector<uint8_t> locked(nVertices);
+    std::vector<uint8_t> touched(nVertices);
+    std::vector<Collapse> collapses;
+    std::vector<std::pair<uint32_t, uint32_t>> targets;
+    std::vector<uint32_t> neighbours;
+    std::vector<uint32_t> opposite;
+
+    while (triangles.size() / 3 > targetTriangles) {
+        uint32_t nTriangles = static_cast<uint32_t>(triangles.size() / 3);
+
+        /* Triangles around every vertex */
+        std::fill(vertexTrianglesStart.begin(), vertexTrianglesStart.end(), 0);
+        for (uint32_t v : triangles) {
+            vertexTrianglesStart[v + 1]++;
+        }
+        std::partial_sum(vertexTrianglesStart.begin(), vertexTrianglesStart.end(), vertexTrianglesStart.begin());
+        vertexTriangles.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(vertexTrianglesStart.begin(), vertexTrianglesStart.end() - 1);
+            for (uint32_t i = 0; i < triangles.size(); i++) {
+                vertexTriangles[fill[triangles[i]]++] = i / 3;
+            }
+        }
+
+        /* Edges between positions. An edge that doesn't have exactly two triangles is on a border or non manifold, its
+         * positions are locked */
+        edges.clear();
+        for (uint32_t t = 0; t < nTriangles; t++) {
+            for (uint32_t j = 0; j < 3; j++) {
+                uint64_t a = canon[triangles[3 * t + j]];
+                uint64_t b = canon[triangles[3 * t + (j + 1) % 3]];
+                edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::fill(locked.begin(), locked.end(), 0);
+        collapses.clear();
+        for (size_t begin = 0; begin < edges.size();) {
+            size_t end = begin + 1;
+            while (end < edges.size() && edges[end] == edges[begin]) {
+                end++;
+            }
+
+            uint32_t a = static_cast<uint32_t>(edges[begin] >> 32);
+            uint32_t b = static_cast<uint32_t>(edges[begin] & 0xFFFFFFFF);
+            if (end - begin != 2) {
+                locked[a] = 1;
+                locked[b] = 1;
+            } else {
+                Quadric q = quadrics[a];
+                q.add(quadrics[b]);
+                collapses.push_back({q.error(position(b)), a, b});
+                collapses.push_back({q.error(position(a)), b, a});
+            }
+            begin = end;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+        /* Collapse in order of error. The triangles around a collapsed position are left alone for the rest of the pass, so
+         * that the checks of every collapse see the triangles as they are */
+        std::fill(touched.begin(), touched.end(), 0);
+        uint32_t removed = 0;
+        uint32_t nCollapsed = 0;
+        for (const Collapse &collapse : collapses) {
+            if (nTriangles - removed <= targetTriangles)
+                break;
+
+            uint32_t u = collapse.from;
+            uint32_t v = collapse.to;
+            if (locked[u] || touched[u] || touched[v])
+                continue;
+
+            /* Every copy of u moves to a copy of v that it shares an edge with, the triangles of that edge are removed and the
+             * rest must not flip */
+            bool valid = true;
+            uint32_t nRemoved = 0;
+            targets.clear();
+            neighbours.clear();
+            opposite.clear();
+            uint32_t uCopy = u;
+            do {
+                uint32_t target = ~0u;
+                for (uint32_t i = vertexTrianglesStart[uCopy]; i < vertexTrianglesStart[uCopy + 1] && valid; i++) {
+                    const uint32_t *triangle = &triangles[3 * vertexTriangles[i]];
+                    uint32_t corner = (triangle[0] == uCopy ? 0 : (triangle[1] == uCopy ? 1 : 2));
+
+                    uint32_t c1 = triangle[(corner + 1) % 3];
+                    uint32_t c2 = triangle[(corner + 2) % 3];
+                    if (canon[c1] == v || canon[c2] == v) {
+                        target = (canon[c1] == v ? c1 : c2);
+                        opposite.push_back(canon[c1] == v ? canon[c2] : canon[c1]);
+                        nRemoved++;
+                        continue;
+                    }
+                    neighbours.push_back(canon[c1]);
+                    neighbours.push_back(canon[c2]);
+
+                    const glm::vec3 &p1 = position(c1);
+                    const glm::vec3 &p2 = position(c2);
+                    glm::vec3 n0 = glm::cross(p1 - position(uCopy), p2 - position(uCopy));
+                    glm::vec3 n1 = glm::cross(p1 - position(v), p2 - position(v));
+                    float l0 = glm::length(n0), l1 = glm::length(n1);
+                    valid = l1 > 0.F && glm::dot(n0, n1) >= COLLAPSE_MIN_NORMAL_COSINE * l0 * l1;
+                }
+
+                /* Copies without triangles stay where they are */
+                if (target != ~0u) {
+                    targets.push_back({uCopy, target});
+                } else if (vertexTrianglesStart[uCopy + 1] > vertexTrianglesStart[uCopy]) {
+                    valid = false;
+                }
+                uCopy = nextCopy[uCopy];
+            } while (uCopy != u && valid);
+
+            if (!valid)
+                continue;
+
+            /* The only positions next to both u and v must be the ones across the collapsed edge, or the surface folds */
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for (uint32_t w : opposite) {
+                auto itr = std::lower_bound(neighbours.begin(), neighbours.end(), w);
+                if (itr != neighbours.end() && *itr == w) {
+                    neighbours.erase(itr);
+                }
+            }
+            uint32_t nShared = 0;
+            uint32_t vCopy = v;
+            do {
+                for (uint32_t i = vertexTrianglesStart[vCopy]; i < vertexTrianglesStart[vCopy + 1]; i++) {
+                    const uint32_t *triangle = &triangles[3 * vertexTriangles[i]];
+                    bool hasU = false;
+                    for (uint32_t j = 0; j < 3; j++) {
+                        hasU = hasU || canon[triangle[j]] == u;
+                    }
+                    if (hasU)
+                        continue;
+                    for (uint32_t j = 0; j < 3; j++) {
+                        uint32_t w = canon[triangle[j]];
+                        auto itr = std::lower_bound(neighbours.begin(), neighbours.end(), w);
+                        if (itr != neighbours.end() && *itr == w) {
+                            nShared++;
+                        }
+                    }
+                }
+                vCopy = nextCopy[vCopy];
+            } while (vCopy != v);
+            if (nShared > 0)
+                continue;
+
+            for (auto &target : targets) {
+                remap[target.first] = target.second;
+                for (uint32_t i = vertexTrianglesStart[target.first]; i < vertexTrianglesStart[target.first + 1]; i++) {
+                    const uint32_t *triangle = &triangles[3 * vertexTriangles[i]];
+                    touched[canon[triangle[0]]] = 1;
+                    touched[canon[triangle[1]]] = 1;
+                    touched[canon[triangle[2]]] = 1;
+                }
+            }
+            quadrics[v].add(quadrics[u]);
+            removed += nRemoved;
+            nCollapsed++;
+        }
+
+        if (nCollapsed == 0)
+            break;
+
+        /* Move the collapsed vertices and drop the triangles of the collapsed edges */
+        size_t nIndices = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            uint32_t a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (canon[a] != canon[b] && canon[b] != canon[c] && canon[c] != canon[a]) {
+                triangles[nIndices++] = a;
+                triangles[nIndices++] = b;
+                triangles[nIndices++] = c;
+            }
+        }
+        triangles.resize(nIndices);
+    }
+
+    return triangles;
+}
+
+}  // namespace vengine
@@ -0,0 +1,28 @@
+#ifndef __MeshSimplification_hpp__
+#define __MeshSimplification_hpp__
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace vengine
+{
+
+/**
+ * @brief Simplify a triangle mesh with quadric error metrics. Edges are collapsed onto one of their end points in order of
+ * increasing error, so the simplified triangles index the same vertices. Vertices with the same position are collapsed
+ * together and only along edges that all of them share, so that normal and UV seams stay closed. Border vertices don't move
+ *
+ * @param vertices
+ * @param indices Triangle list
+ * @param targetTriangles The simplification stops once the number of triangles drops to this
+ * @return The indices of the simplified triangles, more than targetTriangles if no more edges can be collapsed
+ */
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex> &vertices,
+                                   const std::vector<uint32_t> &indices,
+                                   uint32_t targetTriangles);
+
+}  // namespace vengine
+
+#endif
@@ -22,6 +22,16 @@ Mesh *Model3D::mesh(std::string name) const
     return itr->second;
 }
 
+std::string Model3D::meshName(const Mesh *mesh) const
+{
+    for (auto &i : m_meshes) {
+        if (i.second == mesh) {
+            return i.first;
+        }
+    }
+    return "";
+}
+
 std::vector<Mesh *> Model3D::meshes() const
 {
     std::vector<Mesh *> temp;
@@ -31,4 +41,13 @@ std::vector<Mesh *> Model3D::meshes() const
     return temp;
 }
 
+std::vector<std::string> Model3D::meshNames() const
+{
+    std::vector<std::string> temp;
+    for (auto &i : m_meshes) {
+        temp.push_back(i.first);
+    }
+    return temp;
+}
+
 }  // namespace vengine
\ No newline at end of file
@@ -28,8 +28,11 @@ public:
     const Tree<Model3DNode> &nodeTree() const;
 
     Mesh *mesh(std::string name) const;
+    /* The name of a mesh in this model. Meshes are shared between models, so this can differ from the name of the mesh */
+    std::string meshName(const Mesh *mesh) const;
 
     std::vector<Mesh *> meshes() const;
+    std::vector<std::string> meshNames() const;
 
 protected:
     Tree<Model3DNode> m_nodeTree;
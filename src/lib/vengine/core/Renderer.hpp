@@ -51,10 +51,15 @@ public:
     bool &showSelectedAABB() { return m_showSelectedAABB; }
     const bool &showSelectedAABB() const { return m_showSelectedAABB; }
 
+    /* Cull and draw the opaque instances on the GPU if the device supports it, otherwise they are culled on the CPU */
+    bool &gpuCulling() { return m_gpuCulling; }
+    const bool &gpuCulling() const { return m_gpuCulling; }
+
 protected:
     SceneObject *m_selectedObject = nullptr;
 
     bool m_showSelectedAABB = true;
+    bool m_gpuCulling = true;
 
 private:
 };
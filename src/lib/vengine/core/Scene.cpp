@@ -1,7 +1,9 @@
 #include "Scene.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <functional>
+#include <unordered_set>
 
 #include "Engine.hpp"
 #include "AssetManager.hpp"
@@ -10,6 +12,7 @@
 #include "core/SceneUtils.hpp"
 #include "math/Transform.hpp"
 #include "utils/ECS.hpp"
+#include "utils/Parallel.hpp"
 
 #include "debug_tools/Console.hpp"
 #include "debug_tools/Timer.hpp"
@@ -19,6 +22,11 @@
 namespace vengine
 {
 
+/* Minimum number of scene objects a task notifies after the world matrices are updated */
+static const uint32_t UPDATE_MODEL_MATRIX_MIN_GRAIN = 256;
+/* The BVH is rebuilt when more than this fraction of the objects in it changed, and updated incrementally otherwise */
+static const float BVH_REBUILD_FRACTION = 0.25F;
+
 Scene::Scene(Engine &engine)
     : m_engine(engine)
 {
@@ -53,7 +61,7 @@ SceneObject *Scene::addSceneObject(std::string name, SceneObject *parentNode, Tr
     SceneObject *object = createObject(name);
     object->setLocalTransform(transform);
     if (parentNode == nullptr) {
-        m_sceneGraph.push_back(object);
+        SceneObject::addRoot(m_sceneGraph, object);
     } else {
         parentNode->addChild(object);
     }
@@ -61,48 +69,124 @@ SceneObject *Scene::addSceneObject(std::string name, SceneObject *parentNode, Tr
     m_objectsMap.insert({object->getID(), object});
 
     m_sceneGraphNeedsUpdate = true;
-    m_instancesNeedUpdate = true;
+    m_sceneObjectsFlatValid = false;
+    invalidateInstances(object);
 
     return object;
 }
 
+SceneObjectVector Scene::addSceneObjects(const std::vector<SceneObjectDesc> &descs)
+{
+    SceneObjectVector objects;
+    objects.reserve(descs.size());
+    m_objectsMap.reserve(m_objectsMap.size() + descs.size());
+
+    uint32_t nMeshes = 0;
+    uint32_t nMaterials = 0;
+    for (const SceneObjectDesc &desc : descs) {
+        nMeshes += (desc.mesh != nullptr);
+        nMaterials += (desc.material != nullptr);
+    }
+    ComponentManager &cm = ComponentManager::getInstance();
+    cm.reserve<ComponentMesh>(nMeshes);
+    cm.reserve<ComponentMaterial>(nMaterials);
+
+    m_batchUpdate = true;
+    for (uint32_t i = 0; i < descs.size(); i++) {
+        const SceneObjectDesc &desc = descs[i];
+        assert(desc.parentIndex < static_cast<int32_t>(i));
+
+        SceneObject *object = createObject(desc.name);
+        object->setLocalTransform(desc.transform);
+
+        SceneObject *parentNode = (desc.parentIndex >= 0 ? objects[desc.parentIndex] : desc.parent);
+        if (parentNode == nullptr) {
+            SceneObject::addRoot(m_sceneGraph, object);
+        } else {
+            parentNode->addChild(object);
+        }
+        m_objectsMap.insert({object->getID(), object});
+
+        if (desc.mesh != nullptr) {
+            object->add<ComponentMesh>().setMesh(desc.mesh, desc.model);
+        }
+        if (desc.material != nullptr) {
+            object->add<ComponentMaterial>().setMaterial(desc.material);
+        }
+
+        objects.push_back(object);
+    }
+    m_batchUpdate = false;
+
+    m_sceneGraphNeedsUpdate = true;
+    m_sceneObjectsFlatValid = false;
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        m_dirtyInstances.insert(objects.begin(), objects.end());
+    }
+
+    return objects;
+}
+
 void Scene::removeSceneObject(SceneObject *node)
 {
     /* Remove from scene graph */
     if (node->parent() == nullptr) {
         /* Remove scene node from root */
-        m_sceneGraph.erase(std::remove(m_sceneGraph.begin(), m_sceneGraph.end(), node), m_sceneGraph.end());
+        SceneObject::removeRoot(m_sceneGraph, node);
     } else {
         /* Remove from parent */
         node->parent()->removeChild(node);
     }
 
-    SceneObjectVector nodeChildren = node->children();
-    ID nodeId = node->getID();
+    deleteSubtrees({node}, true);
 
-    m_objectsMap.erase(nodeId);
-    deleteObject(node);
+    m_sceneGraphNeedsUpdate = true;
+    m_sceneObjectsFlatValid = false;
+}
 
-    /* Remove children recusrively */
-    std::function<void(const SceneObjectVector &)> removeChildren;
-    removeChildren = [&](const SceneObjectVector &children) {
-        for (auto c : children) {
-            SceneObjectVector cChildren = c->children();
-            ID cId = c->getID();
-            deleteObject(c);
+void Scene::removeSceneObjects(std::span<SceneObject *const> objects)
+{
+    /* Skip objects that are removed with an ancestor */
+    std::unordered_set<SceneObject *> removed(objects.begin(), objects.end());
+    SceneObjectVector roots;
+    roots.reserve(objects.size());
+    for (SceneObject *object : objects) {
+        bool hasRemovedAncestor = false;
+        for (auto p = object->parent(); p != nullptr; p = p->parent()) {
+            if (removed.count(static_cast<SceneObject *>(p)) > 0) {
+                hasRemovedAncestor = true;
+                break;
+            }
+        }
+        if (!hasRemovedAncestor) {
+            roots.push_back(object);
+        }
+    }
 
-            m_objectsMap.erase(cId);
-            removeChildren(cChildren);
+    /* Unlink the roots */
+    for (SceneObject *root : roots) {
+        if (root->parent() == nullptr) {
+            SceneObject::removeRoot(m_sceneGraph, root);
+        } else {
+            root->parent()->removeChild(root);
         }
-    };
+    }
 
-    removeChildren(nodeChildren);
+    deleteSubtrees(roots, true);
 
     m_sceneGraphNeedsUpdate = true;
-    m_instancesNeedUpdate = true;
+    m_sceneObjectsFlatValid = false;
 }
 
 void Scene::update()
+{
+    updateSceneGraph();
+    updateInstances();
+    updateLightInstances();
+}
+
+void Scene::updateSceneGraph()
 {
 #ifdef PRINT_UPDATE_TIME
     debug_tools::Timer timer;
@@ -110,14 +194,40 @@ void Scene::update()
 #endif
 
     bool tlasNeedsUpdate = m_sceneGraphNeedsUpdate || m_instancesNeedUpdate;
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        tlasNeedsUpdate = tlasNeedsUpdate || !m_dirtyInstances.empty();
+    }
     if (tlasNeedsUpdate) {
         invalidateTLAS();
     }
 
+    /* Objects whose components changed, their bounds may have changed too */
+    SceneObjectVector dirtyObjects;
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        dirtyObjects.assign(m_dirtyInstances.begin(), m_dirtyInstances.end());
+    }
+
     if (m_sceneGraphNeedsUpdate) {
         m_sceneGraphNeedsUpdate = false;
 
-        UpdateSceneGraphParallel(m_sceneGraph, m_engine.threadPool());
+        ThreadPool &threadPool = m_engine.threadPool();
+        m_transformHierarchy.update(threadPool);
+
+        /* Notify the objects whose model matrix changed */
+        const std::vector<TransformHierarchy::Handle> &changed = m_transformHierarchy.changed();
+        auto notifyObjects = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                SceneObject *object = m_transformObjects[changed[i]];
+                object->updateModelMatrix(object->modelMatrix());
+            }
+        };
+        parallelFor(threadPool, 0, static_cast<uint32_t>(changed.size()), UPDATE_MODEL_MATRIX_MIN_GRAIN, notifyObjects);
+
+        updateBVH(changed, dirtyObjects);
+    } else {
+        updateBVH({}, dirtyObjects);
     }
 
 #ifdef PRINT_UPDATE_TIME
@@ -125,13 +235,28 @@ void Scene::update()
     if (timer.ToInt() != 0) {
         debug_tools::ConsoleInfo("Scene update time: " + timer.ToString() + " ms");
     }
+#endif
+}
 
+void Scene::updateInstances()
+{
+#ifdef PRINT_UPDATE_TIME
+    debug_tools::Timer timer;
     timer.Start();
 #endif
 
+    std::unordered_set<SceneObject *> dirtyInstances;
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        dirtyInstances.swap(m_dirtyInstances);
+    }
+
     if (m_instancesNeedUpdate) {
         m_instancesNeedUpdate = false;
         instancesManager().invalidate();
+    } else if (!dirtyInstances.empty()) {
+        /* Patch only the objects that changed */
+        instancesManager().update(dirtyInstances);
     }
 
     instancesManager().build();
@@ -144,21 +269,43 @@ void Scene::update()
 #endif
 }
 
-SceneObjectVector Scene::getSceneObjectsFlat() const
+void Scene::updateLightInstances()
+{
+    instancesManager().buildLightInstances();
+}
+
+void Scene::sortTransparent()
+{
+    if (m_camera == nullptr)
+        return;
+
+    instancesManager().sortTransparent(m_camera->transform().position(), m_engine.threadPool());
+}
+
+void Scene::cullInstances()
 {
-    SceneObjectVector temp;
+    if (m_camera == nullptr)
+        return;
 
-    for (auto &&rootNode : m_sceneGraph) {
-        temp.push_back(rootNode);
-        auto rootNodeObjects = rootNode->getSceneNodesFlat();
+    SceneData sceneData = getSceneData();
+    instancesManager().cull(sceneData.m_projection * sceneData.m_view, m_engine.threadPool());
+}
 
-        temp.insert(temp.end(), rootNodeObjects.begin(), rootNodeObjects.end());
+const SceneObjectVector &Scene::getSceneObjectsFlat() const
+{
+    if (!m_sceneObjectsFlatValid) {
+        m_sceneObjectsFlat.clear();
+        m_sceneObjectsFlat.reserve(m_objectsMap.size());
+        for (SceneObject *object : SceneObject::depthFirst(m_sceneGraph)) {
+            m_sceneObjectsFlat.push_back(object);
+        }
+        m_sceneObjectsFlatValid = true;
     }
 
-    return temp;
+    return m_sceneObjectsFlat;
 }
 
-SceneObjectVector &Scene::sceneGraph()
+const SceneObject::Siblings &Scene::sceneGraph() const
 {
     return m_sceneGraph;
 }
@@ -171,6 +318,50 @@ SceneObject *Scene::findSceneObjectByID(vengine::ID id) const
     return itr->second;
 }
 
+SceneObject *Scene::pick(const Ray &ray, float tMax) const
+{
+    /* Test the meshes of the objects whose AABB is hit, in object space. The ray direction isn't normalized, so distances
+     * along the ray are the same in world and object space */
+    auto intersectObject = [&](BVH::ItemID item, float &t) {
+        const SceneObject *so = m_transformObjects[item];
+        /* Inactive objects aren't rendered, same as the instances */
+        if (!so->isActive())
+            return false;
+
+        glm::mat4 worldToObject = glm::inverse(so->modelMatrix());
+        Ray rayObject(glm::vec3(worldToObject * glm::vec4(ray.origin, 1.0F)),
+                      glm::vec3(worldToObject * glm::vec4(ray.direction, 0.0F)));
+
+        return so->get<ComponentMesh>().mesh()->intersect(rayObject, t, t, m_engine.threadPool());
+    };
+
+    float t;
+    BVH::ItemID item = m_bvh.intersectRay(ray, tMax, intersectObject, t);
+    return item != BVH::INVALID_INDEX ? m_transformObjects[item] : nullptr;
+}
+
+SceneObject *Scene::pick(float x, float y) const
+{
+    if (m_camera == nullptr)
+        return nullptr;
+
+    return pick(cameraRay(x, y), 1.0F);
+}
+
+Ray Scene::cameraRay(float x, float y) const
+{
+    assert(m_camera != nullptr);
+
+    /* Unproject the point on the near and the far plane, same as the primary rays of the path tracer */
+    glm::mat4 clipToWorld = glm::inverse(m_camera->projectionMatrix() * m_camera->viewMatrix());
+    glm::vec2 ndc = glm::vec2(x, y) * 2.0F - 1.0F;
+    glm::vec4 pNear = clipToWorld * glm::vec4(ndc, 0.0F, 1.0F);
+    glm::vec4 pFar = clipToWorld * glm::vec4(ndc, 1.0F, 1.0F);
+    glm::vec3 origin = glm::vec3(pNear) / pNear.w;
+
+    return Ray(origin, glm::vec3(pFar) / pFar.w - origin);
+}
+
 void Scene::exportScene(const ExportRenderParams &renderParams) const
 {
     EnvironmentMap *envMap = nullptr;
@@ -183,35 +374,120 @@ void Scene::exportScene(const ExportRenderParams &renderParams) const
 
 void Scene::clear()
 {
-    std::function<void(const SceneObjectVector &)> deleteChildren;
-    deleteChildren = [&](const SceneObjectVector &children) {
-        for (auto c : children) {
-            SceneObjectVector cChildren = c->children();
-            deleteObject(c);
-            deleteChildren(cChildren);
-        }
-    };
-
-    for (SceneObject *so : m_sceneGraph) {
-        SceneObjectVector nodeChildren = so->children();
-        deleteObject(so);
-        /* Delete children recusrively */
-        deleteChildren(nodeChildren);
+    /* Everything goes, drop the instances once instead of removing the objects one by one */
+    instancesManager().invalidate();
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        m_dirtyInstances.clear();
     }
+
+    m_bvh.clear();
+    deleteSubtrees(SceneObjectVector(m_sceneGraph.begin(), m_sceneGraph.end()), false);
+
     m_sceneGraph.clear();
     m_objectsMap.clear();
     m_sceneGraphNeedsUpdate = true;
+    m_sceneObjectsFlatValid = false;
     m_instancesNeedUpdate = true;
 }
 
 void Scene::invalidateSceneGraph(bool changed)
 {
+    if (m_batchUpdate)
+        return;
     m_sceneGraphNeedsUpdate = changed;
 }
 
 void Scene::invalidateInstances(bool changed)
 {
+    if (m_batchUpdate)
+        return;
     m_instancesNeedUpdate = changed;
 }
 
+void Scene::invalidateInstances(SceneObject *object)
+{
+    if (m_batchUpdate)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+    m_dirtyInstances.insert(object);
+}
+
+void Scene::updateBVH(const std::vector<TransformHierarchy::Handle> &changed, const SceneObjectVector &dirty)
+{
+    for (SceneObject *object : dirty) {
+        object->computeAABB();
+    }
+
+    size_t nChanged = changed.size() + dirty.size();
+    if (nChanged == 0)
+        return;
+
+    if (nChanged > BVH_REBUILD_FRACTION * m_bvh.size()) {
+        std::vector<BVH::ItemID> items;
+        std::vector<AABB3> bounds;
+        items.reserve(m_objectsMap.size());
+        bounds.reserve(m_objectsMap.size());
+        for (SceneObject *object : m_transformObjects) {
+            if (object != nullptr && object->hasBounds()) {
+                items.push_back(object->transformHandle());
+                bounds.push_back(object->AABB());
+            }
+        }
+        m_bvh.build(items, bounds, m_engine.threadPool());
+        return;
+    }
+
+    for (TransformHierarchy::Handle handle : changed) {
+        updateBVH(m_transformObjects[handle]);
+    }
+    for (SceneObject *object : dirty) {
+        updateBVH(object);
+    }
+}
+
+void Scene::updateBVH(SceneObject *object)
+{
+    TransformHierarchy::Handle handle = object->transformHandle();
+    bool inBVH = m_bvh.contains(handle);
+    if (object->hasBounds()) {
+        if (inBVH) {
+            m_bvh.update(handle, object->AABB());
+        } else {
+            m_bvh.insert(handle, object->AABB());
+        }
+    } else if (inBVH) {
+        m_bvh.remove(handle);
+    }
+}
+
+void Scene::deleteSubtrees(const SceneObjectVector &roots, bool eraseFromMap)
+{
+    /* Gather all objects first, deleting an object unlinks its children */
+    SceneObjectVector objects(roots.begin(), roots.end());
+    for (size_t i = 0; i < objects.size(); i++) {
+        const SceneObject::Siblings &children = objects[i]->children();
+        objects.insert(objects.end(), children.begin(), children.end());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_dirtyInstancesMutex);
+        for (SceneObject *object : objects) {
+            m_dirtyInstances.erase(object);
+        }
+    }
+
+    for (SceneObject *object : objects) {
+        if (eraseFromMap) {
+            m_objectsMap.erase(object->getID());
+        }
+        if (m_bvh.contains(object->transformHandle())) {
+            m_bvh.remove(object->transformHandle());
+        }
+        instancesManager().removeSceneObject(object);
+        deleteObject(object);
+    }
+}
+
 }  // namespace vengine
@@ -2,8 +2,13 @@
 #define __Scene_hpp__
 
 #include <memory>
+#include <mutex>
+#include <span>
 #include <utility>
+#include <unordered_set>
 
+#include <vengine/math/BVH.hpp>
+#include <vengine/math/TransformHierarchy.hpp>
 #include <vengine/utils/IDGeneration.hpp>
 
 #include "Camera.hpp"
@@ -34,6 +39,21 @@ struct SceneData {
     glm::vec4 m_volumes;    /* R = material id of camera volume, G = near plane, B = far plane, A = unused */
 };
 
+/* Description of a scene object created by Scene::addSceneObjects() */
+struct SceneObjectDesc {
+    std::string name;
+    Transform transform;
+    /* Index of the parent in the same batch, has to be smaller than the index of the object. -1 to use parent instead */
+    int32_t parentIndex = -1;
+    /* Parent outside of the batch, nullptr to add at the root of the scene graph */
+    SceneObject *parent = nullptr;
+    /* Components to attach, skipped if nullptr */
+    Mesh *mesh = nullptr;
+    Material *material = nullptr;
+    /* The model of the mesh, see ComponentMesh::model() */
+    const Model3D *model = nullptr;
+};
+
 class Engine;
 
 class Scene
@@ -71,16 +91,71 @@ public:
     /* Add a new scene object as a child of a node */
     SceneObject *addSceneObject(std::string name, SceneObject *parentNode, Transform transform);
 
+    /**
+     * @brief Add many scene objects at once. Storage for the objects and their components is reserved up front and the scene
+     * is invalidated once at the end, by queueing the new objects for an instance update
+     *
+     * @param descs The objects to add, parents have to come before their children
+     * @return The new objects, in the order of descs
+     */
+    SceneObjectVector addSceneObjects(const std::vector<SceneObjectDesc> &descs);
+
     void removeSceneObject(SceneObject *object);
 
+    /* Remove many scene objects and their children at once, the scene is invalidated once. Objects whose ancestor is also in
+     * the list are removed once */
+    void removeSceneObjects(std::span<SceneObject *const> objects);
+
+    /* Update the scene graph, the instances and the light instances */
     virtual void update();
 
-    SceneObjectVector &sceneGraph();
-    /* Get all scene objects in a flat array */
-    SceneObjectVector getSceneObjectsFlat() const;
+    /* Update stages, update() runs them in order. updateLightInstances() and sortTransparent() need updateInstances() */
+    void updateSceneGraph();
+    void updateInstances();
+    void updateLightInstances();
+    /* Sort the transparent instances back to front from the camera */
+    void sortTransparent();
+    /* Find the instances inside the camera frustum, for the raster renderers. Needs sortTransparent() */
+    void cullInstances();
+
+    /* Get the root scene objects, in no particular order */
+    const SceneObject::Siblings &sceneGraph() const;
+    /* Get all scene objects in a flat array, depth first. The array is cached until objects are added, removed or moved */
+    const SceneObjectVector &getSceneObjectsFlat() const;
+
+    /* Iterate all scene objects depth first, without allocating */
+    SceneObject::DepthFirstRange depthFirst() { return SceneObject::depthFirst(m_sceneGraph); }
+
+    /* Call f for all scene objects breadth first, parents before children, in the order of the transform hierarchy */
+    template <typename F>
+    void visitBreadthFirst(const F &f)
+    {
+        for (TransformHierarchy::Handle handle : m_transformHierarchy.nodes()) {
+            f(m_transformObjects[handle]);
+        }
+    }
 
     SceneObject *findSceneObjectByID(vengine::ID id) const;
 
+    /* Find the closest active scene object whose mesh is hit by a ray in world space, nullptr on a miss. Uses the BVH and the
+     * world matrices of the last updateSceneGraph(), so it can't run while the scene is updated */
+    SceneObject *pick(const Ray &ray, float tMax = std::numeric_limits<float>::max()) const;
+    /* Find the scene object rendered at x, y viewport coordinates in [0, 1], from the top left corner */
+    SceneObject *pick(float x, float y) const;
+    /* Get the camera ray through x, y viewport coordinates in [0, 1], from the top left corner. It starts on the near plane and
+     * reaches the far plane at t = 1. The camera has to be set */
+    Ray cameraRay(float x, float y) const;
+
+    /* Get the transforms of all scene objects */
+    const TransformHierarchy &transformHierarchy() const { return m_transformHierarchy; }
+    TransformHierarchy &transformHierarchy() { return m_transformHierarchy; }
+
+    /* Get the BVH over the AABBs of the scene objects that have a mesh, items are transform hierarchy handles. It is kept in
+     * sync by updateSceneGraph() */
+    const BVH &bvh() const { return m_bvh; }
+    /* Get the scene object of a transform hierarchy handle */
+    SceneObject *sceneObject(TransformHierarchy::Handle handle) const { return m_transformObjects[handle]; }
+
     void exportScene(const ExportRenderParams &renderParams) const;
 
     /* Create a light */
@@ -105,17 +180,50 @@ protected:
 
     std::unordered_map<vengine::ID, SceneObject *> m_objectsMap;
 
-    SceneObjectVector m_sceneGraph;
+    SceneObject::Siblings m_sceneGraph;
     bool m_sceneGraphNeedsUpdate = true;
+    /* Cached result of getSceneObjectsFlat() */
+    mutable SceneObjectVector m_sceneObjectsFlat;
+    mutable bool m_sceneObjectsFlatValid = false;
+    /* Local transforms and world matrices of all scene objects */
+    TransformHierarchy m_transformHierarchy;
+    /* Scene object of every transform hierarchy handle */
+    SceneObjectVector m_transformObjects;
+    /* BVH over the AABBs of the scene objects */
+    BVH m_bvh;
+    /* Set when all instances have to be rebuilt */
     bool m_instancesNeedUpdate = true;
+    /* Scene objects whose instances have to be updated */
+    std::unordered_set<SceneObject *> m_dirtyInstances;
+    std::mutex m_dirtyInstancesMutex;
 
     virtual SceneObject *createObject(std::string name) = 0;
     virtual void deleteObject(SceneObject *) = 0;
     virtual void invalidateTLAS() = 0;
 
 private:
+    /* True while a batch of objects is added, scene objects skip per object invalidations */
+    bool m_batchUpdate = false;
+
     void invalidateSceneGraph(bool changed);
+    /* Rebuild all instances */
     void invalidateInstances(bool changed);
+    /* Update the instances of one scene object */
+    void invalidateInstances(SceneObject *object);
+
+    /**
+     * @brief Bring the BVH up to date with the objects whose model matrix or components changed. The BVH is rebuilt when
+     * many objects changed, and updated incrementally otherwise
+     *
+     * @param changed Transform hierarchy handles of the objects whose model matrix changed
+     * @param dirty Objects whose components changed, their AABB is recomputed
+     */
+    void updateBVH(const std::vector<TransformHierarchy::Handle> &changed, const SceneObjectVector &dirty);
+    /* Insert, update or remove one object in the BVH */
+    void updateBVH(SceneObject *object);
+
+    /* Delete the objects and all their children, without touching the scene graph links of the roots */
+    void deleteSubtrees(const SceneObjectVector &roots, bool eraseFromMap);
 };
 
 }  // namespace vengine
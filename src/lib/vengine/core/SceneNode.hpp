@@ -4,8 +4,11 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <cassert>
+#include <iterator>
 
 #include <vengine/math/Transform.hpp>
+#include <vengine/math/TransformHierarchy.hpp>
 #include <vengine/math/MathUtils.hpp>
 #include <vengine/utils/ThreadPool.hpp>
 
@@ -16,119 +19,293 @@ template <class T>
 class SceneNode
 {
 public:
-    SceneNode(Transform transform)
-        : m_localTransform(transform){};
+    SceneNode(TransformHierarchy &hierarchy, Transform transform)
+        : m_hierarchy(hierarchy)
+        , m_localTransform(transform)
+        , m_transformHandle(hierarchy.add(transform)){};
+
+    virtual ~SceneNode() { m_hierarchy.remove(m_transformHandle); }
 
     /* Get/set local transform */
     const Transform &localTransform() const { return m_localTransform; }
     void setLocalTransform(const Transform &transform)
     {
         m_localTransform = transform;
-        m_localTransformDirty = true;
+        m_hierarchy.setLocalTransform(m_transformHandle, transform);
         transformChanged();
     }
 
-    /* get the world space model matrix */
-    const glm::mat4 &modelMatrix() const { return m_modelMatrix; }
+    /* get the world space model matrix, as of the last update of the transform hierarchy */
+    const glm::mat4 &modelMatrix() const { return m_hierarchy.worldMatrix(m_transformHandle); }
 
     /* get node world position */
-    glm::vec3 worldPosition() const { return getTranslation(m_modelMatrix); }
+    glm::vec3 worldPosition() const { return getTranslation(modelMatrix()); }
+
+    /* get the handle of the node in the transform hierarchy */
+    TransformHierarchy::Handle transformHandle() const { return m_transformHandle; }
+
+    /**
+     * @brief An ordered list of sibling nodes, the children of a node or a list of root nodes. The list is linked through the
+     * nodes, nodes are added at the back and removed in constant time, keeping the order of the rest
+     */
+    class Siblings
+    {
+    public:
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = T *;
+            using pointer = T *const *;
+            using reference = T *;
+
+            Iterator() = default;
+            Iterator(T *node)
+                : m_node(node){};
+
+            T *operator*() const { return m_node; }
+
+            Iterator &operator++()
+            {
+                m_node = m_node->m_nextSibling;
+                return *this;
+            }
+            Iterator operator++(int)
+            {
+                Iterator tmp = *this;
+                m_node = m_node->m_nextSibling;
+                return tmp;
+            }
+
+            bool operator==(const Iterator &other) const { return m_node == other.m_node; }
+            bool operator!=(const Iterator &other) const { return m_node != other.m_node; }
+
+        private:
+            T *m_node = nullptr;
+        };
+
+        Iterator begin() const { return Iterator(m_first); }
+        Iterator end() const { return Iterator(); }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        T *front() const { return m_first; }
+        T *back() const { return m_last; }
+
+        /* Forget all nodes, without unlinking them one by one */
+        void clear()
+        {
+            m_first = m_last = nullptr;
+            m_size = 0;
+        }
+
+    private:
+        friend class SceneNode<T>;
+
+        T *m_first = nullptr;
+        T *m_last = nullptr;
+        size_t m_size = 0;
+
+        void pushBack(T *node)
+        {
+            assert(node->m_prevSibling == nullptr && node->m_nextSibling == nullptr && m_first != node);
+            node->m_prevSibling = m_last;
+            if (m_last != nullptr) {
+                m_last->m_nextSibling = node;
+            } else {
+                m_first = node;
+            }
+            m_last = node;
+            m_size++;
+        }
+
+        void remove(T *node)
+        {
+            assert(m_size > 0);
+            if (node->m_prevSibling != nullptr) {
+                node->m_prevSibling->m_nextSibling = node->m_nextSibling;
+            } else {
+                assert(m_first == node);
+                m_first = node->m_nextSibling;
+            }
+            if (node->m_nextSibling != nullptr) {
+                node->m_nextSibling->m_prevSibling = node->m_prevSibling;
+            } else {
+                assert(m_last == node);
+                m_last = node->m_prevSibling;
+            }
+            node->m_prevSibling = node->m_nextSibling = nullptr;
+            m_size--;
+        }
+    };
 
     /* get parent node */
     const SceneNode<T> *parent() const { return m_parent; }
-    SceneNode<T> *&parent() { return m_parent; }
+    SceneNode<T> *parent() { return m_parent; }
 
-    /* get node children */
-    const std::vector<T *> &children() const { return m_children; }
-    std::vector<T *> &children() { return m_children; }
+    /* get node children, in the order they were added */
+    const Siblings &children() const { return m_children; }
 
-    /* add a child */
+    /* add a child after the existing children */
     T *addChild(T *node)
     {
-        m_children.push_back(node);
-        m_children.back()->parent() = this;
-        return m_children.back();
+        m_children.pushBack(node);
+        node->m_parent = this;
+        m_hierarchy.setParent(node->m_transformHandle, m_transformHandle);
+        return node;
     }
 
-    /* remove a child */
-    void removeChild(T *node) { m_children.erase(std::remove(m_children.begin(), m_children.end(), node), m_children.end()); }
+    /* remove a child in constant time, the other children keep their order */
+    void removeChild(T *node)
+    {
+        m_children.remove(node);
+        node->m_parent = nullptr;
+        m_hierarchy.setParent(node->m_transformHandle, TransformHierarchy::INVALID_HANDLE);
+    }
 
-    /* update this node */
-    void update()
+    /* add a node at the back of a list of root nodes */
+    static void addRoot(Siblings &roots, T *node)
     {
-        m_modelMatrixChanged = false;
-        if (m_parent) {
-            /* if nodes has a parent, update if parent changed, or if we changed */
-            if (m_parent->modelMatrixChanged() || m_localTransformDirty) {
-                m_modelMatrix = m_parent->m_modelMatrix * m_localTransform.getModelMatrix();
-                m_modelMatrixChanged = true;
-                m_localTransformDirty = false;
-            }
-        } else if (m_localTransformDirty) {
-            /* else update only if we changed */
-            m_modelMatrix = m_localTransform.getModelMatrix();
-            m_modelMatrixChanged = true;
-            m_localTransformDirty = false;
+        assert(node->m_parent == nullptr);
+        roots.pushBack(node);
+    }
+
+    /* remove a node added with addRoot() in constant time, the other roots keep their order */
+    static void removeRoot(Siblings &roots, T *node) { roots.remove(node); }
+
+    /**
+     * @brief Depth first, pre-order iterator over scene nodes. It follows the parent and sibling links, so it doesn't allocate.
+     * The tree must not change while iterating
+     */
+    class DepthFirstIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T *;
+        using pointer = T *const *;
+        using reference = T *;
+
+        DepthFirstIterator() = default;
+
+        /* Iterate the roots and their descendants */
+        DepthFirstIterator(const Siblings &roots)
+            : m_node(roots.front()){};
+
+        /* Iterate the subtree of node */
+        DepthFirstIterator(T *node)
+            : m_node(node)
+            , m_subtreeRoot(node){};
+
+        T *operator*() const { return m_node; }
+
+        DepthFirstIterator &operator++()
+        {
+            advance();
+            return *this;
         }
+        DepthFirstIterator operator++(int)
+        {
+            DepthFirstIterator tmp = *this;
+            advance();
+            return tmp;
+        }
+
+        bool operator==(const DepthFirstIterator &other) const { return m_node == other.m_node; }
+        bool operator!=(const DepthFirstIterator &other) const { return m_node != other.m_node; }
 
-        /* if model matrix changed, notify */
-        if (m_modelMatrixChanged) {
-            updateModelMatrix(m_modelMatrix);
+    private:
+        T *m_node = nullptr;
+        /* Set when iterating a subtree, nullptr when iterating a list of roots */
+        T *m_subtreeRoot = nullptr;
+
+        void advance()
+        {
+            T *node = m_node;
+            if (!node->m_children.empty()) {
+                m_node = node->m_children.front();
+                return;
+            }
+
+            /* Go up until a node with a next sibling is found */
+            while (node != m_subtreeRoot) {
+                if (node->m_nextSibling != nullptr) {
+                    m_node = node->m_nextSibling;
+                    return;
+                }
+                if (node->m_parent == nullptr) {
+                    break;
+                }
+                node = static_cast<T *>(node->m_parent);
+            }
+            m_node = nullptr;
         }
-    }
-    
-    /* Get all nodes in a flat array */
-    std::vector<T *> getSceneNodesFlat()
+    };
+
+    /* A range of depth first iterators, usable in range based for loops */
+    class DepthFirstRange
     {
-        std::vector<T *> temp;
+    public:
+        DepthFirstRange(DepthFirstIterator begin)
+            : m_begin(begin){};
+
+        DepthFirstIterator begin() const { return m_begin; }
+        DepthFirstIterator end() const { return DepthFirstIterator(); }
+
+    private:
+        DepthFirstIterator m_begin;
+    };
+
+    /* Iterate this node and all its descendants, depth first */
+    DepthFirstRange subtree() { return DepthFirstRange(DepthFirstIterator(static_cast<T *>(this))); }
 
-        for (auto &child : m_children) {
-            temp.push_back(child);
-            auto childrenObjects = child->getSceneNodesFlat();
+    /* Iterate a list of root nodes and all their descendants, depth first */
+    static DepthFirstRange depthFirst(const Siblings &roots) { return DepthFirstRange(DepthFirstIterator(roots)); }
 
-            temp.insert(temp.end(), childrenObjects.begin(), childrenObjects.end());
+    /* Get all nodes under this node in a flat array, depth first */
+    std::vector<T *> getSceneNodesFlat()
+    {
+        std::vector<T *> temp;
+        for (T *node : subtree()) {
+            if (node != this) {
+                temp.push_back(node);
+            }
         }
 
         return temp;
     }
 
-    /* get all nodes in a flat array, and their world space model matrices */
+    /* get all nodes under this node in a flat array, and their world space model matrices */
     std::vector<T *> getSceneNodesFlat(std::vector<glm::mat4> &modelMatrices)
     {
         std::vector<T *> temp;
-
-        for (auto &child : m_children) {
-            temp.push_back(child);
-            modelMatrices.push_back(child->m_modelMatrix);
-
-            std::vector<glm::mat4> childrenMatrices;
-            auto childrenObjects = child->getSceneNodesFlat(childrenMatrices);
-
-            temp.insert(temp.end(), childrenObjects.begin(), childrenObjects.end());
-            modelMatrices.insert(modelMatrices.end(), childrenMatrices.begin(), childrenMatrices.end());
+        for (T *node : subtree()) {
+            if (node != this) {
+                temp.push_back(node);
+                modelMatrices.push_back(node->modelMatrix());
+            }
         }
 
         return temp;
     }
 
 private:
-    /* world space model matrix */
-    glm::mat4 m_modelMatrix = glm::mat4(1.0f);
-    bool m_modelMatrixChanged = true;
-
+    /* The transform hierarchy holds the world space model matrix and a copy of the local transform */
+    TransformHierarchy &m_hierarchy;
     Transform m_localTransform;
-    bool m_localTransformDirty = true;
+    TransformHierarchy::Handle m_transformHandle;
 
-    std::vector<T *> m_children;
+    Siblings m_children;
 
     SceneNode<T> *m_parent = nullptr;
-
-    /* used internally to stop the update early */
-    bool modelMatrixChanged() { return m_modelMatrixChanged; }
+    /* Links to the previous and next node among the children of the parent, or in the list of roots */
+    T *m_prevSibling = nullptr;
+    T *m_nextSibling = nullptr;
 
     /* notify that the local transform has been changed */
     virtual void transformChanged() = 0;
-    /* notify that the world space model matrix of this node has been changed */
+    /* notify that the world space model matrix of this node has been changed by the transform hierarchy update */
     virtual void updateModelMatrix(const glm::mat4 &modelMatrix) = 0;
 };
 
@@ -7,21 +7,27 @@ namespace vengine
 {
 
 SceneObject::SceneObject(Scene *scene, const std::string &name, const Transform &t)
-    : SceneNode(t)
+    : SceneNode(scene->m_transformHierarchy, t)
     , Entity()
     , m_name(name)
     , m_scene(scene)
 {
+    SceneObjectVector &transformObjects = m_scene->m_transformObjects;
+    if (transformHandle() >= transformObjects.size()) {
+        transformObjects.resize(transformHandle() + 1, nullptr);
+    }
+    transformObjects[transformHandle()] = this;
 }
 
 SceneObject::~SceneObject()
 {
+    m_scene->m_transformObjects[transformHandle()] = nullptr;
 }
 
 void SceneObject::setActive(bool active)
 {
     m_active = active;
-    m_scene->invalidateInstances(true);
+    m_scene->invalidateInstances(this);
 }
 
 const AABB3 &SceneObject::AABB() const
@@ -29,16 +35,19 @@ const AABB3 &SceneObject::AABB() const
     return m_aabb;
 }
 
+bool SceneObject::hasBounds() const
+{
+    return has<ComponentMesh>() && get<ComponentMesh>().mesh() != nullptr;
+}
+
 void SceneObject::computeAABB()
 {
     m_aabb = AABB3();
 
-    if (!has<ComponentMesh>())
+    if (!hasBounds())
         return;
 
-    ComponentMesh &mc = get<ComponentMesh>();
-    if (mc.mesh() == nullptr)
-        return;
+    const ComponentMesh &mc = get<ComponentMesh>();
 
     /* Transform mesh aabb points based on the current node model matrix */
     std::array<glm::vec3, 8> aabbPoints;
@@ -69,24 +78,27 @@ void SceneObject::updateModelMatrix(const glm::mat4 &modelMatrix)
 
 void SceneObject::onComponentAdded()
 {
-    m_scene->invalidateInstances(true);
-    computeAABB();
+    m_scene->invalidateInstances(this);
+    /* Objects added in a batch get their AABB on the first scene graph update */
+    if (!m_scene->m_batchUpdate) {
+        computeAABB();
+    }
 }
 
 void SceneObject::onComponentRemoved()
 {
-    m_scene->invalidateInstances(true);
+    m_scene->invalidateInstances(this);
     computeAABB();
 }
 
 void SceneObject::onMeshComponentChanged()
 {
-    m_scene->invalidateInstances(true);
+    m_scene->invalidateInstances(this);
 }
 
 void SceneObject::onMaterialComponentChanged()
 {
-    m_scene->invalidateInstances(true);
+    m_scene->invalidateInstances(this);
 }
 
 void SceneObject::onLightComponentChanged()
@@ -97,7 +109,7 @@ void SceneObject::onLightComponentChanged()
 
 void SceneObject::onVolumeComponentChanged()
 {
-    m_scene->invalidateInstances(true);
+    m_scene->invalidateInstances(this);
 }
 
 }  // namespace vengine
\ No newline at end of file
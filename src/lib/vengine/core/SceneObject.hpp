@@ -14,6 +14,8 @@ class Scene;
 
 class SceneObject : public SceneNode<SceneObject>, public Entity
 {
+    friend class Scene;
+
 public:
     SceneObject(Scene *scene, const std::string &name, const Transform &t);
     virtual ~SceneObject();
@@ -27,7 +29,11 @@ public:
     void setActive(bool active);
     bool isActive() const { return m_active; }
 
+    Scene *scene() const { return m_scene; }
+
     const AABB3 &AABB() const;
+    /* True if the object has a mesh, the AABB of objects without one is infinite */
+    bool hasBounds() const;
 
     void computeAABB();
 
@@ -6,70 +6,59 @@
 namespace vengine
 {
 
-void UpdateSceneGraph(SceneObjectVector &sceneGraph)
+/* Append the scene object descriptions of a model node and its children */
+static void addModelNodeDescs(const Tree<Model3D::Model3DNode> &nodeTree,
+                              int32_t parentIndex,
+                              bool isRoot,
+                              const Model3D *model,
+                              const std::string &modelName,
+                              const std::optional<Transform> &overrideRootTransform,
+                              Material *overrideMat,
+                              Material *defaultMat,
+                              SceneObject *parent,
+                              std::vector<SceneObjectDesc> &descs)
 {
-    for (SceneObject *&node : sceneGraph) {
-        node->update();
-        UpdateSceneGraph(node->children());
-    }
-}
-
-struct SceneObjectVectorUpdateTask : Task {
-    SceneObjectVectorUpdateTask(SceneObjectVector &sov,
-                                uint32_t s,
-                                uint32_t e,
-                                ThreadPool &tp,
-                                SceneObjectVectorUpdateTask *parent = nullptr)
-        : Task(parent)
-        , sceneObjectVector(sov)
-        , start(s)
-        , end(e)
-        , threadPool(tp){};
+    auto &modelNode = nodeTree.data();
 
-    ThreadPool &threadPool;
-    SceneObjectVector &sceneObjectVector;
-    uint32_t start, end;
-    std::vector<SceneObjectVectorUpdateTask> childrenTasks;
-    bool work(float &progress) override
-    {
-        for (uint32_t i = start; i < end; i++) {
-            SceneObject *sceneObject = sceneObjectVector[i];
-            sceneObject->update();
-            createTasks(sceneObject->children(), childrenTasks, threadPool, this);
-            for (Task &task : childrenTasks) {
-                threadPool.push(&task);
-            }
-        }
-        return true;
+    vengine::Transform nodeTransform = modelNode.transform;
+    if (isRoot && overrideRootTransform.has_value()) {
+        nodeTransform = overrideRootTransform.value();
     }
 
-    static void createTasks(SceneObjectVector &sos,
-                            std::vector<SceneObjectVectorUpdateTask> &tasks,
-                            ThreadPool &threadPool,
-                            SceneObjectVectorUpdateTask *parent = nullptr)
-    {
-        uint32_t batchSize = static_cast<uint32_t>(sos.size()) / threadPool.threads();
-        batchSize++;
-
-        uint32_t start = 0;
-        for (uint32_t start = 0; start < sos.size(); start += batchSize) {
-            uint32_t s = std::min(start, static_cast<uint32_t>(sos.size() - 1));
-            uint32_t e = std::min(start + batchSize, static_cast<uint32_t>(sos.size()));
-            tasks.emplace_back(sos, s, e, threadPool, parent);
+    /* Add all meshes of current node under parent */
+    for (uint32_t i = 0; i < modelNode.meshes.size(); i++) {
+        Material *mat = modelNode.materials[i];
+
+        SceneObjectDesc desc;
+        desc.name = modelName;
+        desc.transform = nodeTransform;
+        desc.parentIndex = parentIndex;
+        desc.parent = parent;
+        desc.mesh = modelNode.meshes[i];
+        desc.model = model;
+        if (overrideMat != nullptr) {
+            desc.material = overrideMat;
+        } else if (mat != nullptr) {
+            desc.material = mat;
+        } else {
+            desc.material = defaultMat;
         }
+        descs.push_back(desc);
     }
-};
-
-void UpdateSceneGraphParallel(SceneObjectVector &sceneGraph, ThreadPool &threadPool)
-{
-    std::vector<SceneObjectVectorUpdateTask> tasks;
 
-    SceneObjectVectorUpdateTask::createTasks(sceneGraph, tasks, threadPool);
-    for (Task &task : tasks) {
-        threadPool.push(&task);
-    }
-    for (Task &task : tasks) {
-        task.wait();
+    if (nodeTree.childrenCount() > 0) {
+        SceneObjectDesc desc;
+        desc.name = modelNode.name;
+        desc.transform = nodeTransform;
+        desc.parentIndex = parentIndex;
+        desc.parent = parent;
+        descs.push_back(desc);
+
+        int32_t nodeIndex = static_cast<int32_t>(descs.size() - 1);
+        for (uint32_t i = 0; i < nodeTree.childrenCount(); i++) {
+            addModelNodeDescs(
+                nodeTree.child(i), nodeIndex, false, model, modelName, overrideRootTransform, overrideMat, defaultMat, parent, descs);
+        }
     }
 }
 
@@ -90,43 +79,11 @@ void addModel3D(vengine::Scene &scene,
     vengine::Material *defaultMat = instanceMaterials.get("defaultMaterial");
     vengine::Material *overrideMat = (overrideMaterial.has_value() ? instanceMaterials.get(overrideMaterial.value()) : nullptr);
 
-    std::function<void(const Tree<Model3D::Model3DNode> &, SceneObject *, bool)> addModelF =
-        [&](const Tree<Model3D::Model3DNode> &nodeTree, SceneObject *parent, bool isRoot) {
-            auto &modelNode = nodeTree.data();
-            /* Add all meshes of current node under parent */
-            for (uint32_t i = 0; i < modelNode.meshes.size(); i++) {
-                auto &mesh = modelNode.meshes[i];
-                auto mat = modelNode.materials[i];
-
-                vengine::Transform nodeTransform = modelNode.transform;
-                if (isRoot && overrideRootTransform.has_value()) {
-                    nodeTransform = overrideRootTransform.value();
-                }
-                vengine::SceneObject *newObject = scene.addSceneObject(modelName, parent, nodeTransform);
-
-                newObject->add<vengine::ComponentMesh>().setMesh(mesh);
-                if (overrideMat != nullptr) {
-                    newObject->add<vengine::ComponentMaterial>().setMaterial(overrideMat);
-                } else if (mat != nullptr) {
-                    newObject->add<vengine::ComponentMaterial>().setMaterial(mat);
-                } else {
-                    newObject->add<vengine::ComponentMaterial>().setMaterial(defaultMat);
-                }
-            }
-
-            if (nodeTree.childrenCount() > 0) {
-                vengine::Transform nodeTransform = modelNode.transform;
-                if (isRoot && overrideRootTransform.has_value()) {
-                    nodeTransform = overrideRootTransform.value();
-                }
-                vengine::SceneObject *newObject = scene.addSceneObject(modelNode.name, parent, nodeTransform);
-                for (uint32_t i = 0; i < nodeTree.childrenCount(); i++) {
-                    addModelF(nodeTree.child(i), newObject, false);
-                }
-            }
-        };
+    /* Describe the whole model first and add it in one batch */
+    std::vector<SceneObjectDesc> descs;
+    addModelNodeDescs(modelNodeData, -1, true, model3D, modelName, overrideRootTransform, overrideMat, defaultMat, parent, descs);
 
-    addModelF(modelNodeData, parent, true);
+    scene.addSceneObjects(descs);
 }
 
 }  // namespace vengine
\ No newline at end of file
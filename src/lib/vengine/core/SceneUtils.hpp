@@ -1,17 +1,14 @@
 #ifndef __SceneUtils_hpp__
 #define __SceneUtils_hpp__
 
+#include <optional>
+
 #include "Scene.hpp"
 #include "utils/ThreadPool.hpp"
 
 namespace vengine
 {
 
-/* Update Scene objects */
-void UpdateSceneGraph(SceneObjectVector &sceneGraph);
-
-void UpdateSceneGraphParallel(SceneObjectVector &sceneGraph, ThreadPool &threadPool);
-
 /**
  * Adds a 3D model onto a scene
  * @param scene The scene to add it in
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <optional>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -18,9 +19,12 @@
 #include "debug_tools/Console.hpp"
 
 #include "core/io/FileTypes.hpp"
+#include "core/MeshKernels.hpp"
+#include "core/MeshOptimization.hpp"
 #include "core/StringUtils.hpp"
 #include "math/Transform.hpp"
 #include "math/MathUtils.hpp"
+#include "utils/Parallel.hpp"
 
 #define SANITIZATION_CHECK
 // #define DEBUG_MATERIAL_WRITE_EMBEDDED_IMAGES
@@ -48,7 +52,13 @@ bool checkValid(glm::vec2 in)
     return !std::isnan(in.x) && !std::isinf(in.x) && !std::isnan(in.y) && !std::isinf(in.y);
 }
 
-Mesh assimpLoadMesh(aiMesh *mesh, const aiScene *scene, const AssetInfo &info)
+/* Load a mesh, returns an empty optional if the mesh has no triangles */
+std::optional<Mesh> assimpLoadMesh(aiMesh *mesh,
+                                   const aiScene *scene,
+                                   const AssetInfo &info,
+                                   VertexCacheStatistics &before,
+                                   VertexCacheStatistics &after,
+                                   ThreadPool *threadPool)
 {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
@@ -58,40 +68,35 @@ Mesh assimpLoadMesh(aiMesh *mesh, const aiScene *scene, const AssetInfo &info)
 
     auto meshName = std::string(mesh->mName.C_Str());
 
-    bool printErrorMessage = true;
+    /* Iterate over faces */
+    indices.reserve(3 * static_cast<size_t>(mesh->mNumFaces));
+    for (size_t i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace &face = mesh->mFaces[i];
+        /* Points and lines are left by the triangulation, skip them to keep a triangle list */
+        if (face.mNumIndices != 3)
+            continue;
+
+        indices.insert(indices.end(), {face.mIndices[0], face.mIndices[1], face.mIndices[2]});
+    }
+
+    /* Point and line meshes would end up with empty vertex and index buffers */
+    if (indices.empty()) {
+        debug_tools::ConsoleWarning("Mesh: [" + std::string(scene->mRootNode->mName.C_Str()) + " : " + meshName +
+                                    "] doesn't have any triangles, skipping");
+        return std::nullopt;
+    }
+
     vertices.resize(mesh->mNumVertices);
     for (size_t i = 0; i < mesh->mNumVertices; i++) {
         vertices[i].position = {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z};
 
-#ifdef SANITIZATION_CHECK
-        if (!checkValid(vertices[i].position) && printErrorMessage) {
-            debug_tools::ConsoleCritical("assimpLoadMesh(): Input vertex for mesh [" + meshName + "] is corrupted");
-            printErrorMessage = false;
-        }
-#endif
-
         if (hasNormals) {
-            vertices[i].normal = glm::normalize(glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z));
-
-#ifdef SANITIZATION_CHECK
-            if (!checkValid(vertices[i].normal) && printErrorMessage) {
-                debug_tools::ConsoleCritical("assimpLoadMesh(): Input normal for mesh [" + meshName + "] is corrupted");
-                printErrorMessage = false;
-            }
-#endif
+            vertices[i].normal = {mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z};
         }
 
-        if (mesh->mTextureCoords[0]) {
+        if (hasUVs) {
             /* Flip v coordinate vertically because of vulkan */
             vertices[i].uv = {mesh->mTextureCoords[0][i].x, 1.f - mesh->mTextureCoords[0][i].y};
-
-#ifdef SANITIZATION_CHECK
-            if (!checkValid(vertices[i].uv) && printErrorMessage) {
-                debug_tools::ConsoleCritical("assimpLoadMesh(): Input uv for mesh [" + meshName + "] is corrupted");
-                printErrorMessage = false;
-            }
-#endif
-
         } else {
             vertices[i].uv = {0, 0};
         }
@@ -99,40 +104,61 @@ Mesh assimpLoadMesh(aiMesh *mesh, const aiScene *scene, const AssetInfo &info)
         vertices[i].color = {1, 1, 1};
 
         if (hasTangents) {
-            vertices[i].tangent = glm::normalize(glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z));
-            vertices[i].bitangent = glm::normalize(glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z));
+            vertices[i].tangent = {mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z};
+            vertices[i].bitangent = {mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z};
+        }
+    }
+
+    /* Normalize and check the attribute arrays as a whole */
+    uint32_t nInvalidNormals = hasNormals ? normalizeVectors(vertices, &Vertex::normal, threadPool) : 0;
+    uint32_t nInvalidTangents = 0;
+    if (hasTangents) {
+        nInvalidTangents += normalizeVectors(vertices, &Vertex::tangent, threadPool);
+        nInvalidTangents += normalizeVectors(vertices, &Vertex::bitangent, threadPool);
+    }
 
 #ifdef SANITIZATION_CHECK
-            if (!checkValid(vertices[i].tangent) || !checkValid(vertices[i].bitangent)) {
-                if (printErrorMessage) {
-                    debug_tools::ConsoleWarning("assimpLoadMesh(): Input tangent or bitangent for mesh [" + meshName +
-                                                "] is corrupted. Attempting reconstruction from normal...");
-                    printErrorMessage = false;
-                }
+    if (countNonFinite(vertices, &Vertex::position, threadPool) > 0) {
+        debug_tools::ConsoleCritical("assimpLoadMesh(): Input vertex for mesh [" + meshName + "] is corrupted");
+    } else if (nInvalidNormals > 0) {
+        debug_tools::ConsoleCritical("assimpLoadMesh(): Input normal for mesh [" + meshName + "] is corrupted");
+    } else if (hasUVs && countNonFinite(vertices, &Vertex::uv, threadPool) > 0) {
+        debug_tools::ConsoleCritical("assimpLoadMesh(): Input uv for mesh [" + meshName + "] is corrupted");
+    }
 
-                auto t1 = glm::cross(vertices[i].normal, Transform::WORLD_Z);
-                auto t2 = glm::cross(vertices[i].normal, Transform::WORLD_X);
-                if (glm::length(t1) > glm::length(t2)) {
-                    vertices[i].tangent = glm::normalize(t1);
-                } else {
-                    vertices[i].tangent = glm::normalize(t2);
-                }
+    if (nInvalidTangents > 0) {
+        debug_tools::ConsoleWarning("assimpLoadMesh(): Input tangent or bitangent for mesh [" + meshName +
+                                    "] is corrupted. Attempting reconstruction from normal...");
 
-                vertices[i].bitangent = glm::normalize(glm::cross(vertices[i].normal, vertices[i].tangent));
+        for (size_t i = 0; i < mesh->mNumVertices; i++) {
+            if (checkValid(vertices[i].tangent) && checkValid(vertices[i].bitangent))
+                continue;
+
+            auto t1 = glm::cross(vertices[i].normal, Transform::WORLD_Z);
+            auto t2 = glm::cross(vertices[i].normal, Transform::WORLD_X);
+            if (glm::length(t1) > glm::length(t2)) {
+                vertices[i].tangent = glm::normalize(t1);
+            } else {
+                vertices[i].tangent = glm::normalize(t2);
             }
-#endif
-        }
-    }
 
-    /* Iterate over faces */
-    for (size_t i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (size_t j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
+            vertices[i].bitangent = glm::normalize(glm::cross(vertices[i].normal, vertices[i].tangent));
         }
     }
+#endif
 
-    Mesh temp(AssetInfo(meshName, info.filepath, info.source, AssetLocation::DISK_EMBEDDED), vertices, indices, hasNormals, hasUVs);
+    /* Reorder the triangles for the vertex cache and overdraw, and the vertices for fetch, before the levels of detail index
+     * the vertices */
+    after = optimizeMesh(vertices, indices, &before);
+
+    Mesh temp(AssetInfo(meshName, info.filepath, info.source, AssetLocation::DISK_EMBEDDED),
+              std::move(vertices),
+              std::move(indices),
+              hasNormals,
+              hasUVs,
+              threadPool);
+    /* The simplified levels of detail share the vertices of the mesh */
+    temp.generateLODs();
 
     if (!hasUVs) {
         debug_tools::ConsoleWarning("Mesh: [" + std::string(scene->mRootNode->mName.C_Str()) + " : " + std::string(temp.name()) +
@@ -147,7 +173,54 @@ glm::mat4 getTransformation(aiNode *node)
     return glm::transpose(glm::make_mat4(&node->mTransformation.a1));
 }
 
-void assimpLoadNode(aiNode *node, const aiScene *scene, const AssetInfo &info, Tree<ImportedModelNode> &root)
+/* Load the meshes of a scene, in parallel on the thread pool if one is given, and report the vertex cache optimization. Meshes
+ * without triangles are left empty */
+std::vector<std::optional<Mesh>> assimpLoadMeshes(const aiScene *scene, const AssetInfo &info, ThreadPool *threadPool)
+{
+    uint32_t nMeshes = scene->mNumMeshes;
+    std::vector<std::optional<Mesh>> meshes(nMeshes);
+    std::vector<VertexCacheStatistics> before(nMeshes), after(nMeshes);
+
+    auto loadMeshes = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            meshes[i] = assimpLoadMesh(scene->mMeshes[i], scene, info, before[i], after[i], threadPool);
+        }
+    };
+    if (threadPool == nullptr) {
+        loadMeshes(0, nMeshes);
+    } else {
+        parallelFor(*threadPool, 0, nMeshes, 1, loadMeshes);
+    }
+
+    VertexCacheStatistics totalBefore, totalAfter;
+    for (uint32_t i = 0; i < nMeshes; i++) {
+        totalBefore += before[i];
+        totalAfter += after[i];
+    }
+    debug_tools::ConsoleInfo("Model: [" + info.name + "] vertex cache optimization, ACMR: " + std::to_string(totalBefore.acmr()) +
+                             " -> " + std::to_string(totalAfter.acmr()) + ", ATVR: " + std::to_string(totalBefore.atvr()) + " -> " +
+                             std::to_string(totalAfter.atvr()));
+
+    return meshes;
+}
+
+/* Count the nodes that reference every mesh */
+void assimpCountMeshUses(aiNode *node, std::vector<uint32_t> &uses)
+{
+    for (size_t i = 0; i < node->mNumMeshes; i++) {
+        uses[node->mMeshes[i]]++;
+    }
+
+    for (size_t i = 0; i < node->mNumChildren; i++) {
+        assimpCountMeshUses(node->mChildren[i], uses);
+    }
+}
+
+void assimpLoadNode(aiNode *node,
+                    const aiScene *scene,
+                    std::vector<std::optional<Mesh>> &meshes,
+                    std::vector<uint32_t> &uses,
+                    Tree<ImportedModelNode> &root)
 {
     root.data().name = std::string(node->mName.C_Str());
 
@@ -160,17 +233,36 @@ void assimpLoadNode(aiNode *node, const aiScene *scene, const AssetInfo &info, T
 
     /* Loop through all meshes in this node */
     for (size_t i = 0; i < node->mNumMeshes; i++) {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        root.data().meshes.push_back(assimpLoadMesh(mesh, scene, info));
-        root.data().materialIndices.push_back(mesh->mMaterialIndex);
+        uint32_t meshIndex = node->mMeshes[i];
+        if (!meshes[meshIndex].has_value())
+            continue;
+
+        /* The last node that references a mesh takes it, the ones before get copies */
+        if (--uses[meshIndex] == 0) {
+            root.data().meshes.push_back(std::move(*meshes[meshIndex]));
+        } else {
+            root.data().meshes.push_back(*meshes[meshIndex]);
+        }
+        root.data().materialIndices.push_back(scene->mMeshes[meshIndex]->mMaterialIndex);
     }
 
     /* Loop through all nodes attached to this node, and append their meshes */
     for (size_t i = 0; i < node->mNumChildren; i++) {
-        assimpLoadNode(node->mChildren[i], scene, info, root.add());
+        assimpLoadNode(node->mChildren[i], scene, meshes, uses, root.add());
     }
 }
 
+/* Build the node tree of a scene, the loaded meshes are moved into it */
+Tree<ImportedModelNode> assimpLoadNodes(const aiScene *scene, std::vector<std::optional<Mesh>> &&meshes)
+{
+    std::vector<uint32_t> uses(meshes.size(), 0);
+    assimpCountMeshUses(scene->mRootNode, uses);
+
+    Tree<ImportedModelNode> importedModel;
+    assimpLoadNode(scene->mRootNode, scene, meshes, uses, importedModel);
+    return importedModel;
+}
+
 uint8_t *assimpLoadTextureData(const aiScene *scene,
                                const std::string &folder,
                                aiString texturePath,
@@ -534,7 +626,7 @@ std::vector<ImportedMaterial> assimpLoadMaterialsGLTF(const aiScene *scene,
     return materials;
 }
 
-Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info)
+Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, ThreadPool *threadPool)
 {
     assert(aiGetVersionMajor() >= 5);
     assert(aiGetVersionMinor() >= 2);
@@ -546,15 +638,14 @@ Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info)
         throw std::runtime_error("Failed to load model: " + info.filepath);
     }
 
-    Tree<ImportedModelNode> importedModel;
-    assimpLoadNode(scene->mRootNode, scene, info, importedModel);
+    Tree<ImportedModelNode> importedModel = assimpLoadNodes(scene, assimpLoadMeshes(scene, info, threadPool));
 
     importer.FreeScene();
 
     return importedModel;
 }
 
-Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, std::vector<ImportedMaterial> &materials)
+Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, std::vector<ImportedMaterial> &materials, ThreadPool *threadPool)
 {
     assert(aiGetVersionMajor() >= 5);
     assert(aiGetVersionMinor() >= 2);
@@ -566,8 +657,7 @@ Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, std::vector<Impor
         throw std::runtime_error("Failed to load model: " + info.filepath);
     }
 
-    Tree<ImportedModelNode> importedModel;
-    assimpLoadNode(scene->mRootNode, scene, info, importedModel);
+    Tree<ImportedModelNode> importedModel = assimpLoadNodes(scene, assimpLoadMeshes(scene, info, threadPool));
 
     FileType fileType;
     std::string folderPath;
@@ -7,12 +7,16 @@
 #include <assimp/scene.h>
 
 #include "ImportTypes.hpp"
+#include "vengine/utils/ThreadPool.hpp"
 
 namespace vengine
 {
 
-Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info);
-Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, std::vector<ImportedMaterial> &materials);
+/* If a thread pool is given, the meshes are loaded in parallel on it */
+Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info, ThreadPool *threadPool = nullptr);
+Tree<ImportedModelNode> assimpLoadModel(const AssetInfo &info,
+                                        std::vector<ImportedMaterial> &materials,
+                                        ThreadPool *threadPool = nullptr);
 
 }  // namespace vengine
 
@@ -113,16 +113,17 @@ void addMeshComponent(rapidjson::Document &d, rapidjson::Value &v, const SceneOb
     Value meshObject;
     meshObject.SetObject();
 
-    /* Get the mesh component */
-    const Mesh *mesh = sceneObject->get<ComponentMesh>().mesh();
-    const Model3D *model = mesh->m_model;
+    /* Get the mesh component, the mesh is exported by its name in the model it was picked from */
+    const ComponentMesh &meshComponent = sceneObject->get<ComponentMesh>();
+    const Model3D *model = meshComponent.model();
+    assert(model != nullptr);
 
     Value name;
     name.SetString(model->name().c_str(), d.GetAllocator());
     meshObject.AddMember("modelName", name, d.GetAllocator());
 
     Value submesh;
-    submesh.SetString(mesh->name().c_str(), d.GetAllocator());
+    submesh.SetString(model->meshName(meshComponent.mesh()).c_str(), d.GetAllocator());
     meshObject.AddMember("submesh", submesh, d.GetAllocator());
 
     v.AddMember("mesh", meshObject, d.GetAllocator());
@@ -627,7 +628,7 @@ void parseSceneObject(rapidjson::Document &d, rapidjson::Value &v, const SceneOb
 
 void exportJson(const ExportRenderParams &renderParams,
                 std::shared_ptr<Camera> sceneCamera,
-                const SceneObjectVector &sceneGraph,
+                const SceneObject::Siblings &sceneGraph,
                 EnvironmentMap *envMap)
 {
     /* Create folder with scene */
@@ -709,7 +710,7 @@ void exportJson(const ExportRenderParams &renderParams,
     {
         scene.SetArray();
 
-        for (auto &itr : sceneGraph) {
+        for (auto itr : sceneGraph) {
             parseSceneObject(d, scene, itr);
         }
     }
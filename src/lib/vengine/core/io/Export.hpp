@@ -22,7 +22,7 @@ struct ExportRenderParams {
 
 void exportJson(const ExportRenderParams &renderParams,
                 std::shared_ptr<Camera> sceneCamera,
-                const SceneObjectVector &sceneObjects,
+                const SceneObject::Siblings &sceneObjects,
                 EnvironmentMap *envMap);
 
 }  // namespace vengine
@@ -108,6 +108,23 @@ void AABB3::add(const glm::vec3 p)
     max() = glm::vec3(std::max(max().x, p.x), std::max(max().y, p.y), std::max(max().z, p.z));
 }
 
+void AABB3::add(const AABB3 &other)
+{
+    min() = glm::min(min(), other.min());
+    max() = glm::max(max(), other.max());
+}
+
+glm::vec3 AABB3::center() const
+{
+    return (min() + max()) * 0.5F;
+}
+
+float AABB3::surfaceArea() const
+{
+    glm::vec3 d = max() - min();
+    return 2.0F * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
 void AABB3::translate(const glm::vec3 &translation)
 {
     for (uint32_t i = 0; i < 3; i++) {
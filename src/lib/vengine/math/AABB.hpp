@@ -35,6 +35,11 @@ public:
     float diagonal() const;
 
     void add(const glm::vec3 p);
+    /* Grow to enclose another box */
+    void add(const AABB3 &other);
+
+    glm::vec3 center() const;
+    float surfaceArea() const;
 
     void translate(const glm::vec3 &translation);
 
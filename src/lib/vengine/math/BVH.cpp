@@ -0,0 +1,513 @@
+#include "BVH.hpp"
+
+#include <cassert>
+
+#include "utils/Parallel.hpp"
+
+namespace vengine
+{
+
+/* Number of bins per axis of the SAH build, smaller ranges use one bin per item */
+static constexpr uint32_t SAH_BINS = 16;
+/* Ranges with at least this many items are binned in parallel and build their two halves in parallel */
+static constexpr uint32_t PARALLEL_BUILD_MIN_ITEMS = 16384;
+/* Minimum number of items a binning task processes */
+static constexpr uint32_t PARALLEL_BINNING_MIN_GRAIN = 4096;
+
+float BVH::Node::surfaceArea() const
+{
+    glm::vec3 d = max - min;
+    return 2.0F * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+namespace
+{
+
+/* An item of the build with its bounds and centroid, items are partitioned in place so every range stays contiguous */
+struct BuildItem {
+    glm::vec3 min;
+    BVH::ItemID item;
+    glm::vec3 max;
+    glm::vec3 centroid;
+};
+
+}  // namespace
+
+struct BVH::BuildContext {
+    ThreadPool &threadPool;
+    std::vector<BuildItem> items;
+};
+
+namespace
+{
+
+struct CentroidBounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void add(const glm::vec3 &p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void add(const CentroidBounds &other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+};
+
+struct Bin {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+    uint32_t count = 0;
+
+    void add(const glm::vec3 &bMin, const glm::vec3 &bMax)
+    {
+        min = glm::min(min, bMin);
+        max = glm::max(max, bMax);
+    }
+    void add(const Bin &other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+        count += other.count;
+    }
+    float surfaceArea() const
+    {
+        if (count == 0)
+            return 0.0F;
+        glm::vec3 d = max - min;
+        return 2.0F * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+typedef std::array<std::array<Bin, SAH_BINS>, 3> Bins;
+
+inline uint32_t binIndex(float c, float min, float scale, uint32_t nBins)
+{
+    return std::min(nBins - 1, static_cast<uint32_t>((c - min) * scale));
+}
+
+}  // namespace
+
+void BVH::build(const std::vector<ItemID> &items, const std::vector<AABB3> &bounds, ThreadPool &threadPool)
+{
+    assert(items.size() == bounds.size());
+
+    clear();
+    if (items.empty())
+        return;
+
+    uint32_t n = static_cast<uint32_t>(items.size());
+
+    BuildContext context{threadPool, std::vector<BuildItem>(n)};
+    ItemID maxItem = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        context.items[i] = {bounds[i].min(), items[i], bounds[i].max(), bounds[i].center()};
+        maxItem = std::max(maxItem, items[i]);
+    }
+    m_leaves.assign(maxItem + 1, INVALID_INDEX);
+
+    /* A tree of n leaves has 2n - 1 nodes. Every range knows where its nodes go, so subtrees can be built in parallel */
+    m_nodes.resize(2 * n - 1);
+    m_root = 0;
+    m_size = n;
+    buildRange(context, 0, n, 0, INVALID_INDEX);
+}
+
+void BVH::buildRange(BuildContext &context, uint32_t begin, uint32_t end, uint32_t nodeIndex, uint32_t parent)
+{
+    Node &node = m_nodes[nodeIndex];
+    node.parent = parent;
+
+    uint32_t count = end - begin;
+    if (count == 1) {
+        const BuildItem &item = context.items[begin];
+        node.min = item.min;
+        node.max = item.max;
+        node.left = INVALID_INDEX;
+        node.right = INVALID_INDEX;
+        node.item = item.item;
+        m_leaves[node.item] = nodeIndex;
+        return;
+    }
+
+    bool parallel = count >= PARALLEL_BUILD_MIN_ITEMS;
+
+    /* Bounds of the centroids, the bins span them */
+    auto mapCentroidBounds = [&](uint32_t b, uint32_t e) {
+        CentroidBounds cb;
+        for (uint32_t i = b; i < e; i++) {
+            cb.add(context.items[i].centroid);
+        }
+        return cb;
+    };
+    auto reduceCentroidBounds = [](CentroidBounds a, const CentroidBounds &b) {
+        a.add(b);
+        return a;
+    };
+    CentroidBounds centroidBounds;
+    if (parallel) {
+        centroidBounds = parallelReduce(
+            context.threadPool, begin, end, PARALLEL_BINNING_MIN_GRAIN, CentroidBounds(), mapCentroidBounds, reduceCentroidBounds);
+    } else {
+        centroidBounds = mapCentroidBounds(begin, end);
+    }
+
+    uint32_t nBins = std::min(SAH_BINS, count);
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        scale[axis] = (extent[axis] > 0.0F ? static_cast<float>(nBins) / extent[axis] : 0.0F);
+    }
+
+    auto mapBins = [&](uint32_t b, uint32_t e) {
+        Bins chunkBins;
+        for (uint32_t i = b; i < e; i++) {
+            const BuildItem &item = context.items[i];
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                Bin &bin = chunkBins[axis][binIndex(item.centroid[axis], centroidBounds.min[axis], scale[axis], nBins)];
+                bin.add(item.min, item.max);
+                bin.count++;
+            }
+        }
+        return chunkBins;
+    };
+    auto reduceBins = [](Bins a, const Bins &b) {
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            for (uint32_t i = 0; i < SAH_BINS; i++) {
+                a[axis][i].add(b[axis][i]);
+            }
+        }
+        return a;
+    };
+    Bins bins;
+    if (parallel) {
+        bins = parallelReduce(context.threadPool, begin, end, PARALLEL_BINNING_MIN_GRAIN, Bins(), mapBins, reduceBins);
+    } else {
+        bins = mapBins(begin, end);
+    }
+
+    /* Pick the split with the lowest SAH cost, the split is after bin bestSplit */
+    float bestCost = std::numeric_limits<float>::max();
+    uint32_t bestAxis = 0;
+    uint32_t bestSplit = 0;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        if (scale[axis] == 0.0F)
+            continue;
+
+        /* Cost of the left side of every split, swept from the left */
+        std::array<float, SAH_BINS - 1> leftCost;
+        Bin left;
+        for (uint32_t i = 0; i < nBins - 1; i++) {
+            left.add(bins[axis][i]);
+            leftCost[i] = left.count * left.surfaceArea();
+        }
+        Bin right;
+        for (uint32_t i = nBins - 1; i > 0; i--) {
+            right.add(bins[axis][i]);
+            float cost = leftCost[i - 1] + right.count * right.surfaceArea();
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i - 1;
+            }
+        }
+    }
+
+    uint32_t mid = begin;
+    if (bestCost < std::numeric_limits<float>::max()) {
+        float min = centroidBounds.min[bestAxis];
+        float axisScale = scale[bestAxis];
+        auto itr = std::partition(context.items.begin() + begin, context.items.begin() + end, [&](const BuildItem &item) {
+            return binIndex(item.centroid[bestAxis], min, axisScale, nBins) <= bestSplit;
+        });
+        mid = static_cast<uint32_t>(itr - context.items.begin());
+    }
+    if (mid == begin || mid == end) {
+        /* All centroids are in the same place */
+        mid = begin + count / 2;
+    }
+
+    /* The left subtree has 2 * (mid - begin) - 1 nodes */
+    uint32_t leftIndex = nodeIndex + 1;
+    uint32_t rightIndex = nodeIndex + 2 * (mid - begin);
+    node.left = leftIndex;
+    node.right = rightIndex;
+    node.item = INVALID_INDEX;
+
+    auto buildChild = [&](uint32_t child) {
+        if (child == 0) {
+            buildRange(context, begin, mid, leftIndex, nodeIndex);
+        } else {
+            buildRange(context, mid, end, rightIndex, nodeIndex);
+        }
+    };
+    if (parallel) {
+        parallelFor(context.threadPool, 0, 2, 1, [&](uint32_t b, uint32_t e) {
+            for (uint32_t child = b; child < e; child++) {
+                buildChild(child);
+            }
+        });
+    } else {
+        buildChild(0);
+        buildChild(1);
+    }
+
+    node.min = glm::min(m_nodes[leftIndex].min, m_nodes[rightIndex].min);
+    node.max = glm::max(m_nodes[leftIndex].max, m_nodes[rightIndex].max);
+}
+
+void BVH::insert(ItemID item, const AABB3 &bounds)
+{
+    assert(!contains(item));
+
+    uint32_t leaf = allocateNode();
+    Node &leafNode = m_nodes[leaf];
+    leafNode.min = bounds.min();
+    leafNode.max = bounds.max();
+    leafNode.item = item;
+
+    if (item >= m_leaves.size()) {
+        m_leaves.resize(item + 1, INVALID_INDEX);
+    }
+    m_leaves[item] = leaf;
+    m_size++;
+
+    if (m_root == INVALID_INDEX) {
+        m_root = leaf;
+        return;
+    }
+
+    /* Walk down to the sibling that enlarges the tree the least */
+    uint32_t index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+        const Node &node = m_nodes[index];
+
+        Node combined;
+        combined.min = glm::min(node.min, bounds.min());
+        combined.max = glm::max(node.max, bounds.max());
+        float area = node.surfaceArea();
+        float combinedArea = combined.surfaceArea();
+
+        /* Cost of making the new leaf a sibling of this node, and the cost of pushing it further down */
+        float cost = 2.0F * combinedArea;
+        float inheritanceCost = 2.0F * (combinedArea - area);
+
+        auto descendCost = [&](uint32_t child) {
+            const Node &childNode = m_nodes[child];
+            Node enlarged;
+            enlarged.min = glm::min(childNode.min, bounds.min());
+            enlarged.max = glm::max(childNode.max, bounds.max());
+            float enlargedArea = enlarged.surfaceArea();
+            return (childNode.isLeaf() ? enlargedArea : enlargedArea - childNode.surfaceArea()) + inheritanceCost;
+        };
+        float costLeft = descendCost(node.left);
+        float costRight = descendCost(node.right);
+
+        if (cost < costLeft && cost < costRight)
+            break;
+
+        index = (costLeft < costRight ? node.left : node.right);
+    }
+    uint32_t sibling = index;
+
+    /* A new parent for the sibling and the leaf */
+    uint32_t oldParent = m_nodes[sibling].parent;
+    uint32_t newParent = allocateNode();
+    Node &parentNode = m_nodes[newParent];
+    parentNode.parent = oldParent;
+    parentNode.min = glm::min(m_nodes[sibling].min, bounds.min());
+    parentNode.max = glm::max(m_nodes[sibling].max, bounds.max());
+    parentNode.left = sibling;
+    parentNode.right = leaf;
+    parentNode.item = INVALID_INDEX;
+
+    if (oldParent == INVALID_INDEX) {
+        m_root = newParent;
+    } else if (m_nodes[oldParent].left == sibling) {
+        m_nodes[oldParent].left = newParent;
+    } else {
+        m_nodes[oldParent].right = newParent;
+    }
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    refitAncestors(newParent);
+}
+
+void BVH::remove(ItemID item)
+{
+    assert(contains(item));
+
+    uint32_t leaf = m_leaves[item];
+    m_leaves[item] = INVALID_INDEX;
+    m_size--;
+
+    if (leaf == m_root) {
+        m_root = INVALID_INDEX;
+        freeNode(leaf);
+        return;
+    }
+
+    /* The sibling takes the place of the parent */
+    uint32_t parent = m_nodes[leaf].parent;
+    uint32_t grandParent = m_nodes[parent].parent;
+    uint32_t sibling = (m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left);
+
+    m_nodes[sibling].parent = grandParent;
+    if (grandParent == INVALID_INDEX) {
+        m_root = sibling;
+    } else {
+        if (m_nodes[grandParent].left == parent) {
+            m_nodes[grandParent].left = sibling;
+        } else {
+            m_nodes[grandParent].right = sibling;
+        }
+        refitAncestors(sibling);
+    }
+
+    freeNode(parent);
+    freeNode(leaf);
+}
+
+void BVH::update(ItemID item, const AABB3 &bounds)
+{
+    uint32_t leaf = m_leaves[item];
+    m_nodes[leaf].min = bounds.min();
+    m_nodes[leaf].max = bounds.max();
+    refitAncestors(leaf);
+}
+
+void BVH::setBounds(ItemID item, const AABB3 &bounds)
+{
+    uint32_t leaf = m_leaves[item];
+    m_nodes[leaf].min = bounds.min();
+    m_nodes[leaf].max = bounds.max();
+}
+
+void BVH::refit()
+{
+    if (m_root == INVALID_INDEX)
+        return;
+
+    /* Internal nodes in pre-order, refitted in reverse so children come before their parents */
+    std::vector<uint32_t> internalNodes;
+    internalNodes.reserve(m_size);
+    TraversalStack stack;
+    stack.push(m_root);
+    while (!stack.empty()) {
+        float t;
+        uint32_t index = stack.pop(t);
+        const Node &node = m_nodes[index];
+        if (node.isLeaf())
+            continue;
+
+        internalNodes.push_back(index);
+        stack.push(node.left);
+        stack.push(node.right);
+    }
+
+    for (auto itr = internalNodes.rbegin(); itr != internalNodes.rend(); ++itr) {
+        Node &node = m_nodes[*itr];
+        node.min = glm::min(m_nodes[node.left].min, m_nodes[node.right].min);
+        node.max = glm::max(m_nodes[node.left].max, m_nodes[node.right].max);
+    }
+}
+
+void BVH::clear()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_leaves.clear();
+    m_root = INVALID_INDEX;
+    m_size = 0;
+}
+
+uint32_t BVH::depth() const
+{
+    if (m_root == INVALID_INDEX)
+        return 0;
+
+    uint32_t maxDepth = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack = {{m_root, 1}};
+    while (!stack.empty()) {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+        maxDepth = std::max(maxDepth, depth);
+
+        const Node &node = m_nodes[index];
+        if (!node.isLeaf()) {
+            stack.push_back({node.left, depth + 1});
+            stack.push_back({node.right, depth + 1});
+        }
+    }
+    return maxDepth;
+}
+
+float BVH::cost() const
+{
+    if (m_root == INVALID_INDEX)
+        return 0.0F;
+
+    float rootArea = m_nodes[m_root].surfaceArea();
+    if (rootArea <= 0.0F)
+        return 0.0F;
+
+    /* Traversal and intersection costs of 1 */
+    float cost = 0.0F;
+    std::vector<uint32_t> stack = {m_root};
+    while (!stack.empty()) {
+        const Node &node = m_nodes[stack.back()];
+        stack.pop_back();
+        cost += node.surfaceArea() / rootArea;
+        if (!node.isLeaf()) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+    return cost;
+}
+
+AABB3 BVH::bounds() const
+{
+    if (m_root == INVALID_INDEX)
+        return AABB3();
+
+    return AABB3::fromMinAndMax(m_nodes[m_root].min, m_nodes[m_root].max);
+}
+
+uint32_t BVH::allocateNode()
+{
+    if (!m_freeNodes.empty()) {
+        uint32_t index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_nodes[index] = Node();
+        return index;
+    }
+
+    m_nodes.emplace_back();
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void BVH::freeNode(uint32_t index)
+{
+    m_freeNodes.push_back(index);
+}
+
+void BVH::refitAncestors(uint32_t index)
+{
+    for (uint32_t parent = m_nodes[index].parent; parent != INVALID_INDEX; parent = m_nodes[parent].parent) {
+        Node &node = m_nodes[parent];
+        glm::vec3 min = glm::min(m_nodes[node.left].min, m_nodes[node.right].min);
+        glm::vec3 max = glm::max(m_nodes[node.left].max, m_nodes[node.right].max);
+        if (min == node.min && max == node.max)
+            break;
+
+        node.min = min;
+        node.max = max;
+    }
+}
+
+}  // namespace vengine
@@ -0,0 +1,287 @@
+#ifndef __BVH_hpp__
+#define __BVH_hpp__
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+#include "Ray.hpp"
+
+namespace vengine
+{
+
+class ThreadPool;
+
+/**
+ * @brief A dynamic bounding volume hierarchy over items identified by small integer IDs, with one item per leaf. build()
+ * creates the tree from scratch with a binned SAH split, in parallel on a thread pool. insert(), remove() and update() change
+ * it incrementally, inserted leaves pick their sibling by the SAH cost of the enlarged ancestors. Bounds of many items can be
+ * changed with setBounds() followed by one refit()
+ */
+class BVH
+{
+public:
+    typedef uint32_t ItemID;
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    BVH() = default;
+
+    /**
+     * @brief Build the tree from scratch, replaces the current items
+     *
+     * @param items IDs of the items
+     * @param bounds Bounds of the items, same size as items
+     * @param threadPool Used to build big subtrees in parallel
+     */
+    void build(const std::vector<ItemID> &items, const std::vector<AABB3> &bounds, ThreadPool &threadPool);
+
+    void insert(ItemID item, const AABB3 &bounds);
+    void remove(ItemID item);
+    /* Change the bounds of an item and refit its ancestors */
+    void update(ItemID item, const AABB3 &bounds);
+    /* Change the bounds of an item without refitting, refit() has to be called before the next query */
+    void setBounds(ItemID item, const AABB3 &bounds);
+    /* Recompute the bounds of all internal nodes */
+    void refit();
+
+    bool contains(ItemID item) const { return item < m_leaves.size() && m_leaves[item] != INVALID_INDEX; }
+    void clear();
+
+    /* Number of items */
+    uint32_t size() const { return m_size; }
+    /* Number of nodes, internal and leaves */
+    uint32_t nodes() const { return static_cast<uint32_t>(m_nodes.size() - m_freeNodes.size()); }
+    /* Length of the longest path from the root to a leaf, 0 if empty */
+    uint32_t depth() const;
+    /* The SAH cost of the tree, relative to the surface area of the root */
+    float cost() const;
+    AABB3 bounds() const;
+
+    /* Call f(item) for every item whose bounds overlap box */
+    template <typename F>
+    void queryBox(const AABB3 &box, const F &f) const
+    {
+        traverse([&](const Node &node) { return overlaps(node, box.min(), box.max()); }, f);
+    }
+
+    /* Call f(item) for every item whose bounds overlap a sphere */
+    template <typename F>
+    void querySphere(const glm::vec3 &center, float radius, const F &f) const
+    {
+        float radius2 = radius * radius;
+        traverse(
+            [&](const Node &node) {
+                glm::vec3 closest = glm::clamp(center, node.min, node.max) - center;
+                return glm::dot(closest, closest) <= radius2;
+            },
+            f);
+    }
+
+    /* Call f(item) for every item whose bounds intersect a frustum, conservatively */
+    template <typename F>
+    void queryFrustum(const Frustum &frustum, const F &f) const
+    {
+        traverse([&](const Node &node) { return frustum.intersects(node.min, node.max); }, f);
+    }
+
+    /* Call f(item, t) for every item whose bounds are hit by the ray in [0, tMax], t is where the ray enters the bounds */
+    template <typename F>
+    void queryRay(const Ray &ray, float tMax, const F &f) const
+    {
+        glm::vec3 invDirection = 1.0F / ray.direction;
+        float t = 0;
+        traverse([&](const Node &node) { return intersect(node, ray.origin, invDirection, tMax, t); },
+                 [&](ItemID item) { f(item, t); });
+    }
+
+    /**
+     * @brief Find the closest item hit by a ray. Nodes are visited near to far and skipped once they are behind the closest
+     * hit found so far
+     *
+     * @param ray
+     * @param tMax Max distance along the ray
+     * @param f bool f(item, float &t), tests the item itself and sets t to the hit distance on hit
+     * @param t The distance of the closest hit
+     * @return The item hit, INVALID_INDEX on a miss
+     */
+    template <typename F>
+    ItemID intersectRay(const Ray &ray, float tMax, const F &f, float &t) const
+    {
+        ItemID closest = INVALID_INDEX;
+        t = tMax;
+        if (m_root == INVALID_INDEX)
+            return closest;
+
+        glm::vec3 invDirection = 1.0F / ray.direction;
+        float tNode;
+        if (!intersect(m_nodes[m_root], ray.origin, invDirection, t, tNode))
+            return closest;
+
+        TraversalStack stack;
+        stack.push(m_root, tNode);
+        while (!stack.empty()) {
+            float tEntry;
+            uint32_t index = stack.pop(tEntry);
+            if (tEntry > t)
+                continue;
+
+            const Node &node = m_nodes[index];
+            if (node.isLeaf()) {
+                float tItem = t;
+                if (f(node.item, tItem) && tItem <= t) {
+                    t = tItem;
+                    closest = node.item;
+                }
+                continue;
+            }
+
+            /* Push the far child first, so the near one is visited next */
+            float tLeft, tRight;
+            bool hitLeft = intersect(m_nodes[node.left], ray.origin, invDirection, t, tLeft);
+            bool hitRight = intersect(m_nodes[node.right], ray.origin, invDirection, t, tRight);
+            if (hitLeft && hitRight) {
+                if (tLeft <= tRight) {
+                    stack.push(node.right, tRight);
+                    stack.push(node.left, tLeft);
+                } else {
+                    stack.push(node.left, tLeft);
+                    stack.push(node.right, tRight);
+                }
+            } else if (hitLeft) {
+                stack.push(node.left, tLeft);
+            } else if (hitRight) {
+                stack.push(node.right, tRight);
+            }
+        }
+
+        return closest;
+    }
+
+private:
+    struct Node {
+        glm::vec3 min;
+        uint32_t parent = INVALID_INDEX;
+        glm::vec3 max;
+        /* Children of internal nodes, left is INVALID_INDEX for leaves */
+        uint32_t left = INVALID_INDEX;
+        uint32_t right = INVALID_INDEX;
+        /* Item of leaves */
+        ItemID item = INVALID_INDEX;
+
+        bool isLeaf() const { return left == INVALID_INDEX; }
+        float surfaceArea() const;
+    };
+
+    /* A stack for the traversal, on the stack of the caller unless the tree is very deep */
+    class TraversalStack
+    {
+    public:
+        void push(uint32_t index, float t = 0.0F)
+        {
+            if (m_size < m_local.size()) {
+                m_local[m_size] = {index, t};
+            } else {
+                m_overflow.push_back({index, t});
+            }
+            m_size++;
+        }
+        uint32_t pop(float &t)
+        {
+            m_size--;
+            Entry entry;
+            if (m_size < m_local.size()) {
+                entry = m_local[m_size];
+            } else {
+                entry = m_overflow.back();
+                m_overflow.pop_back();
+            }
+            t = entry.t;
+            return entry.index;
+        }
+        bool empty() const { return m_size == 0; }
+
+    private:
+        struct Entry {
+            uint32_t index;
+            float t;
+        };
+        std::array<Entry, 64> m_local;
+        std::vector<Entry> m_overflow;
+        size_t m_size = 0;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_freeNodes;
+    uint32_t m_root = INVALID_INDEX;
+    /* Leaf of every item */
+    std::vector<uint32_t> m_leaves;
+    uint32_t m_size = 0;
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t index);
+    /* Recompute the bounds of the ancestors of a node, stops when the bounds don't change */
+    void refitAncestors(uint32_t index);
+
+    static bool overlaps(const Node &node, const glm::vec3 &min, const glm::vec3 &max)
+    {
+        return node.min.x <= max.x && min.x <= node.max.x && node.min.y <= max.y && min.y <= node.max.y && node.min.z <= max.z &&
+               min.z <= node.max.z;
+    }
+
+    /* Slab test, t is where the ray enters the node */
+    static bool intersect(const Node &node, const glm::vec3 &origin, const glm::vec3 &invDirection, float tMax, float &t)
+    {
+        float tEnter = 0.0F;
+        float tExit = tMax;
+        for (int axis = 0; axis < 3; axis++) {
+            float tNear = (node.min[axis] - origin[axis]) * invDirection[axis];
+            float tFar = (node.max[axis] - origin[axis]) * invDirection[axis];
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+
+            /* A ray parallel to the axis with its origin on a slab plane gives 0 * inf = NaN, which fails the comparisons and
+             * leaves the interval unchanged */
+            tEnter = tNear > tEnter ? tNear : tEnter;
+            tExit = tFar < tExit ? tFar : tExit;
+        }
+        t = tEnter;
+        return tEnter <= tExit;
+    }
+
+    /* Visit the leaves under the nodes for which test(node) is true */
+    template <typename Test, typename Visit>
+    void traverse(const Test &test, const Visit &visit) const
+    {
+        if (m_root == INVALID_INDEX)
+            return;
+
+        TraversalStack stack;
+        stack.push(m_root);
+        while (!stack.empty()) {
+            float t;
+            const Node &node = m_nodes[stack.pop(t)];
+            if (!test(node))
+                continue;
+
+            if (node.isLeaf()) {
+                visit(node.item);
+            } else {
+                stack.push(node.right);
+                stack.push(node.left);
+            }
+        }
+    }
+
+    struct BuildContext;
+    void buildRange(BuildContext &context, uint32_t begin, uint32_t end, uint32_t nodeIndex, uint32_t parent);
+};
+
+}  // namespace vengine
+
+#endif
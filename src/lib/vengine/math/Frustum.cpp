@@ -0,0 +1,61 @@
+#include "Frustum.hpp"
+
+namespace vengine
+{
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    /* Rows of the matrix, glm is column major */
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.m_planes[0] = row3 + row0;
+    frustum.m_planes[1] = row3 - row0;
+    frustum.m_planes[2] = row3 + row1;
+    frustum.m_planes[3] = row3 - row1;
+    frustum.m_planes[4] = row2;
+    frustum.m_planes[5] = row3 - row2;
+
+    for (glm::vec4 &plane : frustum.m_planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool Frustum::isInside(const glm::vec3 &p) const
+{
+    for (const glm::vec4 &plane : m_planes) {
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0F) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const glm::vec3 &min, const glm::vec3 &max) const
+{
+    for (const glm::vec4 &plane : m_planes) {
+        /* The corner furthest along the plane normal */
+        glm::vec3 p(plane.x >= 0.0F ? max.x : min.x, plane.y >= 0.0F ? max.y : min.y, plane.z >= 0.0F ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0F) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const
+{
+    for (const glm::vec4 &plane : m_planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace vengine
@@ -0,0 +1,47 @@
+#ifndef __Frustum_hpp__
+#define __Frustum_hpp__
+
+#include <array>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "AABB.hpp"
+
+namespace vengine
+{
+
+/* A view frustum as six planes, with normals pointing inwards */
+class Frustum
+{
+public:
+    Frustum() = default;
+
+    /**
+     * @brief Extract the planes of a projection * view matrix. Clip space depth is expected in [0, 1], as set up by
+     * GLM_FORCE_DEPTH_ZERO_TO_ONE
+     *
+     * @param viewProjection
+     * @return Frustum
+     */
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    /* Plane i as (normal, d), a point p is inside if dot(normal, p) + d >= 0 */
+    const glm::vec4 &plane(uint32_t i) const { return m_planes[i]; }
+
+    bool isInside(const glm::vec3 &p) const;
+
+    /* Conservative test, may return true for boxes near the corners of the frustum that are outside */
+    bool intersects(const AABB3 &box) const { return intersects(box.min(), box.max()); }
+    bool intersects(const glm::vec3 &min, const glm::vec3 &max) const;
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const;
+
+private:
+    /* Left, right, bottom, top, near, far */
+    std::array<glm::vec4, 6> m_planes;
+};
+
+}  // namespace vengine
+
+#endif
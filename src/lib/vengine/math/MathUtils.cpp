@@ -1,5 +1,8 @@
 #include "MathUtils.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace vengine {
 
 uint32_t roundPow2(uint32_t v)
@@ -15,4 +18,22 @@ uint32_t roundPow2(uint32_t v)
 	return v;
 }
 
+glm::vec2 octahedralEncode(const glm::vec3 &n)
+{
+	glm::vec3 p = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	if (p.z >= 0.0F) {
+		return glm::vec2(p.x, p.y);
+	}
+	return glm::vec2((1.0F - std::abs(p.y)) * (p.x >= 0.0F ? 1.0F : -1.0F), (1.0F - std::abs(p.x)) * (p.y >= 0.0F ? 1.0F : -1.0F));
+}
+
+glm::vec3 octahedralDecode(const glm::vec2 &e)
+{
+	glm::vec3 n(e.x, e.y, 1.0F - std::abs(e.x) - std::abs(e.y));
+	float t = std::max(-n.z, 0.0F);
+	n.x += n.x >= 0.0F ? -t : t;
+	n.y += n.y >= 0.0F ? -t : t;
+	return glm::normalize(n);
+}
+
 }
\ No newline at end of file
@@ -27,6 +27,23 @@ inline glm::vec3 getTranslation(const glm::mat4 &m)
     return glm::vec3(m[3][0], m[3][1], m[3][2]);
 }
 
+/**
+ * @brief Encode a unit vector as a point of the [-1, 1] square, by projecting it on the octahedron |x| + |y| + |z| = 1 and
+ * folding the lower half over the upper one
+ *
+ * @param n Unit vector
+ * @return glm::vec2
+ */
+glm::vec2 octahedralEncode(const glm::vec3 &n);
+
+/**
+ * @brief Decode a unit vector encoded with octahedralEncode()
+ *
+ * @param e
+ * @return glm::vec3
+ */
+glm::vec3 octahedralDecode(const glm::vec2 &e);
+
 inline bool isBlack(const glm::vec3 &a, const float &threshold = std::numeric_limits<float>::epsilon())
 {
     return (std::abs(a.r) < threshold) && (std::abs(a.g) < threshold) && (std::abs(a.b) < threshold);
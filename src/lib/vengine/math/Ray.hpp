@@ -0,0 +1,24 @@
+#ifndef __Ray_hpp__
+#define __Ray_hpp__
+
+#include <glm/glm.hpp>
+
+namespace vengine
+{
+
+/* A ray. The direction doesn't have to be normalized, distances along the ray are in multiples of it */
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+
+    Ray() = default;
+    Ray(const glm::vec3 &o, const glm::vec3 &d)
+        : origin(o)
+        , direction(d){};
+
+    glm::vec3 at(float t) const { return origin + t * direction; }
+};
+
+}  // namespace vengine
+
+#endif
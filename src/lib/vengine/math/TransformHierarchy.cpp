@@ -0,0 +1,400 @@
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "utils/Parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define TRANSFORM_HIERARCHY_SSE
+#endif
+
+namespace vengine
+{
+
+/* Index of a node without a parent */
+static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+/* Number of nodes the update kernel processes together */
+static constexpr uint32_t SIMD_WIDTH = 4;
+/* Minimum number of nodes of a level a task updates */
+static constexpr uint32_t UPDATE_MIN_GRAIN = 1024;
+
+void TransformHierarchy::LocalTransforms::resize(uint32_t n)
+{
+    /* Padding so the kernel can always load SIMD_WIDTH values */
+    uint32_t padded = n + SIMD_WIDTH - 1;
+    for (std::vector<float> *v : {&px, &py, &pz, &rx, &ry, &rz, &rw, &sx, &sy, &sz}) {
+        v->resize(padded, 0.0F);
+    }
+}
+
+void TransformHierarchy::LocalTransforms::set(uint32_t i, const Transform &t)
+{
+    px[i] = t.position().x;
+    py[i] = t.position().y;
+    pz[i] = t.position().z;
+    rx[i] = t.rotation().x;
+    ry[i] = t.rotation().y;
+    rz[i] = t.rotation().z;
+    rw[i] = t.rotation().w;
+    sx[i] = t.scale().x;
+    sy[i] = t.scale().y;
+    sz[i] = t.scale().z;
+}
+
+void TransformHierarchy::LocalTransforms::copy(uint32_t to, const LocalTransforms &from, uint32_t i)
+{
+    px[to] = from.px[i];
+    py[to] = from.py[i];
+    pz[to] = from.pz[i];
+    rx[to] = from.rx[i];
+    ry[to] = from.ry[i];
+    rz[to] = from.rz[i];
+    rw[to] = from.rw[i];
+    sx[to] = from.sx[i];
+    sy[to] = from.sy[i];
+    sz[to] = from.sz[i];
+}
+
+TransformHierarchy::TransformHierarchy()
+{
+    m_levels.push_back(0);
+    m_firstChild.push_back(0);
+    m_local.resize(0);
+}
+
+TransformHierarchy::Handle TransformHierarchy::add(const Transform &localTransform)
+{
+    Handle handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(m_indices.size());
+        m_indices.push_back(INVALID_INDEX);
+        m_parentHandles.push_back(INVALID_HANDLE);
+    }
+
+    /* Appended as a root, it moves to its level when the layout is rebuilt */
+    uint32_t index = static_cast<uint32_t>(m_handles.size());
+    m_indices[handle] = index;
+    m_parentHandles[handle] = INVALID_HANDLE;
+
+    m_handles.push_back(handle);
+    m_parents.push_back(INVALID_INDEX);
+    m_local.resize(index + 1);
+    m_local.set(index, localTransform);
+    m_world.push_back(glm::mat4(1.0F));
+    m_dirty.push_back(1);
+    m_worldChanged.push_back(0);
+
+    m_layoutDirty = true;
+
+    return handle;
+}
+
+void TransformHierarchy::remove(Handle handle)
+{
+    uint32_t index = m_indices[handle];
+    assert(m_handles[index] == handle);
+
+    m_handles[index] = INVALID_HANDLE;
+    m_parentHandles[handle] = INVALID_HANDLE;
+    m_removedHandles.push_back(handle);
+    m_removed++;
+
+    m_layoutDirty = true;
+}
+
+void TransformHierarchy::setParent(Handle handle, Handle parent)
+{
+    assert(handle != parent);
+
+    m_parentHandles[handle] = parent;
+    m_dirty[m_indices[handle]] = 1;
+
+    m_layoutDirty = true;
+}
+
+void TransformHierarchy::setLocalTransform(Handle handle, const Transform &localTransform)
+{
+    uint32_t index = m_indices[handle];
+    m_local.set(index, localTransform);
+    markDirty(index);
+}
+
+const std::vector<TransformHierarchy::Handle> &TransformHierarchy::nodes()
+{
+    if (m_layoutDirty) {
+        rebuildLayout();
+    }
+    return m_handles;
+}
+
+void TransformHierarchy::markDirty(uint32_t index)
+{
+    m_dirty[index] = 1;
+
+    /* The dirty ranges are recomputed when the layout is rebuilt */
+    if (m_layoutDirty)
+        return;
+
+    uint32_t level = static_cast<uint32_t>(std::upper_bound(m_levels.begin(), m_levels.end(), index) - m_levels.begin()) - 1;
+    auto &range = m_dirtyRanges[level];
+    range.first = std::min(range.first, index);
+    range.second = std::max(range.second, index + 1);
+}
+
+void TransformHierarchy::rebuildLayout()
+{
+    uint32_t n = static_cast<uint32_t>(m_handles.size());
+
+    /* Parent index of every node, and the children of every node grouped by parent */
+    std::vector<uint32_t> parentOf(n, INVALID_INDEX);
+    std::vector<uint32_t> childrenOffsets(n + 1, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        Handle handle = m_handles[i];
+        if (handle == INVALID_HANDLE)
+            continue;
+
+        Handle parent = m_parentHandles[handle];
+        if (parent == INVALID_HANDLE)
+            continue;
+
+        uint32_t parentIndex = m_indices[parent];
+        if (m_handles[parentIndex] != parent) {
+            /* The parent was removed, the node becomes a root */
+            m_parentHandles[handle] = INVALID_HANDLE;
+            continue;
+        }
+        parentOf[i] = parentIndex;
+        childrenOffsets[parentIndex + 1]++;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        childrenOffsets[i + 1] += childrenOffsets[i];
+    }
+    std::vector<uint32_t> children(childrenOffsets[n]);
+    std::vector<uint32_t> childrenCursor(childrenOffsets.begin(), childrenOffsets.end() - 1);
+    for (uint32_t i = 0; i < n; i++) {
+        if (parentOf[i] != INVALID_INDEX) {
+            children[childrenCursor[parentOf[i]]++] = i;
+        }
+    }
+
+    /* Breadth first order, roots first */
+    std::vector<uint32_t> order;
+    order.reserve(n - m_removed);
+    for (uint32_t i = 0; i < n; i++) {
+        if (m_handles[i] != INVALID_HANDLE && parentOf[i] == INVALID_INDEX) {
+            order.push_back(i);
+        }
+    }
+    m_levels.assign(1, 0);
+    uint32_t levelBegin = 0;
+    while (levelBegin < order.size()) {
+        uint32_t levelEnd = static_cast<uint32_t>(order.size());
+        m_levels.push_back(levelEnd);
+        for (uint32_t k = levelBegin; k < levelEnd; k++) {
+            uint32_t i = order[k];
+            order.insert(order.end(), children.begin() + childrenOffsets[i], children.begin() + childrenOffsets[i + 1]);
+        }
+        levelBegin = levelEnd;
+    }
+    /* Nodes missing here are part of a cycle */
+    assert(order.size() == n - m_removed);
+
+    uint32_t size = static_cast<uint32_t>(order.size());
+    std::vector<uint32_t> newIndex(n, INVALID_INDEX);
+    for (uint32_t k = 0; k < size; k++) {
+        newIndex[order[k]] = k;
+    }
+
+    std::vector<Handle> handles(size);
+    std::vector<uint32_t> parents(size);
+    std::vector<uint32_t> firstChild(size + 1);
+    LocalTransforms local;
+    local.resize(size);
+    std::vector<glm::mat4> world(size);
+    std::vector<uint8_t> dirty(size);
+
+    /* Children of consecutive nodes are consecutive, the first child of the first root comes after all roots */
+    uint32_t childCursor = (levels() > 0 ? m_levels[1] : 0);
+    for (uint32_t k = 0; k < size; k++) {
+        uint32_t i = order[k];
+        handles[k] = m_handles[i];
+        parents[k] = (parentOf[i] != INVALID_INDEX ? newIndex[parentOf[i]] : INVALID_INDEX);
+        firstChild[k] = childCursor;
+        childCursor += childrenOffsets[i + 1] - childrenOffsets[i];
+        local.copy(k, m_local, i);
+        world[k] = m_world[i];
+        dirty[k] = m_dirty[i];
+
+        m_indices[handles[k]] = k;
+    }
+    firstChild[size] = childCursor;
+
+    m_handles = std::move(handles);
+    m_parents = std::move(parents);
+    m_firstChild = std::move(firstChild);
+    m_local = std::move(local);
+    m_world = std::move(world);
+    m_dirty = std::move(dirty);
+    m_worldChanged.assign(size, 0);
+
+    for (Handle handle : m_removedHandles) {
+        m_indices[handle] = INVALID_INDEX;
+        m_freeHandles.push_back(handle);
+    }
+    m_removedHandles.clear();
+    m_removed = 0;
+
+    m_dirtyRanges.assign(levels(), {INVALID_INDEX, 0});
+    for (uint32_t level = 0; level < levels(); level++) {
+        for (uint32_t i = m_levels[level]; i < m_levels[level + 1]; i++) {
+            if (m_dirty[i]) {
+                m_dirtyRanges[level].first = std::min(m_dirtyRanges[level].first, i);
+                m_dirtyRanges[level].second = i + 1;
+            }
+        }
+    }
+
+    m_layoutDirty = false;
+}
+
+void TransformHierarchy::update(ThreadPool &threadPool)
+{
+    if (m_layoutDirty) {
+        rebuildLayout();
+    }
+
+    m_changed.clear();
+
+    /* Range of the previous level that was updated, its children have to be checked */
+    uint32_t parentsBegin = 0, parentsEnd = 0;
+    for (uint32_t level = 0; level < levels(); level++) {
+        uint32_t begin = m_dirtyRanges[level].first;
+        uint32_t end = m_dirtyRanges[level].second;
+        m_dirtyRanges[level] = {INVALID_INDEX, 0};
+
+        if (parentsBegin < parentsEnd && m_firstChild[parentsBegin] < m_firstChild[parentsEnd]) {
+            begin = std::min(begin, m_firstChild[parentsBegin]);
+            end = std::max(end, m_firstChild[parentsEnd]);
+        }
+
+        if (begin >= end) {
+            parentsBegin = parentsEnd = 0;
+            continue;
+        }
+
+        parallelFor(threadPool, begin, end, UPDATE_MIN_GRAIN, [&](uint32_t b, uint32_t e) { updateRange(b, e); });
+
+        for (uint32_t i = begin; i < end; i++) {
+            if (m_worldChanged[i]) {
+                m_changed.push_back(m_handles[i]);
+            }
+        }
+
+        parentsBegin = begin;
+        parentsEnd = end;
+    }
+
+    for (Handle handle : m_changed) {
+        m_worldChanged[m_indices[handle]] = 0;
+    }
+}
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end)
+{
+    /* A node changes if its local transform changed or its parent changed. Parents are on the previous level, already done */
+    for (uint32_t i = begin; i < end; i++) {
+        uint32_t parent = m_parents[i];
+        m_worldChanged[i] = m_dirty[i] || (parent != INVALID_INDEX && m_worldChanged[parent]);
+        m_dirty[i] = 0;
+    }
+
+#ifdef TRANSFORM_HIERARCHY_SSE
+    const __m128 one = _mm_set1_ps(1.0F);
+    const __m128 two = _mm_set1_ps(2.0F);
+
+    for (uint32_t i = begin; i < end; i += SIMD_WIDTH) {
+        /* Local matrices of SIMD_WIDTH nodes, one node per lane. Same as Transform::getModelMatrix() */
+        __m128 x = _mm_loadu_ps(&m_local.rx[i]);
+        __m128 y = _mm_loadu_ps(&m_local.ry[i]);
+        __m128 z = _mm_loadu_ps(&m_local.rz[i]);
+        __m128 w = _mm_loadu_ps(&m_local.rw[i]);
+        __m128 sx = _mm_loadu_ps(&m_local.sx[i]);
+        __m128 sy = _mm_loadu_ps(&m_local.sy[i]);
+        __m128 sz = _mm_loadu_ps(&m_local.sz[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        /* local[c * 3 + r] is row r of column c, local[9 + r] is the translation */
+        alignas(16) float local[12][SIMD_WIDTH];
+        _mm_store_ps(local[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+        _mm_store_ps(local[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+        _mm_store_ps(local[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+        _mm_store_ps(local[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+        _mm_store_ps(local[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+        _mm_store_ps(local[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+        _mm_store_ps(local[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+        _mm_store_ps(local[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+        _mm_store_ps(local[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+        _mm_store_ps(local[9], _mm_loadu_ps(&m_local.px[i]));
+        _mm_store_ps(local[10], _mm_loadu_ps(&m_local.py[i]));
+        _mm_store_ps(local[11], _mm_loadu_ps(&m_local.pz[i]));
+
+        uint32_t lanes = std::min(SIMD_WIDTH, end - i);
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            uint32_t index = i + lane;
+            if (!m_worldChanged[index])
+                continue;
+
+            float *out = &m_world[index][0][0];
+            uint32_t parent = m_parents[index];
+            if (parent == INVALID_INDEX) {
+                _mm_storeu_ps(out + 0, _mm_setr_ps(local[0][lane], local[1][lane], local[2][lane], 0.0F));
+                _mm_storeu_ps(out + 4, _mm_setr_ps(local[3][lane], local[4][lane], local[5][lane], 0.0F));
+                _mm_storeu_ps(out + 8, _mm_setr_ps(local[6][lane], local[7][lane], local[8][lane], 0.0F));
+                _mm_storeu_ps(out + 12, _mm_setr_ps(local[9][lane], local[10][lane], local[11][lane], 1.0F));
+                continue;
+            }
+
+            /* world = parent * local, one column at a time */
+            const float *p = &m_world[parent][0][0];
+            __m128 p0 = _mm_loadu_ps(p + 0);
+            __m128 p1 = _mm_loadu_ps(p + 4);
+            __m128 p2 = _mm_loadu_ps(p + 8);
+            __m128 p3 = _mm_loadu_ps(p + 12);
+            for (uint32_t c = 0; c < 4; c++) {
+                __m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[c * 3 + 0][lane])),
+                                                      _mm_mul_ps(p1, _mm_set1_ps(local[c * 3 + 1][lane]))),
+                                           _mm_mul_ps(p2, _mm_set1_ps(local[c * 3 + 2][lane])));
+                if (c == 3) {
+                    column = _mm_add_ps(column, p3);
+                }
+                _mm_storeu_ps(out + c * 4, column);
+            }
+        }
+    }
+#else
+    for (uint32_t i = begin; i < end; i++) {
+        if (!m_worldChanged[i])
+            continue;
+
+        float x = m_local.rx[i], y = m_local.ry[i], z = m_local.rz[i], w = m_local.rw[i];
+        glm::mat4 local(1.0F);
+        local[0] = glm::vec4(1.0F - 2.0F * (y * y + z * z), 2.0F * (x * y + w * z), 2.0F * (x * z - w * y), 0.0F) * m_local.sx[i];
+        local[1] = glm::vec4(2.0F * (x * y - w * z), 1.0F - 2.0F * (x * x + z * z), 2.0F * (y * z + w * x), 0.0F) * m_local.sy[i];
+        local[2] = glm::vec4(2.0F * (x * z + w * y), 2.0F * (y * z - w * x), 1.0F - 2.0F * (x * x + y * y), 0.0F) * m_local.sz[i];
+        local[3] = glm::vec4(m_local.px[i], m_local.py[i], m_local.pz[i], 1.0F);
+
+        uint32_t parent = m_parents[i];
+        m_world[i] = (parent == INVALID_INDEX ? local : m_world[parent] * local);
+    }
+#endif
+}
+
+}  // namespace vengine
@@ -0,0 +1,116 @@
+#ifndef __TransformHierarchy_hpp__
+#define __TransformHierarchy_hpp__
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Transform.hpp"
+
+namespace vengine
+{
+
+class ThreadPool;
+
+/**
+ * @brief A flat store of the transforms of a node hierarchy. Nodes are kept in breadth first order, so every level of the
+ * hierarchy is a contiguous range and the children of a contiguous range of parents are a contiguous range of the next level.
+ * Local transforms are stored as structure of arrays and world matrices in one contiguous array. update() walks the levels
+ * top down and recomputes only the ranges that contain changed nodes, four nodes at a time with SIMD where available.
+ *
+ * Nodes are referenced by handles that stay valid until the node is removed. Adding, removing or re-parenting a node marks
+ * the layout dirty, and the arrays are reordered on the next update()
+ */
+class TransformHierarchy
+{
+public:
+    typedef uint32_t Handle;
+    static constexpr Handle INVALID_HANDLE = std::numeric_limits<Handle>::max();
+
+    TransformHierarchy();
+
+    /* Add a root node with a local transform */
+    Handle add(const Transform &localTransform);
+    /* Remove a node. Its children, if any are left, become roots */
+    void remove(Handle handle);
+
+    /* Set the parent of a node, INVALID_HANDLE makes it a root */
+    void setParent(Handle handle, Handle parent);
+    Handle parent(Handle handle) const { return m_parentHandles[handle]; }
+
+    void setLocalTransform(Handle handle, const Transform &localTransform);
+
+    /* Get the world matrix of a node, as computed by the last update() */
+    const glm::mat4 &worldMatrix(Handle handle) const { return m_world[m_indices[handle]]; }
+
+    /**
+     * @brief Recompute the world matrices of the nodes whose local transform changed and of their descendants
+     *
+     * @param threadPool Used to split levels with many changed nodes
+     */
+    void update(ThreadPool &threadPool);
+
+    /* Get all nodes in breadth first order. The layout is rebuilt first if nodes were added, removed or re-parented */
+    const std::vector<Handle> &nodes();
+
+    /* Get the nodes whose world matrix changed in the last update() */
+    const std::vector<Handle> &changed() const { return m_changed; }
+
+    /* Number of nodes */
+    uint32_t size() const { return static_cast<uint32_t>(m_handles.size()) - m_removed; }
+    /* Number of levels, as of the last update() */
+    uint32_t levels() const { return static_cast<uint32_t>(m_levels.size()) - 1; }
+
+private:
+    /* Local transforms in structure of arrays layout, padded to a multiple of the SIMD width */
+    struct LocalTransforms {
+        std::vector<float> px, py, pz;
+        std::vector<float> rx, ry, rz, rw;
+        std::vector<float> sx, sy, sz;
+
+        void resize(uint32_t n);
+        void set(uint32_t i, const Transform &t);
+        void copy(uint32_t to, const LocalTransforms &from, uint32_t i);
+    };
+
+    /* Per handle, index of the node in the node arrays and handle of the parent */
+    std::vector<uint32_t> m_indices;
+    std::vector<Handle> m_parentHandles;
+    std::vector<Handle> m_freeHandles;
+    /* Handles removed since the last layout, freed when the layout is rebuilt */
+    std::vector<Handle> m_removedHandles;
+    uint32_t m_removed = 0;
+
+    /* Per node, in breadth first order */
+    std::vector<Handle> m_handles;
+    std::vector<uint32_t> m_parents;
+    /* Children of node i are [m_firstChild[i], m_firstChild[i + 1]) */
+    std::vector<uint32_t> m_firstChild;
+    LocalTransforms m_local;
+    std::vector<glm::mat4> m_world;
+    /* Local transform or parent changed since the last update */
+    std::vector<uint8_t> m_dirty;
+    /* World matrix changed in the current update */
+    std::vector<uint8_t> m_worldChanged;
+
+    /* Level i holds the nodes [m_levels[i], m_levels[i + 1]) */
+    std::vector<uint32_t> m_levels;
+    /* Per level, range of dirty nodes */
+    std::vector<std::pair<uint32_t, uint32_t>> m_dirtyRanges;
+    bool m_layoutDirty = false;
+
+    std::vector<Handle> m_changed;
+
+    void markDirty(uint32_t index);
+    /* Sort the nodes in breadth first order and drop removed nodes */
+    void rebuildLayout();
+    /* Flag the nodes of [begin, end) that changed and recompute their world matrices */
+    void updateRange(uint32_t begin, uint32_t end);
+};
+
+}  // namespace vengine
+
+#endif
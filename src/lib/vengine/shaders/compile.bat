@@ -9,6 +9,7 @@ set compiler=%VULKAN_SDK%\Bin\glslangValidator.exe
 %compiler% -V --target-env spirv1.4 lightCompositionDirectional.frag.glsl -o SPIRV/lightCompositionDirectional.frag.spv
 %compiler% -V --target-env spirv1.4 pbrForward.frag.glsl -o SPIRV/pbrForward.frag.spv
 %compiler% -V --target-env spirv1.4 lambertForward.frag.glsl -o SPIRV/lambertForward.frag.spv
+%compiler% -V --target-env spirv1.4 cull.comp.glsl -o SPIRV/cull.comp.spv
 
 %compiler% -V overlay/transform3D.vert.glsl -o SPIRV/overlay/transform3D.vert.spv
 %compiler% -V overlay/transform3D.frag.glsl -o SPIRV/overlay/transform3D.frag.spv
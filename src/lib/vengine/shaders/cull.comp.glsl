@@ -0,0 +1,100 @@
+#version 460
+
+#extension GL_GOOGLE_include_directive : enable
+#include "include/structs.glsl"
+
+layout(local_size_x = 64) in;
+
+/* CullingMeshGroup struct. A mirror of the CPU struct */
+struct CullingMeshGroup {
+    vec4 min;   /* RGB = min point of the mesh AABB */
+    vec4 max;   /* RGB = max point of the mesh AABB */
+    uvec4 info; /* R = start index in the InstanceData buffer, G = number of instances, B = first flat instance, A = LODs */
+};
+
+/* A mirror of VkDrawIndexedIndirectCommand */
+struct DrawIndexedIndirectCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(push_constant) uniform PushConsts {
+    vec4 planes[6]; /* Frustum planes as (normal, d), normals point inwards */
+    vec4 lodRow;    /* Bounding sphere radius / dot(lodRow, center) is the screen size relative to the first LOD switch */
+    uvec4 info;     /* R = number of opaque instances, G = number of mesh groups, B = draw commands per group */
+} pushConsts;
+
+layout(set = 0, binding = 0) buffer readonly InstanceDataDescriptor {
+    InstanceData data[];
+} instanceData;
+
+layout(set = 1, binding = 0) buffer readonly MeshGroups {
+    CullingMeshGroup data[];
+} meshGroups;
+
+layout(set = 1, binding = 1) buffer DrawCommands {
+    DrawIndexedIndirectCommand data[];
+} drawCommands;
+
+layout(set = 1, binding = 2) buffer DrawCounts {
+    uint data[];
+} drawCounts;
+
+layout(set = 1, binding = 3) buffer writeonly VisibleInstances {
+    uint data[];
+} visibleInstances;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= pushConsts.info.r) {
+        return;
+    }
+
+    /* Find the last group whose first flat instance is at or before i */
+    uint lo = 0;
+    uint hi = pushConsts.info.g - 1;
+    while (lo < hi) {
+        uint mid = (lo + hi + 1) / 2;
+        if (meshGroups.data[mid].info.b <= i) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    CullingMeshGroup group = meshGroups.data[lo];
+    uint instanceDataIndex = group.info.r + (i - group.info.b);
+
+    /* World space AABB of the transformed mesh AABB, as a center and a half extent */
+    mat4 model = instanceData.data[instanceDataIndex].model;
+    vec3 center = vec3(model * vec4(0.5 * (group.min.xyz + group.max.xyz), 1.0));
+    vec3 halfExtent = 0.5 * (group.max.xyz - group.min.xyz);
+    vec3 extent = abs(model[0].xyz) * halfExtent.x + abs(model[1].xyz) * halfExtent.y + abs(model[2].xyz) * halfExtent.z;
+
+    for (int p = 0; p < 6; p++) {
+        vec4 plane = pushConsts.planes[p];
+        if (dot(plane.xyz, center) + dot(abs(plane.xyz), extent) + plane.w < 0.0) {
+            return;
+        }
+    }
+
+    /* Select the level of detail like Mesh::selectLOD(), every next level at half the screen size */
+    uint lod = 0;
+    float distance = dot(pushConsts.lodRow, vec4(center, 1.0));
+    if (distance > 0.0) {
+        float screenSize = length(extent) / distance;
+        float threshold = 1.0;
+        while (lod + 1 < group.info.a && screenSize < threshold) {
+            lod++;
+            threshold *= 0.5;
+        }
+    }
+
+    /* Append the instance to the visible instances of the level's draw command */
+    uint command = lo * pushConsts.info.b + lod;
+    uint slot = atomicAdd(drawCommands.data[command].instanceCount, 1);
+    visibleInstances.data[drawCommands.data[command].firstInstance + slot] = instanceDataIndex;
+    atomicMax(drawCounts.data[lo], lod + 1);
+}
@@ -18,4 +18,12 @@ void unpack16bitTo8Bit(in uint p, out float a, out float b)
     b = float(b_) / 255.0;
 }
 
-
+/* Decode a unit vector from the [-1, 1] square of its octahedral encoding */
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
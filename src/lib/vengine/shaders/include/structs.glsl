@@ -11,6 +11,15 @@ struct Vertex
     vec3 bitangent;
 };
 
+/* PackedVertex struct. A mirror of the CPU struct, stored in the geometry buffers instead of Vertex if PACKED_VERTICES */
+struct PackedVertex
+{
+    vec3 position;
+    uint uv;      /* Half floats */
+    uint normal;  /* Octahedral encoding, snorm 16 */
+    uint tangent; /* R, G = octahedral encoding, B = handedness, A = unused, snorm 8 */
+};
+
 /* SceneData struct. A mirror of the CPU struct */
 struct SceneData {
     mat4 view;
@@ -30,8 +39,8 @@ struct InstanceData {
     uint64_t vertexAddress;
     uint64_t indexAddress;
     uint numTriangles;
+    uint indexSize;
     
-    uint padding1;
     uint padding2;
     uint padding3;
     uint padding4;
@@ -2,8 +2,12 @@
 
 #extension GL_GOOGLE_include_directive : enable
 #include "../include/structs.glsl"
+#include "../include/packing.glsl"
 #extension GL_EXT_nonuniform_qualifier : enable
 
+/* If true the attributes are the ones of PackedVertex, specialized to VULKAN_PACKED_VERTICES */
+layout(constant_id = 0) const bool PACKED_VERTICES = false;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV;
 layout(location = 2) in vec3 inNormal;
@@ -20,6 +24,7 @@ layout(push_constant) uniform PushConsts {
 } pushConsts;
 
 void main() {
-    vec4 worldPos = pushConsts.modelMatrix * vec4(inPosition + normalize(inNormal) * pushConsts.color.a, 1.0);
+    vec3 normal = PACKED_VERTICES ? octahedralDecode(inNormal.xy) : normalize(inNormal);
+    vec4 worldPos = pushConsts.modelMatrix * vec4(inPosition + normal * pushConsts.color.a, 1.0);
     gl_Position = sceneData.data.projection * sceneData.data.view * worldPos;
 }
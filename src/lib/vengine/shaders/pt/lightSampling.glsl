@@ -47,14 +47,12 @@ LightSamplingRecord sampleLight(vec3 originPosition)
         uint meshIndex = uint(light.info.g);
 
         InstanceData instanceData = instances.data[meshIndex];
-        Indices indices = Indices(instanceData.indexAddress);
-        Vertices vertices = Vertices(instanceData.vertexAddress);
         MaterialData material = materialData.data[instanceData.materialIndex];
         mat4 transform = mat4(light.position, light.position1, light.position2, vec4(0, 0, 0, 1));
         transform = transpose(transform);
         
         uint randomTriangle = uint(rand1D(rayPayloadPrimary) * instanceData.numTriangles);
-        ivec3 ind = indices.i[randomTriangle];
+        uvec3 ind = fetchTriangle(instanceData.indexAddress, instanceData.indexSize, randomTriangle);
         float trianglePdf = 1.0 / instanceData.numTriangles;
         
         /* Sample triangle */
@@ -62,9 +60,9 @@ LightSamplingRecord sampleLight(vec3 originPosition)
         vec3 sampledBarycentricCoords = vec3(barycentricCoords, 1.F - barycentricCoords.x - barycentricCoords.y);
 
         /* Sampled triangle info */
-        Vertex v0 = vertices.v[ind.x];
-        Vertex v1 = vertices.v[ind.y];
-        Vertex v2 = vertices.v[ind.z];
+        Vertex v0 = fetchVertex(instanceData.vertexAddress, ind.x);
+        Vertex v1 = fetchVertex(instanceData.vertexAddress, ind.y);
+        Vertex v2 = fetchVertex(instanceData.vertexAddress, ind.z);
 
         vec3 v0PosTransformed = (transform * vec4(v0.position, 1)).xyz;
         vec3 v1PosTransformed = (transform * vec4(v1.position, 1)).xyz;
@@ -22,8 +22,7 @@ layout(location = 1) rayPayloadEXT RayPayloadSecondary rayPayloadSecondary;
 layout(location = 2) rayPayloadEXT RayPayloadNEE rayPayloadNEE;
 
 /* Types for the arrays of vertices and indices of the currently hit object */
-layout(buffer_reference, scalar) buffer Vertices {Vertex v[]; };
-layout(buffer_reference, scalar) buffer Indices {ivec3  i[]; };
+#include "vertices.glsl"
 
 #include "layoutDescriptors/PathTracingData.glsl"
 #include "layoutDescriptors/InstanceData.glsl"
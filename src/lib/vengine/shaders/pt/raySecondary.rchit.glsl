@@ -22,8 +22,7 @@ hitAttributeEXT vec2 attribs;
 layout(location = 1) rayPayloadInEXT RayPayloadSecondary rayPayloadSecondary;
 
 /* Types for the arrays of vertices and indices of the currently hit object */
-layout(buffer_reference, scalar) buffer Vertices {Vertex v[]; };
-layout(buffer_reference, scalar) buffer Indices {ivec3  i[]; };
+#include "vertices.glsl"
 
 #include "layoutDescriptors/InstanceData.glsl"
 #include "layoutDescriptors/MaterialData.glsl"
@@ -0,0 +1,40 @@
+#extension GL_EXT_shader_explicit_arithmetic_types_int16 : require
+
+#include "../include/packing.glsl"
+
+/* If true the vertex buffers hold PackedVertex, specialized to VULKAN_PACKED_VERTICES */
+layout(constant_id = 0) const bool PACKED_VERTICES = false;
+
+layout(buffer_reference, scalar) buffer Vertices {Vertex v[]; };
+layout(buffer_reference, scalar) buffer PackedVertices {PackedVertex v[]; };
+layout(buffer_reference, scalar) buffer Indices {uvec3 i[]; };
+layout(buffer_reference, scalar) buffer Indices16 {u16vec3 i[]; };
+
+/* Get a vertex from the vertex buffer at an address */
+Vertex fetchVertex(uint64_t vertexAddress, uint index)
+{
+    if (!PACKED_VERTICES) {
+        return Vertices(vertexAddress).v[index];
+    }
+
+    PackedVertex packed = PackedVertices(vertexAddress).v[index];
+    vec4 tangent = unpackSnorm4x8(packed.tangent);
+
+    Vertex vertex;
+    vertex.position = packed.position;
+    vertex.uv = unpackHalf2x16(packed.uv);
+    vertex.normal = octahedralDecode(unpackSnorm2x16(packed.normal));
+    vertex.color = vec3(1, 0, 0);
+    vertex.tangent = octahedralDecode(tangent.xy);
+    vertex.bitangent = tangent.z * cross(vertex.normal, vertex.tangent);
+    return vertex;
+}
+
+/* Get the vertex indices of a triangle from the index buffer at an address, with indices of indexSize bytes */
+uvec3 fetchTriangle(uint64_t indexAddress, uint indexSize, uint triangle)
+{
+    if (indexSize == 2) {
+        return uvec3(Indices16(indexAddress).i[triangle]);
+    }
+    return Indices(indexAddress).i[triangle];
+}
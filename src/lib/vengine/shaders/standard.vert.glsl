@@ -2,13 +2,19 @@
 
 #extension GL_GOOGLE_include_directive : enable
 #include "include/structs.glsl"
+#include "include/packing.glsl"
 #extension GL_EXT_nonuniform_qualifier : enable
 
+/* If true the attributes are the ones of PackedVertex, specialized to VULKAN_PACKED_VERTICES */
+layout(constant_id = 0) const bool PACKED_VERTICES = false;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec3 inTangent;
 layout(location = 4) in vec3 inBitangent;  
+/* Per instance, from the visible instances buffer */
+layout(location = 5) in uint inInstanceDataIndex;
 
 layout(location = 0) out vec3 fragPos_world;
 layout(location = 1) out vec3 fragNormal_world;
@@ -26,7 +32,7 @@ layout(set = 1, binding = 0) buffer readonly InstanceDataDescriptor {
 } instanceData;
 
 void main() {
-    instanceDataIndex = gl_InstanceIndex;
+    instanceDataIndex = inInstanceDataIndex;
     InstanceData instance = instanceData.data[nonuniformEXT(instanceDataIndex)];
 
     vec4 worldPos = instance.model * vec4(inPosition, 1.0);
@@ -34,9 +40,12 @@ void main() {
     
     mat4 invTransModel = transpose(inverse(instance.model));
 
+    vec3 normal = PACKED_VERTICES ? octahedralDecode(inNormal.xy) : inNormal;
+    vec3 tangent = PACKED_VERTICES ? octahedralDecode(inTangent.xy) : inTangent;
+
     fragPos_world = worldPos.xyz;
-    fragNormal_world = normalize(vec3(invTransModel * vec4(inNormal, 0.0)));
-    fragTangent_world = normalize(vec3(invTransModel * vec4(inTangent, 0.0)));
+    fragNormal_world = normalize(vec3(invTransModel * vec4(normal, 0.0)));
+    fragTangent_world = normalize(vec3(invTransModel * vec4(tangent, 0.0)));
     fragTangent_world = normalize(fragTangent_world - dot(fragTangent_world, fragNormal_world) * fragNormal_world);
     fragBiTangent_world = cross(fragNormal_world, fragTangent_world);
     fragUV = inUV;
@@ -13,10 +13,16 @@ Mesh *ComponentMesh::mesh() const
     return m_mesh;
 }
 
-void ComponentMesh::setMesh(Mesh *mesh)
+const Model3D *ComponentMesh::model() const
+{
+    return m_model;
+}
+
+void ComponentMesh::setMesh(Mesh *mesh, const Model3D *model)
 {
     assert(mesh != nullptr);
     m_mesh = mesh;
+    m_model = model;
 
     for (Entity *e : *m_owner) {
         e->onMeshComponentChanged();
@@ -133,9 +139,22 @@ ID Entity::getID() const
 
 void ComponentManager::clear()
 {
-    for (auto &it : m_componentBuffers) {
-        it.second->clear();
+    for (IComponentBuffer *componentBuffer : m_componentBuffers) {
+        componentBuffer->clear();
+    }
+}
+
+PagedPoolOccupancy ComponentManager::occupancy() const
+{
+    PagedPoolOccupancy total;
+    for (IComponentBuffer *componentBuffer : m_componentBuffers) {
+        PagedPoolOccupancy occupancy = componentBuffer->occupancy();
+        total.size += occupancy.size;
+        total.capacity += occupancy.capacity;
+        total.pages += occupancy.pages;
+        total.bytes += occupancy.bytes;
     }
+    return total;
 }
 
 }  // namespace vengine
\ No newline at end of file
@@ -3,7 +3,9 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <unordered_map>
+#include <array>
+#include <vector>
+#include <tuple>
 #include <memory>
 #include <stdexcept>
 
@@ -14,16 +16,18 @@
 #include "core/Light.hpp"
 
 #include "IDGeneration.hpp"
-#include "FreeList.hpp"
+#include "PagedPool.hpp"
 
 namespace vengine
 {
 
-static const uint32_t MAX_COMPONENTS = 16384;
+/* Number of components in each page of a component buffer */
+static const uint32_t COMPONENT_PAGE_SIZE = 1024;
 
 class Entity;
 class ComponentOwner;
 class ComponentManager;
+class Model3D;
 
 /* Base Component class */
 class Component
@@ -48,10 +52,14 @@ public:
     ComponentMesh(Mesh *mesh);
 
     Mesh *mesh() const;
-    void setMesh(Mesh *mesh);
+    /* The model the mesh was picked from. Meshes are shared between the models with the same geometry, so the mesh alone
+     * doesn't tell. nullptr for meshes that are not part of a model */
+    const Model3D *model() const;
+    void setMesh(Mesh *mesh, const Model3D *model = nullptr);
 
 private:
     Mesh *m_mesh = nullptr;
+    const Model3D *m_model = nullptr;
 };
 class ComponentMaterial : public Component
 {
@@ -108,6 +116,45 @@ private:
     MaterialVolume *m_materialBackFacing = nullptr;
 };
 
+/* List of all component types. The position of a type in the list is its dense compile time index */
+template <typename... Types>
+struct ComponentTypeList {
+    static constexpr uint32_t size = sizeof...(Types);
+};
+typedef ComponentTypeList<ComponentMesh, ComponentMaterial, ComponentLight, ComponentVolume> ComponentTypes;
+
+static constexpr uint32_t COMPONENT_TYPES = ComponentTypes::size;
+
+template <typename T, typename List>
+struct ComponentTypeIndex;
+template <typename T, typename... Rest>
+struct ComponentTypeIndex<T, ComponentTypeList<T, Rest...>> {
+    static constexpr uint32_t value = 0;
+};
+template <typename T, typename U, typename... Rest>
+struct ComponentTypeIndex<T, ComponentTypeList<U, Rest...>> {
+    static constexpr uint32_t value = 1 + ComponentTypeIndex<T, ComponentTypeList<Rest...>>::value;
+};
+
+/* Get the index of a component type */
+template <typename T>
+constexpr uint32_t componentIndex()
+{
+    static_assert(std::is_base_of<Component, T>::value);
+    return ComponentTypeIndex<T, ComponentTypes>::value;
+}
+
+/* A set of component types, bit i is set if the component type with index i is in the set */
+typedef uint32_t ComponentMask;
+static_assert(COMPONENT_TYPES <= 32);
+
+/* Get the mask of a set of component types */
+template <typename... Types>
+constexpr ComponentMask componentMask()
+{
+    return ((ComponentMask(1) << componentIndex<Types>()) | ... | ComponentMask(0));
+}
+
 /* Component owner */
 class ComponentOwner
 {
@@ -194,20 +241,81 @@ public:
 
     virtual void clear() = 0;
 
+    virtual PagedPoolOccupancy occupancy() const = 0;
+
 private:
 };
+/**
+ * @brief Storage of the components of type T. Components live in a paged pool, so their addresses don't change while they exist
+ * and the storage grows with the scene. Besides the pool, it keeps two packed arrays with one entry for each
+ * entity that has a component of type T, the entity and its component. Removing an entity moves the last entry in its place,
+ * so the arrays have no holes and can be scanned linearly
+ */
 template <typename T>
-class ComponentBuffer : public IComponentBuffer, public FreeBlockList<T>
+class ComponentBuffer : public IComponentBuffer, public PagedPool<T>
 {
+    friend class Entity;
+
 public:
-    ComponentBuffer(uint32_t nComponents)
-        : FreeBlockList<T>(nComponents){};
+    ComponentBuffer(uint32_t pageSize)
+        : PagedPool<T>(pageSize){};
+
+    void clear() override
+    {
+        PagedPool<T>::reset();
+        m_entities.clear();
+        m_components.clear();
+    }
+
+    PagedPoolOccupancy occupancy() const override { return PagedPool<T>::occupancy(); }
+
+    /* Reserve storage for n more components */
+    void reserve(uint32_t n)
+    {
+        PagedPool<T>::reserve(n);
+        m_entities.reserve(m_entities.size() + n);
+        m_components.reserve(m_components.size() + n);
+    }
 
-    void clear() override { FreeBlockList<T>::reset(); }
+    /* Number of entities that have a component of type T */
+    uint32_t entitiesSize() const { return static_cast<uint32_t>(m_entities.size()); }
+    Entity *const *entities() const { return m_entities.data(); }
+    T *const *components() const { return m_components.data(); }
 
 private:
+    std::vector<Entity *> m_entities;
+    std::vector<T *> m_components;
+
+    /* Add an entry for an entity, returns its index in the packed arrays */
+    uint32_t attach(Entity *entity, T *component)
+    {
+        m_entities.push_back(entity);
+        m_components.push_back(component);
+        return static_cast<uint32_t>(m_entities.size() - 1);
+    }
+
+    /* Remove the entry at index, returns the entity that was moved to index or nullptr */
+    Entity *detach(uint32_t index)
+    {
+        assert(index < m_entities.size());
+
+        Entity *moved = nullptr;
+        uint32_t last = static_cast<uint32_t>(m_entities.size() - 1);
+        if (index != last) {
+            m_entities[index] = m_entities[last];
+            m_components[index] = m_components[last];
+            moved = m_entities[index];
+        }
+        m_entities.pop_back();
+        m_components.pop_back();
+
+        return moved;
+    }
 };
 
+template <typename... Types>
+class ComponentView;
+
 /* Component manager */
 class ComponentManager
 {
@@ -232,11 +340,17 @@ public:
 
         auto componentBuffer = buffer<T>();
         auto *component = componentBuffer->get();
-        *component = T();
         component->m_owner = new OwnerType();
         return component;
     }
 
+    /* Reserve storage for n more components of type T, to add many components without growing the buffers in between */
+    template <typename T>
+    void reserve(uint32_t n)
+    {
+        buffer<T>()->reserve(n);
+    }
+
     template <typename T>
     void remove(T *t)
     {
@@ -252,53 +366,50 @@ public:
     template <typename T>
     ComponentBuffer<T> *buffer()
     {
-        const char *name = typeid(T).name();
-        return static_cast<ComponentBuffer<T> *>(m_componentBuffers[name]);
+        return static_cast<ComponentBuffer<T> *>(m_componentBuffers[componentIndex<T>()]);
     }
 
+    /**
+     * @brief Get a view of all entities that have components of every type in Types. The view scans the packed arrays of
+     * the first type, so it's best to put the rarest type first
+     *
+     * @return ComponentView<Types...>
+     */
+    template <typename... Types>
+    ComponentView<Types...> view();
+
+    /* Get the sum of the occupancy of all component buffers */
+    PagedPoolOccupancy occupancy() const;
+
 private:
-    ComponentManager()
+    ComponentManager() { createBuffers(ComponentTypes()); }
+    ~ComponentManager()
     {
-        {
-            const char *name = typeid(ComponentMesh).name();
-            m_componentBuffers.insert({name, new ComponentBuffer<ComponentMesh>(MAX_COMPONENTS)});
-        }
-        {
-            const char *name = typeid(ComponentMaterial).name();
-            m_componentBuffers.insert({name, new ComponentBuffer<ComponentMaterial>(MAX_COMPONENTS)});
-        }
-        {
-            const char *name = typeid(ComponentLight).name();
-            m_componentBuffers.insert({name, new ComponentBuffer<ComponentLight>(MAX_COMPONENTS)});
-        }
-        {
-            const char *name = typeid(ComponentVolume).name();
-            m_componentBuffers.insert({name, new ComponentBuffer<ComponentVolume>(MAX_COMPONENTS)});
+        for (IComponentBuffer *componentBuffer : m_componentBuffers) {
+            delete componentBuffer;
         }
     }
-    ~ComponentManager()
+
+    template <typename... Types>
+    void createBuffers(ComponentTypeList<Types...>)
     {
-        for (auto &itr : m_componentBuffers) {
-            delete itr.second;
-        }
+        ((m_componentBuffers[componentIndex<Types>()] = new ComponentBuffer<Types>(COMPONENT_PAGE_SIZE)), ...);
     }
-    std::unordered_map<const char *, IComponentBuffer *> m_componentBuffers;
+
+    /* Component buffers, indexed by the component type index */
+    std::array<IComponentBuffer *, COMPONENT_TYPES> m_componentBuffers{};
 };
 
 /* Entity class */
 class Entity
 {
+    template <typename... Types>
+    friend class ComponentView;
+
 public:
     Entity();
 
-    virtual ~Entity()
-    {
-        // TODO optimise this?
-        remove<ComponentMesh>();
-        remove<ComponentMaterial>();
-        remove<ComponentLight>();
-        remove<ComponentVolume>();
-    }
+    virtual ~Entity() { removeComponents(ComponentTypes()); }
 
     /**
      * @brief Creates a new unique component of type T, adds to the entity and returns its reference
@@ -318,8 +429,9 @@ public:
         T *c = cm.create<T, ComponentOwnerUnique>();
         static_cast<ComponentOwnerUnique *>(c->m_owner)->m_entity = this;
 
-        const char *name = typeid(T).name();
-        m_components[name] = {c, false};
+        m_components[componentIndex<T>()] = c;
+        m_signature |= componentMask<T>();
+        m_packedIndices[componentIndex<T>()] = cm.buffer<T>()->attach(this, c);
 
         onComponentAdded();
 
@@ -345,8 +457,12 @@ public:
 
         static_cast<ComponentOwnerShared *>(sharedComponent->m_owner)->addEntity(this);
 
-        const char *name = typeid(T).name();
-        m_components[name] = {sharedComponent, true};
+        m_components[componentIndex<T>()] = sharedComponent;
+        m_signature |= componentMask<T>();
+        m_sharedComponents |= componentMask<T>();
+
+        auto &cm = ComponentManager::getInstance();
+        m_packedIndices[componentIndex<T>()] = cm.buffer<T>()->attach(this, static_cast<T *>(sharedComponent));
 
         onComponentAdded();
     }
@@ -361,12 +477,10 @@ public:
     {
         static_assert(std::is_base_of<Component, T>::value);
 
-        const char *name = typeid(T).name();
-        auto itr = m_components.find(name);
-        if (itr == m_components.end()) {
+        if (!has<T>()) {
             throw std::runtime_error("Entity::get(): Component doesn't exist");
         } else
-            return *static_cast<T *>(itr->second.first);
+            return *static_cast<T *>(m_components[componentIndex<T>()]);
     }
 
     /**
@@ -381,11 +495,16 @@ public:
     {
         static_assert(std::is_base_of<Component, T>::value);
 
-        const char *name = typeid(T).name();
-        auto itr = m_components.find(name);
-        return (itr != m_components.end());
+        return (m_signature & componentMask<T>()) != 0;
     }
 
+    /**
+     * @brief Get the mask of the component types the entity has
+     *
+     * @return ComponentMask
+     */
+    ComponentMask signature() const { return m_signature; }
+
     ID getID() const;
 
     /**
@@ -401,14 +520,22 @@ public:
         if (!has<T>())
             return;
 
-        const char *name = typeid(T).name();
-        std::pair<Component *, bool> component = m_components[name];
+        Component *component = m_components[componentIndex<T>()];
+        bool shared = (m_sharedComponents & componentMask<T>()) != 0;
+
+        m_components[componentIndex<T>()] = nullptr;
+        m_signature &= ~componentMask<T>();
+        m_sharedComponents &= ~componentMask<T>();
 
-        m_components.erase(name);
+        auto &cm = ComponentManager::getInstance();
+        uint32_t packedIndex = m_packedIndices[componentIndex<T>()];
+        Entity *moved = cm.buffer<T>()->detach(packedIndex);
+        if (moved != nullptr) {
+            moved->m_packedIndices[componentIndex<T>()] = packedIndex;
+        }
 
-        if (!component.second) {
-            auto &cm = ComponentManager::getInstance();
-            cm.remove<T>(static_cast<T *>(component.first));
+        if (!shared) {
+            cm.remove<T>(static_cast<T *>(component));
         }
 
         onComponentRemoved();
@@ -423,12 +550,117 @@ public:
 
 private:
     ID m_id;
-    /**
-        Map of component name to {Component* and bool to indicate if the component was added as shared}
-     */
-    std::unordered_map<const char *, std::pair<Component *, bool>> m_components;
+    /* Components indexed by the component type index, valid only if the type bit is set in the signature */
+    std::array<Component *, COMPONENT_TYPES> m_components{};
+    ComponentMask m_signature = 0;
+    /* Component types that were added as shared */
+    ComponentMask m_sharedComponents = 0;
+    /* Index of the entity in the packed arrays of each component buffer */
+    std::array<uint32_t, COMPONENT_TYPES> m_packedIndices{};
+
+    template <typename... Types>
+    void removeComponents(ComponentTypeList<Types...>)
+    {
+        if (m_signature == 0)
+            return;
+        (remove<Types>(), ...);
+    }
+};
+
+/**
+ * @brief A view over all entities that have components of every type in Types. Iterating it yields a tuple with the entity and
+ * references to its components, e.g. for (auto [entity, mesh, material] : cm.view<ComponentMesh, ComponentMaterial>())
+ *
+ * @tparam Types
+ */
+template <typename... Types>
+class ComponentView
+{
+public:
+    static_assert(sizeof...(Types) > 0);
+    typedef std::tuple_element_t<0, std::tuple<Types...>> First;
+
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::tuple<Entity *, Types &...>;
+
+        Iterator(const ComponentBuffer<First> *buffer, uint32_t index)
+            : m_buffer(buffer)
+            , m_index(index)
+        {
+            skipInvalid();
+        }
+
+        value_type operator*() const
+        {
+            Entity *entity = m_buffer->entities()[m_index];
+            return value_type(entity, component<Types>(entity)...);
+        }
+
+        Iterator &operator++()
+        {
+            m_index++;
+            skipInvalid();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend bool operator==(const Iterator &a, const Iterator &b) { return a.m_index == b.m_index; };
+        friend bool operator!=(const Iterator &a, const Iterator &b) { return a.m_index != b.m_index; };
+
+    private:
+        const ComponentBuffer<First> *m_buffer;
+        uint32_t m_index;
+
+        static constexpr ComponentMask MASK = componentMask<Types...>();
+
+        void skipInvalid()
+        {
+            if constexpr (sizeof...(Types) > 1) {
+                Entity *const *entities = m_buffer->entities();
+                while (m_index < m_buffer->entitiesSize() && (entities[m_index]->signature() & MASK) != MASK) {
+                    m_index++;
+                }
+            }
+        }
+
+        template <typename T>
+        T &component(Entity *entity) const
+        {
+            if constexpr (std::is_same<T, First>::value) {
+                return *m_buffer->components()[m_index];
+            } else {
+                return *static_cast<T *>(entity->m_components[componentIndex<T>()]);
+            }
+        }
+    };
+
+    ComponentView(const ComponentBuffer<First> *buffer)
+        : m_buffer(buffer){};
+
+    Iterator begin() const { return Iterator(m_buffer, 0); }
+    Iterator end() const { return Iterator(m_buffer, m_buffer->entitiesSize()); }
+
+private:
+    const ComponentBuffer<First> *m_buffer;
 };
 
+template <typename... Types>
+ComponentView<Types...> ComponentManager::view()
+{
+    typedef typename ComponentView<Types...>::First First;
+    return ComponentView<Types...>(buffer<First>());
+}
+
 }  // namespace vengine
 
 #endif
\ No newline at end of file
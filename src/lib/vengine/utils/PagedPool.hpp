@@ -0,0 +1,229 @@
+#ifndef __PagedPool_hpp__
+#define __PagedPool_hpp__
+
+#include <cstdint>
+#include <cassert>
+#include <map>
+#include <memory>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace vengine
+{
+
+/* Occupancy of a paged pool */
+struct PagedPoolOccupancy {
+    /* Number of live objects */
+    uint32_t size = 0;
+    /* Number of objects the allocated pages can hold */
+    uint32_t capacity = 0;
+    /* Number of allocated pages */
+    uint32_t pages = 0;
+    /* Memory of the allocated pages in bytes */
+    size_t bytes = 0;
+};
+
+/**
+ * @brief A pool of objects of type T, allocated in fixed size pages. Pages are allocated when all existing pages are full and
+ * released when they become empty, except for one empty page that is kept so that objects added and removed at a page
+ * boundary don't allocate and release a page every time. Pages never move, so pointers to objects stay valid until the object
+ * is removed
+ *
+ * @tparam T
+ */
+template <typename T>
+class PagedPool
+{
+public:
+    PagedPool(uint32_t pageSize)
+        : m_pageSize(pageSize)
+    {
+        assert(pageSize > 0);
+    }
+
+    ~PagedPool() { reset(); }
+
+    PagedPool(const PagedPool &) = delete;
+    PagedPool &operator=(const PagedPool &) = delete;
+
+    /* Construct a new object, returns its address */
+    T *get()
+    {
+        if (m_available.empty()) {
+            allocatePage();
+        }
+
+        Page *page = m_available.back();
+        uint32_t slot = page->freeSlots.back();
+        page->freeSlots.pop_back();
+        if (page->used++ == 0) {
+            m_emptyPages--;
+        }
+        if (page->freeSlots.empty()) {
+            removeAvailable(page);
+        }
+        m_size++;
+
+        return new (&page->blocks[slot]) T();
+    }
+
+    /* Destroy an object returned by get(). The page of the object is released if it becomes empty and another page is empty */
+    void remove(T *t)
+    {
+        Page *page = findPage(t);
+        assert(page != nullptr);
+
+        t->~T();
+
+        uint32_t slot = static_cast<uint32_t>(reinterpret_cast<Block *>(t) - page->blocks.get());
+        if (page->freeSlots.empty()) {
+            addAvailable(page);
+        }
+        page->freeSlots.push_back(slot);
+        page->used--;
+        m_size--;
+
+        if (page->used == 0) {
+            if (m_emptyPages > 0) {
+                releasePage(page);
+            } else {
+                m_emptyPages++;
+            }
+        }
+    }
+
+    /* Allocate pages until n more objects can be constructed without allocating */
+    void reserve(uint32_t n)
+    {
+        while (static_cast<uint32_t>(m_pages.size()) * m_pageSize - m_size < n) {
+            allocatePage();
+        }
+    }
+
+    /* Destroy all objects and release all pages */
+    void reset()
+    {
+        for (auto &itr : m_pages) {
+            Page *page = itr.second.get();
+
+            /* Objects in free slots are already destroyed */
+            std::vector<bool> isFree(m_pageSize, false);
+            for (uint32_t slot : page->freeSlots) {
+                isFree[slot] = true;
+            }
+            for (uint32_t slot = 0; slot < m_pageSize; slot++) {
+                if (!isFree[slot]) {
+                    reinterpret_cast<T *>(&page->blocks[slot])->~T();
+                }
+            }
+        }
+
+        m_pages.clear();
+        m_available.clear();
+        m_size = 0;
+        m_emptyPages = 0;
+    }
+
+    uint32_t size() const { return m_size; }
+    uint32_t pageSize() const { return m_pageSize; }
+
+    PagedPoolOccupancy occupancy() const
+    {
+        PagedPoolOccupancy occupancy;
+        occupancy.size = m_size;
+        occupancy.pages = static_cast<uint32_t>(m_pages.size());
+        occupancy.capacity = occupancy.pages * m_pageSize;
+        occupancy.bytes = static_cast<size_t>(occupancy.capacity) * sizeof(Block);
+        return occupancy;
+    }
+
+private:
+    struct Block {
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    static constexpr uint32_t NOT_AVAILABLE = ~0u;
+
+    struct Page {
+        std::unique_ptr<Block[]> blocks;
+        std::vector<uint32_t> freeSlots;
+        uint32_t used = 0;
+        /* Index in m_available, NOT_AVAILABLE if the page is full */
+        uint32_t availableIndex = NOT_AVAILABLE;
+    };
+
+    uint32_t m_pageSize;
+    uint32_t m_size = 0;
+    /* Number of allocated pages without objects */
+    uint32_t m_emptyPages = 0;
+
+    /* Pages, keyed by the address of their first block */
+    std::map<const Block *, std::unique_ptr<Page>> m_pages;
+    /* Pages with at least one free slot */
+    std::vector<Page *> m_available;
+
+    void allocatePage()
+    {
+        auto page = std::make_unique<Page>();
+        page->blocks = std::make_unique<Block[]>(m_pageSize);
+        page->freeSlots.resize(m_pageSize);
+        /* Hand out slots in address order */
+        for (uint32_t i = 0; i < m_pageSize; i++) {
+            page->freeSlots[i] = m_pageSize - 1 - i;
+        }
+
+        addAvailable(page.get());
+        m_pages.insert({page->blocks.get(), std::move(page)});
+        m_emptyPages++;
+    }
+
+    void releasePage(Page *page)
+    {
+        assert(page->used == 0);
+        removeAvailable(page);
+        m_pages.erase(page->blocks.get());
+    }
+
+    void addAvailable(Page *page)
+    {
+        assert(page->availableIndex == NOT_AVAILABLE);
+        page->availableIndex = static_cast<uint32_t>(m_available.size());
+        m_available.push_back(page);
+    }
+
+    /* Remove a page from m_available in constant time, the last available page takes its place */
+    void removeAvailable(Page *page)
+    {
+        uint32_t index = page->availableIndex;
+        assert(index < m_available.size() && m_available[index] == page);
+
+        Page *last = m_available.back();
+        m_available[index] = last;
+        last->availableIndex = index;
+        m_available.pop_back();
+        page->availableIndex = NOT_AVAILABLE;
+    }
+
+    Page *findPage(const T *t) const
+    {
+        const Block *block = reinterpret_cast<const Block *>(t);
+
+        /* The page is the last one that starts at or before the block */
+        auto itr = m_pages.upper_bound(block);
+        if (itr == m_pages.begin()) {
+            return nullptr;
+        }
+        --itr;
+
+        if (!std::less<const Block *>()(block, itr->first + m_pageSize)) {
+            return nullptr;
+        }
+        return itr->second.get();
+    }
+};
+
+}  // namespace vengine
+
+#endif
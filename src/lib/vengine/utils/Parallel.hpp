@@ -0,0 +1,215 @@
+#ifndef __Parallel_hpp__
+#define __Parallel_hpp__
+
+#include <algorithm>
+#include <cstdint>
+
+#include "ThreadPool.hpp"
+
+namespace vengine
+{
+
+/* Number of chunks per worker thread a range is split into when the grain size is computed automatically */
+static constexpr uint32_t PARALLEL_CHUNKS_PER_THREAD = 8;
+
+/**
+ * @brief Get the number of indices each task processes for a range of size n. The range is split into a few chunks per
+ * worker thread, but a chunk is never smaller than minGrain
+ *
+ * @param threadPool
+ * @param n Size of the range
+ * @param minGrain Minimum number of indices a task processes
+ * @return The grain size
+ */
+inline uint32_t parallelGrain(ThreadPool &threadPool, uint32_t n, uint32_t minGrain)
+{
+    uint32_t chunks = std::max(threadPool.threads(), 1U) * PARALLEL_CHUNKS_PER_THREAD;
+    return std::max({n / chunks, minGrain, 1U});
+}
+
+template <typename F>
+void parallelForRange(ThreadPool &threadPool, uint32_t begin, uint32_t end, uint32_t grain, const F &f);
+
+template <typename T, typename Map, typename Reduce>
+T parallelReduceRange(ThreadPool &threadPool,
+                      uint32_t begin,
+                      uint32_t end,
+                      uint32_t grain,
+                      const T &identity,
+                      const Map &map,
+                      const Reduce &reduce);
+
+/* Task that processes the right half of a split parallelFor range. It lives on the stack of the thread that split it */
+template <typename F>
+class ParallelForTask : public Task
+{
+public:
+    ParallelForTask(ThreadPool &threadPool, uint32_t begin, uint32_t end, uint32_t grain, const F &f)
+        : m_pool(threadPool)
+        , m_begin(begin)
+        , m_end(end)
+        , m_grain(grain)
+        , m_f(f){};
+
+    bool work(float &progress) override
+    {
+        parallelForRange(m_pool, m_begin, m_end, m_grain, m_f);
+        return true;
+    }
+
+private:
+    ThreadPool &m_pool;
+    uint32_t m_begin, m_end, m_grain;
+    const F &m_f;
+};
+
+/* Task that reduces the right half of a split parallelReduce range. It lives on the stack of the thread that split it */
+template <typename T, typename Map, typename Reduce>
+class ParallelReduceTask : public Task
+{
+public:
+    ParallelReduceTask(ThreadPool &threadPool,
+                       uint32_t begin,
+                       uint32_t end,
+                       uint32_t grain,
+                       const T &identity,
+                       const Map &map,
+                       const Reduce &reduce)
+        : m_pool(threadPool)
+        , m_begin(begin)
+        , m_end(end)
+        , m_grain(grain)
+        , m_identity(identity)
+        , m_map(map)
+        , m_reduce(reduce)
+        , m_result(identity){};
+
+    bool work(float &progress) override
+    {
+        m_result = parallelReduceRange(m_pool, m_begin, m_end, m_grain, m_identity, m_map, m_reduce);
+        return true;
+    }
+
+    T &result() { return m_result; }
+
+private:
+    ThreadPool &m_pool;
+    uint32_t m_begin, m_end, m_grain;
+    const T &m_identity;
+    const Map &m_map;
+    const Reduce &m_reduce;
+    T m_result;
+};
+
+/**
+ * @brief Split [begin, end) in halves until the pieces are not larger than grain. The right half of every split is pushed
+ * to the thread pool while the calling thread continues with the left half, and then helps the pool until the right half
+ * is done. The tasks live on the stack, so no memory is allocated
+ */
+template <typename F>
+void parallelForRange(ThreadPool &threadPool, uint32_t begin, uint32_t end, uint32_t grain, const F &f)
+{
+    if (end - begin <= grain) {
+        f(begin, end);
+        return;
+    }
+
+    uint32_t middle = begin + (end - begin) / 2;
+
+    ParallelForTask<F> right(threadPool, middle, end, grain, f);
+    threadPool.push(&right);
+
+    parallelForRange(threadPool, begin, middle, grain, f);
+
+    right.wait();
+}
+
+template <typename T, typename Map, typename Reduce>
+T parallelReduceRange(ThreadPool &threadPool,
+                      uint32_t begin,
+                      uint32_t end,
+                      uint32_t grain,
+                      const T &identity,
+                      const Map &map,
+                      const Reduce &reduce)
+{
+    if (end - begin <= grain) {
+        return map(begin, end);
+    }
+
+    uint32_t middle = begin + (end - begin) / 2;
+
+    ParallelReduceTask<T, Map, Reduce> right(threadPool, middle, end, grain, identity, map, reduce);
+    threadPool.push(&right);
+
+    T left = parallelReduceRange(threadPool, begin, middle, grain, identity, map, reduce);
+
+    right.wait();
+    return reduce(left, right.result());
+}
+
+/**
+ * @brief Run f(chunkBegin, chunkEnd) over chunks of the range [begin, end) on the thread pool and wait for all of them. The
+ * calling thread takes part in the work, so it's safe to call from inside a task. Ranges that fit in a single chunk, or a
+ * thread pool that is not initialized, run inline without touching the pool
+ *
+ * @param threadPool
+ * @param begin First index of the range
+ * @param end One past the last index of the range
+ * @param minGrain Minimum number of indices a chunk processes. The actual chunk size is computed from the size of the range
+ * and the number of threads
+ * @param f Function called as f(uint32_t chunkBegin, uint32_t chunkEnd)
+ */
+template <typename F>
+void parallelFor(ThreadPool &threadPool, uint32_t begin, uint32_t end, uint32_t minGrain, const F &f)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    uint32_t grain = parallelGrain(threadPool, end - begin, minGrain);
+    if (threadPool.threads() == 0) {
+        grain = end - begin;
+    }
+
+    parallelForRange(threadPool, begin, end, grain, f);
+}
+
+/**
+ * @brief Reduce the range [begin, end) on the thread pool. Every chunk is mapped to a value with map(chunkBegin, chunkEnd)
+ * and the chunk values are combined with reduce(T a, T b). Chunks are always combined in the same order for a given range
+ * and thread count, but the grouping depends on the chunk size, so reduce should be associative
+ *
+ * @param threadPool
+ * @param begin First index of the range
+ * @param end One past the last index of the range
+ * @param minGrain Minimum number of indices a chunk processes
+ * @param identity The value returned for an empty range
+ * @param map Function called as T map(uint32_t chunkBegin, uint32_t chunkEnd)
+ * @param reduce Function called as T reduce(const T &a, const T &b)
+ * @return The reduced value
+ */
+template <typename T, typename Map, typename Reduce>
+T parallelReduce(ThreadPool &threadPool,
+                 uint32_t begin,
+                 uint32_t end,
+                 uint32_t minGrain,
+                 const T &identity,
+                 const Map &map,
+                 const Reduce &reduce)
+{
+    if (end <= begin) {
+        return identity;
+    }
+
+    uint32_t grain = parallelGrain(threadPool, end - begin, minGrain);
+    if (threadPool.threads() == 0) {
+        grain = end - begin;
+    }
+
+    return parallelReduceRange(threadPool, begin, end, grain, identity, map, reduce);
+}
+
+}  // namespace vengine
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef __RadixSort_hpp__
+#define __RadixSort_hpp__
+
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+#include "Parallel.hpp"
+
+namespace vengine
+{
+
+/**
+ * @brief A stable least significant digit radix sort of values by 32 bit unsigned keys, one byte per pass. The keys are split
+ * in chunks that are histogrammed and scattered in parallel, passes where all keys have the same digit are skipped. The
+ * scratch buffers are kept between calls
+ *
+ * @tparam T Type of the values
+ */
+template <typename T>
+class RadixSorter
+{
+public:
+    /* Minimum number of keys per chunk */
+    static constexpr uint32_t MIN_GRAIN = 8192;
+
+    /**
+     * @brief Sort keys in ascending order and move the values with them
+     *
+     * @param keys Sorted in place
+     * @param values Same size as keys, sorted in place
+     * @param threadPool Used to process the chunks in parallel
+     */
+    void sort(std::vector<uint32_t> &keys, std::vector<T> &values, ThreadPool &threadPool)
+    {
+        assert(keys.size() == values.size());
+
+        uint32_t n = static_cast<uint32_t>(keys.size());
+        if (n < 2)
+            return;
+
+        uint32_t grain = (threadPool.threads() == 0 ? n : parallelGrain(threadPool, n, MIN_GRAIN));
+        uint32_t nChunks = (n + grain - 1) / grain;
+        m_histograms.resize(nChunks * RADIX);
+        m_keys.resize(n);
+        m_values.resize(n);
+
+        for (uint32_t shift = 0; shift < 32; shift += BITS) {
+            /* Count the digits of every chunk */
+            parallelFor(threadPool, 0, nChunks, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+                for (uint32_t c = chunkBegin; c < chunkEnd; c++) {
+                    uint32_t *histogram = &m_histograms[c * RADIX];
+                    std::fill(histogram, histogram + RADIX, 0);
+                    for (uint32_t i = c * grain; i < std::min(n, (c + 1) * grain); i++) {
+                        histogram[(keys[i] >> shift) & MASK]++;
+                    }
+                }
+            });
+
+            /* Skip the pass if all keys have the same digit */
+            uint32_t digit = (keys[0] >> shift) & MASK;
+            uint32_t count = 0;
+            for (uint32_t c = 0; c < nChunks; c++) {
+                count += m_histograms[c * RADIX + digit];
+            }
+            if (count == n)
+                continue;
+
+            /* Turn the counts to output offsets, digit major so that the sort is stable across chunks */
+            uint32_t offset = 0;
+            for (uint32_t d = 0; d < RADIX; d++) {
+                for (uint32_t c = 0; c < nChunks; c++) {
+                    uint32_t chunkCount = m_histograms[c * RADIX + d];
+                    m_histograms[c * RADIX + d] = offset;
+                    offset += chunkCount;
+                }
+            }
+
+            parallelFor(threadPool, 0, nChunks, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+                for (uint32_t c = chunkBegin; c < chunkEnd; c++) {
+                    uint32_t *offsets = &m_histograms[c * RADIX];
+                    for (uint32_t i = c * grain; i < std::min(n, (c + 1) * grain); i++) {
+                        uint32_t o = offsets[(keys[i] >> shift) & MASK]++;
+                        m_keys[o] = keys[i];
+                        m_values[o] = values[i];
+                    }
+                }
+            });
+
+            keys.swap(m_keys);
+            values.swap(m_values);
+        }
+    }
+
+private:
+    static constexpr uint32_t BITS = 8;
+    static constexpr uint32_t RADIX = 1U << BITS;
+    static constexpr uint32_t MASK = RADIX - 1;
+
+    /* Per chunk digit counts, then output offsets */
+    std::vector<uint32_t> m_histograms;
+    std::vector<uint32_t> m_keys;
+    std::vector<T> m_values;
+};
+
+}  // namespace vengine
+
+#endif
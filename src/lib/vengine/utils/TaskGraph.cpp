@@ -0,0 +1,151 @@
+#include "TaskGraph.hpp"
+
+#include <cassert>
+
+namespace vengine
+{
+
+TaskGraph::JobTask::JobTask(TaskGraph &graph, JobID id, Task *root)
+    : Task(root)
+    , m_graph(graph)
+    , m_id(id)
+    , m_remainingDependencies(graph.m_jobs[id].nDependencies)
+{
+}
+
+void TaskGraph::JobTask::reset()
+{
+    Task::reset();
+    m_remainingDependencies.store(m_graph.m_jobs[m_id].nDependencies, std::memory_order_relaxed);
+}
+
+bool TaskGraph::JobTask::work(float &progress)
+{
+    Job &job = m_graph.m_jobs[m_id];
+    job.function();
+
+    /* Successors are pushed before this task signals the root, so the root can't become ready in between */
+    for (JobID successor : job.successors) {
+        JobTask &task = m_graph.m_tasks[successor];
+        if (task.dependencyFinished()) {
+            m_graph.m_threadPool->push(&task);
+        }
+    }
+
+    return true;
+}
+
+bool TaskGraph::RootTask::work(float &progress)
+{
+    for (JobID id = 0; id < m_graph.m_jobs.size(); id++) {
+        if (m_graph.m_jobs[id].nDependencies == 0) {
+            m_graph.m_threadPool->push(&m_graph.m_tasks[id]);
+        }
+    }
+
+    return true;
+}
+
+TaskGraph::JobID TaskGraph::addJob(const std::string &name, std::function<void()> function, const std::vector<JobID> &dependencies)
+{
+    assert(!m_executing);
+    m_tasksValid = false;
+
+    JobID id = static_cast<JobID>(m_jobs.size());
+
+    Job job;
+    job.name = name;
+    job.function = function;
+    job.nDependencies = static_cast<uint32_t>(dependencies.size());
+    m_jobs.push_back(job);
+
+    for (JobID dependency : dependencies) {
+        assert(dependency < id);
+        m_jobs[dependency].successors.push_back(id);
+    }
+
+    return id;
+}
+
+bool TaskGraph::dependsOn(JobID job, JobID dependency) const
+{
+    assert(job < m_jobs.size() && dependency < m_jobs.size());
+
+    if (dependency >= job) {
+        return false;
+    }
+
+    /* Successors always have larger ids, so only the jobs between the two can be on a path */
+    std::vector<bool> reached(job - dependency + 1, false);
+    reached[0] = true;
+    for (JobID id = dependency; id < job; id++) {
+        if (!reached[id - dependency]) {
+            continue;
+        }
+        for (JobID successor : m_jobs[id].successors) {
+            if (successor <= job) {
+                reached[successor - dependency] = true;
+            }
+        }
+    }
+
+    return reached[job - dependency];
+}
+
+void TaskGraph::clear()
+{
+    assert(!m_executing);
+
+    m_jobs.clear();
+    m_tasks.clear();
+    m_tasksValid = false;
+}
+
+void TaskGraph::execute(ThreadPool &threadPool)
+{
+    assert(!m_executing);
+
+    if (threadPool.threads() == 0) {
+        for (Job &job : m_jobs) {
+            job.function();
+        }
+        return;
+    }
+
+    m_threadPool = &threadPool;
+    m_executing = true;
+
+    /* The tasks of the previous execution are reused, they are only created again after the jobs change */
+    if (m_root == nullptr) {
+        m_root = std::make_unique<RootTask>(*this);
+    } else {
+        m_root->reset();
+    }
+    if (!m_tasksValid) {
+        m_tasks.clear();
+        for (JobID id = 0; id < m_jobs.size(); id++) {
+            m_tasks.emplace_back(*this, id, m_root.get());
+        }
+        m_tasksValid = true;
+    } else {
+        for (JobTask &task : m_tasks) {
+            task.reset();
+        }
+    }
+
+    threadPool.push(m_root.get());
+}
+
+void TaskGraph::wait()
+{
+    if (!m_executing) {
+        return;
+    }
+
+    m_root->wait();
+
+    m_executing = false;
+    m_threadPool = nullptr;
+}
+
+}  // namespace vengine
@@ -0,0 +1,125 @@
+#ifndef __TaskGraph_hpp__
+#define __TaskGraph_hpp__
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "ThreadPool.hpp"
+
+namespace vengine
+{
+
+/**
+ * @brief A graph of jobs with explicit dependencies. The graph is declared once and can be executed on a thread pool many
+ * times. A job is pushed to the thread pool as soon as all the jobs it depends on have finished, so independent jobs run
+ * in parallel
+ */
+class TaskGraph
+{
+public:
+    typedef uint32_t JobID;
+
+    TaskGraph(){};
+
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+    /**
+     * @brief Add a job to the graph. A job can only depend on jobs that were added before it, so the graph can't have cycles
+     *
+     * @param name The name of the job
+     * @param function The job work
+     * @param dependencies The jobs that have to finish before this one starts
+     * @return The id of the new job
+     */
+    JobID addJob(const std::string &name, std::function<void()> function, const std::vector<JobID> &dependencies = {});
+
+    /**
+     * @brief Check if a job can only start after another job has finished, either directly or through other jobs
+     *
+     * @param job
+     * @param dependency
+     * @return True if there is a path of dependencies from dependency to job
+     */
+    bool dependsOn(JobID job, JobID dependency) const;
+
+    /* Remove all jobs. Don't call while the graph is executing */
+    void clear();
+
+    uint32_t size() const { return static_cast<uint32_t>(m_jobs.size()); }
+    const std::string &jobName(JobID id) const { return m_jobs[id].name; }
+
+    /**
+     * @brief Start executing all jobs on the thread pool. The graph can't be modified or executed again until wait() returns.
+     * If the thread pool is not initialized, the jobs run inline in the order they were added
+     *
+     * @param threadPool
+     */
+    void execute(ThreadPool &threadPool);
+
+    /* Wait for a started execution to finish. The calling thread runs pending tasks of the thread pool while waiting */
+    void wait();
+
+private:
+    struct Job {
+        std::string name;
+        std::function<void()> function;
+        std::vector<JobID> successors;
+        uint32_t nDependencies = 0;
+    };
+
+    /* Runs a job and pushes the successors whose dependencies have all finished */
+    class JobTask : public Task
+    {
+    public:
+        JobTask(TaskGraph &graph, JobID id, Task *root);
+
+        bool work(float &progress) override;
+
+        /* Prepare for the next execution */
+        void reset();
+
+        /* Decrease the number of unfinished dependencies, returns true if this was the last one */
+        bool dependencyFinished() { return m_remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    private:
+        TaskGraph &m_graph;
+        JobID m_id;
+        std::atomic<uint32_t> m_remainingDependencies;
+    };
+
+    /* Pushes the jobs without dependencies. All job tasks are its children, so it's ready when the whole graph has finished */
+    class RootTask : public Task
+    {
+    public:
+        RootTask(TaskGraph &graph)
+            : m_graph(graph){};
+
+        bool work(float &progress) override;
+
+        /* Prepare for the next execution */
+        void reset() { Task::reset(); }
+
+    private:
+        TaskGraph &m_graph;
+    };
+
+    std::vector<Job> m_jobs;
+
+    /* Tasks of the jobs, created on the first execution after the jobs change and reset for the next ones */
+    std::unique_ptr<RootTask> m_root;
+    std::deque<JobTask> m_tasks;
+    bool m_tasksValid = false;
+
+    /* State of the current execution */
+    ThreadPool *m_threadPool = nullptr;
+    bool m_executing = false;
+};
+
+}  // namespace vengine
+
+#endif
@@ -0,0 +1,122 @@
+#include "Tasks.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include "ThreadPool.hpp"
+
+namespace vengine
+{
+
+std::atomic<uint32_t> Waitable::s_parkedWaiters = 0;
+std::atomic<uint32_t> Waitable::s_readyEpoch = 0;
+
+/* Marks the continuation list of a waitable that became ready */
+static Task *const CONTINUATIONS_CLOSED = reinterpret_cast<Task *>(static_cast<uintptr_t>(1));
+
+void Waitable::wait()
+{
+    if (isReady())
+        return;
+
+    if (m_threadPool != nullptr) {
+        m_threadPool->helpUntilReady(this);
+        return;
+    }
+
+    park();
+}
+
+Waitable *Waitable::then(Task *continuation)
+{
+    Task *head = m_continuations.load(std::memory_order_acquire);
+    do {
+        if (head == CONTINUATIONS_CLOSED) {
+            /* Already ready, schedule it now */
+            schedule(m_threadPool, continuation);
+            return continuation;
+        }
+        continuation->m_nextContinuation = head;
+    } while (!m_continuations.compare_exchange_weak(head, continuation, std::memory_order_acq_rel, std::memory_order_acquire));
+
+    return continuation;
+}
+
+void Waitable::signalReady()
+{
+    if (m_signalCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    /* Read everything we need first, this object may be destroyed as soon as it's marked ready */
+    Waitable *parent = m_parent;
+    ThreadPool *threadPool = m_threadPool;
+    Task *continuation = m_continuations.exchange(CONTINUATIONS_CLOSED, std::memory_order_acq_rel);
+
+    m_ready.store(true);
+
+    /* Schedule continuations */
+    while (continuation != nullptr) {
+        Task *next = continuation->m_nextContinuation;
+        schedule(threadPool, continuation);
+        continuation = next;
+    }
+
+    /* Wake up parked waiters, if any */
+    if (s_parkedWaiters.load() > 0) {
+        s_readyEpoch.fetch_add(1);
+        s_readyEpoch.notify_all();
+    }
+
+    // notify parent task if you have one
+    if (parent != nullptr)
+        parent->signalReady();
+}
+
+void Waitable::reset()
+{
+    assert(isReady());
+
+    m_signalCount.store(1, std::memory_order_relaxed);
+    m_continuations.store(nullptr, std::memory_order_relaxed);
+    m_threadPool = nullptr;
+    m_ready.store(false, std::memory_order_release);
+}
+
+void Task::reset()
+{
+    Waitable::reset();
+
+    m_progress = 0.0F;
+    m_started = false;
+    m_finished = false;
+    m_success = false;
+    m_nextContinuation = nullptr;
+}
+
+void Waitable::schedule(ThreadPool *threadPool, Task *continuation)
+{
+    if (threadPool != nullptr) {
+        threadPool->push(continuation);
+        return;
+    }
+
+    /* Not pushed to a thread pool, run it inline. The parent counts it as a child like push would */
+    if (continuation->parent() != nullptr)
+        continuation->parent()->increaseSignalCount();
+    continuation->run();
+    continuation->signalReady();
+}
+
+void Waitable::park()
+{
+    s_parkedWaiters.fetch_add(1);
+    while (!m_ready.load()) {
+        uint32_t epoch = s_readyEpoch.load();
+        if (m_ready.load())
+            break;
+        s_readyEpoch.wait(epoch);
+    }
+    s_parkedWaiters.fetch_sub(1);
+}
+
+}  // namespace vengine
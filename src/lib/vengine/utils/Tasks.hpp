@@ -2,13 +2,19 @@
 #define __Tasks_hpp__
 
 #include <functional>
-#include <mutex>
 #include <iostream>
-#include <condition_variable>
+#include <atomic>
 
 namespace vengine
 {
 
+class ThreadPool;
+class Task;
+
+/**
+ * @brief An atomic dependency counter. The counter starts at one for the waitable itself and is increased by one for each
+ * child pushed with this as a parent. The waitable becomes ready when the counter reaches zero
+ */
 class Waitable
 {
     friend class ThreadPool;
@@ -18,8 +24,6 @@ public:
         : m_parent(nullptr)
         , m_signalCount(1)
     {
-        m_waitLock = std::make_unique<std::mutex>();
-        m_waitCondition = std::make_unique<std::condition_variable>();
     }
 
     /**
@@ -32,55 +36,75 @@ public:
         : m_parent(parent)
         , m_signalCount(1)
     {
-        m_waitLock = std::make_unique<std::mutex>();
-        m_waitCondition = std::make_unique<std::condition_variable>();
     }
 
-    /* Wait for signal ready, don't use this object after the wait finishes */
-    void wait()
+    /* Only waitables that haven't been pushed yet can be moved */
+    Waitable(Waitable &&other) noexcept
+        : m_parent(other.m_parent)
+        , m_signalCount(other.m_signalCount.load())
+        , m_ready(other.m_ready.load())
+        , m_continuations(other.m_continuations.load())
+        , m_threadPool(other.m_threadPool)
     {
-        std::unique_lock<std::mutex> lock(*m_waitLock);
+    }
+    Waitable(const Waitable &) = delete;
+    Waitable &operator=(const Waitable &) = delete;
 
-        if (m_signalCount == 0)
-            return;
+    /**
+     * @brief Wait for signal ready, don't use this object after the wait finishes unless it's reset. If the waitable was pushed to a thread pool,
+     * the calling thread runs pending tasks of that pool while waiting and only parks when there is nothing to run
+     */
+    void wait();
 
-        m_waitCondition->wait(lock, [&]() { return m_signalCount == 0; });
-    }
+    /* Check if the waitable and all its children have finished */
+    bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Push a task to the thread pool when this waitable becomes ready. If it's already ready, the task is pushed
+     * immediately. If the waitable was never pushed to a thread pool, the task runs inline on the thread that makes it ready,
+     * or on the calling thread if it's already ready
+     *
+     * @param continuation
+     * @return The continuation task
+     */
+    Waitable *then(Task *continuation);
+
+protected:
+    /* Make a waitable that became ready pushable again, keeping its parent. Nothing may wait on it or signal it anymore */
+    void reset();
 
 private:
-    std::unique_ptr<std::mutex> m_waitLock;
-    std::unique_ptr<std::condition_variable> m_waitCondition;
-    uint32_t m_signalCount = 1;
     Waitable *m_parent = nullptr;
+    std::atomic<uint32_t> m_signalCount = 1;
+    /* Set once the counter reached zero and the continuation list was closed, but before the continuations are pushed and the
+     * parent is signaled. Waiters may destroy the object as soon as it's set, so nothing of it is touched after that */
+    std::atomic<bool> m_ready = false;
+    /* Intrusive list of continuation tasks, set to a sentinel value once the waitable is ready */
+    std::atomic<Task *> m_continuations = nullptr;
+    /* The thread pool this waitable was pushed to */
+    ThreadPool *m_threadPool = nullptr;
+
+    /* Global parking spot for waiters that have nothing to run */
+    static std::atomic<uint32_t> s_parkedWaiters;
+    static std::atomic<uint32_t> s_readyEpoch;
 
     Waitable *parent() { return m_parent; }
 
-    void signalReady()
-    {
-        std::lock_guard<std::mutex> lock(*m_waitLock);
-        m_signalCount--;
+    void signalReady();
 
-        if (m_signalCount != 0)
-            return;
+    void increaseSignalCount() { m_signalCount.fetch_add(1, std::memory_order_relaxed); }
 
-        // notify parent task if you have one
-        if (m_parent != nullptr)
-            m_parent->signalReady();
-
-        // notify waiters as well
-        m_waitCondition->notify_all();
-    }
+    /* Block until signal ready */
+    void park();
 
-    void increaseSignalCount()
-    {
-        std::lock_guard<std::mutex> lock(*m_waitLock);
-        m_signalCount++;
-    }
+    /* Push a continuation to a thread pool, or run it inline if there is none */
+    static void schedule(ThreadPool *threadPool, Task *continuation);
 };
 
 class Task : public Waitable
 {
     friend class ThreadPool;
+    friend class Waitable;
 
 public:
     Task()
@@ -110,12 +134,20 @@ public:
 protected:
     float m_progress = 0.0F;
 
+    /* Make a finished task pushable again, see Waitable::reset() */
+    void reset();
+
 private:
     bool m_started = false;
     bool m_finished = false;
     bool m_success = false;
+
+    /* Next task in the continuation list of a waitable */
+    Task *m_nextContinuation = nullptr;
+    /* Time the task was pushed to a thread pool, in nanoseconds of the steady clock */
+    uint64_t m_pushTime = 0;
 };
 
 }  // namespace vengine
 
-#endif
\ No newline at end of file
+#endif
@@ -2,13 +2,104 @@
 
 #include "debug_tools/Console.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
+#include <bit>
 
 namespace vengine
 {
 
-ThreadPool::WorkerThread::WorkerThread(ThreadPool &threadpool)
-    : m_threadpool(threadpool){};
+/* The pool and the worker index of the current thread, if the current thread is a pool worker */
+static thread_local ThreadPool *t_threadPool = nullptr;
+static thread_local uint32_t t_workerIndex = 0;
+
+/* Nesting level of the task the current thread runs, and the time it spent parked inside the outermost task */
+static thread_local uint32_t t_executeDepth = 0;
+static thread_local uint64_t t_parkedInTask = 0;
+
+/* Times a waiting thread that has nothing to run yields before parking */
+static constexpr uint32_t HELP_IDLE_SPINS = 64;
+
+static uint64_t now()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void ThreadPool::WorkerCounters::addLatency(uint64_t latency)
+{
+    latencyTime.fetch_add(latency, std::memory_order_relaxed);
+
+    uint32_t bucket = static_cast<uint32_t>(std::bit_width(latency / 1000));
+    latencyHistogram[std::min(bucket, THREADPOOL_LATENCY_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::WorkerCounters::updateMaxQueueDepth(uint32_t depth)
+{
+    uint32_t current = maxQueueDepth.load(std::memory_order_relaxed);
+    while (depth > current && !maxQueueDepth.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
+
+ThreadPoolWorkerStatistics ThreadPool::WorkerCounters::snapshot() const
+{
+    ThreadPoolWorkerStatistics s;
+    s.tasksExecuted = tasksExecuted.load(std::memory_order_relaxed);
+    s.busyTime = busyTime.load(std::memory_order_relaxed);
+    s.parkedTime = parkedTime.load(std::memory_order_relaxed);
+    s.latencyTime = latencyTime.load(std::memory_order_relaxed);
+    s.maxQueueDepth = maxQueueDepth.load(std::memory_order_relaxed);
+    for (uint32_t b = 0; b < THREADPOOL_LATENCY_BUCKETS; b++) {
+        s.latencyHistogram[b] = latencyHistogram[b].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void ThreadPool::WorkerCounters::reset()
+{
+    tasksExecuted = 0;
+    busyTime = 0;
+    parkedTime = 0;
+    latencyTime = 0;
+    maxQueueDepth = 0;
+    for (auto &count : latencyHistogram) {
+        count = 0;
+    }
+}
+
+uint32_t ThreadPool::TaskDeque::push(Task *task)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_tasks.push_back(task);
+    return static_cast<uint32_t>(m_tasks.size());
+}
+
+Task *ThreadPool::TaskDeque::pop()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_tasks.empty())
+        return nullptr;
+
+    Task *task = m_tasks.back();
+    m_tasks.pop_back();
+    return task;
+}
+
+Task *ThreadPool::TaskDeque::steal()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_tasks.empty())
+        return nullptr;
+
+    Task *task = m_tasks.front();
+    m_tasks.pop_front();
+    return task;
+}
+
+ThreadPool::WorkerThread::WorkerThread(ThreadPool &threadpool, uint32_t index)
+    : m_threadpool(threadpool)
+    , m_index(index){};
 
 ThreadPool::~ThreadPool()
 {
@@ -18,34 +109,29 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::WorkerThread::loop()
 {
+    t_threadPool = &m_threadpool;
+    t_workerIndex = m_index;
+
     while (1) {
-        /* Acquire lock */
-        std::unique_lock<std::mutex> lock(m_threadpool.m_lock);
+        Task *task = m_threadpool.findTask(m_index);
+        if (task != nullptr) {
+            m_threadpool.execute(task, m_index);
+            continue;
+        }
 
-        /* Wait for work */
-        m_threadpool.m_condition.wait(lock, [&]() { return !m_threadpool.m_tasks.empty() || !m_threadpool.m_run; });
+        /* No work found, park until something is pushed */
+        std::unique_lock<std::mutex> lock(m_threadpool.m_lock);
+        uint64_t parkStart = now();
+        m_threadpool.m_sleeping++;
+        m_threadpool.m_condition.wait(lock, [&]() { return m_threadpool.m_pending > 0 || !m_threadpool.m_run; });
+        m_threadpool.m_sleeping--;
+        m_counters.parkedTime.fetch_add(now() - parkStart, std::memory_order_relaxed);
 
         /* Exit if no work and exit is requested */
-        if (m_threadpool.m_tasks.empty() && !m_threadpool.m_run) {
+        if (m_threadpool.m_pending == 0 && !m_threadpool.m_run) {
             lock.unlock();
             return;
         }
-
-        /* Ignore if tasks empty */
-        if (m_threadpool.m_tasks.empty()) {
-            lock.unlock();
-            continue;
-        }
-
-        /* Get a task */
-        Task *task = m_threadpool.m_tasks.front();
-        m_threadpool.m_tasks.pop();
-
-        /* Unlock and run task */
-        lock.unlock();
-
-        task->run();
-        task->signalReady();
     }
 }
 
@@ -53,9 +139,14 @@ bool ThreadPool::init(uint32_t numThreads)
 {
     m_run = true;
     for (uint32_t i = 0; i < numThreads; i++) {
-        m_workerThreads.push_back(std::thread(&WorkerThread::loop, new WorkerThread(*this)));
+        m_workers.push_back(std::make_unique<WorkerThread>(*this, i));
+    }
+    for (uint32_t i = 0; i < numThreads; i++) {
+        m_workerThreads.push_back(std::thread(&WorkerThread::loop, m_workers[i].get()));
     }
 
+    m_statisticsStart.store(now(), std::memory_order_relaxed);
+
     m_initialized = true;
     return m_initialized;
 }
@@ -68,9 +159,22 @@ Waitable *ThreadPool::push(Task *task)
     if (task->parent() != nullptr)
         task->parent()->increaseSignalCount();
 
-    std::lock_guard<std::mutex> lock(m_lock);
-    m_tasks.push(task);
-    m_condition.notify_one();
+    task->m_threadPool = this;
+    task->m_pushTime = now();
+
+    /* Tasks pushed by a worker go to its own deque, the rest are spread over all workers */
+    uint32_t queueIndex;
+    if (t_threadPool == this) {
+        queueIndex = t_workerIndex;
+    } else {
+        queueIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % threads();
+    }
+
+    m_pending++;
+    uint32_t depth = m_workers[queueIndex]->tasks().push(task);
+    m_workers[queueIndex]->counters().updateMaxQueueDepth(depth);
+
+    notifyWorker();
 
     return task;
 }
@@ -91,6 +195,9 @@ void ThreadPool::stop()
     for (std::vector<std::thread>::iterator itr = m_workerThreads.begin(); itr != m_workerThreads.end(); itr++)
         itr->join();
 
+    m_workerThreads.clear();
+    m_workers.clear();
+
     m_initialized = false;
     return;
 }
@@ -100,4 +207,132 @@ uint32_t ThreadPool::threads()
     return static_cast<uint32_t>(m_workerThreads.size());
 }
 
-}  // namespace vengine
\ No newline at end of file
+ThreadPoolStatistics ThreadPool::statistics() const
+{
+    ThreadPoolStatistics statistics;
+    for (const std::unique_ptr<WorkerThread> &worker : m_workers) {
+        statistics.workers.push_back(worker->counters().snapshot());
+    }
+    statistics.workers.push_back(m_externalCounters.snapshot());
+
+    uint64_t start = m_statisticsStart.load(std::memory_order_relaxed);
+    uint64_t end = now();
+    statistics.elapsedTime = end - std::min(end, start);
+    statistics.pendingTasks = m_pending;
+
+    return statistics;
+}
+
+void ThreadPool::resetStatistics()
+{
+    for (std::unique_ptr<WorkerThread> &worker : m_workers) {
+        worker->counters().reset();
+    }
+    m_externalCounters.reset();
+
+    m_statisticsStart.store(now(), std::memory_order_relaxed);
+}
+
+ThreadPool::WorkerCounters &ThreadPool::counters(uint32_t index)
+{
+    if (index < m_workers.size()) {
+        return m_workers[index]->counters();
+    }
+    return m_externalCounters;
+}
+
+Task *ThreadPool::findTask(uint32_t index)
+{
+    if (m_pending == 0)
+        return nullptr;
+
+    uint32_t nWorkers = static_cast<uint32_t>(m_workers.size());
+
+    /* Own deque first */
+    Task *task = nullptr;
+    if (index < nWorkers) {
+        task = m_workers[index]->tasks().pop();
+    }
+
+    /* Then try to steal from the others, starting from the next worker */
+    for (uint32_t i = 1; i <= nWorkers && task == nullptr; i++) {
+        uint32_t victim = (index + i) % nWorkers;
+        if (victim == index)
+            continue;
+        task = m_workers[victim]->tasks().steal();
+    }
+
+    if (task != nullptr) {
+        m_pending--;
+    }
+
+    return task;
+}
+
+void ThreadPool::execute(Task *task, uint32_t index)
+{
+    WorkerCounters &c = counters(index);
+
+    uint64_t start = now();
+    c.addLatency(start - std::min(start, task->m_pushTime));
+
+    /* Only the outermost task adds busy time, nested tasks run while it waits and are part of it */
+    bool outermost = (t_executeDepth++ == 0);
+    if (outermost) {
+        t_parkedInTask = 0;
+    }
+
+    task->run();
+
+    t_executeDepth--;
+    uint64_t end = now();
+
+    c.tasksExecuted.fetch_add(1, std::memory_order_relaxed);
+    if (outermost) {
+        c.busyTime.fetch_add(end - start - std::min(end - start, t_parkedInTask), std::memory_order_relaxed);
+    }
+
+    task->signalReady();
+}
+
+void ThreadPool::helpUntilReady(Waitable *waitable)
+{
+    uint32_t index = (t_threadPool == this) ? t_workerIndex : threads();
+
+    uint32_t idleSpins = 0;
+    while (!waitable->isReady()) {
+        Task *task = findTask(index);
+        if (task != nullptr) {
+            execute(task, index);
+            idleSpins = 0;
+            continue;
+        }
+
+        /* Nothing to help with, spin for a while and then park until ready */
+        if (idleSpins++ < HELP_IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint64_t parkStart = now();
+        waitable->park();
+        uint64_t parked = now() - parkStart;
+
+        counters(index).parkedTime.fetch_add(parked, std::memory_order_relaxed);
+        if (t_executeDepth > 0) {
+            t_parkedInTask += parked;
+        }
+        return;
+    }
+}
+
+void ThreadPool::notifyWorker()
+{
+    if (m_sleeping == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_condition.notify_one();
+}
+
+}  // namespace vengine
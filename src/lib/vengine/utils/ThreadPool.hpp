@@ -2,20 +2,30 @@
 #define __ThreadPool_hpp_
 
 #include <vector>
+#include <deque>
+#include <memory>
 #include <functional>
-#include <queue>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
+#include <array>
 
 #include "Tasks.hpp"
+#include "ThreadPoolStatistics.hpp"
 
 namespace vengine
 {
 
+/**
+ * @brief A work stealing thread pool. Every worker owns a task deque. Tasks pushed from inside a running task go to the
+ * deque of the worker that runs it, tasks pushed from other threads are distributed round robin. Workers pop their own
+ * deque in LIFO order and steal from the other deques in FIFO order when they run out of work
+ */
 class ThreadPool
 {
+    friend class Waitable;
+
 public:
     ThreadPool(){};
     ~ThreadPool();
@@ -32,31 +42,95 @@ public:
     /* Get available workers */
     uint32_t threads();
 
+    /* Get a snapshot of the statistics. Counters are read one by one while the pool runs, so they can be slightly out of sync */
+    ThreadPoolStatistics statistics() const;
+    /* Set all statistics to zero */
+    void resetStatistics();
+
 private:
+    /* Statistics counters of a worker, updated with relaxed atomics. Aligned to a cache line so workers don't share one */
+    struct alignas(64) WorkerCounters {
+        std::atomic<uint64_t> tasksExecuted = 0;
+        std::atomic<uint64_t> busyTime = 0;
+        std::atomic<uint64_t> parkedTime = 0;
+        std::atomic<uint64_t> latencyTime = 0;
+        std::atomic<uint32_t> maxQueueDepth = 0;
+        std::array<std::atomic<uint64_t>, THREADPOOL_LATENCY_BUCKETS> latencyHistogram{};
+
+        void addLatency(uint64_t latency);
+        void updateMaxQueueDepth(uint32_t depth);
+
+        ThreadPoolWorkerStatistics snapshot() const;
+        void reset();
+    };
+
+    /* A double ended task queue. The owner pushes and pops at the back, thieves steal from the front */
+    class TaskDeque
+    {
+    public:
+        /* Push a task and return the number of tasks in the deque */
+        uint32_t push(Task *task);
+        Task *pop();
+        Task *steal();
+
+    private:
+        std::mutex m_lock;
+        std::deque<Task *> m_tasks;
+    };
+
     class WorkerThread
     {
     public:
-        WorkerThread(ThreadPool &threadpool);
+        WorkerThread(ThreadPool &threadpool, uint32_t index);
 
         void loop();
 
+        TaskDeque &tasks() { return m_tasks; }
+        WorkerCounters &counters() { return m_counters; }
+
     private:
         ThreadPool &m_threadpool;
+        uint32_t m_index;
+        TaskDeque m_tasks;
+        WorkerCounters m_counters;
     };
 
+    std::vector<std::unique_ptr<WorkerThread>> m_workers;
     std::vector<std::thread> m_workerThreads;
 
-    std::queue<Task *> m_tasks;
-
     bool m_initialized = false;
 
-    /* Tasks queue mutex and condition variable */
+    /* Index of the next worker deque to receive a task pushed from outside the pool */
+    std::atomic<uint32_t> m_nextQueue = 0;
+    /* Number of tasks pushed but not yet picked up */
+    std::atomic<uint32_t> m_pending = 0;
+    /* Number of workers parked on the condition variable */
+    std::atomic<uint32_t> m_sleeping = 0;
+
+    /* Mutex and condition variable used only to park idle workers */
     std::mutex m_lock;
     std::condition_variable m_condition;
 
-    std::atomic<bool> m_run;
+    std::atomic<bool> m_run = false;
+
+    /* Counters of the threads outside the pool that run tasks while waiting */
+    WorkerCounters m_externalCounters;
+    /* Time the statistics were last reset, in nanoseconds of the steady clock. Atomic, since a reset can run alongside a read */
+    std::atomic<uint64_t> m_statisticsStart = 0;
+
+    /* Get the counters of worker index, or the external counters for index == threads() */
+    WorkerCounters &counters(uint32_t index);
+
+    /* Get a task from the deque of worker index, or steal one from the rest. Use index == threads() for non worker threads */
+    Task *findTask(uint32_t index);
+    /* Run a task and signal its waitable. Index is the worker that runs it, or threads() for non worker threads */
+    void execute(Task *task, uint32_t index);
+    /* Run pending tasks on the calling thread until the waitable is ready */
+    void helpUntilReady(Waitable *waitable);
+    /* Wake up a parked worker if there is one */
+    void notifyWorker();
 };
 
 }  // namespace vengine
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,85 @@
+#include "ThreadPoolStatistics.hpp"
+
+#include <algorithm>
+
+#define RAPIDJSON_NO_SIZETYPEDEFINE
+namespace rapidjson
+{
+typedef ::std::size_t SizeType;
+}
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace vengine
+{
+
+void ThreadPoolWorkerStatistics::add(const ThreadPoolWorkerStatistics &other)
+{
+    tasksExecuted += other.tasksExecuted;
+    busyTime += other.busyTime;
+    parkedTime += other.parkedTime;
+    latencyTime += other.latencyTime;
+    maxQueueDepth = std::max(maxQueueDepth, other.maxQueueDepth);
+    for (uint32_t b = 0; b < THREADPOOL_LATENCY_BUCKETS; b++) {
+        latencyHistogram[b] += other.latencyHistogram[b];
+    }
+}
+
+ThreadPoolWorkerStatistics ThreadPoolStatistics::total() const
+{
+    ThreadPoolWorkerStatistics total;
+    for (const ThreadPoolWorkerStatistics &worker : workers) {
+        total.add(worker);
+    }
+    return total;
+}
+
+template <typename Writer>
+static void writeWorker(Writer &writer, const ThreadPoolWorkerStatistics &worker)
+{
+    writer.StartObject();
+    writer.Key("tasksExecuted");
+    writer.Uint64(worker.tasksExecuted);
+    writer.Key("busyTime");
+    writer.Uint64(worker.busyTime);
+    writer.Key("parkedTime");
+    writer.Uint64(worker.parkedTime);
+    writer.Key("latencyTime");
+    writer.Uint64(worker.latencyTime);
+    writer.Key("maxQueueDepth");
+    writer.Uint(worker.maxQueueDepth);
+    writer.Key("latencyHistogram");
+    writer.StartArray();
+    for (uint64_t count : worker.latencyHistogram) {
+        writer.Uint64(count);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+std::string ThreadPoolStatistics::toJSON() const
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+
+    writer.StartObject();
+    writer.Key("elapsedTime");
+    writer.Uint64(elapsedTime);
+    writer.Key("pendingTasks");
+    writer.Uint(pendingTasks);
+
+    writer.Key("total");
+    writeWorker(writer, total());
+
+    writer.Key("workers");
+    writer.StartArray();
+    for (const ThreadPoolWorkerStatistics &worker : workers) {
+        writeWorker(writer, worker);
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    return buffer.GetString();
+}
+
+}  // namespace vengine
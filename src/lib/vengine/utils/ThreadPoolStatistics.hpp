@@ -0,0 +1,54 @@
+#ifndef __ThreadPoolStatistics_hpp__
+#define __ThreadPoolStatistics_hpp__
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace vengine
+{
+
+/**
+ * Number of buckets of the task latency histogram. Bucket 0 counts tasks that started less than 1 us after they were pushed,
+ * bucket i counts tasks that started in [2^(i-1), 2^i) us and the last bucket counts everything slower
+ */
+static constexpr uint32_t THREADPOOL_LATENCY_BUCKETS = 20;
+
+/* Statistics of a thread pool worker. Times are in nanoseconds */
+struct ThreadPoolWorkerStatistics {
+    /* Number of tasks executed, including tasks executed while waiting inside another task */
+    uint64_t tasksExecuted = 0;
+    /* Time spent running tasks */
+    uint64_t busyTime = 0;
+    /* Time spent blocked with nothing to run */
+    uint64_t parkedTime = 0;
+    /* Sum of the time tasks spent in the queue before they started */
+    uint64_t latencyTime = 0;
+    /* Max number of tasks in the worker deque */
+    uint32_t maxQueueDepth = 0;
+    std::array<uint64_t, THREADPOOL_LATENCY_BUCKETS> latencyHistogram{};
+
+    /* Add the statistics of another worker */
+    void add(const ThreadPoolWorkerStatistics &other);
+};
+
+/* A snapshot of the statistics of a thread pool */
+struct ThreadPoolStatistics {
+    /* One entry per worker, followed by one entry for the threads outside the pool that run tasks while waiting */
+    std::vector<ThreadPoolWorkerStatistics> workers;
+    /* Time since the pool was initialized or the statistics were reset, in nanoseconds */
+    uint64_t elapsedTime = 0;
+    /* Number of tasks pushed but not yet picked up */
+    uint32_t pendingTasks = 0;
+
+    /* Get the sum of all workers */
+    ThreadPoolWorkerStatistics total() const;
+
+    /* Get the statistics as a JSON string */
+    std::string toJSON() const;
+};
+
+}  // namespace vengine
+
+#endif
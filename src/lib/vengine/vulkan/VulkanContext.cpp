@@ -293,11 +293,33 @@ VkResult VulkanContext::createLogicalDevice()
     deviceFeatures2.features.shaderInt64 = VK_TRUE;
     deviceFeatures2.features.shaderInt16 = VK_TRUE;
     deviceFeatures2.features.independentBlend = VK_TRUE;
+    /* Optional features of the culled indirect draws, enabled only if the device supports them */
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+    deviceFeatures2.features.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures2.features.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
     deviceFeatures2.pNext = &rayQueryFeatures;
 
+    /* Enable the mandatory extensions and the optional ones that the device supports */
+    uint32_t extensionCount;
+    VULKAN_CHECK_CRITICAL(vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr));
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    VULKAN_CHECK_CRITICAL(
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, availableExtensions.data()));
+
+    std::set<std::string> supportedExtensions;
+    for (const auto &extension : availableExtensions) {
+        supportedExtensions.insert(extension.extensionName);
+    }
+
     std::vector<const char *> extensionNames;
-    for (auto e : VULKAN_DEVICE_EXTENSIONS)
-        extensionNames.push_back(e.first);
+    for (auto e : VULKAN_DEVICE_EXTENSIONS) {
+        if (e.second || supportedExtensions.count(e.first) > 0)
+            extensionNames.push_back(e.first);
+    }
+    /* The culled draws use the instance offset as the first instance and draw one command per LOD, so GPU culling needs all */
+    m_drawIndirectCount = supportedExtensions.count("VK_KHR_draw_indirect_count") > 0 && supportedFeatures.drawIndirectFirstInstance &&
+                          supportedFeatures.multiDrawIndirect;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos = m_queueManager.getQueueCreateInfo();
 
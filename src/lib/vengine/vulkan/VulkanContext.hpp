@@ -43,6 +43,7 @@ static const std::vector<std::pair<const char *, bool>> VULKAN_DEVICE_EXTENSIONS
     {"VK_KHR_shader_float_controls", false},
     {"VK_KHR_maintenance3", false},
     {"VK_KHR_ray_query", true},
+    {"VK_KHR_draw_indirect_count", false},
 };
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -83,6 +84,9 @@ public:
     VkCommandPool &graphicsCommandPool() { return m_graphicsCommandPool; }
     VkCommandPool &renderCommandPool() { return m_renderCommandPool; }
 
+    /* True if the device supports VK_KHR_draw_indirect_count and the drawIndirectFirstInstance and multiDrawIndirect features */
+    bool drawIndirectCount() const { return m_drawIndirectCount; }
+
 private:
     bool m_initialized = false;
 
@@ -95,6 +99,7 @@ private:
     VkPhysicalDeviceProperties m_physicalDeviceProperties;
     VkDevice m_device;
     VkSampleCountFlagBits m_msaaSamples;
+    bool m_drawIndirectCount = false;
     VkDebugUtilsMessengerEXT m_debugCallback;
 
     /* Queues */
@@ -141,12 +141,48 @@ void VulkanEngine::waitIdle()
     m_renderer.waitIdle();
 }
 
-Mesh *VulkanEngine::createMesh(const Mesh &mesh)
+void VulkanEngine::runBetweenFrames(const std::function<void()> &function)
+{
+    std::unique_lock<std::mutex> lock(m_betweenFramesMutex);
+    if (m_betweenFramesClosed || std::this_thread::get_id() == m_threadMain.get_id()) {
+        lock.unlock();
+        function();
+        return;
+    }
+
+    uint64_t ticket = m_betweenFramesPushed++;
+    m_betweenFrames.push_back(function);
+    m_betweenFramesCondition.wait(lock, [&]() { return m_betweenFramesFinished > ticket; });
+}
+
+void VulkanEngine::runPendingFunctions()
+{
+    std::vector<std::function<void()>> functions;
+    {
+        std::lock_guard<std::mutex> lock(m_betweenFramesMutex);
+        functions.swap(m_betweenFrames);
+    }
+    if (functions.empty())
+        return;
+
+    for (const std::function<void()> &function : functions) {
+        function();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_betweenFramesMutex);
+        m_betweenFramesFinished += functions.size();
+    }
+    m_betweenFramesCondition.notify_all();
+}
+
+Mesh *VulkanEngine::createMesh(Mesh &&mesh, bool keepGeometry)
 {
     auto vkmesh = new VulkanMesh(
-        mesh,
+        std::move(mesh),
         {m_context.physicalDevice(), m_context.device(), m_context.graphicsCommandPool(), m_context.queueManager().graphicsQueue()},
-        true);
+        true,
+        keepGeometry);
 
     auto &meshesMap = AssetManager::getInstance().meshesMap();
     meshesMap.add(vkmesh);
@@ -154,7 +190,7 @@ Mesh *VulkanEngine::createMesh(const Mesh &mesh)
     return vkmesh;
 }
 
-Model3D *VulkanEngine::importModel(const AssetInfo &info, bool importMaterials)
+Model3D *VulkanEngine::importModel(const AssetInfo &info, bool importMaterials, bool keepGeometry)
 {
     try {
         auto &modelsMap = AssetManager::getInstance().modelsMap();
@@ -166,21 +202,22 @@ Model3D *VulkanEngine::importModel(const AssetInfo &info, bool importMaterials)
         std::vector<Material *> materials = {};
         if (importMaterials) {
             std::vector<ImportedMaterial> importedMaterials;
-            importedNode = assimpLoadModel(info, importedMaterials);
+            importedNode = assimpLoadModel(info, importedMaterials, &m_threadPool);
 
             materials = m_materials.createImportedMaterials(importedMaterials, m_textures);
         } else {
-            importedNode = assimpLoadModel(info);
+            importedNode = assimpLoadModel(info, &m_threadPool);
         }
 
         auto vkmodel = new VulkanModel3D(info,
-                                         importedNode,
+                                         std::move(importedNode),
                                          materials,
                                          {m_context.physicalDevice(),
                                           m_context.device(),
                                           m_context.graphicsCommandPool(),
                                           m_context.queueManager().graphicsQueue()},
-                                         true);
+                                         true,
+                                         keepGeometry);
 
         return modelsMap.add(vkmodel);
     } catch (std::runtime_error &e) {
@@ -294,12 +331,20 @@ void VulkanEngine::deleteImportedAssets()
 
 void VulkanEngine::mainLoop()
 {
+    buildFrameGraph();
+
     for (;;) {
         if (m_threadMainExit) {
             break;
         }
 
+        /* The frame graph of the previous iteration has finished, and the next one hasn't started */
+        runPendingFunctions();
+
         if (m_threadMainPaused) {
+            /* Submit the frame recorded in the last iteration before reporting that the engine is paused */
+            m_renderer.submitFrame();
+
             m_status = STATUS::PAUSED;
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
@@ -316,18 +361,48 @@ void VulkanEngine::mainLoop()
         debug_tools::ConsoleInfo("Frame time: " + std::to_string(static_cast<uint32_t>(m_deltaTime * 1000)) + " ms");
 #endif
 
-        /* update scene */
-        m_scene.update();
+        /* Update the scene and record the frame, while the frame recorded in the previous iteration is submitted */
+        m_frameGraph.execute(m_threadPool);
+        m_frameGraph.wait();
+    }
 
-        /* Render frame */
-        VkResult res = m_renderer.renderFrame();
-        if (res != VK_SUCCESS && res != VK_ERROR_OUT_OF_DATE_KHR)
-            PRINT_LINE_WARNING_NUMBER(res);
+    m_renderer.submitFrame();
+
+    /* Run the functions pushed until now, later ones run on the calling thread */
+    {
+        std::lock_guard<std::mutex> lock(m_betweenFramesMutex);
+        m_betweenFramesClosed = true;
     }
+    runPendingFunctions();
 
     m_status = STATUS::EXITED;
 }
 
+void VulkanEngine::buildFrameGraph()
+{
+    auto check = [](VkResult res) {
+        if (res != VK_SUCCESS && res != VK_ERROR_OUT_OF_DATE_KHR)
+            PRINT_LINE_WARNING_NUMBER(res);
+    };
+
+    FrameJobs jobs;
+    jobs.updateSceneGraph = [this]() { m_scene.updateSceneGraph(); };
+    jobs.updateInstances = [this]() { m_scene.updateInstances(); };
+    jobs.updateLightInstances = [this]() { m_scene.updateLightInstances(); };
+    jobs.sortTransparent = [this]() { m_scene.sortTransparent(); };
+    jobs.cullInstances = [this]() { m_renderer.cullInstances(); };
+    jobs.submitFrame = [this, check]() { check(m_renderer.submitFrame()); };
+    jobs.beginFrame = [this, check]() { check(m_renderer.beginFrame()); };
+    jobs.updateSceneBuffers = [this, check]() { check(m_renderer.updateSceneBuffers()); };
+    jobs.updateMaterialBuffers = [this, check]() { check(m_renderer.updateMaterialBuffers()); };
+    jobs.updateTextures = [this, check]() { check(m_renderer.updateTextures()); };
+    jobs.recordDeferredPass = [this, check]() { check(m_renderer.recordDeferredPass()); };
+    jobs.recordOverlayPass = [this, check]() { check(m_renderer.recordOverlayPass()); };
+    jobs.recordOutputPass = [this, check]() { check(m_renderer.recordOutputPass()); };
+
+    vengine::buildFrameGraph(m_frameGraph, jobs);
+}
+
 void VulkanEngine::initDefaultData()
 {
     /* default materials */
@@ -372,10 +447,10 @@ void VulkanEngine::initDefaultData()
     }
 
     {
-        /* Some models */
-        auto uvsphereMeshModel = importModel(AssetInfo("assets/models/uvsphere.obj", AssetSource::ENGINE), false);
-        auto planeMeshModel = importModel(AssetInfo("assets/models/plane.obj", AssetSource::ENGINE), false);
-        auto cubeMeshModel = importModel(AssetInfo("assets/models/cube.obj", AssetSource::ENGINE), false);
+        /* Some models, small enough to keep their geometry for picking */
+        auto uvsphereMeshModel = importModel(AssetInfo("assets/models/uvsphere.obj", AssetSource::ENGINE), false, true);
+        auto planeMeshModel = importModel(AssetInfo("assets/models/plane.obj", AssetSource::ENGINE), false, true);
+        auto cubeMeshModel = importModel(AssetInfo("assets/models/cube.obj", AssetSource::ENGINE), false, true);
     }
 
     /* A skybox material */
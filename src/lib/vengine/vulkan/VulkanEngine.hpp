@@ -1,7 +1,13 @@
 #ifndef __VulkanEngine_hpp__
 #define __VulkanEngine_hpp__
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 #include <vengine/core/Engine.hpp>
+#include <vengine/core/FrameGraph.hpp>
+#include <vengine/utils/TaskGraph.hpp>
 #include "renderers/VulkanRenderer.hpp"
 
 #include "VulkanContext.hpp"
@@ -37,9 +43,10 @@ public:
     void stop() override;
     void exit() override;
     void waitIdle() override;
+    void runBetweenFrames(const std::function<void()> &function) override;
 
-    Mesh *createMesh(const Mesh &mesh) override;
-    Model3D *importModel(const AssetInfo &info, bool importMaterials = true) override;
+    Mesh *createMesh(Mesh &&mesh, bool keepGeometry = false) override;
+    Model3D *importModel(const AssetInfo &info, bool importMaterials = true, bool keepGeometry = false) override;
     EnvironmentMap *importEnvironmentMap(const AssetInfo &info, bool keepTexture = false) override;
 
     void deleteImportedAssets() override;
@@ -58,6 +65,20 @@ private:
     bool m_threadMainExit = false;
     void mainLoop();
 
+    /* Functions to run between two frames, and the number of them that have finished */
+    std::mutex m_betweenFramesMutex;
+    std::condition_variable m_betweenFramesCondition;
+    std::vector<std::function<void()>> m_betweenFrames;
+    uint64_t m_betweenFramesPushed = 0;
+    uint64_t m_betweenFramesFinished = 0;
+    /* Set once the main loop has exited, the functions run on the calling thread after that */
+    bool m_betweenFramesClosed = false;
+    void runPendingFunctions();
+
+    /* CPU jobs of a frame */
+    TaskGraph m_frameGraph;
+    void buildFrameGraph();
+
     /* Delta time data */
     std::chrono::steady_clock::time_point m_frameTimePrev;
     float m_deltaTime = 0.016F;
@@ -1,6 +1,9 @@
 #include "VulkanInstances.hpp"
 
+#include <cstring>
+
 #include "vulkan/common/VulkanLimits.hpp"
+#include "vulkan/common/VulkanUtils.hpp"
 #include "vulkan/resources/VulkanMesh.hpp"
 #include "vulkan/VulkanScene.hpp"
 
@@ -39,6 +42,7 @@ VkResult VulkanInstancesManager::initSwapchainResources(uint32_t nImages)
     VULKAN_CHECK_CRITICAL(m_instancesSSBO.createBuffers(m_vkctx.physicalDevice(), m_vkctx.device(), nImages));
     VULKAN_CHECK_CRITICAL(createDescriptorPool(nImages));
     VULKAN_CHECK_CRITICAL(createDescriptorSets(nImages));
+    VULKAN_CHECK_CRITICAL(createVisibleInstancesBuffers(nImages));
 
     return VK_SUCCESS;
 }
@@ -57,16 +61,18 @@ VkResult VulkanInstancesManager::releaseSwapchainResources()
 {
     m_lightInstancesUBO.destroyGPUBuffers(m_vkctx.device());
     m_instancesSSBO.destroyGPUBuffers(m_vkctx.device());
+    for (VulkanBuffer &buffer : m_visibleInstancesBuffers) {
+        buffer.destroy(m_vkctx.device());
+    }
+    m_visibleInstancesBuffers.clear();
 
     vkDestroyDescriptorPool(m_vkctx.device(), m_descriptorPool, nullptr);
 
     return VK_SUCCESS;
 }
 
-void VulkanInstancesManager::build()
+void VulkanInstancesManager::buildLightInstances()
 {
-    InstancesManager::build();
-
     /* Update LightInstance data */
     // TODO don't do this per frame if light instance data haven't changed
 
@@ -112,6 +118,15 @@ void VulkanInstancesManager::updateBuffers(uint32_t imageIndex)
 {
     m_lightInstancesUBO.updateBuffer(m_vkctx.device(), imageIndex);
     m_instancesSSBO.updateBuffer(m_vkctx.device(), imageIndex);
+
+    const std::vector<uint32_t> &visible = visibleInstances();
+    if (!visible.empty()) {
+        VkDeviceSize size = visible.size() * sizeof(uint32_t);
+        void *data;
+        vkMapMemory(m_vkctx.device(), m_visibleInstancesBuffers[imageIndex].memory(), 0, size, 0, &data);
+        memcpy(data, visible.data(), size);
+        vkUnmapMemory(m_vkctx.device(), m_visibleInstancesBuffers[imageIndex].memory());
+    }
 }
 
 void VulkanInstancesManager::initInstanceData(InstanceData *instanceData, SceneObject *so)
@@ -125,6 +140,7 @@ void VulkanInstancesManager::initInstanceData(InstanceData *instanceData, SceneO
 
         instanceData->vertexAddress = mesh->vertexBuffer().address().deviceAddress;
         instanceData->indexAddress = mesh->indexBuffer().address().deviceAddress;
+        instanceData->indexSize = mesh->indexSize();
         instanceData->numTriangles = mesh->nTriangles();
     }
 }
@@ -135,7 +151,7 @@ VkResult VulkanInstancesManager::createDescriptorSetsLayouts()
     VkDescriptorSetLayoutBinding instanceDataBufferBinding = vkinit::descriptorSetLayoutBinding(
         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
         VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR |
-            VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR,
+            VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT,
         0,
         1);
 
@@ -188,4 +204,19 @@ VkResult VulkanInstancesManager::createDescriptorSets(uint32_t nImages)
     return VK_SUCCESS;
 }
 
+VkResult VulkanInstancesManager::createVisibleInstancesBuffers(uint32_t nImages)
+{
+    m_visibleInstancesBuffers.resize(nImages);
+    for (uint32_t i = 0; i < nImages; i++) {
+        VULKAN_CHECK_CRITICAL(createBuffer(m_vkctx.physicalDevice(),
+                                           m_vkctx.device(),
+                                           VULKAN_LIMITS_MAX_OBJECTS * sizeof(uint32_t),
+                                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           m_visibleInstancesBuffers[i]));
+    }
+
+    return VK_SUCCESS;
+}
+
 }  // namespace vengine
\ No newline at end of file
@@ -28,7 +28,10 @@ public:
     VkDescriptorSetLayout &layoutInstanceData() { return m_descriptorSetLayoutInstanceData; }
     VkDescriptorSet &descriptorSetInstanceData(uint32_t imageIndex) { return m_descriptorSetsInstanceData[imageIndex]; };
 
-    void build() override;
+    /* Per instance vertex buffer with the visibleInstances() of the last cull() */
+    VkBuffer visibleInstancesBuffer(uint32_t imageIndex) const { return m_visibleInstancesBuffers[imageIndex].buffer(); }
+
+    void buildLightInstances() override;
 
     void updateBuffers(uint32_t imageIndex);
 
@@ -45,11 +48,15 @@ private:
     /* Buffers for LightInstance */
     VulkanUBODefault<LightInstance> m_lightInstancesUBO;
 
+    /* Buffers for the visible instances, host visible since they are rewritten every frame */
+    std::vector<VulkanBuffer> m_visibleInstancesBuffers;
+
     void initInstanceData(InstanceData *instanceData, SceneObject *so) override;
 
     VkResult createDescriptorSetsLayouts();
     VkResult createDescriptorPool(uint32_t nImages);
     VkResult createDescriptorSets(uint32_t nImages);
+    VkResult createVisibleInstancesBuffers(uint32_t nImages);
 };
 
 }  // namespace vengine
@@ -19,6 +19,10 @@ struct VulkanDeviceFunctionsRayTracing {
     PFN_vkCreateRayTracingPipelinesKHR vkCreateRayTracingPipelinesKHR;
 };
 
+struct VulkanDeviceFunctionsDrawIndirectCount {
+    PFN_vkCmdDrawIndexedIndirectCountKHR vkCmdDrawIndexedIndirectCountKHR;
+};
+
 class VulkanDeviceFunctions
 {
     friend class VulkanContext;
@@ -33,11 +37,13 @@ public:
     void operator=(VulkanDeviceFunctions const &) = delete;
 
     VulkanDeviceFunctionsRayTracing *rayTracingPipeline() { return &m_deviceFunctionsRayTracing; }
+    VulkanDeviceFunctionsDrawIndirectCount *drawIndirectCount() { return &m_deviceFunctionsDrawIndirectCount; }
 
 private:
     VulkanDeviceFunctions() {}
 
     VulkanDeviceFunctionsRayTracing m_deviceFunctionsRayTracing;
+    VulkanDeviceFunctionsDrawIndirectCount m_deviceFunctionsDrawIndirectCount;
 
     void init(VkDevice device)
     {
@@ -67,6 +73,12 @@ private:
             m_deviceFunctionsRayTracing.vkCreateRayTracingPipelinesKHR =
                 reinterpret_cast<PFN_vkCreateRayTracingPipelinesKHR>(vkGetDeviceProcAddr(device, "vkCreateRayTracingPipelinesKHR"));
         }
+        {
+            /* nullptr if VK_KHR_draw_indirect_count is not enabled */
+            m_deviceFunctionsDrawIndirectCount.vkCmdDrawIndexedIndirectCountKHR =
+                reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                    vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        }
     }
 };
 
@@ -12,6 +12,7 @@ static constexpr uint32_t VULKAN_LIMITS_MAX_MATERIALS = 512;          /* These l
 static constexpr uint32_t VULKAN_LIMITS_MAX_TEXTURES = 1024;
 static constexpr uint32_t VULKAN_LIMITS_MAX_UNIQUE_LIGHTS = 1024;
 static constexpr uint32_t VULKAN_LIMITS_MAX_LIGHT_INSTANCES = 1024;
+static constexpr uint32_t VULKAN_LIMITS_MAX_MESH_GROUPS = 16384; /* Opaque mesh groups that can be culled on the GPU */
 
 }  // namespace vengine
 
@@ -101,6 +101,20 @@ struct PushBlockOutput {
     glm::vec4 info;
 };
 
+struct PushBlockCulling {
+    glm::vec4 planes[6]; /* Frustum planes as (normal, d), normals point inwards */
+    glm::vec4 lodRow;    /* InstancesManager::screenSizeRow() divided by Mesh::LOD_SCREEN_SIZE */
+    glm::uvec4 info;     /* R = number of opaque instances, G = number of mesh groups, B = draw commands per group, A = unused */
+}; /* sizeof(PushBlockCulling) = 128 */
+
+/* A GPU clone */
+/* Describes an opaque mesh group for the culling compute shader */
+struct CullingMeshGroup {
+    glm::vec4 min;   /* RGB = min point of the mesh AABB, A = unused */
+    glm::vec4 max;   /* RGB = max point of the mesh AABB, A = unused */
+    glm::uvec4 info; /* R = start index in the InstanceData buffer, G = number of instances, B = first flat instance, A = LODs */
+}; /* sizeof(CullingMeshGroup) = 48 */
+
 }  // namespace vengine
 
 /* Hash function for ModeData struct */
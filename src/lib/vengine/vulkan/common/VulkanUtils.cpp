@@ -184,8 +184,16 @@ VkResult createVertexBuffer(VulkanCommandInfo vci,
                             VkBufferUsageFlags extraUsageFlags,
                             VulkanBuffer &outBuffer)
 {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    return createVertexBuffer(vci, vertices.data(), sizeof(vertices[0]) * vertices.size(), extraUsageFlags, outBuffer);
+}
 
+/* Create a device local buffer, the data is written in a staging buffer by write(void *data) and copied */
+static VkResult createDeviceLocalBuffer(VulkanCommandInfo vci,
+                                        VkDeviceSize bufferSize,
+                                        VkBufferUsageFlags bufferUsage,
+                                        const std::function<void(void *)> &write,
+                                        VulkanBuffer &outBuffer)
+{
     VulkanBuffer stagingBuffer;
     VULKAN_CHECK_CRITICAL(createBuffer(vci.physicalDevice,
                                        vci.device,
@@ -196,13 +204,13 @@ VkResult createVertexBuffer(VulkanCommandInfo vci,
 
     void *data;
     VULKAN_CHECK_CRITICAL(vkMapMemory(vci.device, stagingBuffer.memory(), 0, bufferSize, 0, &data));
-    memcpy(data, vertices.data(), (size_t)bufferSize);
+    write(data);
     vkUnmapMemory(vci.device, stagingBuffer.memory());
 
     VULKAN_CHECK_CRITICAL(createBuffer(vci.physicalDevice,
                                        vci.device,
                                        bufferSize,
-                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsageFlags,
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | bufferUsage,
                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                        outBuffer));
 
@@ -213,38 +221,50 @@ VkResult createVertexBuffer(VulkanCommandInfo vci,
     return VK_SUCCESS;
 }
 
+VkResult createVertexBuffer(VulkanCommandInfo vci,
+                            const void *vertices,
+                            VkDeviceSize bufferSize,
+                            VkBufferUsageFlags extraUsageFlags,
+                            VulkanBuffer &outBuffer)
+{
+    auto write = [&](void *data) { memcpy(data, vertices, (size_t)bufferSize); };
+    return createVertexBuffer(vci, bufferSize, write, extraUsageFlags, outBuffer);
+}
+
+VkResult createVertexBuffer(VulkanCommandInfo vci,
+                            VkDeviceSize bufferSize,
+                            const std::function<void(void *)> &write,
+                            VkBufferUsageFlags extraUsageFlags,
+                            VulkanBuffer &outBuffer)
+{
+    return createDeviceLocalBuffer(vci, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsageFlags, write, outBuffer);
+}
+
 VkResult createIndexBuffer(VulkanCommandInfo vci,
                            const std::vector<uint32_t> &indices,
                            VkBufferUsageFlags extraUsageFlags,
                            VulkanBuffer &outBuffer)
 {
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    VulkanBuffer stagingBuffer;
-    VULKAN_CHECK_CRITICAL(createBuffer(vci.physicalDevice,
-                                       vci.device,
-                                       bufferSize,
-                                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       stagingBuffer));
-
-    void *data;
-    VULKAN_CHECK_CRITICAL(vkMapMemory(vci.device, stagingBuffer.memory(), 0, bufferSize, 0, &data));
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(vci.device, stagingBuffer.memory());
-
-    VULKAN_CHECK_CRITICAL(createBuffer(vci.physicalDevice,
-                                       vci.device,
-                                       bufferSize,
-                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | extraUsageFlags,
-                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                       outBuffer));
-
-    VULKAN_CHECK_CRITICAL(copyBufferToBuffer(vci, stagingBuffer.buffer(), outBuffer.buffer(), bufferSize));
+    return createIndexBuffer(vci, indices.data(), sizeof(indices[0]) * indices.size(), extraUsageFlags, outBuffer);
+}
 
-    stagingBuffer.destroy(vci.device);
+VkResult createIndexBuffer(VulkanCommandInfo vci,
+                           const void *indices,
+                           VkDeviceSize bufferSize,
+                           VkBufferUsageFlags extraUsageFlags,
+                           VulkanBuffer &outBuffer)
+{
+    auto write = [&](void *data) { memcpy(data, indices, (size_t)bufferSize); };
+    return createIndexBuffer(vci, bufferSize, write, extraUsageFlags, outBuffer);
+}
 
-    return VK_SUCCESS;
+VkResult createIndexBuffer(VulkanCommandInfo vci,
+                           VkDeviceSize bufferSize,
+                           const std::function<void(void *)> &write,
+                           VkBufferUsageFlags extraUsageFlags,
+                           VulkanBuffer &outBuffer)
+{
+    return createDeviceLocalBuffer(vci, bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | extraUsageFlags, write, outBuffer);
 }
 
 VkResult createImage(VkPhysicalDevice physicalDevice,
@@ -5,6 +5,7 @@
 #include <vector>
 #include <fstream>
 #include <array>
+#include <functional>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -80,11 +81,39 @@ VkResult createVertexBuffer(VulkanCommandInfo vci,
                             VkBufferUsageFlags extraUsageFlags,
                             VulkanBuffer &outBuffer);
 
+/* Create a vertex buffer from vertices in any layout */
+VkResult createVertexBuffer(VulkanCommandInfo vci,
+                            const void *vertices,
+                            VkDeviceSize bufferSize,
+                            VkBufferUsageFlags extraUsageFlags,
+                            VulkanBuffer &outBuffer);
+
+/* Create a vertex buffer whose data is written by write(void *data) directly in the staging memory */
+VkResult createVertexBuffer(VulkanCommandInfo vci,
+                            VkDeviceSize bufferSize,
+                            const std::function<void(void *)> &write,
+                            VkBufferUsageFlags extraUsageFlags,
+                            VulkanBuffer &outBuffer);
+
 VkResult createIndexBuffer(VulkanCommandInfo vci,
                            const std::vector<uint32_t> &indices,
                            VkBufferUsageFlags extraUsageFlags,
                            VulkanBuffer &outBuffer);
 
+/* Create an index buffer from indices of any type */
+VkResult createIndexBuffer(VulkanCommandInfo vci,
+                           const void *indices,
+                           VkDeviceSize bufferSize,
+                           VkBufferUsageFlags extraUsageFlags,
+                           VulkanBuffer &outBuffer);
+
+/* Create an index buffer whose data is written by write(void *data) directly in the staging memory */
+VkResult createIndexBuffer(VulkanCommandInfo vci,
+                           VkDeviceSize bufferSize,
+                           const std::function<void(void *)> &write,
+                           VkBufferUsageFlags extraUsageFlags,
+                           VulkanBuffer &outBuffer);
+
 VkResult createImage(VkPhysicalDevice physicalDevice,
                      VkDevice device,
                      const VkImageCreateInfo &imageCreateInfo,
@@ -45,6 +45,7 @@ VulkanRenderer::VulkanRenderer(VulkanContext &context,
     , m_scene(scene)
     , m_random(context)
     , m_renderPassDeferred(context)
+    , m_rendererCulling(context)
     , m_rendererGBuffer(context)
     , m_rendererLightComposition(context)
     , m_rendererPBR(context)
@@ -63,6 +64,7 @@ VkResult VulkanRenderer::initResources()
     VULKAN_CHECK_CRITICAL(m_random.initResources());
 
     /* Initialize renderers */
+    VULKAN_CHECK_CRITICAL(m_rendererCulling.initResources(m_scene.descriptorSetlayoutInstanceData()));
     VULKAN_CHECK_CRITICAL(m_rendererSkybox.initResources(m_vkctx.physicalDevice(),
                                                          m_vkctx.device(),
                                                          m_vkctx.queueManager().graphicsQueue(),
@@ -121,8 +123,8 @@ VkResult VulkanRenderer::initSwapChainResources()
 
     VULKAN_CHECK_CRITICAL(createRenderPasses());
     VULKAN_CHECK_CRITICAL(createFrameBuffers());
-    VULKAN_CHECK_CRITICAL(createSelectionImage());
 
+    VULKAN_CHECK_CRITICAL(m_rendererCulling.initSwapChainResources(m_swapchain.imageCount()));
     VULKAN_CHECK_CRITICAL(m_rendererGBuffer.initSwapChainResources(swapchainExtent, m_renderPassDeferred));
     VULKAN_CHECK_CRITICAL(m_rendererLightComposition.initSwapChainResources(swapchainExtent, m_renderPassDeferred));
     VULKAN_CHECK_CRITICAL(m_rendererSkybox.initSwapChainResources(swapchainExtent, m_renderPassDeferred));
@@ -146,6 +148,7 @@ VkResult VulkanRenderer::releaseSwapChainResources()
     m_framebufferOverlay.destroy(m_vkctx.device());
     m_framebufferOutput.destroy(m_vkctx.device());
 
+    m_rendererCulling.releaseSwapChainResources();
     m_rendererGBuffer.releaseSwapChainResources();
     m_rendererLightComposition.releaseSwapChainResources();
     m_rendererSkybox.releaseSwapChainResources();
@@ -158,8 +161,6 @@ VkResult VulkanRenderer::releaseSwapChainResources()
     m_renderPassOverlay.releaseResources(m_vkctx.device());
     m_renderPassOutput.releaseResources(m_vkctx.device());
 
-    m_imageSelection.destroy(m_vkctx.device());
-
     return VK_SUCCESS;
 }
 
@@ -175,6 +176,10 @@ VkResult VulkanRenderer::releaseResources()
         vkDestroyFence(m_vkctx.device(), m_fenceInFlight[f], nullptr);
     }
 
+    vkDestroyCommandPool(m_vkctx.device(), m_commandPoolDeferred, nullptr);
+    vkDestroyCommandPool(m_vkctx.device(), m_commandPoolOverlay, nullptr);
+    vkDestroyCommandPool(m_vkctx.device(), m_commandPoolOutput, nullptr);
+
     /* Destroy cubemaps */
     {
         auto &cubemapsMap = AssetManager::getInstance().cubemapsMap();
@@ -184,6 +189,7 @@ VkResult VulkanRenderer::releaseResources()
         }
     }
 
+    m_rendererCulling.releaseResources();
     m_rendererGBuffer.releaseResources();
     m_rendererLightComposition.releaseResources();
     m_rendererSkybox.releaseResources();
@@ -225,6 +231,34 @@ void VulkanRenderer::waitIdle()
 
 VkResult VulkanRenderer::renderFrame()
 {
+    VULKAN_CHECK(beginFrame());
+
+    m_scene.sortTransparent();
+    cullInstances();
+    VULKAN_CHECK(updateSceneBuffers());
+    VULKAN_CHECK(updateMaterialBuffers());
+    VULKAN_CHECK(updateTextures());
+
+    VULKAN_CHECK(recordDeferredPass());
+    VULKAN_CHECK(recordOverlayPass());
+    VULKAN_CHECK(recordOutputPass());
+
+    return submitFrame();
+}
+
+void VulkanRenderer::cullInstances()
+{
+    m_gpuCullingFrame = m_gpuCulling && m_vkctx.drawIndirectCount() && m_scene.camera() != nullptr &&
+                        m_scene.m_instances.opaqueMeshes().size() <= VULKAN_LIMITS_MAX_MESH_GROUPS;
+
+    m_scene.m_instances.cullOpaque() = !m_gpuCullingFrame;
+    m_scene.cullInstances();
+}
+
+VkResult VulkanRenderer::beginFrame()
+{
+    assert(!m_frameStarted);
+
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
     /* Wait previous render operation to finish */
@@ -244,140 +278,263 @@ VkResult VulkanRenderer::renderFrame()
 
     VULKAN_CHECK(vkResetFences(m_vkctx.device(), 1, &m_fenceInFlight[m_currentFrame]));
 
-    /* Render frame */
-    VULKAN_CHECK(buildFrame(imageIndex));
-
-    /* Present to swapchain */
-    VkSemaphore waitSemaphores[] = {m_semaphoreOutputFinished[m_currentFrame]};
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = waitSemaphores;
-    VkSwapchainKHR swapChains[] = {m_swapchain.swapchain()};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
-    VULKAN_CHECK(vkQueuePresentKHR(m_vkctx.queueManager().presentQueue(), &presentInfo));
+    m_imageIndex = imageIndex;
+    m_frameStarted = true;
 
     return VK_SUCCESS;
 }
 
-VkResult VulkanRenderer::buildFrame(uint32_t imageIndex)
+VkResult VulkanRenderer::updateSceneBuffers()
 {
-    /* Update scene and buffers */
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
     m_scene.updateFrame(
-        {m_vkctx.physicalDevice(), m_vkctx.device(), m_vkctx.renderCommandPool(), m_vkctx.queueManager().renderQueue()}, imageIndex);
-    m_materials.updateBuffers(static_cast<uint32_t>(imageIndex));
+        {m_vkctx.physicalDevice(), m_vkctx.device(), m_vkctx.renderCommandPool(), m_vkctx.queueManager().renderQueue()}, m_imageIndex);
+
+    if (m_gpuCullingFrame) {
+        SceneData sceneData = m_scene.getSceneData();
+        m_rendererCulling.updateBuffers(m_scene.m_instances, sceneData.m_projection * sceneData.m_view, m_imageIndex);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::updateMaterialBuffers()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
+    m_materials.updateBuffers(m_imageIndex);
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::updateTextures()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
     m_textures.updateTextures();
 
-    /* Deferred pass */
-    {
-        VkCommandBuffer &commandBufferDeferred = m_commandBufferDeferred[m_currentFrame];
-        VULKAN_CHECK(vkResetCommandBuffer(commandBufferDeferred, 0));
-
-        VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
-        VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferDeferred, &beginInfo));
-
-        /* Start deferred pass */
-        glm::vec3 clearColor = m_scene.backgroundColor();
-        std::array<VkClearValue, 4> clearValues{};
-        VkClearColorValue cl = {{clearColor.r, clearColor.g, clearColor.b, 1.0F}};
-        clearValues[0].color = {0, 0, 0, 0};
-        clearValues[1].color = {0, 0, 0, 0};
-        clearValues[2].depthStencil = {1.0f, 0};
-        clearValues[3].color = cl;
-        VkRenderPassBeginInfo rpBeginInfo = vkinit::renderPassBeginInfo(m_renderPassDeferred.renderPass(),
-                                                                        m_frameBufferDeferred.framebuffer(imageIndex),
-                                                                        static_cast<uint32_t>(clearValues.size()),
-                                                                        clearValues.data());
-        rpBeginInfo.renderArea.extent = m_swapchain.extent();
-        vkCmdBeginRenderPass(commandBufferDeferred, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        /* Get skybox material and check if its parameters have changed */
-        auto skybox = dynamic_cast<VulkanMaterialSkybox *>(m_scene.skyboxMaterial());
-        assert(skybox != nullptr);
-        /* If material parameters have changed, update descriptor */
-        if (skybox->needsUpdate(imageIndex)) {
-            skybox->updateDescriptorSet(m_vkctx.device(), imageIndex);
-        }
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::recordDeferredPass()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
+    uint32_t imageIndex = m_imageIndex;
+
+    VkCommandBuffer &commandBufferDeferred = m_commandBufferDeferred[m_currentFrame];
+    VULKAN_CHECK(vkResetCommandBuffer(commandBufferDeferred, 0));
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferDeferred, &beginInfo));
+
+    /* Cull the opaque instances before the render pass, compute dispatches are not allowed inside */
+    if (m_gpuCullingFrame) {
+        m_rendererCulling.record(commandBufferDeferred, m_scene.descriptorSetInstanceData(imageIndex), imageIndex);
+    }
 
-        /* GBuffer subpass */
-        {
+    /* Start deferred pass */
+    glm::vec3 clearColor = m_scene.backgroundColor();
+    std::array<VkClearValue, 4> clearValues{};
+    VkClearColorValue cl = {{clearColor.r, clearColor.g, clearColor.b, 1.0F}};
+    clearValues[0].color = {0, 0, 0, 0};
+    clearValues[1].color = {0, 0, 0, 0};
+    clearValues[2].depthStencil = {1.0f, 0};
+    clearValues[3].color = cl;
+    VkRenderPassBeginInfo rpBeginInfo = vkinit::renderPassBeginInfo(m_renderPassDeferred.renderPass(),
+                                                                    m_frameBufferDeferred.framebuffer(imageIndex),
+                                                                    static_cast<uint32_t>(clearValues.size()),
+                                                                    clearValues.data());
+    rpBeginInfo.renderArea.extent = m_swapchain.extent();
+    vkCmdBeginRenderPass(commandBufferDeferred, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    /* Get skybox material and check if its parameters have changed */
+    auto skybox = dynamic_cast<VulkanMaterialSkybox *>(m_scene.skyboxMaterial());
+    assert(skybox != nullptr);
+    /* If material parameters have changed, update descriptor */
+    if (skybox->needsUpdate(imageIndex)) {
+        skybox->updateDescriptorSet(m_vkctx.device(), imageIndex);
+    }
+
+    /* GBuffer subpass */
+    {
+        if (m_gpuCullingFrame) {
+            m_rendererGBuffer.renderOpaqueInstancesIndirect(commandBufferDeferred,
+                                                            m_rendererCulling,
+                                                            imageIndex,
+                                                            m_scene.descriptorSetSceneData(imageIndex),
+                                                            m_scene.descriptorSetInstanceData(imageIndex),
+                                                            m_materials.descriptorSet(imageIndex),
+                                                            m_textures.descriptorSet());
+        } else {
             m_rendererGBuffer.renderOpaqueInstances(commandBufferDeferred,
                                                     m_scene.m_instances,
+                                                    m_scene.m_instances.visibleInstancesBuffer(imageIndex),
                                                     m_scene.descriptorSetSceneData(imageIndex),
                                                     m_scene.descriptorSetInstanceData(imageIndex),
                                                     m_materials.descriptorSet(imageIndex),
                                                     m_textures.descriptorSet());
+        }
 
-            if (m_scene.environmentType() == EnvironmentType::HDRI) {
-                m_rendererSkybox.renderSkybox(commandBufferDeferred, m_scene.descriptorSetSceneData(imageIndex), imageIndex, skybox);
-            }
+        if (m_scene.environmentType() == EnvironmentType::HDRI) {
+            m_rendererSkybox.renderSkybox(commandBufferDeferred, m_scene.descriptorSetSceneData(imageIndex), imageIndex, skybox);
         }
+    }
 
-        /* Light composition subpass */
-        vkCmdNextSubpass(commandBufferDeferred, VK_SUBPASS_CONTENTS_INLINE);
-        {
-            /* Perform IBL if needed */
-            if (m_scene.environmentIntensity() > 0.F) {
-                m_rendererLightComposition.renderIBL(commandBufferDeferred,
-                                                     m_scene.m_instances,
-                                                     m_renderPassDeferred.descriptor(imageIndex),
-                                                     m_scene.descriptorSetSceneData(imageIndex),
-                                                     m_scene.descriptorSetInstanceData(imageIndex),
-                                                     m_scene.descriptorSetLight(imageIndex),
-                                                     skybox->getDescriptor(imageIndex),
-                                                     m_materials.descriptorSet(imageIndex),
-                                                     m_textures.descriptorSet(),
-                                                     m_scene.descriptorSetTLAS(imageIndex));
-            }
-
-            m_rendererLightComposition.renderLights(commandBufferDeferred,
-                                                    m_scene.m_instances,
-                                                    m_renderPassDeferred.descriptor(imageIndex),
-                                                    m_scene.descriptorSetSceneData(imageIndex),
-                                                    m_scene.descriptorSetInstanceData(imageIndex),
-                                                    m_scene.descriptorSetLight(imageIndex),
-                                                    skybox->getDescriptor(imageIndex),
-                                                    m_materials.descriptorSet(imageIndex),
-                                                    m_textures.descriptorSet(),
-                                                    m_scene.descriptorSetTLAS(imageIndex));
+    /* Light composition subpass */
+    vkCmdNextSubpass(commandBufferDeferred, VK_SUBPASS_CONTENTS_INLINE);
+    {
+        /* Perform IBL if needed */
+        if (m_scene.environmentIntensity() > 0.F) {
+            m_rendererLightComposition.renderIBL(commandBufferDeferred,
+                                                 m_scene.m_instances,
+                                                 m_renderPassDeferred.descriptor(imageIndex),
+                                                 m_scene.descriptorSetSceneData(imageIndex),
+                                                 m_scene.descriptorSetInstanceData(imageIndex),
+                                                 m_scene.descriptorSetLight(imageIndex),
+                                                 skybox->getDescriptor(imageIndex),
+                                                 m_materials.descriptorSet(imageIndex),
+                                                 m_textures.descriptorSet(),
+                                                 m_scene.descriptorSetTLAS(imageIndex));
+        }
+
+        m_rendererLightComposition.renderLights(commandBufferDeferred,
+                                                m_scene.m_instances,
+                                                m_renderPassDeferred.descriptor(imageIndex),
+                                                m_scene.descriptorSetSceneData(imageIndex),
+                                                m_scene.descriptorSetInstanceData(imageIndex),
+                                                m_scene.descriptorSetLight(imageIndex),
+                                                skybox->getDescriptor(imageIndex),
+                                                m_materials.descriptorSet(imageIndex),
+                                                m_textures.descriptorSet(),
+                                                m_scene.descriptorSetTLAS(imageIndex));
+    }
+
+    /* Perform forward subpass */
+    vkCmdNextSubpass(commandBufferDeferred, VK_SUBPASS_CONTENTS_INLINE);
+    {
+        /* Transparent objects are sorted back to front and culled by the scene before recording */
+        std::unordered_map<MaterialType, VulkanRendererForward *> renderers = {
+            {MaterialType::MATERIAL_LAMBERT, &m_rendererLambert}, {MaterialType::MATERIAL_PBR_STANDARD, &m_rendererPBR}};
+        for (auto itr : m_scene.m_instances.visibleTransparentMeshes()) {
+            auto renderer = renderers[itr->get<ComponentMaterial>().material()->type()];
+
+            renderer->renderObject(commandBufferDeferred,
+                                   m_scene.m_instances,
+                                   m_scene.m_instances.visibleInstancesBuffer(imageIndex),
+                                   m_scene.descriptorSetSceneData(imageIndex),
+                                   m_scene.descriptorSetInstanceData(imageIndex),
+                                   m_scene.descriptorSetLight(imageIndex),
+                                   skybox->getDescriptor(imageIndex),
+                                   m_materials.descriptorSet(imageIndex),
+                                   m_textures.descriptorSet(),
+                                   m_scene.descriptorSetTLAS(imageIndex),
+                                   itr,
+                                   m_scene.instancesManager().lights());
         }
+    }
 
-        /* Perform forward subpass */
-        vkCmdNextSubpass(commandBufferDeferred, VK_SUBPASS_CONTENTS_INLINE);
-        {
-            /* Sort with distance to camera */
-            glm::vec3 cameraPos = m_scene.camera()->transform().position();
-            m_scene.m_instances.sortTransparent(cameraPos);
-
-            std::unordered_map<MaterialType, VulkanRendererForward *> renderers = {
-                {MaterialType::MATERIAL_LAMBERT, &m_rendererLambert}, {MaterialType::MATERIAL_PBR_STANDARD, &m_rendererPBR}};
-            for (auto itr : m_scene.m_instances.transparentMeshes()) {
-                auto renderer = renderers[itr->get<ComponentMaterial>().material()->type()];
-
-                renderer->renderObject(commandBufferDeferred,
-                                       m_scene.m_instances,
-                                       m_scene.descriptorSetSceneData(imageIndex),
-                                       m_scene.descriptorSetInstanceData(imageIndex),
-                                       m_scene.descriptorSetLight(imageIndex),
-                                       skybox->getDescriptor(imageIndex),
-                                       m_materials.descriptorSet(imageIndex),
-                                       m_textures.descriptorSet(),
-                                       m_scene.descriptorSetTLAS(imageIndex),
-                                       itr,
-                                       m_scene.instancesManager().lights());
-            }
+    vkCmdEndRenderPass(commandBufferDeferred);
+    vkEndCommandBuffer(commandBufferDeferred);
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::recordOverlayPass()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
+    uint32_t imageIndex = m_imageIndex;
+
+    VkCommandBuffer &commandBufferOverlay = m_commandBufferOverlay[m_currentFrame];
+    VULKAN_CHECK(vkResetCommandBuffer(commandBufferOverlay, 0));
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferOverlay, &beginInfo));
+
+    /* Render a transform if an object is selected */
+    VkRenderPassBeginInfo rpBeginInfo =
+        vkinit::renderPassBeginInfo(m_renderPassOverlay.renderPass(), m_framebufferOverlay.framebuffer(imageIndex), 0, nullptr);
+    rpBeginInfo.renderArea.extent = m_swapchain.extent();
+    vkCmdBeginRenderPass(commandBufferOverlay, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    bool has_selected = m_selectedObject != nullptr;
+    if (has_selected) {
+        if (m_showSelectedAABB) {
+            m_rendererOverlay.renderAABB3(commandBufferOverlay,
+                                          m_scene.descriptorSetSceneData(imageIndex),
+                                          m_selectedObject->AABB(),
+                                          m_scene.camera());
         }
 
-        vkCmdEndRenderPass(commandBufferDeferred);
-        vkEndCommandBuffer(commandBufferDeferred);
+        glm::vec3 transformPosition = m_selectedObject->worldPosition();
+        m_rendererOverlay.render3DTransform(commandBufferOverlay,
+                                            m_scene.descriptorSetSceneData(imageIndex),
+                                            m_selectedObject->modelMatrix(),
+                                            m_scene.camera());
+
+        m_rendererOverlay.renderOutline(commandBufferOverlay,
+                                        m_scene.descriptorSetSceneData(imageIndex),
+                                        m_selectedObject,
+                                        m_scene.camera());
+    }
+
+    vkCmdEndRenderPass(commandBufferOverlay);
+    vkEndCommandBuffer(commandBufferOverlay);
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::recordOutputPass()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
+    uint32_t imageIndex = m_imageIndex;
+
+    VkCommandBuffer &commandBufferOutput = m_commandBufferOutput[m_currentFrame];
+    VULKAN_CHECK(vkResetCommandBuffer(commandBufferOutput, 0));
 
-        /* Submit deferred command buffer */
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferOutput, &beginInfo));
+
+    /* Render internal color target to swapchain image */
+    {
+        VkClearValue clearValue;
+        clearValue.color = {0, 0, 0, 0};
+        VkRenderPassBeginInfo rpBeginInfo = vkinit::renderPassBeginInfo(
+            m_renderPassOutput.renderPass(), m_framebufferOutput.framebuffer(imageIndex), 1, &clearValue);
+        rpBeginInfo.renderArea.extent = m_swapchain.extent();
+        vkCmdBeginRenderPass(commandBufferOutput, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        m_rendererOutput.render(commandBufferOutput, m_scene.descriptorSetSceneData(imageIndex), imageIndex);
+
+        vkCmdEndRenderPass(commandBufferOutput);
+        vkEndCommandBuffer(commandBufferOutput);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRenderer::submitFrame()
+{
+    if (!m_frameStarted)
+        return VK_SUCCESS;
+
+    m_frameStarted = false;
+
+    /* Submit deferred command buffer */
+    {
         VkSemaphore waitSemaphores[] = {m_semaphoreImageAvailable[m_currentFrame]};
         VkSemaphore signalSemaphores[] = {m_semaphoreDeferredFinished[m_currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &commandBufferDeferred);
+        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &m_commandBufferDeferred[m_currentFrame]);
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
@@ -386,49 +543,12 @@ VkResult VulkanRenderer::buildFrame(uint32_t imageIndex)
         VULKAN_CHECK(vkQueueSubmit(m_vkctx.queueManager().renderQueue(), 1, &submitInfo, VK_NULL_HANDLE));
     }
 
-    /* Overlay pass */
+    /* Submit overlay command buffer */
     {
-        VkCommandBuffer &commandBufferOverlay = m_commandBufferOverlay[m_currentFrame];
-        VULKAN_CHECK(vkResetCommandBuffer(commandBufferOverlay, 0));
-
-        VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
-        VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferOverlay, &beginInfo));
-
-        /* Render a transform if an object is selected */
-        VkRenderPassBeginInfo rpBeginInfo =
-            vkinit::renderPassBeginInfo(m_renderPassOverlay.renderPass(), m_framebufferOverlay.framebuffer(imageIndex), 0, nullptr);
-        rpBeginInfo.renderArea.extent = m_swapchain.extent();
-        vkCmdBeginRenderPass(commandBufferOverlay, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        bool has_selected = m_selectedObject != nullptr;
-        if (has_selected) {
-            if (m_showSelectedAABB) {
-                m_rendererOverlay.renderAABB3(commandBufferOverlay,
-                                              m_scene.descriptorSetSceneData(imageIndex),
-                                              m_selectedObject->AABB(),
-                                              m_scene.camera());
-            }
-
-            glm::vec3 transformPosition = m_selectedObject->worldPosition();
-            m_rendererOverlay.render3DTransform(commandBufferOverlay,
-                                                m_scene.descriptorSetSceneData(imageIndex),
-                                                m_selectedObject->modelMatrix(),
-                                                m_scene.camera());
-
-            m_rendererOverlay.renderOutline(commandBufferOverlay,
-                                            m_scene.descriptorSetSceneData(imageIndex),
-                                            m_selectedObject,
-                                            m_scene.camera());
-        }
-
-        vkCmdEndRenderPass(commandBufferOverlay);
-        vkEndCommandBuffer(commandBufferOverlay);
-
-        /* Submit post command buffer */
         VkSemaphore waitSemaphores[] = {m_semaphoreDeferredFinished[m_currentFrame]};
         VkSemaphore signalSemaphores[] = {m_semaphoreOverlayFinished[m_currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &commandBufferOverlay);
+        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &m_commandBufferOverlay[m_currentFrame]);
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
@@ -437,61 +557,12 @@ VkResult VulkanRenderer::buildFrame(uint32_t imageIndex)
         VULKAN_CHECK(vkQueueSubmit(m_vkctx.queueManager().renderQueue(), 1, &submitInfo, VK_NULL_HANDLE));
     }
 
-    /* Output pass */
+    /* Submit output command buffer */
     {
-        VkCommandBuffer &commandBufferOutput = m_commandBufferOutput[m_currentFrame];
-        VULKAN_CHECK(vkResetCommandBuffer(commandBufferOutput, 0));
-
-        VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
-        VULKAN_CHECK_CRITICAL(vkBeginCommandBuffer(commandBufferOutput, &beginInfo));
-
-        /* Copy Gbuffer 1 attachment to selection iamge */
-        {
-            VkImageSubresourceRange subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
-
-            /* Transition attachment to transfer source optimal */
-            transitionImageLayout(commandBufferOutput,
-                                  m_attachmentGBuffer1.image(imageIndex).image(),
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                  subresourceRange);
-
-            /* Copy images */
-            VkImageCopy copyRegion{};
-            copyRegion.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-            copyRegion.srcOffset = {0, 0, 0};
-            copyRegion.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-            copyRegion.dstOffset = {0, 0, 0};
-            copyRegion.extent = {m_swapchain.extent().width, m_swapchain.extent().height, 1};
-            vkCmdCopyImage(commandBufferOutput,
-                           m_attachmentGBuffer1.image(imageIndex).image(),
-                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                           m_imageSelection.image(),
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1,
-                           &copyRegion);
-        }
-
-        /* Render internal color target to swapchain image */
-        {
-            VkClearValue clearValue;
-            clearValue.color = {0, 0, 0, 0};
-            VkRenderPassBeginInfo rpBeginInfo = vkinit::renderPassBeginInfo(
-                m_renderPassOutput.renderPass(), m_framebufferOutput.framebuffer(imageIndex), 1, &clearValue);
-            rpBeginInfo.renderArea.extent = m_swapchain.extent();
-            vkCmdBeginRenderPass(commandBufferOutput, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-            m_rendererOutput.render(commandBufferOutput, m_scene.descriptorSetSceneData(imageIndex), imageIndex);
-
-            vkCmdEndRenderPass(commandBufferOutput);
-            vkEndCommandBuffer(commandBufferOutput);
-        }
-
-        /* Submit output command buffer */
         VkSemaphore waitSemaphores[] = {m_semaphoreOverlayFinished[m_currentFrame]};
         VkSemaphore signalSemaphores[] = {m_semaphoreOutputFinished[m_currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &commandBufferOutput);
+        VkSubmitInfo submitInfo = vkinit::submitInfo(1, &m_commandBufferOutput[m_currentFrame]);
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
@@ -500,6 +571,18 @@ VkResult VulkanRenderer::buildFrame(uint32_t imageIndex)
         VULKAN_CHECK(vkQueueSubmit(m_vkctx.queueManager().renderQueue(), 1, &submitInfo, m_fenceInFlight[m_currentFrame]));
     }
 
+    /* Present to swapchain */
+    VkSemaphore waitSemaphores[] = {m_semaphoreOutputFinished[m_currentFrame]};
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = waitSemaphores;
+    VkSwapchainKHR swapChains[] = {m_swapchain.swapchain()};
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = swapChains;
+    presentInfo.pImageIndices = &m_imageIndex;
+    VULKAN_CHECK(vkQueuePresentKHR(m_vkctx.queueManager().presentQueue(), &presentInfo));
+
     return VK_SUCCESS;
 }
 
@@ -508,33 +591,21 @@ RendererPathTracing &VulkanRenderer::rendererPathTracing()
     return m_rendererPathTracing;
 }
 
-ID VulkanRenderer::findID(float x, float y)
+ID VulkanRenderer::findID(float x, float y, ThreadPool &threadPool)
 {
-    /* Get the texel color at this row and column of the highlight render target */
-    uint32_t row = static_cast<uint32_t>(y * m_swapchain.extent().height);
-    uint32_t column = static_cast<uint32_t>(x * m_swapchain.extent().width);
-
-    /* Since the image is stored in linear tiling, get the subresource layout to calculate the padding */
-    VkImageSubresource subResource{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
-    VkSubresourceLayout subResourceLayout;
-    vkGetImageSubresourceLayout(m_vkctx.device(), m_imageSelection.image(), &subResource, &subResourceLayout);
-
-    /* Byte index of x,y texel */
-    uint32_t index = (row * static_cast<uint32_t>(subResourceLayout.rowPitch) + column * 4 * sizeof(float));
-
-    /* Store highlight render result for that texel to the disk */
-    float *gbuffer1Tex;
-    VkResult res = vkMapMemory(m_vkctx.device(),
-                               m_imageSelection.memory(),
-                               subResourceLayout.offset + index,
-                               4 * sizeof(float),
-                               0,
-                               reinterpret_cast<void **>(&gbuffer1Tex));
-    float id;
-    memcpy(&id, gbuffer1Tex + 3, sizeof(float));
-    vkUnmapMemory(m_vkctx.device(), m_imageSelection.memory());
-
-    return static_cast<ID>(id);
+    if (m_scene.camera() == nullptr)
+        return 0;
+
+    Ray ray = m_scene.cameraRay(x, y);
+
+    if (m_selectedObject != nullptr) {
+        ID arrow = m_rendererOverlay.pick3DTransform(ray, m_selectedObject->modelMatrix(), m_scene.camera(), threadPool);
+        if (arrow != 0)
+            return arrow;
+    }
+
+    SceneObject *object = m_scene.pick(ray, 1.0F);
+    return (object != nullptr ? object->getID() : 0);
 }
 
 VkResult VulkanRenderer::createRenderPasses()
@@ -565,7 +636,7 @@ VkResult VulkanRenderer::createFrameBuffers()
                                         swapchainExtent.height,
                                         m_formatGBuffer1,
                                         VK_SAMPLE_COUNT_1_BIT,
-                                        VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT),
+                                        VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT),
         swapchainImages));
     VULKAN_CHECK_CRITICAL(m_attachmentGBuffer2.init(m_vkctx,
                                                     VulkanFrameBufferAttachmentInfo("GBuffer 2",
@@ -628,19 +699,27 @@ VkResult VulkanRenderer::createCommandBuffers()
     m_commandBufferOverlay.resize(MAX_FRAMES_IN_FLIGHT);
     m_commandBufferOutput.resize(MAX_FRAMES_IN_FLIGHT);
 
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_vkctx.queueManager().renderQueueIndex().first;
+    VULKAN_CHECK_CRITICAL(vkCreateCommandPool(m_vkctx.device(), &poolInfo, nullptr, &m_commandPoolDeferred));
+    VULKAN_CHECK_CRITICAL(vkCreateCommandPool(m_vkctx.device(), &poolInfo, nullptr, &m_commandPoolOverlay));
+    VULKAN_CHECK_CRITICAL(vkCreateCommandPool(m_vkctx.device(), &poolInfo, nullptr, &m_commandPoolOutput));
+
     {
         VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_vkctx.renderCommandPool(), static_cast<uint32_t>(m_commandBufferDeferred.size()));
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_commandPoolDeferred, static_cast<uint32_t>(m_commandBufferDeferred.size()));
         VULKAN_CHECK_CRITICAL(vkAllocateCommandBuffers(m_vkctx.device(), &allocInfo, m_commandBufferDeferred.data()));
     }
     {
         VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_vkctx.renderCommandPool(), static_cast<uint32_t>(m_commandBufferOverlay.size()));
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_commandPoolOverlay, static_cast<uint32_t>(m_commandBufferOverlay.size()));
         VULKAN_CHECK_CRITICAL(vkAllocateCommandBuffers(m_vkctx.device(), &allocInfo, m_commandBufferOverlay.data()));
     }
     {
         VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_vkctx.renderCommandPool(), static_cast<uint32_t>(m_commandBufferOutput.size()));
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_commandPoolOutput, static_cast<uint32_t>(m_commandBufferOutput.size()));
         VULKAN_CHECK_CRITICAL(vkAllocateCommandBuffers(m_vkctx.device(), &allocInfo, m_commandBufferOutput.data()));
     }
 
@@ -672,36 +751,4 @@ VkResult VulkanRenderer::createSyncObjects()
     return VK_SUCCESS;
 }
 
-VkResult VulkanRenderer::createSelectionImage()
-{
-    /* Create image used to copy gbuffer 1 result from gpu memory to cpu memory */
-    VkImageCreateInfo imageInfo = vkinit::imageCreateInfo({m_swapchain.extent().width, m_swapchain.extent().height, 1},
-                                                          m_formatGBuffer1,
-                                                          1,
-                                                          VK_SAMPLE_COUNT_1_BIT,
-                                                          VK_IMAGE_TILING_LINEAR,
-                                                          VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-    VULKAN_CHECK_CRITICAL(createImage(m_vkctx.physicalDevice(),
-                                      m_vkctx.device(),
-                                      imageInfo,
-                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                      m_imageSelection.image(),
-                                      m_imageSelection.memory()));
-
-    /* Transition image to the approriate layout ready for render */
-    VkCommandBuffer cmdBuf;
-    VULKAN_CHECK_CRITICAL(beginSingleTimeCommands(m_vkctx.device(), m_vkctx.graphicsCommandPool(), cmdBuf));
-
-    transitionImageLayout(cmdBuf,
-                          m_imageSelection.image(),
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                          {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1});
-
-    VULKAN_CHECK_CRITICAL(
-        endSingleTimeCommands(m_vkctx.device(), m_vkctx.graphicsCommandPool(), m_vkctx.queueManager().graphicsQueue(), cmdBuf));
-
-    return VK_SUCCESS;
-}
-
 }  // namespace vengine
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include "vulkan/common/VulkanUtils.hpp"
 #include "vulkan/common/VulkanStructs.hpp"
 #include "vulkan/common/IncludeVulkan.hpp"
+#include "vulkan/renderers/VulkanRendererCulling.hpp"
 #include "vulkan/renderers/VulkanRendererGBuffer.hpp"
 #include "vulkan/renderers/VulkanRendererLightComposition.hpp"
 #include "vulkan/renderers/VulkanRendererPBRStandard.hpp"
@@ -60,11 +61,33 @@ public:
     RendererPathTracing &rendererPathTracing() override;
     VulkanRendererSkybox &rendererSkybox() { return m_rendererSkybox; }
 
-    /* Find the id of the object that is renderd in x, y pixel coordinates */
-    ID findID(float x, float y);
+    /* Find the id of the object that is rendered in x, y viewport coordinates in [0, 1], from the top left corner. The arrows of
+     * the transform widget are on top of the scene, so they are tested first. Don't call while the scene is updated */
+    ID findID(float x, float y, ThreadPool &threadPool);
 
+    /* Run all frame stages in order on the calling thread */
     VkResult renderFrame();
 
+    /* Cull the scene instances for the next frame, the opaque instances are left to the culling compute pass if GPU culling
+     * is used. Runs after the transparent sort of the scene and before updateSceneBuffers() */
+    void cullInstances();
+
+    /**
+     * Frame stages. The buffer updates need beginFrame(), the pass recordings need the buffer updates and the transparent sort
+     * of the scene, and submitFrame() needs all recordings. The buffer updates can run in parallel, and so can the
+     * recordings, since each pass records into a command buffer of its own command pool. Stages after a failed beginFrame()
+     * do nothing
+     */
+    VkResult beginFrame();
+    VkResult updateSceneBuffers();
+    VkResult updateMaterialBuffers();
+    VkResult updateTextures();
+    VkResult recordDeferredPass();
+    VkResult recordOverlayPass();
+    VkResult recordOutputPass();
+    /* Submit the recorded passes and present, does nothing if no frame was started */
+    VkResult submitFrame();
+
     /* Blocks and waits for the renderer to idle, stop the renderer before waiting here */
     void waitIdle();
 
@@ -75,11 +98,6 @@ private:
     VkResult createCommandBuffers();
     VkResult createSyncObjects();
 
-    VkResult createSelectionImage();
-
-    /* Render */
-    VkResult buildFrame(uint32_t imageIndex);
-
 private:
     VulkanContext &m_vkctx;
     VulkanSwapchain &m_swapchain;
@@ -103,10 +121,8 @@ private:
     VulkanFrameBuffer m_framebufferOverlay;
     VulkanFrameBuffer m_framebufferOutput;
 
-    /* Object selection image */
-    VulkanImage m_imageSelection;
-
     /* Renderers */
+    VulkanRendererCulling m_rendererCulling;
     VulkanRendererLightComposition m_rendererLightComposition;
     VulkanRendererGBuffer m_rendererGBuffer;
     VulkanRendererPBR m_rendererPBR;
@@ -121,6 +137,16 @@ private:
     std::vector<VkFence> m_fenceInFlight;
     const uint32_t MAX_FRAMES_IN_FLIGHT = 3;
     uint32_t m_currentFrame = 0;
+    /* Swapchain image of the frame started with beginFrame() */
+    uint32_t m_imageIndex = 0;
+    bool m_frameStarted = false;
+    /* If the frame culls and draws the opaque instances on the GPU, set by cullInstances() */
+    bool m_gpuCullingFrame = false;
+
+    /* A command pool per pass, so that passes can be recorded from different threads */
+    VkCommandPool m_commandPoolDeferred;
+    VkCommandPool m_commandPoolOverlay;
+    VkCommandPool m_commandPoolOutput;
 
     std::vector<VkCommandBuffer> m_commandBufferDeferred;
     std::vector<VkSemaphore> m_semaphoreDeferredFinished;
@@ -0,0 +1,281 @@
+#include "VulkanRendererCulling.hpp"
+
+#include <array>
+
+#include "vulkan/common/VulkanInitializers.hpp"
+#include "vulkan/common/VulkanLimits.hpp"
+#include "vulkan/common/VulkanShader.hpp"
+#include "vulkan/common/VulkanUtils.hpp"
+
+namespace vengine
+{
+
+VulkanRendererCulling::VulkanRendererCulling(VulkanContext &context)
+    : m_ctx(context)
+{
+}
+
+VkResult VulkanRendererCulling::initResources(VkDescriptorSetLayout instanceDataDescriptorLayout)
+{
+    m_descriptorSetLayoutInstanceData = instanceDataDescriptorLayout;
+
+    VULKAN_CHECK_CRITICAL(createDescriptorSetsLayout());
+    VULKAN_CHECK_CRITICAL(createPipeline());
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::initSwapChainResources(uint32_t swapchainImages)
+{
+    m_meshGroups.resize(swapchainImages);
+    m_pushConstants.resize(swapchainImages);
+
+    VULKAN_CHECK_CRITICAL(createBuffers(swapchainImages));
+    VULKAN_CHECK_CRITICAL(createDescriptorPool(swapchainImages));
+    VULKAN_CHECK_CRITICAL(createDescriptors(swapchainImages));
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::releaseResources()
+{
+    vkDestroyPipeline(m_ctx.device(), m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_ctx.device(), m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_ctx.device(), m_descriptorSetLayout, nullptr);
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::releaseSwapChainResources()
+{
+    for (auto buffers : {&m_meshGroupsBuffers, &m_drawCommandsBuffers, &m_drawCountsBuffers, &m_visibleInstancesBuffers}) {
+        for (VulkanBuffer &buffer : *buffers) {
+            buffer.destroy(m_ctx.device());
+        }
+        buffers->clear();
+    }
+    m_meshGroups.clear();
+
+    vkDestroyDescriptorPool(m_ctx.device(), m_descriptorPool, nullptr);
+
+    return VK_SUCCESS;
+}
+
+void VulkanRendererCulling::updateBuffers(const VulkanInstancesManager &instances,
+                                          const glm::mat4 &viewProjection,
+                                          uint32_t imageIndex)
+{
+    std::vector<const VulkanMesh *> &meshGroups = m_meshGroups[imageIndex];
+    meshGroups.clear();
+
+    void *groupsData, *commandsData, *countsData;
+    vkMapMemory(m_ctx.device(), m_meshGroupsBuffers[imageIndex].memory(), 0, VK_WHOLE_SIZE, 0, &groupsData);
+    vkMapMemory(m_ctx.device(), m_drawCommandsBuffers[imageIndex].memory(), 0, VK_WHOLE_SIZE, 0, &commandsData);
+    vkMapMemory(m_ctx.device(), m_drawCountsBuffers[imageIndex].memory(), 0, VK_WHOLE_SIZE, 0, &countsData);
+    auto groups = static_cast<CullingMeshGroup *>(groupsData);
+    auto commands = static_cast<VkDrawIndexedIndirectCommand *>(commandsData);
+    auto counts = static_cast<uint32_t *>(countsData);
+
+    /* The instances of all groups are numbered in one flat index space, a thread of the compute pass tests one instance */
+    uint32_t nInstances = 0;
+    for (auto &meshGroup : instances.opaqueMeshes()) {
+        const InstancesManager::MeshGroup &group = meshGroup.second;
+        uint32_t nGroupObjects = static_cast<uint32_t>(group.sceneObjects.size());
+        if (nGroupObjects == 0)
+            continue;
+
+        assert(meshGroups.size() < VULKAN_LIMITS_MAX_MESH_GROUPS);
+
+        const VulkanMesh *vkmesh = static_cast<const VulkanMesh *>(meshGroup.first);
+        assert(vkmesh != nullptr);
+
+        uint32_t g = static_cast<uint32_t>(meshGroups.size());
+        meshGroups.push_back(vkmesh);
+
+        groups[g].min = glm::vec4(vkmesh->aabb().min(), 0);
+        groups[g].max = glm::vec4(vkmesh->aabb().max(), 0);
+        groups[g].info = glm::uvec4(group.startIndex, nGroupObjects, nInstances, vkmesh->nLODs());
+
+        /* The compute pass counts the visible instances, the instance attributes of a level are read starting at the group's
+         * range of the level's part of the visible instances */
+        for (uint32_t l = 0; l < Mesh::MAX_LODS; l++) {
+            VkDrawIndexedIndirectCommand &command = commands[g * Mesh::MAX_LODS + l];
+            Mesh::LOD lod = l < vkmesh->nLODs() ? vkmesh->lod(l) : Mesh::LOD{0, 0};
+            command.indexCount = lod.nIndices;
+            command.instanceCount = 0;
+            command.firstIndex = lod.firstIndex;
+            command.vertexOffset = 0;
+            command.firstInstance = l * VULKAN_LIMITS_MAX_OBJECTS + group.startIndex;
+        }
+        counts[g] = 0;
+
+        nInstances += nGroupObjects;
+    }
+
+    vkUnmapMemory(m_ctx.device(), m_meshGroupsBuffers[imageIndex].memory());
+    vkUnmapMemory(m_ctx.device(), m_drawCommandsBuffers[imageIndex].memory());
+    vkUnmapMemory(m_ctx.device(), m_drawCountsBuffers[imageIndex].memory());
+
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    PushBlockCulling &pushConstants = m_pushConstants[imageIndex];
+    for (uint32_t i = 0; i < 6; i++) {
+        pushConstants.planes[i] = frustum.plane(i);
+    }
+    pushConstants.lodRow = InstancesManager::screenSizeRow(viewProjection) / Mesh::LOD_SCREEN_SIZE;
+    pushConstants.info = glm::uvec4(nInstances, static_cast<uint32_t>(meshGroups.size()), Mesh::MAX_LODS, 0);
+}
+
+void VulkanRendererCulling::record(VkCommandBuffer cmdBuf, VkDescriptorSet &descriptorInstanceData, uint32_t imageIndex) const
+{
+    const PushBlockCulling &pushConstants = m_pushConstants[imageIndex];
+    uint32_t nInstances = pushConstants.info.r;
+    if (nInstances == 0)
+        return;
+
+    vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdPushConstants(cmdBuf, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushBlockCulling), &pushConstants);
+
+    std::array<VkDescriptorSet, 2> descriptorSets = {descriptorInstanceData, m_descriptorSets[imageIndex]};
+    vkCmdBindDescriptorSets(cmdBuf,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_pipelineLayout,
+                            0,
+                            static_cast<uint32_t>(descriptorSets.size()),
+                            descriptorSets.data(),
+                            0,
+                            nullptr);
+
+    vkCmdDispatch(cmdBuf, (nInstances + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    /* The draw commands and the visible instances are consumed by the indirect draws */
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuf,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+}
+
+VkResult VulkanRendererCulling::createDescriptorSetsLayout()
+{
+    /* Binding 0, mesh groups. Binding 1, draw commands. Binding 2, draw counts. Binding 3, visible instances */
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (uint32_t b = 0; b < 4; b++) {
+        bindings.push_back(vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, b, 1));
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo =
+        vkinit::descriptorSetLayoutCreateInfo(static_cast<uint32_t>(bindings.size()), bindings.data());
+    VULKAN_CHECK_CRITICAL(vkCreateDescriptorSetLayout(m_ctx.device(), &layoutInfo, nullptr, &m_descriptorSetLayout));
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::createDescriptorPool(uint32_t imageCount)
+{
+    VkDescriptorPoolSize storagePoolSize = vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * imageCount);
+    std::vector<VkDescriptorPoolSize> poolSizes = {storagePoolSize};
+
+    VkDescriptorPoolCreateInfo poolInfo =
+        vkinit::descriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), imageCount);
+    VULKAN_CHECK_CRITICAL(vkCreateDescriptorPool(m_ctx.device(), &poolInfo, nullptr, &m_descriptorPool));
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::createDescriptors(uint32_t imageCount)
+{
+    m_descriptorSets.resize(imageCount);
+
+    std::vector<VkDescriptorSetLayout> setLayouts(imageCount, m_descriptorSetLayout);
+    VkDescriptorSetAllocateInfo setAllocInfo = vkinit::descriptorSetAllocateInfo(m_descriptorPool, imageCount, setLayouts.data());
+    VULKAN_CHECK_CRITICAL(vkAllocateDescriptorSets(m_ctx.device(), &setAllocInfo, m_descriptorSets.data()));
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos = {
+            vkinit::descriptorBufferInfo(m_meshGroupsBuffers[i].buffer(), 0, VK_WHOLE_SIZE),
+            vkinit::descriptorBufferInfo(m_drawCommandsBuffers[i].buffer(), 0, VK_WHOLE_SIZE),
+            vkinit::descriptorBufferInfo(m_drawCountsBuffers[i].buffer(), 0, VK_WHOLE_SIZE),
+            vkinit::descriptorBufferInfo(m_visibleInstancesBuffers[i].buffer(), 0, VK_WHOLE_SIZE),
+        };
+
+        std::vector<VkWriteDescriptorSet> setWrites;
+        for (uint32_t b = 0; b < bufferInfos.size(); b++) {
+            setWrites.push_back(
+                vkinit::writeDescriptorSet(m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, b, 1, &bufferInfos[b]));
+        }
+        vkUpdateDescriptorSets(m_ctx.device(), static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::createBuffers(uint32_t imageCount)
+{
+    m_meshGroupsBuffers.resize(imageCount);
+    m_drawCommandsBuffers.resize(imageCount);
+    m_drawCountsBuffers.resize(imageCount);
+    m_visibleInstancesBuffers.resize(imageCount);
+
+    /* The mesh groups and the reset draw commands are written by the host every frame */
+    VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VULKAN_CHECK_CRITICAL(createBuffer(m_ctx.physicalDevice(),
+                                           m_ctx.device(),
+                                           VULKAN_LIMITS_MAX_MESH_GROUPS * sizeof(CullingMeshGroup),
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                           hostMemory,
+                                           m_meshGroupsBuffers[i]));
+        VULKAN_CHECK_CRITICAL(createBuffer(m_ctx.physicalDevice(),
+                                           m_ctx.device(),
+                                           VULKAN_LIMITS_MAX_MESH_GROUPS * Mesh::MAX_LODS * sizeof(VkDrawIndexedIndirectCommand),
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                           hostMemory,
+                                           m_drawCommandsBuffers[i]));
+        VULKAN_CHECK_CRITICAL(createBuffer(m_ctx.physicalDevice(),
+                                           m_ctx.device(),
+                                           VULKAN_LIMITS_MAX_MESH_GROUPS * sizeof(uint32_t),
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                           hostMemory,
+                                           m_drawCountsBuffers[i]));
+        VULKAN_CHECK_CRITICAL(createBuffer(m_ctx.physicalDevice(),
+                                           m_ctx.device(),
+                                           Mesh::MAX_LODS * VULKAN_LIMITS_MAX_OBJECTS * sizeof(uint32_t),
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           m_visibleInstancesBuffers[i]));
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererCulling::createPipeline()
+{
+    VkShaderModule computeShader = VulkanShader::load(m_ctx.device(), "shaders/SPIRV/cull.comp.spv");
+
+    std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = {m_descriptorSetLayoutInstanceData, m_descriptorSetLayout};
+    VkPushConstantRange pushConstantRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(PushBlockCulling), 0);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo(
+        static_cast<uint32_t>(descriptorSetLayouts.size()), descriptorSetLayouts.data(), 1, &pushConstantRange);
+    VULKAN_CHECK_CRITICAL(vkCreatePipelineLayout(m_ctx.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, computeShader, "main");
+    pipelineInfo.layout = m_pipelineLayout;
+    VULKAN_CHECK_CRITICAL(vkCreateComputePipelines(m_ctx.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+
+    vkDestroyShaderModule(m_ctx.device(), computeShader, nullptr);
+
+    return VK_SUCCESS;
+}
+
+}  // namespace vengine
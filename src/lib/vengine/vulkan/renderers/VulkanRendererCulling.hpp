@@ -0,0 +1,86 @@
+#ifndef __VulkanRendererCulling_hpp__
+#define __VulkanRendererCulling_hpp__
+
+#include <vector>
+
+#include "math/Frustum.hpp"
+#include "vulkan/common/IncludeVulkan.hpp"
+#include "vulkan/common/VulkanStructs.hpp"
+#include "vulkan/resources/VulkanBuffer.hpp"
+#include "vulkan/resources/VulkanMesh.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include "vulkan/VulkanInstances.hpp"
+
+namespace vengine
+{
+
+/**
+ * @brief Frustum culls the opaque instances in a compute pass. Every instance of a mesh group is tested against the frustum
+ * with its mesh AABB and model matrix, and the visible ones select a level of detail by their screen size, append their
+ * InstanceData index to the visible instances of that level and increment the instance count of the level's indexed indirect
+ * draw command. A group has Mesh::MAX_LODS draw commands and its draw count is set to 1 + the highest level drawn, so that
+ * empty groups are skipped by vkCmdDrawIndexedIndirectCountKHR
+ */
+class VulkanRendererCulling
+{
+public:
+    VulkanRendererCulling(VulkanContext &context);
+
+    VkResult initResources(VkDescriptorSetLayout instanceDataDescriptorLayout);
+    VkResult initSwapChainResources(uint32_t swapchainImages);
+
+    VkResult releaseResources();
+    VkResult releaseSwapChainResources();
+
+    /**
+     * @brief Write the mesh groups and reset the draw commands of a swapchain image
+     *
+     * @param instances The instances, at most VULKAN_LIMITS_MAX_MESH_GROUPS opaque mesh groups
+     * @param viewProjection The camera projection * view matrix
+     * @param imageIndex
+     */
+    void updateBuffers(const VulkanInstancesManager &instances, const glm::mat4 &viewProjection, uint32_t imageIndex);
+
+    /* Record the culling dispatch and the barrier to the indirect draws, outside of a render pass */
+    void record(VkCommandBuffer cmdBuf, VkDescriptorSet &descriptorInstanceData, uint32_t imageIndex) const;
+
+    /* The meshes of the groups of draw commands of an image, in order */
+    const std::vector<const VulkanMesh *> &meshGroups(uint32_t imageIndex) const { return m_meshGroups[imageIndex]; }
+
+    const VulkanBuffer &drawCommandsBuffer(uint32_t imageIndex) const { return m_drawCommandsBuffers[imageIndex]; }
+    const VulkanBuffer &drawCountsBuffer(uint32_t imageIndex) const { return m_drawCountsBuffers[imageIndex]; }
+    /* Per instance vertex buffer with the visible InstanceData indices. Level l of a group is written starting at
+     * l * VULKAN_LIMITS_MAX_OBJECTS + the group's start index */
+    const VulkanBuffer &visibleInstancesBuffer(uint32_t imageIndex) const { return m_visibleInstancesBuffers[imageIndex]; }
+
+private:
+    static const uint32_t WORKGROUP_SIZE = 64;
+
+    VulkanContext &m_ctx;
+
+    VkDescriptorSetLayout m_descriptorSetLayoutInstanceData;
+    VkDescriptorSetLayout m_descriptorSetLayout;
+    VkDescriptorPool m_descriptorPool;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+
+    VkPipelineLayout m_pipelineLayout;
+    VkPipeline m_pipeline;
+
+    /* Per swapchain image */
+    std::vector<VulkanBuffer> m_meshGroupsBuffers;
+    std::vector<VulkanBuffer> m_drawCommandsBuffers;
+    std::vector<VulkanBuffer> m_drawCountsBuffers;
+    std::vector<VulkanBuffer> m_visibleInstancesBuffers;
+    std::vector<std::vector<const VulkanMesh *>> m_meshGroups;
+    std::vector<PushBlockCulling> m_pushConstants;
+
+    VkResult createDescriptorSetsLayout();
+    VkResult createDescriptorPool(uint32_t imageCount);
+    VkResult createDescriptors(uint32_t imageCount);
+    VkResult createBuffers(uint32_t imageCount);
+    VkResult createPipeline();
+};
+
+}  // namespace vengine
+
+#endif
@@ -59,6 +59,7 @@ VkResult VulkanRendererForward::releaseSwapChainResources()
 
 VkResult VulkanRendererForward::renderObject(VkCommandBuffer &cmdBuf,
                                              const VulkanInstancesManager &instances,
+                                             VkBuffer visibleInstances,
                                              VkDescriptorSet &descriptorScene,
                                              VkDescriptorSet &descriptorModel,
                                              VkDescriptorSet &descriptorLight,
@@ -91,9 +92,10 @@ VkResult VulkanRendererForward::renderObject(VkCommandBuffer &cmdBuf,
         return VK_ERROR_UNKNOWN;
     }
 
-    VkBuffer vertexBuffers[] = {vkmesh->vertexBuffer().buffer()};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(cmdBuf, 0, 1, vertexBuffers, offsets);
+    /* The entry of a transparent object in the visible instances is its own InstanceData index */
+    VkBuffer vertexBuffers[] = {vkmesh->vertexBuffer().buffer(), visibleInstances};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(cmdBuf, 0, 2, vertexBuffers, offsets);
     vkCmdBindIndexBuffer(cmdBuf, vkmesh->indexBuffer().buffer(), 0, vkmesh->indexType());
 
     Material *material = vkobject->get<ComponentMaterial>().material();
@@ -120,7 +122,7 @@ VkResult VulkanRendererForward::renderObject(VkCommandBuffer &cmdBuf,
                        sizeof(PushBlockForward),
                        &pushConstants);
 
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, pushConstants.info.g);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, pushConstants.info.g);
 
     return VK_SUCCESS;
 }
@@ -132,14 +134,19 @@ VkResult VulkanRendererForward::createPipeline(const VulkanRenderPassDeferred &r
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo =
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vs, "main");
+    vertShaderStageInfo.pSpecializationInfo = VulkanVertex::getSpecializationInfo();
     VkPipelineShaderStageCreateInfo fragShaderStageInfo =
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fs, "main");
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = VulkanVertex::getBindingDescription();
-    auto attributeDescriptions = VulkanVertex::getAttributeDescriptionsFull();
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = vkinit::pipelineVertexInputStateCreateInfo(
-        1, &bindingDescription, static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {VulkanVertex::getBindingDescription(),
+                                                                          VulkanVertex::getBindingDescriptionInstance()};
+    auto attributeDescriptions = VulkanVertex::getAttributeDescriptionsInstanced();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo =
+        vkinit::pipelineVertexInputStateCreateInfo(static_cast<uint32_t>(bindingDescriptions.size()),
+                                                   bindingDescriptions.data(),
+                                                   static_cast<uint32_t>(attributeDescriptions.size()),
+                                                   attributeDescriptions.data());
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = vkinit::pipelineInputAssemblyCreateInfo();
 
@@ -33,6 +33,7 @@ public:
 
     VkResult renderObject(VkCommandBuffer &cmdBuf,
                           const VulkanInstancesManager &instances,
+                          VkBuffer visibleInstances,
                           VkDescriptorSet &descriptorSceneData,
                           VkDescriptorSet &descriptorInstanceData,
                           VkDescriptorSet &descriptorLightData,
@@ -2,6 +2,7 @@
 
 #include "utils/Algorithms.hpp"
 
+#include "vulkan/common/VulkanDeviceFunctions.hpp"
 #include "vulkan/common/VulkanInitializers.hpp"
 #include "vulkan/common/VulkanShader.hpp"
 #include "vulkan/resources/VulkanMesh.hpp"
@@ -50,10 +51,73 @@ VkResult VulkanRendererGBuffer::releaseSwapChainResources()
 
 VkResult VulkanRendererGBuffer::renderOpaqueInstances(VkCommandBuffer &cmdBuf,
                                                       const VulkanInstancesManager &instances,
+                                                      VkBuffer visibleInstances,
                                                       VkDescriptorSet &descriptorSceneData,
                                                       VkDescriptorSet &descriptorInstanceData,
                                                       VkDescriptorSet &descriptorMaterials,
                                                       VkDescriptorSet &descriptorTextures) const
+{
+    bindDescriptorSets(cmdBuf, descriptorSceneData, descriptorInstanceData, descriptorMaterials, descriptorTextures);
+
+    /* The InstanceData index of every drawn instance comes from the visible instances, the mesh groups bind binding 0 */
+    VkDeviceSize visibleInstancesOffset = 0;
+    vkCmdBindVertexBuffers(cmdBuf, 1, 1, &visibleInstances, &visibleInstancesOffset);
+
+    for (auto &meshGroup : instances.opaqueMeshes()) {
+        if (meshGroup.second.visibleCount == 0)
+            continue;
+
+        const VulkanMesh *vkmesh = static_cast<const VulkanMesh *>(meshGroup.first);
+        assert(vkmesh != nullptr);
+        renderMeshGroup(cmdBuf, vkmesh, meshGroup.second);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanRendererGBuffer::renderOpaqueInstancesIndirect(VkCommandBuffer &cmdBuf,
+                                                              const VulkanRendererCulling &culling,
+                                                              uint32_t imageIndex,
+                                                              VkDescriptorSet &descriptorSceneData,
+                                                              VkDescriptorSet &descriptorInstanceData,
+                                                              VkDescriptorSet &descriptorMaterials,
+                                                              VkDescriptorSet &descriptorTextures) const
+{
+    bindDescriptorSets(cmdBuf, descriptorSceneData, descriptorInstanceData, descriptorMaterials, descriptorTextures);
+
+    VkBuffer visibleInstances = culling.visibleInstancesBuffer(imageIndex).buffer();
+    VkDeviceSize visibleInstancesOffset = 0;
+    vkCmdBindVertexBuffers(cmdBuf, 1, 1, &visibleInstances, &visibleInstancesOffset);
+
+    /* Each mesh has its own vertex and index buffers, so every group is a separate indirect draw of one command per level of
+     * detail. The draw count of a group without visible instances is 0 */
+    auto drawIndexedIndirectCount = VulkanDeviceFunctions::getInstance().drawIndirectCount()->vkCmdDrawIndexedIndirectCountKHR;
+    const std::vector<const VulkanMesh *> &meshGroups = culling.meshGroups(imageIndex);
+    for (uint32_t g = 0; g < meshGroups.size(); g++) {
+        const VulkanMesh *vkmesh = meshGroups[g];
+
+        VkBuffer vertexBuffers[] = {vkmesh->vertexBuffer().buffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(cmdBuf, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(cmdBuf, vkmesh->indexBuffer().buffer(), 0, vkmesh->indexType());
+
+        drawIndexedIndirectCount(cmdBuf,
+                                 culling.drawCommandsBuffer(imageIndex).buffer(),
+                                 g * Mesh::MAX_LODS * sizeof(VkDrawIndexedIndirectCommand),
+                                 culling.drawCountsBuffer(imageIndex).buffer(),
+                                 g * sizeof(uint32_t),
+                                 Mesh::MAX_LODS,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    return VK_SUCCESS;
+}
+
+void VulkanRendererGBuffer::bindDescriptorSets(VkCommandBuffer &cmdBuf,
+                                               VkDescriptorSet &descriptorSceneData,
+                                               VkDescriptorSet &descriptorInstanceData,
+                                               VkDescriptorSet &descriptorMaterials,
+                                               VkDescriptorSet &descriptorTextures) const
 {
     vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
 
@@ -71,14 +135,6 @@ VkResult VulkanRendererGBuffer::renderOpaqueInstances(VkCommandBuffer &cmdBuf,
                             &descriptorSets[0],
                             0,
                             nullptr);
-
-    for (auto &meshGroup : instances.opaqueMeshes()) {
-        const VulkanMesh *vkmesh = static_cast<const VulkanMesh *>(meshGroup.first);
-        assert(vkmesh != nullptr);
-        renderMeshGroup(cmdBuf, vkmesh, meshGroup.second);
-    }
-
-    return VK_SUCCESS;
 }
 
 VkResult VulkanRendererGBuffer::renderMeshGroup(VkCommandBuffer &commandBuffer,
@@ -90,12 +146,17 @@ VkResult VulkanRendererGBuffer::renderMeshGroup(VkCommandBuffer &commandBuffer,
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
     vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer().buffer(), 0, mesh->indexType());
 
-    vkCmdDrawIndexed(commandBuffer,
-                     static_cast<uint32_t>(mesh->indices().size()),
-                     static_cast<uint32_t>(meshGroup.sceneObjects.size()),
-                     0,
-                     0,
-                     meshGroup.startIndex);
+    /* The visible instances are sorted by level of detail, one draw per level */
+    uint32_t firstInstance = meshGroup.startIndex;
+    for (uint32_t l = 0; l < mesh->nLODs(); l++) {
+        uint32_t instanceCount = meshGroup.lodVisibleCount[l];
+        if (instanceCount == 0)
+            continue;
+
+        Mesh::LOD lod = mesh->lod(l);
+        vkCmdDrawIndexed(commandBuffer, lod.nIndices, instanceCount, lod.firstIndex, 0, firstInstance);
+        firstInstance += instanceCount;
+    }
 
     return VK_SUCCESS;
 }
@@ -107,14 +168,19 @@ VkResult VulkanRendererGBuffer::createPipeline(const VulkanRenderPassDeferred &r
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo =
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader, "main");
+    vertShaderStageInfo.pSpecializationInfo = VulkanVertex::getSpecializationInfo();
     VkPipelineShaderStageCreateInfo fragShaderStageInfo =
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader, "main");
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = VulkanVertex::getBindingDescription();
-    auto attributeDescriptions = VulkanVertex::getAttributeDescriptionsFull();
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = vkinit::pipelineVertexInputStateCreateInfo(
-        1, &bindingDescription, static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {VulkanVertex::getBindingDescription(),
+                                                                          VulkanVertex::getBindingDescriptionInstance()};
+    auto attributeDescriptions = VulkanVertex::getAttributeDescriptionsInstanced();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo =
+        vkinit::pipelineVertexInputStateCreateInfo(static_cast<uint32_t>(bindingDescriptions.size()),
+                                                   bindingDescriptions.data(),
+                                                   static_cast<uint32_t>(attributeDescriptions.size()),
+                                                   attributeDescriptions.data());
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = vkinit::pipelineInputAssemblyCreateInfo();
 
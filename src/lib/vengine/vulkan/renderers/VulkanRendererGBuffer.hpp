@@ -5,6 +5,7 @@
 #include "vulkan/VulkanSceneObject.hpp"
 #include "vulkan/VulkanInstances.hpp"
 #include "vulkan/VulkanRenderPass.hpp"
+#include "vulkan/renderers/VulkanRendererCulling.hpp"
 
 namespace vengine
 {
@@ -27,13 +28,24 @@ public:
     const VkPipeline &graphicsPipeline() { return m_graphicsPipeline; }
     const VkPipelineLayout &pipelineLayout() { return m_pipelineLayout; }
 
+    /* Draw the visible instances of the opaque mesh groups, visibleInstances holds the InstancesManager::visibleInstances() */
     VkResult renderOpaqueInstances(VkCommandBuffer &cmdBuf,
                                    const VulkanInstancesManager &instances,
+                                   VkBuffer visibleInstances,
                                    VkDescriptorSet &descriptorSceneData,
                                    VkDescriptorSet &descriptorInstanceData,
                                    VkDescriptorSet &descriptorMaterials,
                                    VkDescriptorSet &descriptorTextures) const;
 
+    /* Draw the opaque mesh groups with the draw commands and the visible instances written by the culling compute pass */
+    VkResult renderOpaqueInstancesIndirect(VkCommandBuffer &cmdBuf,
+                                           const VulkanRendererCulling &culling,
+                                           uint32_t imageIndex,
+                                           VkDescriptorSet &descriptorSceneData,
+                                           VkDescriptorSet &descriptorInstanceData,
+                                           VkDescriptorSet &descriptorMaterials,
+                                           VkDescriptorSet &descriptorTextures) const;
+
 private:
     VulkanContext &m_ctx;
     VkExtent2D m_swapchainExtent;
@@ -47,6 +59,12 @@ private:
     /* Pipeline creation */
     VkResult createPipeline(const VulkanRenderPassDeferred &renderPass);
 
+    void bindDescriptorSets(VkCommandBuffer &cmdBuf,
+                            VkDescriptorSet &descriptorSceneData,
+                            VkDescriptorSet &descriptorInstanceData,
+                            VkDescriptorSet &descriptorMaterials,
+                            VkDescriptorSet &descriptorTextures) const;
+
     VkResult renderMeshGroup(VkCommandBuffer &commandBuffer,
                              const VulkanMesh *mesh,
                              const InstancesManager::MeshGroup &meshGoup) const;
@@ -2,6 +2,8 @@
 
 #include "Console.hpp"
 
+#include <limits>
+
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/quaternion.hpp>
 
@@ -24,9 +26,10 @@ VkResult VulkanRendererOverlay::initResources(VkDescriptorSetLayout cameraDescri
     AssetInfo arrowInfo = AssetInfo("assets/models/arrow.obj", AssetSource::ENGINE);
     Tree<ImportedModelNode> modelData = assimpLoadModel(arrowInfo);
     m_arrow = new VulkanModel3D(arrowInfo,
-                          modelData,
+                          std::move(modelData),
                           {m_ctx.physicalDevice(), m_ctx.device(), m_ctx.graphicsCommandPool(), m_ctx.queueManager().graphicsQueue()},
-                          false);
+                          false,
+                          true);
 
     m_IdX = static_cast<ID>(ReservedObjectID::TRANSFORM_ARROW_X);
     m_IdY = static_cast<ID>(ReservedObjectID::TRANSFORM_ARROW_Y);
@@ -73,17 +76,7 @@ VkResult VulkanRendererOverlay::render3DTransform(VkCommandBuffer &cmdBuf,
                                                   const glm::mat4 &modelMatrix,
                                                   const std::shared_ptr<Camera> &camera) const
 {
-    /* Get global transform position */
-    auto worldPos = getTranslation(modelMatrix);
-    auto cameraDistance = glm::distance(camera->transform().position(), worldPos);
-
-    /* Keep the same size for the transform on screen at all times */
-    float scale = 0.0155f;
-    scale *= cameraDistance;
-    if (camera->type() == CameraType::PERSPECTIVE) {
-        float fov = reinterpret_cast<PerspectiveCamera *>(camera.get())->fov();
-        scale *= fov / 60.0F;
-    }
+    std::array<glm::mat4, 3> arrowMatrices = transformArrowMatrices(modelMatrix, camera);
 
     vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline3DTransform);
 
@@ -102,19 +95,8 @@ VkResult VulkanRendererOverlay::render3DTransform(VkCommandBuffer &cmdBuf,
 
     PushBlockOverlayTransform3D pushConstants;
 
-    /* Calculate the unscaled version of the input model matrix, if scale is zero this will fail */
-    glm::mat4 modelMatrixUnscaled;
-    {
-        glm::vec3 scaleM, translation;
-        glm::quat rotation;
-        glm::vec3 skew;
-        glm::vec4 perspective;
-        glm::decompose(modelMatrix, scaleM, rotation, translation, skew, perspective);
-        modelMatrixUnscaled = glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation);
-    }
-
     /* Render Z arrow */
-    pushConstants.modelMatrix = glm::scale(modelMatrixUnscaled, {scale, scale, scale});
+    pushConstants.modelMatrix = arrowMatrices[0];
     pushConstants.color = glm::vec4(0, 0, 1, m_IdZ);
     vkCmdPushConstants(cmdBuf,
                        m_pipelineLayout3DTransform,
@@ -122,9 +104,9 @@ VkResult VulkanRendererOverlay::render3DTransform(VkCommandBuffer &cmdBuf,
                        0,
                        sizeof(PushBlockOverlayTransform3D),
                        &pushConstants);
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, 0);
     /* Render X arrow */
-    pushConstants.modelMatrix = glm::scale(glm::rotate(modelMatrixUnscaled, glm::radians(90.F), {0, 1, 0}), {scale, scale, scale});
+    pushConstants.modelMatrix = arrowMatrices[1];
     pushConstants.color = glm::vec4(1, 0, 0, m_IdX);
     vkCmdPushConstants(cmdBuf,
                        m_pipelineLayout3DTransform,
@@ -132,9 +114,9 @@ VkResult VulkanRendererOverlay::render3DTransform(VkCommandBuffer &cmdBuf,
                        0,
                        sizeof(PushBlockOverlayTransform3D),
                        &pushConstants);
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, 0);
     /* Render Y arrow */
-    pushConstants.modelMatrix = glm::scale(glm::rotate(modelMatrixUnscaled, glm::radians(-90.F), {1, 0, 0}), {scale, scale, scale});
+    pushConstants.modelMatrix = arrowMatrices[2];
     pushConstants.color = glm::vec4(0, 1, 0, m_IdY);
     vkCmdPushConstants(cmdBuf,
                        m_pipelineLayout3DTransform,
@@ -142,11 +124,70 @@ VkResult VulkanRendererOverlay::render3DTransform(VkCommandBuffer &cmdBuf,
                        0,
                        sizeof(PushBlockOverlayTransform3D),
                        &pushConstants);
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, 0);
 
     return VK_SUCCESS;
 }
 
+ID VulkanRendererOverlay::pick3DTransform(const Ray &ray,
+                                          const glm::mat4 &modelMatrix,
+                                          const std::shared_ptr<Camera> &camera,
+                                          ThreadPool &threadPool) const
+{
+    if (m_arrow == nullptr)
+        return 0;
+
+    const Mesh *arrow = m_arrow->mesh("Cone");
+    std::array<glm::mat4, 3> arrowMatrices = transformArrowMatrices(modelMatrix, camera);
+    std::array<ID, 3> ids = {m_IdZ, m_IdX, m_IdY};
+
+    /* Test the ray against the three arrows in their object space, and keep the closest hit */
+    ID id = 0;
+    float t = std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < 3; i++) {
+        glm::mat4 worldToObject = glm::inverse(arrowMatrices[i]);
+        Ray rayObject(glm::vec3(worldToObject * glm::vec4(ray.origin, 1.0F)),
+                      glm::vec3(worldToObject * glm::vec4(ray.direction, 0.0F)));
+        if (arrow->intersect(rayObject, t, t, threadPool)) {
+            id = ids[i];
+        }
+    }
+
+    return id;
+}
+
+std::array<glm::mat4, 3> VulkanRendererOverlay::transformArrowMatrices(const glm::mat4 &modelMatrix,
+                                                                      const std::shared_ptr<Camera> &camera) const
+{
+    /* Get global transform position */
+    auto worldPos = getTranslation(modelMatrix);
+    auto cameraDistance = glm::distance(camera->transform().position(), worldPos);
+
+    /* Keep the same size for the transform on screen at all times */
+    float scale = 0.0155f;
+    scale *= cameraDistance;
+    if (camera->type() == CameraType::PERSPECTIVE) {
+        float fov = reinterpret_cast<PerspectiveCamera *>(camera.get())->fov();
+        scale *= fov / 60.0F;
+    }
+
+    /* Calculate the unscaled version of the input model matrix, if scale is zero this will fail */
+    glm::mat4 modelMatrixUnscaled;
+    {
+        glm::vec3 scaleM, translation;
+        glm::quat rotation;
+        glm::vec3 skew;
+        glm::vec4 perspective;
+        glm::decompose(modelMatrix, scaleM, rotation, translation, skew, perspective);
+        modelMatrixUnscaled = glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation);
+    }
+
+    /* The arrow model points to Z, rotate it for X and Y */
+    return {glm::scale(modelMatrixUnscaled, {scale, scale, scale}),
+            glm::scale(glm::rotate(modelMatrixUnscaled, glm::radians(90.F), {0, 1, 0}), {scale, scale, scale}),
+            glm::scale(glm::rotate(modelMatrixUnscaled, glm::radians(-90.F), {1, 0, 0}), {scale, scale, scale})};
+}
+
 VkResult VulkanRendererOverlay::renderAABB3(VkCommandBuffer &cmdBuf,
                                             VkDescriptorSet &descriptorScene,
                                             const AABB3 &aabb,
@@ -213,7 +254,7 @@ VkResult VulkanRendererOverlay::renderOutline(VkCommandBuffer &cmdBuf,
                        0,
                        sizeof(PushBlockOverlayOutline),
                        &pushConstants);
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, 0);
 
     glm::vec3 worldPos = so->worldPosition();
     float cameraDistance = glm::distance(camera->transform().position(), worldPos);
@@ -238,7 +279,7 @@ VkResult VulkanRendererOverlay::renderOutline(VkCommandBuffer &cmdBuf,
                        0,
                        sizeof(PushBlockOverlayOutline),
                        &pushConstants);
-    vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(vkmesh->indices().size()), 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmdBuf, vkmesh->nIndices(), 1, 0, 0, 0);
 
     return VK_SUCCESS;
 }
@@ -370,6 +411,7 @@ VkResult VulkanRendererOverlay::createGraphicsPipelineOutline(const VulkanRender
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = vkinit::pipelineShaderStageCreateInfo(
         VK_SHADER_STAGE_VERTEX_BIT, VulkanShader::load(m_ctx.device(), "shaders/SPIRV/overlay/outline.vert.spv"), "main");
+    vertShaderStageInfo.pSpecializationInfo = VulkanVertex::getSpecializationInfo();
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = vkinit::pipelineShaderStageCreateInfo(
         VK_SHADER_STAGE_FRAGMENT_BIT, VulkanShader::load(m_ctx.device(), "shaders/SPIRV/overlay/outline.frag.spv"), "main");
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
@@ -1,8 +1,12 @@
 #ifndef __VulkanRendererOverlay_hpp__
 #define __VulkanRendererOverlay_hpp__
 
+#include <array>
+
 #include "core/Camera.hpp"
 #include "math/AABB.hpp"
+#include "math/Ray.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include "vulkan/VulkanSceneObject.hpp"
 #include "vulkan/VulkanFramebuffer.hpp"
@@ -35,6 +39,12 @@ public:
                                const glm::mat4 &modelMatrix,
                                const std::shared_ptr<Camera> &camera) const;
 
+    /* Find the arrow of the transform widget at a certain position that is hit by a ray in world space, 0 on a miss */
+    ID pick3DTransform(const Ray &ray,
+                       const glm::mat4 &modelMatrix,
+                       const std::shared_ptr<Camera> &camera,
+                       ThreadPool &threadPool) const;
+
     /* Draw an AABB */
     VkResult renderAABB3(VkCommandBuffer &cmdBuf,
                          VkDescriptorSet &descriptorScene,
@@ -60,6 +70,9 @@ private:
     VulkanModel3D *m_arrow = nullptr;
     ID m_IdX, m_IdY, m_IdZ;
 
+    /* Get the model matrices of the Z, X and Y arrows of the transform widget, scaled to keep the same size on screen */
+    std::array<glm::mat4, 3> transformArrowMatrices(const glm::mat4 &modelMatrix, const std::shared_ptr<Camera> &camera) const;
+
     VkResult createGraphicsPipeline3DTransform(const VulkanRenderPassOverlay &renderPass);
     VkResult createGraphicsPipelineAABB3(const VulkanRenderPassOverlay &renderPass);
     VkResult createGraphicsPipelineOutline(const VulkanRenderPassOverlay &renderPass);
@@ -25,6 +25,7 @@
 #include "vulkan/common/VulkanLimits.hpp"
 #include "vulkan/common/VulkanDeviceFunctions.hpp"
 #include "vulkan/resources/VulkanLight.hpp"
+#include "vulkan/resources/VulkanMesh.hpp"
 
 namespace vengine
 {
@@ -129,7 +130,7 @@ void VulkanRendererPathTracing::render()
     timer.Start();
 
     /* Get the scene objects */
-    SceneObjectVector sceneObjects = m_scene.getSceneObjectsFlat();
+    const SceneObjectVector &sceneObjects = m_scene.getSceneObjectsFlat();
     if (sceneObjects.size() == 0) {
         debug_tools::ConsoleWarning("Trying to render an empty scene");
         return;
@@ -689,6 +690,11 @@ VkResult VulkanRendererPathTracing::createRayTracingPipeline()
         }
     }
 
+    /* The hit shaders and the light sampling read the vertex buffers */
+    for (VkPipelineShaderStageCreateInfo &shaderStage : shaderStages) {
+        shaderStage.pSpecializationInfo = VulkanVertex::getSpecializationInfo();
+    }
+
     /* Spec only guarantees 1 level of "recursion". Check for that sad possibility here */
     if (m_rayTracingPipelineProperties.maxRayRecursionDepth <= 1) {
         throw std::runtime_error("VulkanRendererPathTracing::createRayTracingPipeline(): Device doesn't support ray recursion");
@@ -89,7 +89,7 @@ VkResult VulkanRendererSkybox::renderSkybox(VkCommandBuffer cmdBuf,
 
         vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 2, &descriptorSets[0], 0, nullptr);
 
-        vkCmdDrawIndexed(cmdBuf, static_cast<uint32_t>(m_cube->indices().size()), 1, 0, 0, 0);
+        vkCmdDrawIndexed(cmdBuf, m_cube->nIndices(), 1, 0, 0, 0);
     }
 
     return VK_SUCCESS;
@@ -376,7 +376,7 @@ VkResult VulkanRendererSkybox::createCubemap(VulkanTexture *inputImage, VulkanCu
             VkDeviceSize offsets[] = {0};
             vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
             vkCmdBindIndexBuffer(commandBuffer, m_cube->indexBuffer().buffer(), 0, m_cube->indexType());
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_cube->indices().size()), 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, m_cube->nIndices(), 1, 0, 0, 0);
 
             vkCmdEndRenderPass(commandBuffer);
 
@@ -791,7 +791,7 @@ VkResult VulkanRendererSkybox::createIrradianceMap(VulkanCubemap *inputMap, Vulk
             VkDeviceSize offsets[] = {0};
             vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
             vkCmdBindIndexBuffer(commandBuffer, m_cube->indexBuffer().buffer(), 0, m_cube->indexType());
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_cube->indices().size()), 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, m_cube->nIndices(), 1, 0, 0, 0);
 
             vkCmdEndRenderPass(commandBuffer);
 
@@ -1151,7 +1151,7 @@ VkResult VulkanRendererSkybox::createPrefilteredCubemap(VulkanCubemap *inputMap,
                 VkDeviceSize offsets[] = {0};
                 vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
                 vkCmdBindIndexBuffer(commandBuffer, m_cube->indexBuffer().buffer(), 0, m_cube->indexType());
-                vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_cube->indices().size()), 1, 0, 0, 0);
+                vkCmdDrawIndexed(commandBuffer, m_cube->nIndices(), 1, 0, 0, 0);
 
                 vkCmdEndRenderPass(commandBuffer);
 
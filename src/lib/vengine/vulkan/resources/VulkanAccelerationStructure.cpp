@@ -20,9 +20,7 @@ VkResult VulkanAccelerationStructure::initializeBottomLevelAcceslerationStructur
 
     auto devF = VulkanDeviceFunctions::getInstance().rayTracingPipeline();
 
-    const std::vector<Vertex> &vertices = mesh.vertices();
-    const std::vector<uint32_t> indices = mesh.indices();
-    uint32_t indexCount = static_cast<uint32_t>(indices.size());
+    uint32_t indexCount = mesh.nIndices();
 
     VkTransformMatrixKHR transformMatrix = {
         t[0][0], t[1][0], t[2][0], t[3][0], t[0][1], t[1][1], t[2][1], t[3][1], t[0][2], t[1][2], t[2][2], t[3][2]};
@@ -50,7 +48,7 @@ VkResult VulkanAccelerationStructure::initializeBottomLevelAcceslerationStructur
     transformBufferDeviceAddress.deviceAddress = getBufferDeviceAddress(vci.device, transformBuffer.buffer()).deviceAddress;
 
     std::vector<uint32_t> numTriangles = {indexCount / 3};
-    uint32_t maxVertex = static_cast<uint32_t>(vertices.size());
+    uint32_t maxVertex = mesh.nVertices();
 
     /* Specify an acceleration structure geometry for the mesh */
     VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
@@ -62,8 +60,8 @@ VkResult VulkanAccelerationStructure::initializeBottomLevelAcceslerationStructur
     accelerationStructureGeometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
     accelerationStructureGeometry.geometry.triangles.vertexData = vertexBufferDeviceAddress;
     accelerationStructureGeometry.geometry.triangles.maxVertex = maxVertex;
-    accelerationStructureGeometry.geometry.triangles.vertexStride = sizeof(Vertex);
-    accelerationStructureGeometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+    accelerationStructureGeometry.geometry.triangles.vertexStride = VulkanVertex::stride();
+    accelerationStructureGeometry.geometry.triangles.indexType = mesh.indexType();
     accelerationStructureGeometry.geometry.triangles.indexData = indexBufferDeviceAddress;
     accelerationStructureGeometry.geometry.triangles.transformData.deviceAddress = 0;
     accelerationStructureGeometry.geometry.triangles.transformData.hostAddress = nullptr;
@@ -1,28 +1,97 @@
 #include "VulkanMesh.hpp"
 
+#include <algorithm>
+#include <limits>
+
+#include <glm/gtc/packing.hpp>
+
 #include "math/Constants.hpp"
+#include "math/MathUtils.hpp"
 #include "vulkan/common/VulkanUtils.hpp"
 #include "vulkan/renderers/VulkanRendererPathTracing.hpp"
 
 namespace vengine
 {
 
+PackedVertex::PackedVertex(const Vertex &vertex)
+    : position(vertex.position)
+{
+    uv = glm::packHalf2x16(vertex.uv);
+    normal = glm::packSnorm2x16(octahedralEncode(vertex.normal));
+
+    float handedness = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0F ? -1.0F : 1.0F;
+    tangent = glm::packSnorm4x8(glm::vec4(octahedralEncode(vertex.tangent), handedness, 0.0F));
+}
+
+/* Upload the vertices in the layout of VulkanVertex. Packed vertices are written directly in the staging memory */
+static VkResult createMeshVertexBuffer(VulkanCommandInfo vci,
+                                       const std::vector<Vertex> &vertices,
+                                       VkBufferUsageFlags extraUsageFlags,
+                                       VulkanBuffer &outBuffer)
+{
+    if (!VULKAN_PACKED_VERTICES) {
+        return createVertexBuffer(vci, vertices.data(), sizeof(Vertex) * vertices.size(), extraUsageFlags, outBuffer);
+    }
+
+    auto writePacked = [&](void *data) {
+        PackedVertex *packedVertices = static_cast<PackedVertex *>(data);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            packedVertices[i] = PackedVertex(vertices[i]);
+        }
+    };
+    return createVertexBuffer(vci, sizeof(PackedVertex) * vertices.size(), writePacked, extraUsageFlags, outBuffer);
+}
+
+/* Upload the indices followed by the LOD indices, with 16 bits if the vertices fit, and return the index type. The indices are
+ * written directly in the staging memory */
+static VkIndexType createMeshIndexBuffer(VulkanCommandInfo vci,
+                                         const std::vector<uint32_t> &indices,
+                                         const std::vector<uint32_t> &lodIndices,
+                                         size_t nVertices,
+                                         VkBufferUsageFlags extraUsageFlags,
+                                         VulkanBuffer &outBuffer)
+{
+    size_t nIndices = indices.size() + lodIndices.size();
+    if (nVertices > std::numeric_limits<uint16_t>::max() + size_t(1)) {
+        auto write = [&](void *data) {
+            uint32_t *indices32 = static_cast<uint32_t *>(data);
+            std::copy(indices.begin(), indices.end(), indices32);
+            std::copy(lodIndices.begin(), lodIndices.end(), indices32 + indices.size());
+        };
+        createIndexBuffer(vci, sizeof(uint32_t) * nIndices, write, extraUsageFlags, outBuffer);
+        return VK_INDEX_TYPE_UINT32;
+    }
+
+    auto write = [&](void *data) {
+        uint16_t *indices16 = static_cast<uint16_t *>(data);
+        std::copy(indices.begin(), indices.end(), indices16);
+        std::copy(lodIndices.begin(), lodIndices.end(), indices16 + indices.size());
+    };
+    createIndexBuffer(vci, sizeof(uint16_t) * nIndices, write, extraUsageFlags, outBuffer);
+    return VK_INDEX_TYPE_UINT16;
+}
+
 VulkanMesh::VulkanMesh(const AssetInfo &info)
     : Mesh(info)
 {
 }
 
-VulkanMesh::VulkanMesh(const Mesh &mesh, VulkanCommandInfo vci, bool generateBLAS)
-    : Mesh(mesh)
+VulkanMesh::VulkanMesh(Mesh &&mesh, VulkanCommandInfo vci, bool generateBLAS, bool keepGeometry)
+    : Mesh(std::move(mesh))
 {
     VkBufferUsageFlags rayTracingUsageFlags = VulkanRendererPathTracing::getBufferUsageFlags();
 
-    createVertexBuffer(vci, m_vertices, rayTracingUsageFlags, m_vertexBuffer);
-    createIndexBuffer(vci, m_indices, rayTracingUsageFlags, m_indexBuffer);
+    createMeshVertexBuffer(vci, m_vertices, rayTracingUsageFlags, m_vertexBuffer);
+    /* The full mesh first, so that the acceleration structure and the path tracer only see level 0 */
+    m_indexType = createMeshIndexBuffer(vci, m_indices, m_lodIndices, m_vertices.size(), rayTracingUsageFlags, m_indexBuffer);
 
     if (generateBLAS) {
         m_blas.initializeBottomLevelAcceslerationStructure(vci, *this, glm::mat4(1.0F), true);
     }
+
+    if (!keepGeometry) {
+        releaseGeometry();
+    }
 }
 
 void VulkanMesh::destroy(VkDevice device)
@@ -49,10 +118,11 @@ VulkanCube::VulkanCube(const AssetInfo &info, VulkanCommandInfo vci, bool genera
 
     m_indices = {0, 1, 2, 2, 3, 0, 1, 5, 6, 6, 2, 1, 7, 6, 5, 5, 4, 7, 4, 0, 3, 3, 7, 4, 4, 5, 1, 1, 0, 4, 3, 2, 6, 6, 7, 3};
 
+    m_nVertices = static_cast<uint32_t>(m_vertices.size());
     m_nTriangles = static_cast<uint32_t>(m_indices.size()) / 3U;
 
-    createVertexBuffer(vci, m_vertices, {}, m_vertexBuffer);
-    createIndexBuffer(vci, m_indices, {}, m_indexBuffer);
+    createMeshVertexBuffer(vci, m_vertices, {}, m_vertexBuffer);
+    m_indexType = createMeshIndexBuffer(vci, m_indices, {}, m_vertices.size(), {}, m_indexBuffer);
 
     if (generateBLAS) {
         m_blas.initializeBottomLevelAcceslerationStructure(vci, *this, glm::mat4(1.0F), true);
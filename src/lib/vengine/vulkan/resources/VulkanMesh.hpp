@@ -1,6 +1,7 @@
 #ifndef __VulkanMesh_hpp__
 #define __VulkanMesh_hpp__
 
+#include <algorithm>
 #include <array>
 
 #include "core/Mesh.hpp"
@@ -12,20 +13,55 @@
 namespace vengine
 {
 
+/* Opt in with the VENGINE_PACKED_VERTICES build option, the vertex buffers of the meshes then hold PackedVertex */
+#ifdef VENGINE_PACKED_VERTICES
+static constexpr bool VULKAN_PACKED_VERTICES = true;
+#else
+static constexpr bool VULKAN_PACKED_VERTICES = false;
+#endif
+
+/* A GPU clone */
+/* A Vertex in 24 bytes. The color is dropped and the bitangent is rebuilt from the normal, the tangent and the handedness */
+struct PackedVertex {
+    glm::vec3 position;
+    uint32_t uv;      /* Half floats */
+    uint32_t normal;  /* Octahedral encoding, snorm 16 */
+    uint32_t tangent; /* R, G = octahedral encoding, B = handedness, A = unused, snorm 8 */
+
+    PackedVertex() = default;
+    PackedVertex(const Vertex &vertex);
+}; /* sizeof(PackedVertex) = 24 */
+
 class VulkanVertex
 {
 public:
+    /* Size of a vertex in the vertex buffers */
+    static constexpr uint32_t stride() { return VULKAN_PACKED_VERTICES ? sizeof(PackedVertex) : sizeof(Vertex); }
+
     static VkVertexInputBindingDescription getBindingDescription()
     {
         VkVertexInputBindingDescription bindingDescription{};
         bindingDescription.binding = 0; /* The buffers index to the buffers specified in vkCmdBindVertexBuffers */
-        bindingDescription.stride = sizeof(Vertex);
+        bindingDescription.stride = stride();
         bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
         return bindingDescription;
     }
 
+    /* Specializes the shaders that read vertices to the layout of the vertex buffers, constant 0 is VULKAN_PACKED_VERTICES */
+    static const VkSpecializationInfo *getSpecializationInfo()
+    {
+        static const VkBool32 packedVertices = VULKAN_PACKED_VERTICES;
+        static const VkSpecializationMapEntry mapEntry = {0, 0, sizeof(VkBool32)};
+        static const VkSpecializationInfo specializationInfo = {1, &mapEntry, sizeof(VkBool32), &packedVertices};
+        return &specializationInfo;
+    }
+
     static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptionsFull()
     {
+        if (VULKAN_PACKED_VERTICES) {
+            return getAttributeDescriptionsPacked();
+        }
+
         std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
         attributeDescriptions[0].binding = 0;
         attributeDescriptions[0].location = 0;
@@ -55,13 +91,72 @@ public:
         return attributeDescriptions;
     }
 
+    /* The vertex shaders decode the packed attributes. The bitangent is rebuilt by the shaders, location 4 reads the tangent */
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptionsPacked()
+    {
+        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, position);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, uv);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[2].offset = offsetof(PackedVertex, normal);
+
+        attributeDescriptions[3].binding = 0;
+        attributeDescriptions[3].location = 3;
+        attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_SNORM;
+        attributeDescriptions[3].offset = offsetof(PackedVertex, tangent);
+
+        attributeDescriptions[4].binding = 0;
+        attributeDescriptions[4].location = 4;
+        attributeDescriptions[4].format = VK_FORMAT_R8G8B8A8_SNORM;
+        attributeDescriptions[4].offset = offsetof(PackedVertex, tangent);
+
+        return attributeDescriptions;
+    }
+
+    /* Binding 1, one index into the InstanceData buffer per instance, read from the visible instances buffer */
+    static VkVertexInputBindingDescription getBindingDescriptionInstance()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(uint32_t);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescription;
+    }
+
+    /* The full vertex attributes and the InstanceData index at location 5 */
+    static std::array<VkVertexInputAttributeDescription, 6> getAttributeDescriptionsInstanced()
+    {
+        std::array<VkVertexInputAttributeDescription, 6> attributeDescriptions{};
+        auto vertexAttributes = getAttributeDescriptionsFull();
+        std::copy(vertexAttributes.begin(), vertexAttributes.end(), attributeDescriptions.begin());
+
+        attributeDescriptions[5].binding = 1;
+        attributeDescriptions[5].location = 5;
+        attributeDescriptions[5].format = VK_FORMAT_R32_UINT;
+        attributeDescriptions[5].offset = 0;
+
+        return attributeDescriptions;
+    }
+
     static std::array<VkVertexInputAttributeDescription, 1> getAttributeDescriptionsPos()
     {
         std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
         attributeDescriptions[0].binding = 0;
         attributeDescriptions[0].location = 0;
         attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        /* The position comes first in both layouts */
         attributeDescriptions[0].offset = offsetof(Vertex, position);
+        static_assert(offsetof(Vertex, position) == offsetof(PackedVertex, position));
 
         return attributeDescriptions;
     }
@@ -71,7 +166,15 @@ class VulkanMesh : public Mesh
 {
 public:
     VulkanMesh(const AssetInfo &info);
-    VulkanMesh(const Mesh &mesh, VulkanCommandInfo vci, bool generateBLAS);
+    /**
+     * @brief Take the geometry of a mesh and upload it
+     *
+     * @param mesh Moved from
+     * @param vci
+     * @param generateBLAS
+     * @param keepGeometry If false, the vertices and the indices are freed on the CPU after the upload
+     */
+    VulkanMesh(Mesh &&mesh, VulkanCommandInfo vci, bool generateBLAS, bool keepGeometry = false);
 
     void destroy(VkDevice device);
 
@@ -81,7 +184,10 @@ public:
     VulkanBuffer &indexBuffer() { return m_indexBuffer; }
     const VulkanBuffer &indexBuffer() const { return m_indexBuffer; }
 
-    VkIndexType indexType() const { return VK_INDEX_TYPE_UINT32; }
+    /* UINT16 if all vertices can be indexed with 16 bits, UINT32 otherwise */
+    VkIndexType indexType() const { return m_indexType; }
+    /* The size of an index in bytes */
+    uint32_t indexSize() const { return m_indexType == VK_INDEX_TYPE_UINT16 ? 2U : 4U; }
 
     VulkanAccelerationStructure &blas() { return m_blas; }
     const VulkanAccelerationStructure &blas() const { return m_blas; }
@@ -89,6 +195,7 @@ public:
 protected:
     VulkanBuffer m_vertexBuffer;
     VulkanBuffer m_indexBuffer;
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
     VulkanAccelerationStructure m_blas;
 };
 
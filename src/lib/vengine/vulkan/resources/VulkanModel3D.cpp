@@ -1,5 +1,6 @@
 #include "VulkanModel3D.hpp"
 
+#include "core/AssetManager.hpp"
 #include "VulkanMesh.hpp"
 
 namespace vengine
@@ -11,28 +12,35 @@ VulkanModel3D::VulkanModel3D(const AssetInfo &info)
 }
 
 VulkanModel3D::VulkanModel3D(const AssetInfo &info,
-                             const Tree<ImportedModelNode> &importedNodeTree,
+                             Tree<ImportedModelNode> &&importedNodeTree,
                              VulkanCommandInfo vci,
-                             bool generateBLAS)
+                             bool generateBLAS,
+                             bool keepGeometry)
     : Model3D(info)
 {
-    importNode(importedNodeTree, m_nodeTree, vci, generateBLAS, {});
+    importNode(importedNodeTree, m_nodeTree, vci, generateBLAS, keepGeometry, {});
 }
 
 VulkanModel3D::VulkanModel3D(const AssetInfo &info,
-                             const Tree<ImportedModelNode> &importedNodeTree,
+                             Tree<ImportedModelNode> &&importedNodeTree,
                              const std::vector<Material *> &materials,
                              VulkanCommandInfo vci,
-                             bool generateBLAS)
+                             bool generateBLAS,
+                             bool keepGeometry)
     : Model3D(info)
 {
-    importNode(importedNodeTree, m_nodeTree, vci, generateBLAS, materials);
+    importNode(importedNodeTree, m_nodeTree, vci, generateBLAS, keepGeometry, materials);
 }
 
 void VulkanModel3D::destroy(VkDevice device)
 {
+    auto &meshRegistry = AssetManager::getInstance().meshRegistry();
     std::function<void(VkDevice, Tree<Model3DNode> &)> destroyR = [&](VkDevice device, Tree<Model3DNode> &node) {
         for (auto &m : node.data().meshes) {
+            /* Shared meshes are destroyed with their last reference */
+            if (!meshRegistry.release(m))
+                continue;
+
             VulkanMesh *mesh = static_cast<VulkanMesh *>(m);
             mesh->destroy(device);
             delete mesh;
@@ -46,23 +54,29 @@ void VulkanModel3D::destroy(VkDevice device)
     destroyR(device, m_nodeTree);
 }
 
-void VulkanModel3D::importNode(const Tree<ImportedModelNode> &importedNodeTree,
+void VulkanModel3D::importNode(Tree<ImportedModelNode> &importedNodeTree,
                                Tree<Model3DNode> &nodeTree,
                                VulkanCommandInfo vci,
                                bool generateBLAS,
+                               bool keepGeometry,
                                const std::vector<Material *> &materials)
 {
     Model3DNode model3DNode;
     model3DNode.name = importedNodeTree.data().name;
     for (uint32_t i = 0; i < importedNodeTree.data().meshes.size(); i++) {
         auto &mesh = importedNodeTree.data().meshes[i];
+        std::string meshName = mesh.name();
         auto *mat = (materials.size() > 0 ? materials[importedNodeTree.data().materialIndices[i]] : nullptr);
 
-        auto vkmesh = new VulkanMesh(mesh, vci, generateBLAS);
-        vkmesh->m_model = this;
+        auto createMesh = [&]() -> Mesh * { return new VulkanMesh(std::move(mesh), vci, generateBLAS, keepGeometry); };
+        /* Meshes with acceleration structures are shared with the meshes of the same geometry imported before, in this or
+         * other models. The ones without stay with the model, so that they don't end up where an acceleration structure is
+         * needed. If the geometry is kept, meshes that released theirs are not shared. The mesh is moved from only if a new one
+         * is created */
+        Mesh *vkmesh = generateBLAS ? AssetManager::getInstance().meshRegistry().get(mesh, keepGeometry, createMesh) : createMesh();
 
         model3DNode.meshes.emplace_back(vkmesh);
-        m_meshes[mesh.name()] = vkmesh;
+        m_meshes[meshName] = vkmesh;
         model3DNode.materials.emplace_back(mat);
     }
     model3DNode.transform = importedNodeTree.data().transform;
@@ -70,7 +84,7 @@ void VulkanModel3D::importNode(const Tree<ImportedModelNode> &importedNodeTree,
     nodeTree.data() = model3DNode;
 
     for (uint32_t i = 0; i < importedNodeTree.childrenCount(); i++) {
-        importNode(importedNodeTree.child(i), m_nodeTree.add(), vci, generateBLAS, materials);
+        importNode(importedNodeTree.child(i), m_nodeTree.add(), vci, generateBLAS, keepGeometry, materials);
     }
 }
 
@@ -13,12 +13,19 @@ class VulkanModel3D : public Model3D
 {
 public:
     VulkanModel3D(const AssetInfo &info);
-    VulkanModel3D(const AssetInfo &info, const Tree<ImportedModelNode> &importedNodeTree, VulkanCommandInfo vci, bool generateBLAS);
+    /* The meshes are moved out of the imported tree, the ones with the same geometry as a mesh imported before are shared with
+     * it. Their vertices and indices are freed on the CPU after the upload, unless keepGeometry is set */
     VulkanModel3D(const AssetInfo &info,
-                  const Tree<ImportedModelNode> &importedNodeTree,
+                  Tree<ImportedModelNode> &&importedNodeTree,
+                  VulkanCommandInfo vci,
+                  bool generateBLAS,
+                  bool keepGeometry = false);
+    VulkanModel3D(const AssetInfo &info,
+                  Tree<ImportedModelNode> &&importedNodeTree,
                   const std::vector<Material *> &materials,
                   VulkanCommandInfo vci,
-                  bool generateBLAS);
+                  bool generateBLAS,
+                  bool keepGeometry = false);
 
     void destroy(VkDevice device);
 
@@ -33,11 +40,13 @@ private:
      * @param queue
      * @param commandPool
      * @param extraUsageFlags
+     * @param keepGeometry
      */
-    void importNode(const Tree<ImportedModelNode> &importedNodeTree,
+    void importNode(Tree<ImportedModelNode> &importedNodeTree,
                     Tree<Model3DNode> &nodeTree,
                     VulkanCommandInfo vci,
                     bool generateBLAS,
+                    bool keepGeometry,
                     const std::vector<Material *> &materials);
 };
 